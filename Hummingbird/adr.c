@@ -0,0 +1,189 @@
+/*
+ * adr.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "adr.h"
+
+/*
+Margin over the SNR limit to aim for, and how far under it the current
+settings may drift before they're given up on. The gap between the two is the
+hysteresis that keeps it from flapping on every report.
+*/
+static const uint8_t MARGIN_DB = 6;
+static const uint8_t MARGIN_SLACK_DB = 3;
+// more than this lost and the margin goes up by LOSS_STEP_DB
+static const uint8_t LOSS_TARGET_PERCENT = 10;
+static const uint8_t LOSS_STEP_DB = 2;
+static const uint8_t MAX_EXTRA_MARGIN_DB = 10;
+// only move for settings that are this much better, in percent
+static const uint8_t IMPROVEMENT_PERCENT = 25;
+
+// narrower bandwidths drift off frequency with the kite's crystal
+static const uint8_t MIN_BANDWIDTH = LORA_BW_125;
+static const uint8_t MAX_BANDWIDTH = LORA_BW_500;
+
+// 10^(dBm / 10) in tenths of a mW, from ADR_MIN_POWER_DBM up
+static const uint16_t POWER_TENTHS_MW[] = {
+    32, 40, 50, 63, 79, 100, 126, 158, 200, 251, 316, 398, 501, 631, 794, 1000,
+};
+
+void adr_reset(adr_state *adr) {
+  adr->running = false;
+  adr->extra_margin_db = 0;
+}
+
+void adr_limit(adr_state *adr, uint8_t length, uint32_t airtime_us) {
+  adr->limit_length = length;
+  adr->limit_us = airtime_us;
+}
+
+// a packet of the limit's length fits in it on modem with these instead
+static bool within_limit(const adr_state *adr, const lora_modem *modem,
+                         uint8_t spreading_factor, uint8_t bandwidth) {
+  if (adr->limit_us == 0) {
+    return true;
+  }
+  lora_modem settings = *modem;
+  settings.spreading_factor = spreading_factor;
+  settings.bandwidth = bandwidth;
+  return lora_airtime_us(&settings, adr->limit_length) <= adr->limit_us;
+}
+
+static uint32_t bit_rate(uint8_t spreading_factor, uint8_t bandwidth) {
+  lora_modem modem = LORA_MODEM_DEFAULT;
+  modem.spreading_factor = spreading_factor;
+  modem.bandwidth = bandwidth;
+  return lora_bit_rate(&modem);
+}
+
+static uint16_t power_tenths_mw(uint8_t power_dbm) {
+  return POWER_TENTHS_MW[power_dbm - ADR_MIN_POWER_DBM];
+}
+
+/*
+Lowest power at which spreading_factor and bandwidth have margin_db over the
+limit, going by an SNR measured with the current settings: 1 dB of SNR per
+dB of power, 3 dB per halving of the bandwidth. 0 if even full power won't
+do.
+*/
+static uint8_t power_needed(const adr_state *adr, int8_t snr,
+                            uint8_t spreading_factor, uint8_t bandwidth,
+                            uint8_t margin_db) {
+  int16_t wanted = lora_snr_limit(spreading_factor) + 4 * margin_db;
+  int16_t at_current = snr - 12 * ((int16_t)bandwidth - adr->bandwidth);
+  int16_t shortfall = wanted - at_current; // quarter dB
+  int16_t power = adr->power_dbm + (shortfall + 3 * (shortfall > 0)) / 4;
+  if (power < ADR_MIN_POWER_DBM) {
+    power = ADR_MIN_POWER_DBM;
+  }
+  return power > ADR_MAX_POWER_DBM ? 0 : (uint8_t)power;
+}
+
+// a better than b, in bits per second per mW
+static bool better(uint32_t rate_a, uint8_t power_a, uint32_t rate_b,
+                   uint8_t power_b, uint8_t percent) {
+  return (uint64_t)rate_a * power_tenths_mw(power_b) * 100 >
+         (uint64_t)rate_b * power_tenths_mw(power_a) * (100 + percent);
+}
+
+bool adr_update(adr_state *adr, const lora_modem *modem,
+                const adr_report *report) {
+  if (!adr->running) {
+    adr->running = true;
+    adr->spreading_factor = modem->spreading_factor;
+    adr->bandwidth = modem->bandwidth;
+    adr->power_dbm = ADR_MAX_POWER_DBM;
+  }
+
+  bool lossy = report->sent > 0 && (uint16_t)report->heard * 100 <
+                                       (uint16_t)report->sent *
+                                           (100 - LOSS_TARGET_PERCENT);
+  if (lossy) {
+    adr->extra_margin_db += LOSS_STEP_DB;
+    if (adr->extra_margin_db > MAX_EXTRA_MARGIN_DB) {
+      adr->extra_margin_db = MAX_EXTRA_MARGIN_DB;
+    }
+  } else if (adr->extra_margin_db > 0) {
+    adr->extra_margin_db--;
+  }
+  uint8_t margin = MARGIN_DB + adr->extra_margin_db;
+
+  // the most bits per mW that still has the full margin
+  uint8_t best_sf = LORA_MAX_SPREADING_FACTOR;
+  uint8_t best_bw = MIN_BANDWIDTH;
+  uint8_t best_power = ADR_MAX_POWER_DBM;
+  uint32_t best_rate = bit_rate(best_sf, best_bw);
+  bool found = false;
+  bool fallback = false; // the slowest within the limit, if nothing closes
+  for (uint8_t sf = LORA_MIN_SPREADING_FACTOR; sf <= LORA_MAX_SPREADING_FACTOR;
+       sf++) {
+    for (uint8_t bw = MIN_BANDWIDTH; bw <= MAX_BANDWIDTH; bw++) {
+      if (!within_limit(adr, modem, sf, bw)) {
+        continue;
+      }
+      uint32_t rate = bit_rate(sf, bw);
+      if (!found && (!fallback || rate < best_rate)) {
+        best_sf = sf;
+        best_bw = bw;
+        best_rate = rate;
+        fallback = true;
+      }
+      uint8_t power = power_needed(adr, report->snr, sf, bw, margin);
+      if (power == 0) {
+        continue;
+      }
+      // ties go to the faster one, it's on air for less time
+      if (!found || better(rate, power, best_rate, best_power, 0) ||
+          (!better(best_rate, best_power, rate, power, 0) &&
+           rate > best_rate)) {
+        best_sf = sf;
+        best_bw = bw;
+        best_power = power;
+        best_rate = rate;
+        found = true;
+      }
+    }
+  }
+
+  // keep what we have while it still closes, unless the best is well ahead
+  uint8_t keep_power = power_needed(adr, report->snr, adr->spreading_factor,
+                                    adr->bandwidth, margin - MARGIN_SLACK_DB);
+  bool holding = !lossy && keep_power != 0 && keep_power <= adr->power_dbm &&
+                 within_limit(adr, modem, adr->spreading_factor,
+                              adr->bandwidth);
+  if (holding && !better(best_rate, best_power,
+                         bit_rate(adr->spreading_factor, adr->bandwidth),
+                         adr->power_dbm, IMPROVEMENT_PERCENT)) {
+    return false;
+  }
+  if (best_sf == adr->spreading_factor && best_bw == adr->bandwidth &&
+      best_power == adr->power_dbm) {
+    return false;
+  }
+  adr->spreading_factor = best_sf;
+  adr->bandwidth = best_bw;
+  adr->power_dbm = best_power;
+  return true;
+}
+
+void adr_apply(const adr_state *adr, lora_modem *modem) {
+  modem->spreading_factor = adr->spreading_factor;
+  modem->bandwidth = adr->bandwidth;
+}
+
+void adr_report_pack(const adr_report *report, uint8_t *out) {
+  out[0] = (uint8_t)report->snr;
+  out[1] = (uint16_t)report->rssi_dbm & 0xff;
+  out[2] = (uint16_t)report->rssi_dbm >> 8;
+  out[3] = report->heard;
+  out[4] = report->sent;
+}
+
+void adr_report_unpack(adr_report *report, const uint8_t *in) {
+  report->snr = (int8_t)in[0];
+  report->rssi_dbm = (int16_t)(in[1] | in[2] << 8);
+  report->heard = in[3];
+  report->sent = in[4];
+}
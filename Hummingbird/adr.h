@@ -0,0 +1,81 @@
+/*
+ * adr.h
+ *
+ * Created: 10/19/2026
+ *
+ * Adaptive data rate. The ground sends link reports (the SNR and RSSI it
+ * sees from the kite and how many packets it heard) as uplink commands, and
+ * from each one the kite works out the spreading factor, bandwidth and TX
+ * power that get the most bits out per milliwatt while keeping a margin
+ * over the demodulator's SNR limit.
+ *
+ * The ground runs the same code on every report once it sees it
+ * acknowledged, so both ends switch together without announcing settings
+ * in every packet. Both start from the settings in use at full power on
+ * the first report after a reset, and both go back to LORA_MODEM_DEFAULT
+ * if they stop hearing each other (ADR_SILENCE_PACKETS, ADR_SILENCE_MS).
+ * Under a dwell limit both only pick settings a packet of a given length
+ * stays within it on, see adr_limit.
+ *
+ * No hardware dependencies, the ground side builds it to follow along.
+ */
+
+#ifndef ADR_H_
+#define ADR_H_
+
+#include "lora_modem.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ADR_MIN_POWER_DBM 5
+#define ADR_MAX_POWER_DBM 20
+
+// the ground sends a report every this many packets it hears
+#define ADR_REPORT_PACKETS 16
+// the kite gives up after sending this many packets without a command
+#define ADR_SILENCE_PACKETS 64
+// the ground gives up after hearing nothing for this long
+#define ADR_SILENCE_MS 120000
+
+typedef struct adr_report {
+  int8_t snr;       // quarter dB, mean of the packets heard
+  int16_t rssi_dbm; // mean of the packets heard
+  uint8_t heard;
+  uint8_t sent; // going by the packet numbers
+} adr_report;
+
+// packed for the uplink: [snr][rssi i16 LE][heard][sent]
+#define ADR_REPORT_PACKED 5
+
+typedef struct adr_state {
+  bool running;
+  uint8_t spreading_factor;
+  uint8_t bandwidth; // lora_bandwidth, 125 kHz and up
+  uint8_t power_dbm;
+  uint8_t extra_margin_db; // raised while packets go missing anyway
+  uint8_t limit_length; // a packet this long stays on air
+  uint32_t limit_us; // no longer than this, 0 for no limit
+} adr_state;
+
+void adr_reset(adr_state *adr);
+/*
+Only settings a packet of length bytes (RadioHead header included) stays on
+air for at most airtime_us on, 0 for no limit. Kept over adr_reset. With
+nothing that closes, it goes for the slowest settings within the limit
+rather than SF12 at 125 kHz.
+*/
+void adr_limit(adr_state *adr, uint8_t length, uint32_t airtime_us);
+/*
+Take a report. Starts from modem at full power if not running yet. Returns
+true if the settings changed, which the kite applies once the
+acknowledgement is out.
+*/
+bool adr_update(adr_state *adr, const lora_modem *modem,
+                const adr_report *report);
+// modem with the spreading factor and bandwidth adr picked
+void adr_apply(const adr_state *adr, lora_modem *modem);
+
+void adr_report_pack(const adr_report *report, uint8_t *out);
+void adr_report_unpack(adr_report *report, const uint8_t *in);
+
+#endif /* ADR_H_ */
@@ -0,0 +1,72 @@
+/*
+ * airtime_budget.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "airtime_budget.h"
+
+void airtime_budget_init(airtime_budget *budget, uint16_t duty_permille,
+                         uint32_t burst_us, uint32_t dwell_us,
+                         uint32_t now_ms) {
+  budget->duty_permille = duty_permille;
+  budget->burst_us = burst_us;
+  budget->dwell_us = dwell_us;
+  budget->tokens_us = burst_us;
+  budget->updated_ms = now_ms;
+  budget->spent_us = 0;
+  budget->deferred = 0;
+}
+
+// duty_permille us of airtime for every ms that goes by
+static void refill(airtime_budget *budget, uint32_t now_ms) {
+  int32_t elapsed = (int32_t)(now_ms - budget->updated_ms);
+  if (elapsed <= 0) {
+    return;
+  }
+  uint64_t tokens =
+      budget->tokens_us + (uint64_t)elapsed * budget->duty_permille;
+  budget->tokens_us =
+      tokens > budget->burst_us ? budget->burst_us : (uint32_t)tokens;
+  budget->updated_ms = now_ms;
+}
+
+uint32_t airtime_budget_available_us(airtime_budget *budget, uint32_t now_ms) {
+  refill(budget, now_ms);
+  if (budget->dwell_us != 0 && budget->tokens_us > budget->dwell_us) {
+    return budget->dwell_us;
+  }
+  return budget->tokens_us;
+}
+
+uint32_t airtime_budget_max_us(const airtime_budget *budget) {
+  if (budget->dwell_us != 0 && budget->dwell_us < budget->burst_us) {
+    return budget->dwell_us;
+  }
+  return budget->burst_us;
+}
+
+uint32_t airtime_budget_wait_ms(airtime_budget *budget, uint32_t now_ms,
+                                uint32_t airtime_us) {
+  if (airtime_us > airtime_budget_max_us(budget) ||
+      budget->duty_permille == 0) {
+    return UINT32_MAX;
+  }
+  refill(budget, now_ms);
+  if (budget->tokens_us >= airtime_us) {
+    return 0;
+  }
+  uint32_t missing = airtime_us - budget->tokens_us;
+  uint32_t wait = (missing + budget->duty_permille - 1) / budget->duty_permille;
+  // spent from a time still ahead of now, nothing comes in before that
+  int32_t ahead = (int32_t)(budget->updated_ms - now_ms);
+  return ahead > 0 ? wait + ahead : wait;
+}
+
+void airtime_budget_spend(airtime_budget *budget, uint32_t now_ms,
+                          uint32_t airtime_us) {
+  refill(budget, now_ms);
+  budget->tokens_us =
+      airtime_us > budget->tokens_us ? 0 : budget->tokens_us - airtime_us;
+  budget->spent_us += airtime_us;
+}
@@ -0,0 +1,50 @@
+/*
+ * airtime_budget.h
+ *
+ * Created: 10/19/2026
+ *
+ * Token bucket for time on air. Tokens are microseconds of airtime and come
+ * in at the duty cycle (100 per mille is 100 us every ms), up to burst_us
+ * saved. A packet takes its exact airtime (lora_airtime_us) out. dwell_us
+ * caps any single packet, for rules like FCC 15.247's 400 ms per channel.
+ *
+ * The budget knows nothing of channels. telemetry.c keeps one for all of
+ * them, hopping included, which holds the duty cycle on every channel and
+ * on all of them together, more than hopping needs. Nothing hardware
+ * specific, the simulator checks the radio against the same numbers.
+ */
+
+#ifndef AIRTIME_BUDGET_H_
+#define AIRTIME_BUDGET_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct airtime_budget {
+  uint16_t duty_permille;
+  uint32_t burst_us;
+  uint32_t dwell_us; // 0 for no limit
+  uint32_t tokens_us;
+  uint32_t updated_ms;
+
+  uint64_t spent_us;
+  uint32_t deferred; // packets that had to wait for tokens
+} airtime_budget;
+
+// starts out full
+void airtime_budget_init(airtime_budget *budget, uint16_t duty_permille,
+                         uint32_t burst_us, uint32_t dwell_us, uint32_t now_ms);
+// the longest packet allowed right now
+uint32_t airtime_budget_available_us(airtime_budget *budget, uint32_t now_ms);
+// the longest packet ever allowed, the burst or the dwell limit
+uint32_t airtime_budget_max_us(const airtime_budget *budget);
+/*
+How long until a packet of airtime_us fits, 0 if it does now, UINT32_MAX if
+it never will (longer than the burst or the dwell limit)
+*/
+uint32_t airtime_budget_wait_ms(airtime_budget *budget, uint32_t now_ms,
+                                uint32_t airtime_us);
+void airtime_budget_spend(airtime_budget *budget, uint32_t now_ms,
+                          uint32_t airtime_us);
+
+#endif /* AIRTIME_BUDGET_H_ */
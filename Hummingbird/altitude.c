@@ -0,0 +1,115 @@
+/*
+ * altitude.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "altitude.h"
+
+#define TABLE_BASE_PA 30000
+#define TABLE_STEP_SHIFT 9 // 512 Pa between entries
+#define TABLE_SIZE 158
+
+/*
+44330 * (1 - (p / 101325) ^ (1 / 5.255)) in cm, for
+p = TABLE_BASE_PA + 512 * i
+*/
+static const int32_t ALTITUDE_CM[TABLE_SIZE] = {
+    916516, 905173, 893984, 882943, 872047, 861290, 850670, 840182,
+    829822, 819588, 809475, 799482, 789604, 779838, 770183, 760634,
+    751190, 741848, 732606, 723460, 714410, 705452, 696585, 687807,
+    679116, 670509, 661985, 653542, 645179, 636894, 628685, 620550,
+    612489, 604500, 596581, 588730, 580948, 573231, 565580, 557993,
+    550468, 543005, 535603, 528259, 520974, 513747, 506575, 499459,
+    492397, 485389, 478433, 471529, 464676, 457873, 451118, 444413,
+    437755, 431143, 424578, 418059, 411584, 405153, 398766, 392421,
+    386118, 379857, 373637, 367457, 361317, 355216, 349153, 343129,
+    337142, 331192, 325279, 319402, 313560, 307753, 301981, 296242,
+    290538, 284867, 279228, 273622, 268048, 262506, 256994, 251514,
+    246064, 240643, 235253, 229892, 224559, 219256, 213980, 208733,
+    203513, 198320, 193155, 188016, 182903, 177816, 172755, 167720,
+    162709, 157724, 152763, 147827, 142914, 138026, 133161, 128319,
+    123500, 118705, 113931, 109180, 104452, 99745, 95060, 90396,
+    85753, 81131, 76531, 71950, 67391, 62851, 58331, 53831,
+    49351, 44890, 40448, 36026, 31622, 27237, 22870, 18522,
+    14191, 9879, 5585, 1308, -2951, -7193, -11418, -15626,
+    -19817, -23991, -28148, -32290, -36415, -40523, -44616, -48693,
+    -52754, -56800, -60830, -64845, -68844, -72829,
+};
+
+/*
+The kite gets thrown around a fair bit, the process noise is how hard (in
+m/s^2) we expect it to be accelerated between samples. The measurement noise
+is the BMP388 at x1 oversampling plus gusts on the static port.
+*/
+static const float ACCELERATION_NOISE = 0.5f; // m/s^2
+static const float MEASUREMENT_NOISE = 0.5f;  // m
+// where to start the covariance, we don't know anything yet
+static const float INITIAL_SPEED_VARIANCE = 25.0f; // (m/s)^2
+
+static bool ready;
+static uint32_t last_ms;
+static float altitude; // m
+static float speed;    // m/s
+static float p00, p01, p11; // covariance, symmetric
+
+int32_t altitude_from_pressure_cm(uint32_t pressure) {
+  const uint32_t base = (uint32_t)TABLE_BASE_PA << ALTITUDE_PRESSURE_SHIFT;
+  const uint8_t shift = TABLE_STEP_SHIFT + ALTITUDE_PRESSURE_SHIFT;
+  if (pressure <= base) {
+    return ALTITUDE_CM[0];
+  }
+  uint32_t offset = pressure - base;
+  uint32_t index = offset >> shift;
+  if (index >= TABLE_SIZE - 1) {
+    return ALTITUDE_CM[TABLE_SIZE - 1];
+  }
+  uint32_t fraction = offset & ((1ul << shift) - 1);
+  // neighbouring entries are at most 114 m apart, so this fits in 32 bits
+  int32_t difference = ALTITUDE_CM[index + 1] - ALTITUDE_CM[index];
+  return ALTITUDE_CM[index] + (difference * (int32_t)fraction >> shift);
+}
+
+void altitude_filter_init(void) { ready = false; }
+
+void altitude_filter_update(int32_t altitude_cm, uint32_t now_ms) {
+  float measured = altitude_cm / 100.0f;
+  if (!ready) {
+    altitude = measured;
+    speed = 0;
+    p00 = MEASUREMENT_NOISE * MEASUREMENT_NOISE;
+    p01 = 0;
+    p11 = INITIAL_SPEED_VARIANCE;
+    last_ms = now_ms;
+    ready = true;
+    return;
+  }
+
+  float dt = (now_ms - last_ms) / 1000.0f;
+  last_ms = now_ms;
+
+  // predict, constant velocity with white acceleration noise
+  altitude += speed * dt;
+  float q = ACCELERATION_NOISE * ACCELERATION_NOISE;
+  float dt2 = dt * dt;
+  p00 += dt * (2 * p01 + dt * p11) + q * dt2 * dt2 / 4;
+  p01 += dt * p11 + q * dt2 * dt / 2;
+  p11 += q * dt2;
+
+  // update with the measured altitude
+  float s = p00 + MEASUREMENT_NOISE * MEASUREMENT_NOISE;
+  float k0 = p00 / s;
+  float k1 = p01 / s;
+  float innovation = measured - altitude;
+  altitude += k0 * innovation;
+  speed += k1 * innovation;
+  p11 -= k1 * p01;
+  p01 -= k1 * p00;
+  p00 -= k0 * p00;
+}
+
+bool altitude_filter_ready(void) { return ready; }
+
+float altitude_filter_m(void) { return altitude; }
+
+float altitude_filter_vertical_speed_ms(void) { return speed; }
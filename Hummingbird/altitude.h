@@ -0,0 +1,32 @@
+/*
+ * altitude.h
+ *
+ * Created: 10/19/2026
+ *
+ * Barometric altitude without powf: a table of standard atmosphere heights
+ * every 512 Pa with linear interpolation in between (within 2 cm near the
+ * ground, 20 cm at 9 km), and a two state Kalman filter over it for altitude
+ * and vertical speed.
+ */
+
+#ifndef ALTITUDE_H_
+#define ALTITUDE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// pressure in 1/256 Pa, covers 30 kPa to 110 kPa (clamped outside of that)
+#define ALTITUDE_PRESSURE_SHIFT 8
+
+// standard atmosphere altitude in cm for a pressure in 1/256 Pa
+int32_t altitude_from_pressure_cm(uint32_t pressure);
+
+void altitude_filter_init(void);
+// feed an altitude from altitude_from_pressure_cm measured at now_ms
+void altitude_filter_update(int32_t altitude_cm, uint32_t now_ms);
+
+bool altitude_filter_ready(void); // had at least one measurement
+float altitude_filter_m(void);
+float altitude_filter_vertical_speed_ms(void); // up is positive
+
+#endif /* ALTITUDE_H_ */
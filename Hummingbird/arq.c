@@ -0,0 +1,211 @@
+/*
+ * arq.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "arq.h"
+#include "crc.h"
+#include <string.h>
+
+static crc_t segment_crc(const uint8_t *packet, uint8_t length) {
+  crc_t crc = crc_init();
+  crc = crc_update(crc, packet, length);
+  return crc_finalize(crc);
+}
+
+uint16_t arq_segments(uint32_t length, uint8_t segment_bytes) {
+  // always at least one, so even nothing gets acknowledged as arrived
+  if (length == 0) {
+    return 1;
+  }
+  return (uint16_t)((length + segment_bytes - 1) / segment_bytes);
+}
+
+uint8_t arq_segment_encode(const arq_segment *segment, uint8_t *out) {
+  out[0] = segment->device_id;
+  out[1] = segment->transfer;
+  out[2] = segment->segment_bytes;
+  out[3] = segment->sequence & 0xff;
+  out[4] = segment->sequence >> 8;
+  out[5] = segment->segments & 0xff;
+  out[6] = segment->segments >> 8;
+  memcpy(out + ARQ_SEGMENT_HEADER, segment->data, segment->length);
+  uint8_t length = ARQ_SEGMENT_HEADER + segment->length;
+  out[length] = segment_crc(out, length);
+  return length + 1;
+}
+
+bool arq_segment_parse(const uint8_t *packet, uint8_t length,
+                       arq_segment *segment) {
+  if (length < ARQ_SEGMENT_OVERHEAD ||
+      segment_crc(packet, length - 1) != packet[length - 1]) {
+    return false;
+  }
+  segment->device_id = packet[0];
+  segment->transfer = packet[1];
+  segment->segment_bytes = packet[2];
+  segment->sequence = packet[3] | packet[4] << 8;
+  segment->segments = packet[5] | packet[6] << 8;
+  segment->data = packet + ARQ_SEGMENT_HEADER;
+  segment->length = length - ARQ_SEGMENT_OVERHEAD;
+  return segment->segment_bytes > 0 &&
+         segment->length <= segment->segment_bytes &&
+         segment->sequence < segment->segments;
+}
+
+void arq_ack_pack(const arq_ack *ack, uint8_t *out) {
+  out[0] = ack->transfer;
+  out[1] = ack->cumulative & 0xff;
+  out[2] = ack->cumulative >> 8;
+  for (uint8_t i = 0; i < 4; i++) {
+    out[3 + i] = (ack->bitmap >> (8 * i)) & 0xff;
+  }
+}
+
+void arq_ack_unpack(arq_ack *ack, const uint8_t *in) {
+  ack->transfer = in[0];
+  ack->cumulative = in[1] | in[2] << 8;
+  ack->bitmap = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    ack->bitmap |= (uint32_t)in[3 + i] << (8 * i);
+  }
+}
+
+void arq_sender_begin(arq_sender *sender, uint8_t transfer,
+                      uint8_t segment_bytes, uint32_t length,
+                      uint32_t timeout_ms) {
+  memset(sender, 0, sizeof(*sender));
+  sender->transfer = transfer;
+  sender->segment_bytes = segment_bytes;
+  sender->segments = arq_segments(length, segment_bytes);
+  sender->timeout_ms = timeout_ms;
+}
+
+bool arq_sender_done(const arq_sender *sender) {
+  return sender->base == sender->segments;
+}
+
+static bool acknowledged(const arq_sender *sender, uint16_t sequence) {
+  return (sender->acknowledged >> (sequence - sender->base)) & 1;
+}
+
+static bool timed_out(const arq_sender *sender, uint16_t sequence,
+                      uint32_t now_ms) {
+  return now_ms - sender->sent_ms[sequence % ARQ_WINDOW] >= sender->timeout_ms;
+}
+
+bool arq_sender_next(const arq_sender *sender, uint32_t now_ms,
+                     uint16_t *sequence) {
+  for (uint16_t s = sender->base; s != sender->next; s++) {
+    if (!acknowledged(sender, s) && timed_out(sender, s, now_ms)) {
+      *sequence = s;
+      return true;
+    }
+  }
+  if (sender->next < sender->segments &&
+      sender->next - sender->base < ARQ_WINDOW) {
+    *sequence = sender->next;
+    return true;
+  }
+  return false;
+}
+
+void arq_sender_sent(arq_sender *sender, uint16_t sequence, uint32_t now_ms) {
+  sender->sent_ms[sequence % ARQ_WINDOW] = now_ms;
+  sender->sent++;
+  if (sequence == sender->next) {
+    sender->next++;
+  } else {
+    sender->retransmissions++;
+  }
+}
+
+void arq_sender_ack(arq_sender *sender, const arq_ack *ack) {
+  if (ack->transfer != sender->transfer || ack->cumulative > sender->next) {
+    return;
+  }
+  for (uint16_t s = sender->base; s != sender->next; s++) {
+    bool arrived = s < ack->cumulative;
+    if (s > ack->cumulative && s - ack->cumulative - 1 < 32) {
+      arrived = (ack->bitmap >> (s - ack->cumulative - 1)) & 1;
+    }
+    if (arrived) {
+      sender->acknowledged |= 1ul << (s - sender->base);
+    }
+  }
+  while (sender->base != sender->next && (sender->acknowledged & 1)) {
+    sender->acknowledged >>= 1;
+    sender->base++;
+  }
+}
+
+uint32_t arq_sender_wait_ms(const arq_sender *sender, uint32_t now_ms) {
+  uint16_t sequence;
+  if (arq_sender_next(sender, now_ms, &sequence)) {
+    return 0;
+  }
+  uint32_t wait = UINT32_MAX;
+  for (uint16_t s = sender->base; s != sender->next; s++) {
+    if (acknowledged(sender, s)) {
+      continue;
+    }
+    uint32_t left =
+        sender->timeout_ms - (now_ms - sender->sent_ms[s % ARQ_WINDOW]);
+    if (left < wait) {
+      wait = left;
+    }
+  }
+  return wait;
+}
+
+void arq_receiver_begin(arq_receiver *receiver, uint8_t transfer) {
+  memset(receiver, 0, sizeof(*receiver));
+  receiver->transfer = transfer;
+}
+
+bool arq_receiver_segment(arq_receiver *receiver, const arq_segment *segment) {
+  if (segment->transfer != receiver->transfer) {
+    return false;
+  }
+  receiver->segment_bytes = segment->segment_bytes;
+  receiver->segments = segment->segments;
+  uint16_t sequence = segment->sequence;
+  if (sequence < receiver->cumulative) {
+    receiver->duplicates++;
+    return false;
+  }
+  if (sequence > receiver->cumulative) {
+    uint16_t bit = sequence - receiver->cumulative - 1;
+    if (bit >= 32) {
+      return false; // past the window, it'll come again
+    }
+    if ((receiver->bitmap >> bit) & 1) {
+      receiver->duplicates++;
+      return false;
+    }
+    receiver->bitmap |= 1ul << bit;
+    receiver->received++;
+    return true;
+  }
+
+  // the one holding everything up, and whatever was waiting behind it
+  receiver->cumulative++;
+  while (receiver->bitmap & 1) {
+    receiver->bitmap >>= 1;
+    receiver->cumulative++;
+  }
+  receiver->bitmap >>= 1;
+  receiver->received++;
+  return true;
+}
+
+void arq_receiver_ack(const arq_receiver *receiver, arq_ack *ack) {
+  ack->transfer = receiver->transfer;
+  ack->cumulative = receiver->cumulative;
+  ack->bitmap = receiver->bitmap;
+}
+
+bool arq_receiver_done(const arq_receiver *receiver) {
+  return receiver->segments > 0 && receiver->cumulative == receiver->segments;
+}
@@ -0,0 +1,121 @@
+/*
+ * arq.h
+ *
+ * Created: 10/19/2026
+ *
+ * Selective repeat ARQ for getting bulk data, like the flash log, off the
+ * kite over the radio reliably. The data is cut into segments of up to
+ * ARQ_MAX_SEGMENT_BYTES, as long as the modem settings allow, numbered from
+ * 0 and sent with ARQ_SEGMENT_FLAG in the RadioHead header flags:
+ *
+ *   [device id][transfer id][segment bytes][sequence u16][segments u16]
+ *   [data...][crc8]
+ *
+ * Segment sequence goes at sequence * segment bytes, only the last one is
+ * shorter.
+ *
+ * The receiver answers with an acknowledgement (an UPLINK_TRANSFER_ACK
+ * command) saying which it has: every segment before cumulative, and a
+ * bitmap of the ARQ_WINDOW after it. The sender keeps at most ARQ_WINDOW
+ * segments past the oldest unacknowledged one in flight, and sends a segment
+ * again once timeout_ms goes by without it being acknowledged, oldest
+ * first. Acknowledgements only ever say what has arrived, so losing one
+ * costs nothing as long as a later one gets through.
+ *
+ * The receiver only answers segments with ARQ_POLL_FLAG as well, so a fast
+ * link can send a burst of them and be acknowledged once at the end.
+ *
+ * Plain C with no hardware dependencies, the ground side builds it too.
+ */
+
+#ifndef ARQ_H_
+#define ARQ_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ARQ_WINDOW 32
+#define ARQ_MAX_SEGMENT_BYTES 192
+// RadioHead header flag bit, next to FEC_REPAIR_FLAG
+#define ARQ_SEGMENT_FLAG 0x02
+#define ARQ_POLL_FLAG 0x04
+#define ARQ_SEGMENT_HEADER 7
+#define ARQ_SEGMENT_OVERHEAD (ARQ_SEGMENT_HEADER + 1)
+#define ARQ_ACK_PACKED 7
+
+typedef struct arq_segment {
+  uint8_t device_id;
+  uint8_t transfer;
+  uint8_t segment_bytes;
+  uint16_t sequence;
+  uint16_t segments;
+  const uint8_t *data;
+  uint8_t length;
+} arq_segment;
+
+typedef struct arq_ack {
+  uint8_t transfer;
+  uint16_t cumulative; // every segment before this has arrived
+  uint32_t bitmap; // bit i: cumulative + 1 + i has arrived
+} arq_ack;
+
+typedef struct arq_sender {
+  uint8_t transfer;
+  uint8_t segment_bytes;
+  uint16_t segments;
+  uint16_t base; // oldest not acknowledged
+  uint16_t next; // first never sent
+  uint32_t acknowledged; // bit i: base + i
+  uint32_t sent_ms[ARQ_WINDOW]; // by sequence % ARQ_WINDOW
+  uint32_t timeout_ms;
+
+  uint32_t sent;
+  uint32_t retransmissions;
+} arq_sender;
+
+typedef struct arq_receiver {
+  uint8_t transfer;
+  uint8_t segment_bytes; // these two are 0 until the first segment
+  uint16_t segments;
+  uint16_t cumulative;
+  uint32_t bitmap;
+
+  uint32_t received;
+  uint32_t duplicates;
+} arq_receiver;
+
+// segments covering length bytes, at least one even for nothing
+uint16_t arq_segments(uint32_t length, uint8_t segment_bytes);
+
+uint8_t arq_segment_encode(const arq_segment *segment, uint8_t *out);
+// false if it's damaged or not a segment
+bool arq_segment_parse(const uint8_t *packet, uint8_t length,
+                       arq_segment *segment);
+void arq_ack_pack(const arq_ack *ack, uint8_t *out);
+void arq_ack_unpack(arq_ack *ack, const uint8_t *in);
+
+void arq_sender_begin(arq_sender *sender, uint8_t transfer,
+                      uint8_t segment_bytes, uint32_t length,
+                      uint32_t timeout_ms);
+bool arq_sender_done(const arq_sender *sender);
+/*
+The segment to send now: the oldest whose timer ran out, or else a new one if
+the window has room. Returns false if there's nothing to send yet.
+*/
+bool arq_sender_next(const arq_sender *sender, uint32_t now_ms,
+                     uint16_t *sequence);
+void arq_sender_sent(arq_sender *sender, uint16_t sequence, uint32_t now_ms);
+void arq_sender_ack(arq_sender *sender, const arq_ack *ack);
+// until arq_sender_next will have something, UINT32_MAX if that's up to acks
+uint32_t arq_sender_wait_ms(const arq_sender *sender, uint32_t now_ms);
+
+void arq_receiver_begin(arq_receiver *receiver, uint8_t transfer);
+/*
+Returns true if it's a segment of this transfer not seen before, to be
+stored at sequence * segment bytes
+*/
+bool arq_receiver_segment(arq_receiver *receiver, const arq_segment *segment);
+void arq_receiver_ack(const arq_receiver *receiver, arq_ack *ack);
+bool arq_receiver_done(const arq_receiver *receiver);
+
+#endif /* ARQ_H_ */
@@ -15,7 +15,7 @@
 
 static uint8_t bmp388_read_register(uint8_t address);
 static void bmp388_read_registers(uint8_t address, uint8_t *data,
-                                  uint8_t length);
+                                  uint16_t length);
 static void bmp388_write_register(uint8_t address, uint8_t value);
 static void load_calibration();
 
@@ -25,19 +25,44 @@ static void enable_and_set_mode(bool pressure, bool temperature,
 
 static double parse_temperature(uint8_t data_3, uint8_t data_4, uint8_t data_5);
 static double parse_pressure(uint8_t data_0, uint8_t data_1, uint8_t data_2);
+inline static uint16_t byte_concat(uint8_t msb, uint8_t lsb);
 
 static const uint8_t READ_MASK = 0x80; // Set bit 7 high for read
 
 static const uint8_t BMP388_REG_CHIP_ID = 0x00;
+static const uint8_t BMP388_REG_ERR = 0x02;
 static const uint8_t BMP388_REG_STATUS = 0x03;
 static const uint8_t BMP388_REG_DATA = 0x04;
+static const uint8_t BMP388_REG_FIFO_LENGTH = 0x12;
+static const uint8_t BMP388_REG_FIFO_DATA = 0x14;
+static const uint8_t BMP388_REG_FIFO_CONFIG_1 = 0x17;
+static const uint8_t BMP388_REG_FIFO_CONFIG_2 = 0x18;
 static const uint8_t BMP388_REG_PWR_CTRL = 0x1B;
+static const uint8_t BMP388_REG_OSR = 0x1C;
+static const uint8_t BMP388_REG_ODR = 0x1D;
 static const uint8_t BMP388_REG_CALIBRATION = 0x31;
 static const uint8_t BMP388_REG_CMD = 0x7E;
 
+static const uint8_t BMP388_CMD_FIFO_FLUSH = 0xB0;
 static const uint8_t BMP388_CMD_RESET = 0xB6;
 
+static const uint8_t ERR_CONF = 0x04;
+// fifo_mode, fifo_press_en and fifo_temp_en, oldest dropped when full
+static const uint8_t FIFO_PRESSURE_AND_TEMPERATURE = 0x19;
+static const uint8_t FIFO_FRAME_SENSOR = 0x80;
+static const uint8_t FIFO_FRAME_TEMPERATURE = 0x10;
+static const uint8_t FIFO_FRAME_PRESSURE = 0x04;
+static const uint8_t FIFO_FRAME_CONFIG_CHANGE = 0x48;
+static const uint8_t FIFO_FRAME_CONFIG_ERROR = 0x44;
+static const uint8_t FIFO_FRAME_SENSORTIME = 0xA0;
+// a frame with both in, and how many fit in one burst
+#define FIFO_FRAME_LENGTH 7
+#define FIFO_BURST_FRAMES 36
+
 static struct io_descriptor *io;
+// forced readings' oversampling, put back when the FIFO stops
+static uint8_t forced_osr;
+static uint8_t forced_odr;
 
 typedef struct calibration_data {
   double par_t1;
@@ -79,6 +104,96 @@ void bmp388_reset(void) {
   bmp388_write_register(BMP388_REG_CMD, BMP388_CMD_RESET);
 }
 
+bool bmp388_start_fifo(uint8_t odr, uint8_t osr) {
+  enable_and_set_mode(false, false, SLEEP);
+  forced_osr = bmp388_read_register(BMP388_REG_OSR);
+  forced_odr = bmp388_read_register(BMP388_REG_ODR);
+  bmp388_write_register(BMP388_REG_OSR, osr & 0x07); // temperature x1
+  bmp388_write_register(BMP388_REG_ODR, odr);
+  bmp388_write_register(BMP388_REG_FIFO_CONFIG_1,
+                        FIFO_PRESSURE_AND_TEMPERATURE);
+  // every reading, it resets to every 4th
+  bmp388_write_register(BMP388_REG_FIFO_CONFIG_2, 0);
+  bmp388_write_register(BMP388_REG_CMD, BMP388_CMD_FIFO_FLUSH);
+  bmp388_read_register(BMP388_REG_ERR); // clears it
+  enable_and_set_mode(true, true, NORMAL);
+  return !(bmp388_read_register(BMP388_REG_ERR) & ERR_CONF);
+}
+
+/*
+Back to forced readings as before. The data ready bits are still set from
+normal mode, where nothing reads the data registers, and reading them is
+what clears them, or the next forced reading would come back straight away
+with an old one.
+*/
+void bmp388_stop_fifo(void) {
+  enable_and_set_mode(false, false, SLEEP);
+  bmp388_write_register(BMP388_REG_FIFO_CONFIG_1, 0);
+  bmp388_write_register(BMP388_REG_OSR, forced_osr);
+  bmp388_write_register(BMP388_REG_ODR, forced_odr);
+  uint8_t data[6];
+  bmp388_read_registers(BMP388_REG_DATA, data, sizeof(data));
+}
+
+/*
+Only whole frames are read, a partly read one would come out again from the
+start next time. Frames with just one of the two in (from before the FIFO
+was set up) carry nothing to return and are skipped.
+
+See BMP388 datasheet, section 3.6 for the frame layout
+*/
+uint8_t bmp388_read_fifo(bmp_reading *readings, uint8_t max) {
+  static uint8_t frames[FIFO_FRAME_LENGTH * FIFO_BURST_FRAMES];
+  uint8_t length_bytes[2];
+  bmp388_read_registers(BMP388_REG_FIFO_LENGTH, length_bytes,
+                        sizeof(length_bytes));
+  uint16_t available = byte_concat(length_bytes[1] & 0x01, length_bytes[0]);
+
+  uint8_t count = 0;
+  while (count < max && available >= FIFO_FRAME_LENGTH) {
+    uint16_t burst = available;
+    if (burst > (max - count) * FIFO_FRAME_LENGTH) {
+      burst = (max - count) * FIFO_FRAME_LENGTH;
+    }
+    if (burst > sizeof(frames)) {
+      burst = sizeof(frames);
+    }
+    bmp388_read_registers(BMP388_REG_FIFO_DATA, frames, burst);
+    available -= burst;
+
+    uint16_t i = 0;
+    while (i < burst) {
+      uint8_t header = frames[i];
+      uint8_t length;
+      if (header == FIFO_FRAME_CONFIG_CHANGE ||
+          header == FIFO_FRAME_CONFIG_ERROR) {
+        length = 2;
+      } else if (header == FIFO_FRAME_SENSORTIME) {
+        length = 4;
+      } else if ((header & 0xC0) == FIFO_FRAME_SENSOR) {
+        length = 1 + ((header & FIFO_FRAME_TEMPERATURE) ? 3 : 0) +
+                 ((header & FIFO_FRAME_PRESSURE) ? 3 : 0);
+      } else {
+        return count; // lost track of the frames
+      }
+      if (header == FIFO_FRAME_SENSOR || i + length > burst) {
+        return count; // empty, or cut off
+      }
+      if (length == FIFO_FRAME_LENGTH) {
+        const uint8_t *frame = &frames[i];
+        // temperature first, pressure is compensated with it
+        readings[count].temperature =
+            parse_temperature(frame[1], frame[2], frame[3]);
+        readings[count].pressure =
+            parse_pressure(frame[4], frame[5], frame[6]);
+        count++;
+      }
+      i += length;
+    }
+  }
+  return count;
+}
+
 void bmp388_get_reading(bmp_reading* reading) {
   enable_and_set_mode(false, false, SLEEP);
   delay_ms(5);
@@ -230,6 +345,7 @@ static void enable_and_set_mode(bool pressure, bool temperature,
                                 bmp388_mode_t mode) {
   uint8_t value = 0;
   value = bmp388_read_register(BMP388_REG_PWR_CTRL);
+  value &= ~(3 << 4); // out of whatever mode it was in
   if (pressure) {
     value |= (1 << 0); // set bit 0
   } else {
@@ -249,7 +365,7 @@ static void enable_and_set_mode(bool pressure, bool temperature,
     value |= (1 << 4); // 01
     break;
   case NORMAL:
-    value |= (2 << 4); // 11
+    value |= (3 << 4); // 11
     break;
   }
   bmp388_write_register(BMP388_REG_PWR_CTRL, value);
@@ -270,7 +386,7 @@ static uint8_t bmp388_read_register(uint8_t address) {
 }
 
 static void bmp388_read_registers(uint8_t address, uint8_t *data,
-                                  uint8_t length) {
+                                  uint16_t length) {
   address = address | READ_MASK;
   uint8_t address_and_dummy_byte[2];
   address_and_dummy_byte[0] = address;
@@ -8,6 +8,9 @@
 #ifndef BMP388_H_
 #define BMP388_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 typedef struct bmp_reading {
 	double temperature;
 	double pressure;
@@ -17,6 +20,16 @@ void bmp388_reset(void);
 void bmp388_init(void);
 void bmp388_get_reading(bmp_reading*);
 
+/*
+Normal mode at 200 Hz >> odr with pressure oversampled 2^osr times, each
+reading queued in the chip's FIFO. False if the conversions don't fit in
+the period.
+*/
+bool bmp388_start_fifo(uint8_t odr, uint8_t osr);
+void bmp388_stop_fifo(void);
+// up to max readings out of the FIFO, oldest first, returns how many
+uint8_t bmp388_read_fifo(bmp_reading *readings, uint8_t max);
+
 
 
 #endif /* BMP388_H_ */
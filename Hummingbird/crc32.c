@@ -0,0 +1,227 @@
+/*
+ * crc32.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "crc32.h"
+#include "atmel_start.h"
+#include <hri_d21.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+DMAC channels for crc32_spi_read, receive above transmit so a byte is out of
+the SERCOM before the next one goes. The Atmel Start DMAC driver is off
+(CONF_DMAC_ENABLE), so the DMAC is ours to set up.
+*/
+#define RX_CHANNEL 0
+#define TX_CHANNEL 1
+#define CHANNELS 2
+// CRCCTRL.CRCSRC: 0x20 + n is channel n
+static const uint8_t CRCSRC_CHANNEL = 0x20;
+// the DSU's write protection bit in PAC1, set out of reset
+static const uint32_t PAC1_WP_DSU = 1u << 1;
+// SERCOMn's DMAC triggers are RX 0x01 + 2n and TX 0x02 + 2n
+static const uint8_t SERCOM_TRIGGERS = 0x01;
+static const uint32_t SERCOM_SPACING = 0x400;
+// the reflected 0x04C11DB7, for the odd bytes the DSU can't take
+static const uint32_t CRC32_POLYNOMIAL = 0xEDB88320;
+// the standard check, the CRC-32 of "123456789"
+static const char CHECK_STRING[] = "123456789";
+static const uint32_t CHECK_VALUE = 0xCBF43926;
+
+COMPILER_ALIGNED(16)
+static DmacDescriptor descriptors[CHANNELS];
+COMPILER_ALIGNED(16)
+static DmacDescriptor write_back[CHANNELS];
+static const uint8_t idle_byte = 0xFF;
+static bool ready;
+
+static void enable(void) {
+  if (ready) {
+    return;
+  }
+  hri_pm_set_AHBMASK_DSU_bit(PM);
+  hri_pm_set_APBBMASK_DSU_bit(PM);
+  hri_pac_clear_WP_reg(PAC1, PAC1_WP_DSU);
+
+  hri_pm_set_AHBMASK_DMAC_bit(PM);
+  hri_pm_set_APBBMASK_DMAC_bit(PM);
+  hri_dmac_clear_CTRL_DMAENABLE_bit(DMAC);
+  hri_dmac_clear_CTRL_CRCENABLE_bit(DMAC);
+  hri_dmac_set_CTRL_SWRST_bit(DMAC);
+  while (hri_dmac_get_CTRL_SWRST_bit(DMAC)) {
+  }
+  hri_dmac_write_BASEADDR_reg(DMAC, (uint32_t)descriptors);
+  hri_dmac_write_WRBADDR_reg(DMAC, (uint32_t)write_back);
+  hri_dmac_write_CTRL_reg(DMAC, DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN0 |
+                                    DMAC_CTRL_LVLEN1);
+  ready = true;
+}
+
+/*
+CRCCTRL can only change with the engine off. Seeds it with the checksum to
+carry on from.
+*/
+static void engine_begin(uint16_t poly, uint8_t source, uint32_t checksum) {
+  hri_dmac_clear_CTRL_CRCENABLE_bit(DMAC);
+  hri_dmac_write_CRCCTRL_reg(DMAC, DMAC_CRCCTRL_CRCBEATSIZE_BYTE | poly |
+                                       DMAC_CRCCTRL_CRCSRC(source));
+  hri_dmac_write_CRCCHKSUM_reg(DMAC, checksum);
+  hri_dmac_set_CTRL_CRCENABLE_bit(DMAC);
+}
+
+static uint32_t engine_finish(void) {
+  hri_dmac_clear_CRCSTATUS_reg(DMAC, DMAC_CRCSTATUS_CRCBUSY);
+  uint32_t checksum = hri_dmac_read_CRCCHKSUM_reg(DMAC);
+  hri_dmac_clear_CTRL_CRCENABLE_bit(DMAC);
+  return checksum;
+}
+
+// no RBIT on the M0+
+static uint32_t reflect(uint32_t value) {
+  uint32_t reflected = 0;
+  for (uint8_t i = 0; i < 32; i++) {
+    reflected = (reflected << 1) | (value & 1);
+    value >>= 1;
+  }
+  return reflected;
+}
+
+/*
+The engine keeps CRC-32 unreflected and hands it out reflected and
+complemented (19.6.3.7), crc32_update's is reflected and not complemented
+like the DSU's
+*/
+static uint32_t engine_seed(uint32_t crc) { return reflect(crc); }
+
+static uint32_t engine_crc(uint32_t checksum) { return ~checksum; }
+
+uint32_t crc32_software_update(uint32_t crc, const void *data,
+                              size_t length) {
+  const uint8_t *bytes = data;
+  while (length-- > 0) {
+    crc ^= *bytes++;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (crc & 1 ? CRC32_POLYNOMIAL : 0);
+    }
+  }
+  return crc;
+}
+
+/*
+The DSU only takes whole words on a word boundary, the few bytes either side
+of them are done here
+*/
+uint32_t crc32_update(uint32_t crc, const void *data, size_t length) {
+  const uint8_t *bytes = data;
+  size_t head = (4 - (uint32_t)bytes % 4) % 4;
+  if (head > length) {
+    head = length;
+  }
+  crc = crc32_software_update(crc, bytes, head);
+  bytes += head;
+  length -= head;
+
+  size_t words = length / 4;
+  if (words > 0) {
+    enable();
+    hri_dsu_write_DATA_reg(DSU, crc);
+    hri_dsu_write_ADDR_reg(DSU, (uint32_t)bytes);
+    hri_dsu_write_LENGTH_reg(DSU, words * 4);
+    hri_dsu_clear_STATUSA_reg(DSU, DSU_STATUSA_DONE | DSU_STATUSA_BERR);
+    hri_dsu_write_CTRL_reg(DSU, DSU_CTRL_CRC);
+    while (!hri_dsu_get_STATUSA_DONE_bit(DSU)) {
+    }
+    if (hri_dsu_get_STATUSA_BERR_bit(DSU)) {
+      // not somewhere the DSU can read, the long way then
+      crc = crc32_software_update(crc, bytes, words * 4);
+    } else {
+      crc = hri_dsu_read_DATA_reg(DSU);
+    }
+    bytes += words * 4;
+    length -= words * 4;
+  }
+  return crc32_software_update(crc, bytes, length);
+}
+
+bool crc32_self_test(void) {
+  // from a word boundary the DSU takes two words, one off it takes one
+  COMPILER_ALIGNED(4)
+  uint8_t buffer[4 + sizeof(CHECK_STRING)];
+  for (uint8_t offset = 0; offset < 2; offset++) {
+    memcpy(buffer + offset, CHECK_STRING, sizeof(CHECK_STRING) - 1);
+    uint32_t crc = crc32_update(crc32_init(), buffer + offset,
+                                sizeof(CHECK_STRING) - 1);
+    if (crc32_finalize(crc) != CHECK_VALUE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void channel_begin(uint8_t channel, uint8_t trigger, uint8_t level,
+                          uint32_t source, uint32_t destination,
+                          uint16_t btctrl, uint16_t length) {
+  hri_dmac_write_CHID_reg(DMAC, channel);
+  hri_dmac_clear_CHCTRLA_ENABLE_bit(DMAC);
+  hri_dmac_clear_CHINTFLAG_reg(DMAC, DMAC_CHINTFLAG_MASK);
+  hri_dmac_write_CHCTRLB_reg(DMAC, DMAC_CHCTRLB_TRIGSRC(trigger) |
+                                       DMAC_CHCTRLB_TRIGACT_BEAT |
+                                       DMAC_CHCTRLB_LVL(level));
+  DmacDescriptor *descriptor = &descriptors[channel];
+  // incrementing addresses are given at the end of the block
+  hri_dmacdescriptor_write_SRCADDR_reg(
+      descriptor, source + (btctrl & DMAC_BTCTRL_SRCINC ? length : 0));
+  hri_dmacdescriptor_write_DSTADDR_reg(
+      descriptor, destination + (btctrl & DMAC_BTCTRL_DSTINC ? length : 0));
+  hri_dmacdescriptor_write_BTCNT_reg(descriptor, length);
+  hri_dmacdescriptor_write_DESCADDR_reg(descriptor, 0);
+  hri_dmacdescriptor_write_BTCTRL_reg(descriptor,
+                                      btctrl | DMAC_BTCTRL_BEATSIZE_BYTE |
+                                          DMAC_BTCTRL_BLOCKACT_NOACT |
+                                          DMAC_BTCTRL_VALID);
+}
+
+static void channel_enable(uint8_t channel) {
+  hri_dmac_write_CHID_reg(DMAC, channel);
+  hri_dmac_set_CHCTRLA_ENABLE_bit(DMAC);
+}
+
+bool crc32_spi_read(struct spi_m_sync_descriptor *spi, uint8_t *data,
+                    uint16_t length, uint32_t *crc) {
+  if (length == 0) {
+    return true;
+  }
+  enable();
+  Sercom *sercom = spi->dev.prvt;
+  uint8_t index = ((uint32_t)sercom - (uint32_t)SERCOM0) / SERCOM_SPACING;
+  uint32_t spi_data = (uint32_t)&sercom->SPI.DATA.reg;
+
+  engine_begin(DMAC_CRCCTRL_CRCPOLY_CRC32, CRCSRC_CHANNEL + RX_CHANNEL,
+               engine_seed(*crc));
+  channel_begin(RX_CHANNEL, SERCOM_TRIGGERS + 2 * index, 1, spi_data,
+                (uint32_t)data, DMAC_BTCTRL_DSTINC, length);
+  channel_begin(TX_CHANNEL, SERCOM_TRIGGERS + 2 * index + 1, 0,
+                (uint32_t)&idle_byte, spi_data, 0, length);
+  // receive first, so it's waiting when the first byte comes back
+  channel_enable(RX_CHANNEL);
+  channel_enable(TX_CHANNEL);
+
+  hri_dmac_write_CHID_reg(DMAC, RX_CHANNEL);
+  while (!hri_dmac_get_CHINTFLAG_reg(DMAC, DMAC_CHINTFLAG_TCMPL |
+                                               DMAC_CHINTFLAG_TERR)) {
+  }
+  bool failed = hri_dmac_get_CHINTFLAG_TERR_bit(DMAC);
+  hri_dmac_clear_CHINTFLAG_reg(DMAC, DMAC_CHINTFLAG_MASK);
+  hri_dmac_clear_CHCTRLA_ENABLE_bit(DMAC);
+  hri_dmac_write_CHID_reg(DMAC, TX_CHANNEL);
+  hri_dmac_clear_CHCTRLA_ENABLE_bit(DMAC);
+  uint32_t checksum = engine_finish();
+  if (failed) {
+    return false;
+  }
+  *crc = engine_crc(checksum);
+  return true;
+}
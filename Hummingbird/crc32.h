@@ -0,0 +1,54 @@
+/*
+ * crc32.h
+ *
+ * Created: 10/19/2026
+ *
+ * CRC-32 (IEEE 802.3, the same as zlib's crc32) on the SAMD21's CRC
+ * hardware, for checks over whole pages and downloads where crc.h's CRC-8
+ * per record is too weak and costs a table lookup a byte:
+ *
+ *  - memory goes through the DSU's CRC-32 unit (datasheet 13.11.3), which
+ *    reads it over the bus by itself
+ *  - bytes read over SPI go through the DMAC's CRC engine on their way into
+ *    RAM (19.6.3.7), so checking them costs no CPU at all
+ *
+ * Used like crc.h:
+ *
+ *   uint32_t crc = crc32_init();
+ *   crc = crc32_update(crc, page, sizeof(page));
+ *   crc = crc32_finalize(crc);
+ *
+ * The host simulation computes the same in software, see sim_hal.c.
+ */
+
+#ifndef CRC32_H_
+#define CRC32_H_
+
+#include "atmel_start.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static inline uint32_t crc32_init(void) { return 0xFFFFFFFF; }
+uint32_t crc32_update(uint32_t crc, const void *data, size_t length);
+static inline uint32_t crc32_finalize(uint32_t crc) { return ~crc; }
+// the same a bit at a time on the CPU, for when the hardware can't be trusted
+uint32_t crc32_software_update(uint32_t crc, const void *data, size_t length);
+
+/*
+crc32_update over the check string "123456789", on and off a word boundary,
+against its CRC-32 0xCBF43926. Run on boot, see spi_flash_init, which checks
+crc32_spi_read against crc32_software_update too.
+*/
+bool crc32_self_test(void);
+
+/*
+length bytes from spi into data, clocking out 0xFF, with crc updated from
+them as the DMAC moves them. Chip select and the command before them are the
+caller's. Returns false on a transfer error, leaving crc as it was and data
+not to be trusted.
+*/
+bool crc32_spi_read(struct spi_m_sync_descriptor *spi, uint8_t *data,
+                    uint16_t length, uint32_t *crc);
+
+#endif /* CRC32_H_ */
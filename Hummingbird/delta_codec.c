@@ -0,0 +1,233 @@
+/*
+ * delta_codec.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "delta_codec.h"
+
+static const uint8_t HEADER_BYTES = 1; // sample count
+// a quotient this long is written as a raw 32 bit value instead
+static const uint8_t ESCAPE_QUOTIENT = 20;
+static const uint8_t MAX_RICE_K = 24;
+// the residual estimate starts out at k = 3 and forgets after 16 samples
+static const uint32_t INITIAL_RESIDUAL_SUM = 8;
+static const uint8_t RESIDUAL_WINDOW = 16;
+
+static bool write_bits(delta_bits *bits, uint32_t value, uint8_t count) {
+  if (bits->position + count > (uint32_t)bits->capacity * 8) {
+    return false;
+  }
+  while (count > 0) {
+    count--;
+    uint8_t *byte = &bits->buffer[bits->position >> 3];
+    uint8_t mask = 0x80 >> (bits->position & 7);
+    if ((value >> count) & 1) {
+      *byte |= mask;
+    } else {
+      *byte &= ~mask;
+    }
+    bits->position++;
+  }
+  return true;
+}
+
+static bool write_ones(delta_bits *bits, uint8_t count) {
+  return write_bits(bits, 0xffffffff, count);
+}
+
+static bool read_bit(delta_decoder *decoder, uint8_t *bit) {
+  if (decoder->position >= (uint32_t)decoder->length * 8) {
+    return false;
+  }
+  uint8_t byte = decoder->buffer[decoder->position >> 3];
+  *bit = (byte >> (7 - (decoder->position & 7))) & 1;
+  decoder->position++;
+  return true;
+}
+
+static bool read_bits(delta_decoder *decoder, uint8_t count, uint32_t *value) {
+  *value = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t bit;
+    if (!read_bit(decoder, &bit)) {
+      return false;
+    }
+    *value = (*value << 1) | bit;
+  }
+  return true;
+}
+
+static uint32_t zigzag(int32_t residual) {
+  return residual < 0 ? ~((uint32_t)residual << 1) : (uint32_t)residual << 1;
+}
+
+static int32_t unzigzag(uint32_t value) {
+  return (value & 1) ? (int32_t)~(value >> 1) : (int32_t)(value >> 1);
+}
+
+static void channel_reset(delta_channel *channel) {
+  channel->residual_sum = INITIAL_RESIDUAL_SUM;
+  channel->residual_count = 1;
+}
+
+// the smallest k with count * 2^k >= sum, mean residual rounded up
+static uint8_t rice_parameter(const delta_channel *channel) {
+  uint8_t k = 0;
+  while (k < MAX_RICE_K &&
+         ((uint32_t)channel->residual_count << k) < channel->residual_sum) {
+    k++;
+  }
+  return k;
+}
+
+static void channel_update(delta_channel *channel, uint32_t value,
+                           uint32_t zigzagged) {
+  uint32_t limit = 1ul << MAX_RICE_K;
+  channel->residual_sum += zigzagged < limit ? zigzagged : limit;
+  channel->residual_count++;
+  if (channel->residual_count == RESIDUAL_WINDOW) {
+    channel->residual_sum >>= 1;
+    channel->residual_count >>= 1;
+  }
+  channel->before_last = channel->last;
+  channel->last = value;
+}
+
+/*
+Second order prediction, except for the second sample of a block where there
+is only one value to go on. Wrapping arithmetic, so a counter rolling over is
+just another small residual.
+*/
+static uint32_t predict(const delta_channel *channel, uint8_t sample) {
+  if (sample == 1) {
+    return channel->last;
+  }
+  return 2 * channel->last - channel->before_last;
+}
+
+void delta_encoder_begin(delta_encoder *encoder, uint8_t channels,
+                         uint8_t *buffer, uint16_t capacity) {
+  encoder->bits.buffer = buffer;
+  encoder->bits.capacity = capacity;
+  encoder->bits.position = HEADER_BYTES * 8;
+  encoder->channels = channels;
+  encoder->samples = 0;
+}
+
+bool delta_encoder_add(delta_encoder *encoder, const int32_t *values) {
+  if (encoder->samples == DELTA_MAX_SAMPLES) {
+    return false;
+  }
+
+  delta_encoder saved = *encoder;
+  bool fits = true;
+  for (uint8_t c = 0; c < encoder->channels && fits; c++) {
+    delta_channel *channel = &encoder->channel[c];
+    uint32_t value = (uint32_t)values[c];
+    if (encoder->samples == 0) {
+      fits = write_bits(&encoder->bits, value, 32);
+      channel_reset(channel);
+      channel->last = value;
+      continue;
+    }
+
+    uint32_t zigzagged =
+        zigzag((int32_t)(value - predict(channel, encoder->samples)));
+    uint8_t k = rice_parameter(channel);
+    uint32_t quotient = zigzagged >> k;
+    if (quotient < ESCAPE_QUOTIENT) {
+      fits = write_ones(&encoder->bits, (uint8_t)quotient) &&
+             write_bits(&encoder->bits, 0, 1) &&
+             write_bits(&encoder->bits, zigzagged, k);
+    } else {
+      fits = write_ones(&encoder->bits, ESCAPE_QUOTIENT) &&
+             write_bits(&encoder->bits, zigzagged, 32);
+    }
+    channel_update(channel, value, zigzagged);
+  }
+
+  if (!fits) {
+    *encoder = saved;
+    return false;
+  }
+  encoder->samples++;
+  return true;
+}
+
+uint16_t delta_encoder_finish(delta_encoder *encoder) {
+  if (encoder->samples == 0) {
+    return 0;
+  }
+  encoder->bits.buffer[0] = encoder->samples;
+  // clear the padding at the end of the last byte
+  uint8_t spare = (8 - (encoder->bits.position & 7)) & 7;
+  write_bits(&encoder->bits, 0, spare);
+  return (uint16_t)(encoder->bits.position / 8);
+}
+
+bool delta_decoder_begin(delta_decoder *decoder, uint8_t channels,
+                         const uint8_t *buffer, uint16_t length) {
+  if (length < HEADER_BYTES || channels > DELTA_MAX_CHANNELS) {
+    return false;
+  }
+  decoder->buffer = buffer;
+  decoder->length = length;
+  decoder->position = HEADER_BYTES * 8;
+  decoder->channels = channels;
+  decoder->samples = buffer[0];
+  decoder->decoded = 0;
+  return true;
+}
+
+bool delta_decoder_next(delta_decoder *decoder, int32_t *values) {
+  if (decoder->decoded == decoder->samples) {
+    return false;
+  }
+
+  for (uint8_t c = 0; c < decoder->channels; c++) {
+    delta_channel *channel = &decoder->channel[c];
+    uint32_t value;
+    if (decoder->decoded == 0) {
+      if (!read_bits(decoder, 32, &value)) {
+        return false;
+      }
+      channel_reset(channel);
+      channel->last = value;
+      values[c] = (int32_t)value;
+      continue;
+    }
+
+    uint8_t k = rice_parameter(channel);
+    uint32_t quotient = 0;
+    uint8_t bit = 1;
+    while (quotient < ESCAPE_QUOTIENT) {
+      if (!read_bit(decoder, &bit)) {
+        return false;
+      }
+      if (bit == 0) {
+        break;
+      }
+      quotient++;
+    }
+
+    uint32_t zigzagged;
+    if (quotient == ESCAPE_QUOTIENT) {
+      if (!read_bits(decoder, 32, &zigzagged)) {
+        return false;
+      }
+    } else {
+      uint32_t remainder;
+      if (!read_bits(decoder, k, &remainder)) {
+        return false;
+      }
+      zigzagged = (quotient << k) | remainder;
+    }
+
+    value = predict(channel, decoder->decoded) + (uint32_t)unzigzag(zigzagged);
+    channel_update(channel, value, zigzagged);
+    values[c] = (int32_t)value;
+  }
+  decoder->decoded++;
+  return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * delta_codec.h
+ *
+ * Created: 10/19/2026
+ *
+ * Streaming compression for slowly changing integer series, like pressure
+ * in 1/100 Pa, temperature in 1/100 C and sample time in ms.
+ *
+ * Each channel is predicted from its last two values (2 * x[n-1] - x[n-2]),
+ * the residual is zigzag mapped to an unsigned number and Rice coded with a
+ * parameter that adapts to the recent residual size. Readings that sit still
+ * or change steadily cost a couple of bits per channel instead of 4 bytes.
+ *
+ * Output is cut into self contained blocks, one radio packet or one flash log
+ * record each, so losing one doesn't stop the rest from being decoded:
+ *
+ *   [sample count][first sample, 32 bits per channel][Rice codes...]
+ *
+ * Plain C with no hardware dependencies, the ground tools build it too.
+ */
+
+#ifndef DELTA_CODEC_H_
+#define DELTA_CODEC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DELTA_MAX_CHANNELS 4
+#define DELTA_MAX_SAMPLES 255
+
+typedef struct delta_channel {
+  uint32_t last;
+  uint32_t before_last;
+  uint32_t residual_sum; // running Rice parameter estimate
+  uint8_t residual_count;
+} delta_channel;
+
+typedef struct delta_bits {
+  uint8_t *buffer;
+  uint16_t capacity; // bytes
+  uint32_t position; // bits
+} delta_bits;
+
+typedef struct delta_encoder {
+  delta_bits bits;
+  uint8_t channels;
+  uint8_t samples;
+  delta_channel channel[DELTA_MAX_CHANNELS];
+} delta_encoder;
+
+typedef struct delta_decoder {
+  const uint8_t *buffer;
+  uint16_t length;
+  uint32_t position; // bits
+  uint8_t channels;
+  uint8_t samples;
+  uint8_t decoded;
+  delta_channel channel[DELTA_MAX_CHANNELS];
+} delta_decoder;
+
+// start a new block in buffer
+void delta_encoder_begin(delta_encoder *encoder, uint8_t channels,
+                         uint8_t *buffer, uint16_t capacity);
+/*
+Add one sample (a value per channel). Returns false, leaving the block as it
+was, if it doesn't fit.
+*/
+bool delta_encoder_add(delta_encoder *encoder, const int32_t *values);
+// finish the block, returns its length in bytes, 0 if it holds no samples
+uint16_t delta_encoder_finish(delta_encoder *encoder);
+
+/*
+Decoding. Returns false from delta_decoder_begin if the block is too short to
+be one, and from delta_decoder_next once all samples have been read or the
+block turns out to be truncated.
+*/
+bool delta_decoder_begin(delta_decoder *decoder, uint8_t channels,
+                         const uint8_t *buffer, uint16_t length);
+bool delta_decoder_next(delta_decoder *decoder, int32_t *values);
+
+#endif /* DELTA_CODEC_H_ */
@@ -0,0 +1,319 @@
+/*
+ * fec.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "fec.h"
+#include "crc.h"
+#include <string.h>
+
+// x^8 + x^4 + x^3 + x^2 + 1, the usual Reed-Solomon field
+static const uint8_t GF_POLYNOMIAL = 0x1d;
+
+static uint8_t gf_mul(uint8_t a, uint8_t b) {
+  uint8_t product = 0;
+  while (b != 0) {
+    if (b & 1) {
+      product ^= a;
+    }
+    a = (a & 0x80) ? (uint8_t)(a << 1) ^ GF_POLYNOMIAL : (uint8_t)(a << 1);
+    b >>= 1;
+  }
+  return product;
+}
+
+// a^254, every non zero a has a^255 = 1
+static uint8_t gf_inverse(uint8_t a) {
+  uint8_t result = 1;
+  for (uint8_t bit = 0x80; bit != 0; bit >>= 1) {
+    result = gf_mul(result, result);
+    if (254 & bit) {
+      result = gf_mul(result, a);
+    }
+  }
+  return result;
+}
+
+/*
+Cauchy matrix 1 / (x_j + y_i) with x_j = j and y_i = FEC_MAX_REPAIR + i, all
+different, so every square piece of it can be inverted
+*/
+static uint8_t coefficient(uint8_t repair, uint8_t data) {
+  return gf_inverse(repair ^ (FEC_MAX_REPAIR + data));
+}
+
+/*
+Multiplying a whole symbol by one coefficient: products of the two nibbles,
+two lookups a byte instead of a multiply
+*/
+typedef struct gf_table {
+  uint8_t low[16];
+  uint8_t high[16];
+} gf_table;
+
+static void gf_table_init(gf_table *table, uint8_t c) {
+  for (uint8_t n = 0; n < 16; n++) {
+    table->low[n] = gf_mul(c, n);
+    table->high[n] = gf_mul(c, (uint8_t)(n << 4));
+  }
+}
+
+static inline uint8_t gf_table_mul(const gf_table *table, uint8_t b) {
+  return table->low[b & 0x0f] ^ table->high[b >> 4];
+}
+
+// out += c * ([length][data] padded with zeros)
+static void add_symbol(uint8_t *out, uint8_t c, const uint8_t *data,
+                       uint8_t length) {
+  gf_table table;
+  gf_table_init(&table, c);
+  out[0] ^= gf_table_mul(&table, length);
+  for (uint8_t i = 0; i < length; i++) {
+    out[i + 1] ^= gf_table_mul(&table, data[i]);
+  }
+}
+
+static crc_t repair_crc(const uint8_t *packet, uint8_t length) {
+  crc_t crc = crc_init();
+  crc = crc_update(crc, packet, length);
+  return crc_finalize(crc);
+}
+
+bool fec_encoder_begin(fec_encoder *encoder, uint8_t k, uint8_t m) {
+  if (k == 0 || k > FEC_MAX_DATA || m > FEC_MAX_REPAIR) {
+    return false;
+  }
+  encoder->data_packets = k;
+  encoder->repair_packets = m;
+  encoder->added = 0;
+  encoder->first_packet = 0;
+  encoder->symbol_length = 0;
+  return true;
+}
+
+bool fec_encoder_add(fec_encoder *encoder, uint32_t packet_number,
+                     const uint8_t *data, uint8_t length) {
+  if (encoder->repair_packets == 0) {
+    return false;
+  }
+  if (length > FEC_MAX_PACKET ||
+      (encoder->added > 0 &&
+       packet_number != encoder->first_packet + encoder->added)) {
+    encoder->added = 0;
+    if (length > FEC_MAX_PACKET) {
+      return false; // can't be protected, the next one starts a group
+    }
+  }
+  if (encoder->added == 0) {
+    encoder->first_packet = packet_number;
+    encoder->symbol_length = 0;
+    memset(encoder->repair, 0, sizeof(encoder->repair));
+  }
+
+  if (length + 1 > encoder->symbol_length) {
+    encoder->symbol_length = length + 1;
+  }
+  for (uint8_t j = 0; j < encoder->repair_packets; j++) {
+    add_symbol(encoder->repair[j], coefficient(j, encoder->added), data,
+               length);
+  }
+  if (++encoder->added < encoder->data_packets) {
+    return false;
+  }
+  encoder->added = 0;
+  return true;
+}
+
+uint8_t fec_encoder_repair(const fec_encoder *encoder, uint8_t index,
+                           uint8_t device_id, uint8_t *out) {
+  out[0] = device_id;
+  out[1] = encoder->first_packet & 0xff;
+  out[2] = (encoder->first_packet >> 8) & 0xff;
+  out[3] = (encoder->first_packet >> 16) & 0xff;
+  out[4] = (encoder->first_packet >> 24) & 0xff;
+  out[5] = encoder->data_packets;
+  out[6] = encoder->repair_packets;
+  out[7] = index;
+  memcpy(out + FEC_REPAIR_HEADER, encoder->repair[index],
+         encoder->symbol_length);
+  uint8_t length = FEC_REPAIR_HEADER + encoder->symbol_length;
+  out[length] = repair_crc(out, length);
+  return length + 1;
+}
+
+void fec_decoder_init(fec_decoder *decoder) {
+  memset(decoder, 0, sizeof(*decoder));
+  decoder->done = true; // no group yet
+}
+
+void fec_decoder_data(fec_decoder *decoder, uint32_t packet_number,
+                      const uint8_t *data, uint8_t length) {
+  if (length > FEC_MAX_PACKET) {
+    return;
+  }
+  uint8_t slot = packet_number % FEC_MAX_DATA;
+  decoder->held[slot] = true;
+  decoder->number[slot] = packet_number;
+  decoder->length[slot] = length;
+  memcpy(decoder->data[slot], data, length);
+}
+
+const uint8_t *fec_decoder_packet(const fec_decoder *decoder,
+                                  uint32_t packet_number, uint8_t *length) {
+  uint8_t slot = packet_number % FEC_MAX_DATA;
+  if (!decoder->held[slot] || decoder->number[slot] != packet_number) {
+    return NULL;
+  }
+  *length = decoder->length[slot];
+  return decoder->data[slot];
+}
+
+/*
+Invert the e x e matrix in place by Gauss-Jordan elimination. The Cauchy
+pieces always can be, so there's always a pivot.
+*/
+static void invert(uint8_t matrix[FEC_MAX_REPAIR][FEC_MAX_REPAIR], uint8_t e,
+                   uint8_t inverse[FEC_MAX_REPAIR][FEC_MAX_REPAIR]) {
+  memset(inverse, 0, sizeof(uint8_t) * FEC_MAX_REPAIR * FEC_MAX_REPAIR);
+  for (uint8_t i = 0; i < e; i++) {
+    inverse[i][i] = 1;
+  }
+  for (uint8_t column = 0; column < e; column++) {
+    uint8_t pivot = column;
+    while (matrix[pivot][column] == 0) {
+      pivot++;
+    }
+    for (uint8_t c = 0; c < e; c++) {
+      uint8_t swap = matrix[column][c];
+      matrix[column][c] = matrix[pivot][c];
+      matrix[pivot][c] = swap;
+      swap = inverse[column][c];
+      inverse[column][c] = inverse[pivot][c];
+      inverse[pivot][c] = swap;
+    }
+    uint8_t scale = gf_inverse(matrix[column][column]);
+    for (uint8_t c = 0; c < e; c++) {
+      matrix[column][c] = gf_mul(matrix[column][c], scale);
+      inverse[column][c] = gf_mul(inverse[column][c], scale);
+    }
+    for (uint8_t row = 0; row < e; row++) {
+      uint8_t factor = matrix[row][column];
+      if (row == column || factor == 0) {
+        continue;
+      }
+      for (uint8_t c = 0; c < e; c++) {
+        matrix[row][c] ^= gf_mul(factor, matrix[column][c]);
+        inverse[row][c] ^= gf_mul(factor, inverse[column][c]);
+      }
+    }
+  }
+}
+
+int fec_decoder_repair(fec_decoder *decoder, const uint8_t *packet,
+                       uint8_t length) {
+  decoder->recovered_count = 0;
+  if (length < FEC_REPAIR_HEADER + 2 ||
+      repair_crc(packet, length - 1) != packet[length - 1]) {
+    return -1;
+  }
+  uint32_t first = packet[1] | (uint32_t)packet[2] << 8 |
+                   (uint32_t)packet[3] << 16 | (uint32_t)packet[4] << 24;
+  uint8_t k = packet[5];
+  uint8_t m = packet[6];
+  uint8_t index = packet[7];
+  uint8_t symbol_length = length - FEC_REPAIR_HEADER - 1;
+  if (k == 0 || k > FEC_MAX_DATA || m == 0 || m > FEC_MAX_REPAIR ||
+      index >= m || symbol_length > FEC_MAX_SYMBOL) {
+    return -1;
+  }
+
+  if (first != decoder->first_packet || k != decoder->data_packets ||
+      m != decoder->repair_packets ||
+      symbol_length != decoder->symbol_length) {
+    decoder->first_packet = first;
+    decoder->data_packets = k;
+    decoder->repair_packets = m;
+    decoder->symbol_length = symbol_length;
+    decoder->done = false;
+    memset(decoder->have_repair, 0, sizeof(decoder->have_repair));
+  }
+  if (decoder->done) {
+    return 0;
+  }
+  memcpy(decoder->repair[index], packet + FEC_REPAIR_HEADER, symbol_length);
+  decoder->have_repair[index] = true;
+
+  uint8_t missing[FEC_MAX_REPAIR];
+  uint8_t repairs[FEC_MAX_REPAIR];
+  uint8_t e = 0;
+  uint8_t r = 0;
+  for (uint8_t i = 0; i < k; i++) {
+    uint8_t data_length;
+    if (fec_decoder_packet(decoder, first + i, &data_length) == NULL) {
+      if (e == FEC_MAX_REPAIR) {
+        return 0; // more gone than any group can put back
+      }
+      missing[e++] = i;
+    }
+  }
+  for (uint8_t j = 0; j < m && r < e; j++) {
+    if (decoder->have_repair[j]) {
+      repairs[r++] = j;
+    }
+  }
+  if (e == 0) {
+    decoder->done = true;
+    return 0;
+  }
+  if (r < e) {
+    return 0; // wait for more
+  }
+
+  // take what was heard out of the repairs, leaving sums of the missing ones
+  uint8_t sums[FEC_MAX_REPAIR][FEC_MAX_SYMBOL];
+  for (uint8_t row = 0; row < e; row++) {
+    memcpy(sums[row], decoder->repair[repairs[row]], symbol_length);
+    for (uint8_t i = 0, next_missing = 0; i < k; i++) {
+      if (next_missing < e && missing[next_missing] == i) {
+        next_missing++;
+        continue;
+      }
+      uint8_t data_length = 0;
+      const uint8_t *data = fec_decoder_packet(decoder, first + i,
+                                               &data_length);
+      if (data_length + 1 > symbol_length) {
+        return -1; // not from this group after all
+      }
+      add_symbol(sums[row], coefficient(repairs[row], i), data, data_length);
+    }
+  }
+
+  uint8_t matrix[FEC_MAX_REPAIR][FEC_MAX_REPAIR];
+  uint8_t inverse[FEC_MAX_REPAIR][FEC_MAX_REPAIR];
+  for (uint8_t row = 0; row < e; row++) {
+    for (uint8_t c = 0; c < e; c++) {
+      matrix[row][c] = coefficient(repairs[row], missing[c]);
+    }
+  }
+  invert(matrix, e, inverse);
+
+  decoder->done = true;
+  for (uint8_t c = 0; c < e; c++) {
+    uint8_t symbol[FEC_MAX_SYMBOL];
+    memset(symbol, 0, symbol_length);
+    for (uint8_t row = 0; row < e; row++) {
+      gf_table table;
+      gf_table_init(&table, inverse[c][row]);
+      for (uint8_t b = 0; b < symbol_length; b++) {
+        symbol[b] ^= gf_table_mul(&table, sums[row][b]);
+      }
+    }
+    if (symbol[0] + 1 > symbol_length) {
+      continue; // damaged beyond what the crc caught
+    }
+    fec_decoder_data(decoder, first + missing[c], symbol + 1, symbol[0]);
+    decoder->recovered[decoder->recovered_count++] = first + missing[c];
+  }
+  return decoder->recovered_count;
+}
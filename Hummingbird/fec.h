@@ -0,0 +1,101 @@
+/*
+ * fec.h
+ *
+ * Created: 10/19/2026
+ *
+ * Forward error correction across radio packets. After every group of k
+ * data packets the kite sends m repair packets, and the ground can rebuild
+ * any m of the group that it missed from the rest, with no need to ask.
+ *
+ * The code is systematic Reed-Solomon over GF(2^8): data packets go out as
+ * they are, and repair j is the sum of c(j, i) * symbol i over the group,
+ * with c from a Cauchy matrix so any k of the k + m packets are enough.
+ * Symbol i is data packet i with its length in front, padded with zeros to
+ * the longest in the group. A repair packet, sent with FEC_REPAIR_FLAG in the
+ * RadioHead header flags, is
+ *
+ *   [device id][first packet number u32][k][m][repair index][symbol][crc8]
+ *
+ * Data packets are numbered by their Datapoint's packet_number, a group is k
+ * in a row starting from the first packet number. m = 0 is no repairs.
+ *
+ * Plain C with no hardware dependencies, the ground tools build it too.
+ */
+
+#ifndef FEC_H_
+#define FEC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FEC_MAX_DATA 16
+#define FEC_MAX_REPAIR 4
+// RadioHead header flag bit, the low 4 are left to the application
+#define FEC_REPAIR_FLAG 0x01
+#define FEC_REPAIR_HEADER 8
+// a repair for it still fits in RFM9X_MAX_PAYLOAD
+#define FEC_MAX_PACKET 241
+#define FEC_MAX_SYMBOL (FEC_MAX_PACKET + 1)
+
+typedef struct fec_encoder {
+  uint8_t data_packets; // k
+  uint8_t repair_packets; // m
+  uint8_t added;
+  uint32_t first_packet;
+  uint8_t symbol_length;
+  uint8_t repair[FEC_MAX_REPAIR][FEC_MAX_SYMBOL];
+} fec_encoder;
+
+/*
+Returns false, leaving the encoder as it was, for k outside 1 to
+FEC_MAX_DATA or m over FEC_MAX_REPAIR
+*/
+bool fec_encoder_begin(fec_encoder *encoder, uint8_t k, uint8_t m);
+/*
+Add the next data packet, at most FEC_MAX_PACKET bytes. Returns true when
+that completes the group and the repairs are ready. A packet number that
+doesn't follow on from the last starts a new group.
+*/
+bool fec_encoder_add(fec_encoder *encoder, uint32_t packet_number,
+                     const uint8_t *data, uint8_t length);
+// repair packet index of the group just completed, returns its length
+uint8_t fec_encoder_repair(const fec_encoder *encoder, uint8_t index,
+                           uint8_t device_id, uint8_t *out);
+
+/*
+Ground side. Remembers the last FEC_MAX_DATA data packets heard and puts a
+group's missing ones back once enough of its repairs are in.
+*/
+typedef struct fec_decoder {
+  bool held[FEC_MAX_DATA]; // by packet number % FEC_MAX_DATA
+  uint32_t number[FEC_MAX_DATA];
+  uint8_t length[FEC_MAX_DATA];
+  uint8_t data[FEC_MAX_DATA][FEC_MAX_PACKET];
+
+  // the group repairs are coming in for
+  uint32_t first_packet;
+  uint8_t data_packets;
+  uint8_t repair_packets;
+  uint8_t symbol_length;
+  bool done;
+  bool have_repair[FEC_MAX_REPAIR];
+  uint8_t repair[FEC_MAX_REPAIR][FEC_MAX_SYMBOL];
+
+  uint32_t recovered[FEC_MAX_REPAIR]; // packet numbers, from the last repair
+  uint8_t recovered_count;
+} fec_decoder;
+
+void fec_decoder_init(fec_decoder *decoder);
+void fec_decoder_data(fec_decoder *decoder, uint32_t packet_number,
+                      const uint8_t *data, uint8_t length);
+/*
+A repair packet was heard. Returns how many data packets it let the decoder
+rebuild, listed in recovered, or -1 if it's damaged.
+*/
+int fec_decoder_repair(fec_decoder *decoder, const uint8_t *packet,
+                       uint8_t length);
+// a data packet heard or rebuilt, NULL if the decoder doesn't have it
+const uint8_t *fec_decoder_packet(const fec_decoder *decoder,
+                                  uint32_t packet_number, uint8_t *length);
+
+#endif /* FEC_H_ */
@@ -0,0 +1,391 @@
+/*
+ * flash_log.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "flash_log.h"
+#include "crc.h"
+#include "spi_flash.h"
+#include <string.h>
+
+static const uint32_t PAGE_COUNT = SPI_FLASH_SIZE / SPI_FLASH_PAGE_SIZE;
+static const uint32_t FIRST_PAGE = FLASH_LOG_START / SPI_FLASH_PAGE_SIZE;
+static const uint32_t DIRECTORY_SLOTS =
+    FLASH_LOG_START / FLASH_LOG_DIRECTORY_ENTRY;
+
+static uint32_t head;
+/*
+Everything before here is on flash. The records from here to the head are
+in the head's page of buffer, waiting for flash_log_flush or the page to
+fill up.
+*/
+static uint32_t flushed;
+static uint8_t buffer[SPI_FLASH_PAGE_SIZE];
+// everything from head up to here is erased, or being erased
+static uint32_t erased_end;
+static flash_log_erase_stats erase_stats;
+// address of the first erased directory entry
+static uint32_t directory_head;
+static uint32_t last_flight; // the last one in the directory, 0 for none
+static uint32_t last_start; // where it starts
+static uint32_t current_flight; // since flash_log_begin_flight
+
+// page cache for recovery and flash_log_next
+static uint8_t page[SPI_FLASH_PAGE_SIZE];
+static uint32_t page_address = UINT32_MAX;
+
+static const uint8_t *read_page(uint32_t address) {
+  address -= address % SPI_FLASH_PAGE_SIZE;
+  if (address != page_address) {
+    spi_flash_read(address, page, sizeof(page));
+    page_address = address;
+    if (head > flushed && address == flushed - flushed % SPI_FLASH_PAGE_SIZE) {
+      uint16_t offset = flushed % SPI_FLASH_PAGE_SIZE;
+      memcpy(&page[offset], &buffer[offset], head - flushed);
+    }
+  }
+  return page;
+}
+
+/*
+Never 0xFF: the CRC goes in last, so a record or directory entry torn before
+it has it still erased and can't pass
+*/
+static crc_t log_crc(const uint8_t *data, uint16_t length) {
+  crc_t crc = crc_init();
+  crc = crc_update(crc, data, length);
+  crc = crc_finalize(crc);
+  return crc == FLASH_LOG_ERASED ? 0x00 : crc;
+}
+
+static crc_t record_crc(const uint8_t *record, uint8_t length) {
+  return log_crc(record, length + FLASH_LOG_OVERHEAD - 1);
+}
+
+/*
+Check the record at offset in a page buffer, returns its total size or 0 if
+there is no valid record there
+*/
+static uint16_t record_size(const uint8_t *buffer, uint16_t offset) {
+  if (offset + FLASH_LOG_OVERHEAD > SPI_FLASH_PAGE_SIZE ||
+      buffer[offset] == FLASH_LOG_ERASED) {
+    return 0;
+  }
+  uint8_t length = buffer[offset + 1];
+  uint16_t size = length + FLASH_LOG_OVERHEAD;
+  if (offset + size > SPI_FLASH_PAGE_SIZE ||
+      record_crc(&buffer[offset], length) != buffer[offset + size - 1]) {
+    return 0;
+  }
+  return size;
+}
+
+static bool is_erased(const uint8_t *data, uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    if (data[i] != 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+Everything from address to the end of its sector must be erased before we
+write there, a reset during a sector erase can leave it half done
+*/
+static bool sector_tail_erased(uint32_t address) {
+  uint32_t end = address - (address % SPI_FLASH_SECTOR_SIZE) +
+                 SPI_FLASH_SECTOR_SIZE;
+  uint8_t buffer[32];
+  bool erased = true;
+  spi_flash_batch_begin();
+  while (erased && address < end) {
+    uint16_t length = sizeof(buffer);
+    if (end - address < length) {
+      length = end - address;
+    }
+    spi_flash_read(address, buffer, length);
+    erased = is_erased(buffer, length);
+    address += length;
+  }
+  spi_flash_batch_end();
+  return erased;
+}
+
+static bool entry_valid(const uint8_t *entry) {
+  return log_crc(entry, 6) == entry[6];
+}
+
+static uint32_t entry_number(const uint8_t *entry) {
+  return entry[0] | (uint32_t)entry[1] << 8 | (uint32_t)entry[2] << 16 |
+         (uint32_t)entry[3] << 24;
+}
+
+static uint32_t entry_start(const uint8_t *entry) {
+  return (uint32_t)(entry[4] | entry[5] << 8) * SPI_FLASH_PAGE_SIZE;
+}
+
+static void directory_init(void) {
+  // entries go in in order, find the first erased one
+  uint8_t entry[FLASH_LOG_DIRECTORY_ENTRY];
+  uint32_t low = 0;
+  uint32_t high = DIRECTORY_SLOTS;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    spi_flash_read(middle * sizeof(entry), entry, sizeof(entry));
+    if (is_erased(entry, sizeof(entry))) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  directory_head = low * sizeof(entry);
+
+  last_flight = 0;
+  last_start = 0;
+  current_flight = 0;
+  for (uint32_t address = directory_head; address > 0;) {
+    address -= sizeof(entry);
+    spi_flash_read(address, entry, sizeof(entry));
+    if (entry_valid(entry)) {
+      last_flight = entry_number(entry);
+      last_start = entry_start(entry);
+      break;
+    }
+  }
+}
+
+void flash_log_init(void) {
+  directory_init();
+
+  // first page whose first byte is still erased
+  uint32_t low = FIRST_PAGE;
+  uint32_t high = PAGE_COUNT;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    uint8_t first;
+    spi_flash_read(middle * SPI_FLASH_PAGE_SIZE, &first, 1);
+    if (first == FLASH_LOG_ERASED) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+
+  head = low * SPI_FLASH_PAGE_SIZE;
+  page_address = UINT32_MAX;
+  if (low > FIRST_PAGE) {
+    // resume inside the last written page if it ends cleanly
+    uint32_t last = (low - 1) * SPI_FLASH_PAGE_SIZE;
+    const uint8_t *buffer = read_page(last);
+    uint16_t offset = 0;
+    uint16_t size;
+    while ((size = record_size(buffer, offset)) > 0) {
+      offset += size;
+    }
+    if (is_erased(&buffer[offset], SPI_FLASH_PAGE_SIZE - offset)) {
+      head = last + offset;
+    }
+  }
+
+  if (head < SPI_FLASH_SIZE && head % SPI_FLASH_SECTOR_SIZE != 0 &&
+      !sector_tail_erased(head)) {
+    head += SPI_FLASH_SECTOR_SIZE - head % SPI_FLASH_SECTOR_SIZE;
+  }
+  flushed = head;
+  // sectors erased ahead before the reset may not have finished, do them again
+  erased_end = head;
+  if (head % SPI_FLASH_SECTOR_SIZE != 0) {
+    erased_end += SPI_FLASH_SECTOR_SIZE - head % SPI_FLASH_SECTOR_SIZE;
+  }
+  memset(&erase_stats, 0, sizeof(erase_stats));
+}
+
+void flash_log_format(void) {
+  spi_flash_chip_erase();
+  head = FLASH_LOG_START;
+  flushed = head;
+  erased_end = SPI_FLASH_SIZE;
+  page_address = UINT32_MAX;
+  directory_head = 0;
+  last_flight = 0;
+  last_start = 0;
+  current_flight = 0;
+}
+
+bool flash_log_append(flash_log_type type, const void *data, uint8_t length) {
+  uint16_t size = length + FLASH_LOG_OVERHEAD;
+  if (size > SPI_FLASH_PAGE_SIZE) {
+    return false;
+  }
+  if (size > SPI_FLASH_PAGE_SIZE - head % SPI_FLASH_PAGE_SIZE) {
+    flash_log_new_page();
+  }
+  if (head + size > SPI_FLASH_SIZE) {
+    return false;
+  }
+
+  if (head >= erased_end) {
+    spi_flash_sector_erase(head);
+    erased_end = head + SPI_FLASH_SECTOR_SIZE;
+    erase_stats.inline_erases++;
+  }
+
+  uint8_t *record = &buffer[head % SPI_FLASH_PAGE_SIZE];
+  record[0] = type;
+  record[1] = length;
+  memcpy(&record[2], data, length);
+  record[size - 1] = record_crc(record, length);
+
+  if (page_address == head - head % SPI_FLASH_PAGE_SIZE) {
+    page_address = UINT32_MAX;
+  }
+  head += size;
+  if (head % SPI_FLASH_PAGE_SIZE == 0) {
+    flash_log_flush(); // not another byte fits
+  }
+  return true;
+}
+
+void flash_log_flush(void) {
+  if (flushed == head) {
+    return;
+  }
+  uint16_t offset = flushed % SPI_FLASH_PAGE_SIZE;
+  spi_flash_page_program(flushed, &buffer[offset], head - flushed);
+  flushed = head;
+}
+
+uint16_t flash_log_pending(void) { return head - flushed; }
+
+void flash_log_new_page(void) {
+  flash_log_flush();
+  if (head % SPI_FLASH_PAGE_SIZE != 0) {
+    head += SPI_FLASH_PAGE_SIZE - head % SPI_FLASH_PAGE_SIZE;
+    flushed = head;
+  }
+}
+
+uint32_t flash_log_head(void) { return head; }
+
+bool flash_log_erase_ahead(uint8_t sectors) {
+  uint32_t want = head - head % SPI_FLASH_SECTOR_SIZE +
+                  (uint32_t)(sectors + 1) * SPI_FLASH_SECTOR_SIZE;
+  if (want > SPI_FLASH_SIZE) {
+    want = SPI_FLASH_SIZE;
+  }
+  if (erased_end >= want || spi_flash_busy()) {
+    return false;
+  }
+  spi_flash_sector_erase_start(erased_end);
+  erased_end += SPI_FLASH_SECTOR_SIZE;
+  erase_stats.ahead++;
+  return true;
+}
+
+const flash_log_erase_stats *flash_log_erases(void) { return &erase_stats; }
+
+uint32_t flash_log_begin_flight(void) {
+  flash_log_new_page();
+  if (last_flight != 0 && last_start == head) {
+    // nothing was logged in the last one, it does for this one too
+    current_flight = last_flight;
+    return last_flight;
+  }
+  if (flash_log_directory_full()) {
+    // no slot for it, the last flight goes on to take in what's logged now
+    current_flight = last_flight;
+    return last_flight;
+  }
+  current_flight = 0;
+  if (head >= SPI_FLASH_SIZE) {
+    return 0;
+  }
+  uint32_t number = last_flight + 1;
+  uint16_t first_page = head / SPI_FLASH_PAGE_SIZE;
+  uint8_t entry[FLASH_LOG_DIRECTORY_ENTRY] = {
+      number, number >> 8, number >> 16, number >> 24, first_page,
+      first_page >> 8, 0, 0xFF};
+  entry[6] = log_crc(entry, 6);
+  spi_flash_page_program(directory_head, entry, sizeof(entry));
+  directory_head += sizeof(entry);
+  last_flight = number;
+  last_start = head;
+  current_flight = number;
+  return number;
+}
+
+bool flash_log_directory_full(void) {
+  return directory_head >= FLASH_LOG_START;
+}
+
+bool flash_log_flight_find(uint32_t number, flash_log_flight *flight) {
+  if (number == 0) {
+    number = current_flight;
+  }
+  bool found = false;
+  flight->end = head;
+  uint8_t entry[FLASH_LOG_DIRECTORY_ENTRY];
+  spi_flash_batch_begin();
+  for (uint32_t address = 0; number != 0 && address < directory_head;
+       address += sizeof(entry)) {
+    spi_flash_read(address, entry, sizeof(entry));
+    if (!entry_valid(entry)) {
+      continue;
+    }
+    if (found) {
+      flight->end = entry_start(entry);
+      break;
+    }
+    if (entry_number(entry) == number) {
+      found = true;
+      flight->number = number;
+      flight->start = entry_start(entry);
+    }
+  }
+  spi_flash_batch_end();
+  return found;
+}
+
+bool flash_log_page_record(uint32_t address, uint8_t type, void *data,
+                           uint8_t length) {
+  address -= address % SPI_FLASH_PAGE_SIZE;
+  const uint8_t *record = page;
+  if (head > flushed && address == flushed - flushed % SPI_FLASH_PAGE_SIZE) {
+    record = read_page(address);
+  } else {
+    // only as much of it as the record
+    spi_flash_read(address, page, length + FLASH_LOG_OVERHEAD);
+    page_address = UINT32_MAX;
+  }
+  if (record[0] != type || record[1] != length ||
+      record_size(record, 0) == 0) {
+    return false;
+  }
+  memcpy(data, &record[2], length);
+  return true;
+}
+
+bool flash_log_next(uint32_t *cursor, flash_log_record *record) {
+  if (*cursor < FLASH_LOG_START) {
+    *cursor = FLASH_LOG_START;
+  }
+  while (*cursor < head) {
+    const uint8_t *buffer = read_page(*cursor);
+    uint16_t offset = *cursor % SPI_FLASH_PAGE_SIZE;
+    uint16_t size = record_size(buffer, offset);
+    if (size == 0) {
+      // end of this page's records, or a torn one
+      *cursor += SPI_FLASH_PAGE_SIZE - offset;
+      continue;
+    }
+    record->address = *cursor;
+    record->type = buffer[offset];
+    record->length = buffer[offset + 1];
+    memcpy(record->data, &buffer[offset + 2], record->length);
+    *cursor += size;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,126 @@
+/*
+ * flash_log.h
+ *
+ * Created: 10/19/2026
+ *
+ * Append only record log on the W25 flash.
+ *
+ * Records are [type][length][payload][crc8] and never straddle a page, the
+ * rest of a page that can't fit the next record is left erased. Pages are
+ * filled in order from FLASH_LOG_START, so on boot the head can be found by
+ * binary searching for the first page that starts with 0xFF. Sectors are
+ * erased ahead of the write head in idle time by flash_log_erase_ahead, so
+ * appending only programs pages; a sector the head reaches before that is
+ * erased then. A record that was cut short by a reset fails its CRC (which
+ * is never 0xFF, an erased byte) and the rest of that page is abandoned.
+ *
+ * Appended records are kept in RAM and programmed together, when the next
+ * one doesn't fit in the page or on flash_log_flush, which saves a program
+ * (write enable, command, busy wait) per record. A reset loses the ones not
+ * flushed, at most a page of them and the record being appended.
+ *
+ * Sector 0 is the flight directory, an entry for every flight
+ *
+ *   [flight number u32][first page u16][crc8][0xFF]
+ *
+ * little endian, written as the flight starts on a page of its own. A
+ * flight ends where the next one starts, or at the head. An entry torn by a
+ * reset fails its CRC and is skipped. A boot that logs nothing doesn't use
+ * up an entry. The directory holds 512 flights, after that the last one takes
+ * in everything logged until the chip is formatted (UPLINK_FORMAT_LOG).
+ *
+ * The log has to start from an erased chip, see flash_log_format.
+ */
+
+#ifndef FLASH_LOG_H_
+#define FLASH_LOG_H_
+
+#include "spi_flash.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FLASH_LOG_OVERHEAD 3
+#define FLASH_LOG_MAX_PAYLOAD (SPI_FLASH_PAGE_SIZE - FLASH_LOG_OVERHEAD)
+// after the flight directory
+#define FLASH_LOG_START SPI_FLASH_SECTOR_SIZE
+#define FLASH_LOG_DIRECTORY_ENTRY 8
+
+typedef enum flash_log_type {
+  FLASH_LOG_DATAPOINT = 0x01,
+  FLASH_LOG_SAMPLES = 0x02, // a delta_codec block of telemetry samples
+  FLASH_LOG_SUMMARY = 0x03, // a block_summary, see telemetry.h
+  FLASH_LOG_ERASED = 0xFF,
+} flash_log_type;
+
+typedef struct flash_log_flight {
+  uint32_t number;
+  uint32_t start; // address of its first page
+  uint32_t end; // the next flight's start or the head
+} flash_log_flight;
+
+typedef struct flash_log_erase_stats {
+  uint32_t ahead; // by flash_log_erase_ahead
+  uint32_t inline_erases; // by flash_log_append, the head got there first
+} flash_log_erase_stats;
+
+typedef struct flash_log_record {
+  uint32_t address;
+  uint8_t type;
+  uint8_t length;
+  uint8_t data[FLASH_LOG_MAX_PAYLOAD];
+} flash_log_record;
+
+// find the write head, call after spi_flash_init
+void flash_log_init(void);
+// erase the whole chip and start an empty log
+void flash_log_format(void);
+
+// returns false if the log is full
+bool flash_log_append(flash_log_type type, const void *data, uint8_t length);
+// program the records only in RAM so far
+void flash_log_flush(void);
+// bytes of records only in RAM
+uint16_t flash_log_pending(void);
+// so the next record starts a page
+void flash_log_new_page(void);
+// address of the next byte to be written
+uint32_t flash_log_head(void);
+
+/*
+Start erasing the next sector if fewer than sectors ahead of the write head
+are erased and the flash isn't busy. It doesn't wait for the erase, appends
+and reads meanwhile suspend it (see spi_flash_sector_erase_start). Returns
+false if there was nothing to do.
+*/
+bool flash_log_erase_ahead(uint8_t sectors);
+const flash_log_erase_stats *flash_log_erases(void);
+
+/*
+Start a flight on a new page and put it in the directory, numbered one after
+the last. Returns its number, 0 if the log is full. If nothing was logged
+since the last flight started, that one is returned again rather than taking
+another entry. Once the directory is full there's no new entry either: the
+last flight carries on and its number is returned again, so what's logged
+stays in a flight that can be found and downloaded, until flash_log_format.
+*/
+uint32_t flash_log_begin_flight(void);
+// true once the directory has no room for another flight
+bool flash_log_directory_full(void);
+// the flight with number, 0 for the current one; false if it isn't there
+bool flash_log_flight_find(uint32_t number, flash_log_flight *flight);
+
+/*
+Read the first record of the page at address into data if it is of type and
+length, without reading the rest of the page. Returns false if it isn't.
+*/
+bool flash_log_page_record(uint32_t address, uint8_t type, void *data,
+                           uint8_t length);
+
+/*
+Read the record at or after *cursor, start with *cursor = 0, including ones
+not flushed yet. Corrupt records are skipped. Returns false once the write
+head is reached.
+*/
+bool flash_log_next(uint32_t *cursor, flash_log_record *record);
+
+#endif /* FLASH_LOG_H_ */
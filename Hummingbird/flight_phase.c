@@ -0,0 +1,166 @@
+/*
+ * flight_phase.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "flight_phase.h"
+#include <math.h>
+
+// the barometric ground level drifts with the weather, follow it slowly on
+// the ground
+static const float GROUND_TAU_S = 60.0f;
+
+static const float LAUNCH_SPEED = 1.5f; // m/s
+static const float LAUNCH_HEIGHT = 3.0f;
+static const float AIRBORNE_HEIGHT = 20.0f;
+static const float LANDED_HEIGHT = 5.0f;
+static const float STILL_SPEED = 0.3f;
+// hysteresis, it takes more to start climbing or sinking than to keep going
+static const float CLIMB_ENTER = 1.0f;
+static const float CLIMB_EXIT = 0.3f;
+static const float SINK_ENTER = -1.0f;
+static const float SINK_EXIT = -0.3f;
+
+// how long a new phase has to keep looking right before we switch to it
+static const uint32_t HOLD_MS[PHASE_COUNT] = {
+    [PHASE_PAD] = 300000,
+    [PHASE_LAUNCH] = 0,
+    [PHASE_CLIMBING] = 2000,
+    [PHASE_STEADY] = 10000,
+    [PHASE_DESCENT] = 5000,
+    [PHASE_LANDED] = 15000,
+};
+
+static const phase_policy POLICIES[PHASE_COUNT] = {
+    //                sample  transmit    log  power  radio sleep
+    [PHASE_PAD] =      {10000,   60000, 60000,     5, true},
+    [PHASE_LAUNCH] =   {  200,    1000,   200,    17, false},
+    [PHASE_CLIMBING] = {  500,    2000,   500,    17, false},
+    [PHASE_STEADY] =   { 2000,    5000,  2000,    13, false},
+    [PHASE_DESCENT] =  {  500,    2000,   500,    17, false},
+    [PHASE_LANDED] =   {10000,   30000, 60000,    13, true},
+};
+
+static flight_phase phase;
+static flight_phase pending;
+static uint32_t pending_since_ms;
+
+static bool started;
+static uint32_t last_ms;
+static float altitude;
+static float ground_altitude;
+static bool ground_known; // false if we started up in the air
+static float vertical_speed;
+
+void flight_phase_init(void) {
+  phase = PHASE_PAD;
+  pending = PHASE_PAD;
+  started = false;
+  ground_known = true;
+  vertical_speed = 0;
+}
+
+static float smoothing(float dt_s, float tau_s) { return dt_s / (tau_s + dt_s); }
+
+float flight_phase_height_m(void) {
+  if (!started) {
+    return 0;
+  }
+  return altitude - ground_altitude;
+}
+
+float flight_phase_vertical_speed_ms(void) { return vertical_speed; }
+
+static bool on_ground(float height, float speed) {
+  if (fabsf(speed) >= STILL_SPEED) {
+    return false;
+  }
+  // without a ground reference all we can go on is having stopped moving
+  return !ground_known || height < LANDED_HEIGHT;
+}
+
+// the phase the current readings point at, before any hold time
+static flight_phase evaluate(float height, float speed) {
+  switch (phase) {
+  case PHASE_PAD:
+  case PHASE_LANDED:
+    if (speed > LAUNCH_SPEED && height > LAUNCH_HEIGHT) {
+      return PHASE_LAUNCH;
+    }
+    if (speed < SINK_ENTER) {
+      return PHASE_DESCENT; // can't sink through the ground, we're flying
+    }
+    // landed for long enough counts as waiting on the pad again
+    return PHASE_PAD;
+  case PHASE_LAUNCH:
+    if (height > AIRBORNE_HEIGHT) {
+      return PHASE_CLIMBING;
+    }
+    if (height < LAUNCH_HEIGHT && fabsf(speed) < STILL_SPEED) {
+      return PHASE_LANDED; // false start
+    }
+    return PHASE_LAUNCH;
+  case PHASE_CLIMBING:
+  case PHASE_STEADY:
+  case PHASE_DESCENT:
+    if (on_ground(height, speed)) {
+      return PHASE_LANDED;
+    }
+    if (phase == PHASE_CLIMBING ? speed > CLIMB_EXIT : speed > CLIMB_ENTER) {
+      return PHASE_CLIMBING;
+    }
+    if (phase == PHASE_DESCENT ? speed < SINK_EXIT : speed < SINK_ENTER) {
+      return PHASE_DESCENT;
+    }
+    return PHASE_STEADY;
+  default:
+    return phase;
+  }
+}
+
+flight_phase flight_phase_update(float altitude_m, float vertical_speed_ms,
+                                 uint32_t now_ms) {
+  altitude = altitude_m;
+  vertical_speed = vertical_speed_ms;
+  if (!started) {
+    ground_altitude = altitude_m;
+    last_ms = now_ms;
+    pending_since_ms = now_ms;
+    started = true;
+    return phase;
+  }
+
+  float dt = (now_ms - last_ms) / 1000.0f;
+  last_ms = now_ms;
+  if (phase == PHASE_PAD) {
+    ground_altitude += smoothing(dt, GROUND_TAU_S) * (altitude - ground_altitude);
+  }
+
+  float height = flight_phase_height_m();
+  flight_phase next = evaluate(height, vertical_speed);
+  if (next == phase) {
+    pending = phase;
+  } else if (next != pending) {
+    pending = next;
+    pending_since_ms = now_ms;
+  }
+  if (pending != phase && now_ms - pending_since_ms >= HOLD_MS[pending]) {
+    if (pending == PHASE_DESCENT && (phase == PHASE_PAD || phase == PHASE_LANDED)) {
+      ground_known = false;
+    }
+    if (pending == PHASE_LANDED) {
+      // wherever we came down is the ground now
+      ground_altitude = altitude;
+      ground_known = true;
+    }
+    phase = pending;
+  }
+  return phase;
+}
+
+flight_phase flight_phase_current(void) { return phase; }
+
+const phase_policy *flight_phase_policy(flight_phase phase) {
+  return &POLICIES[phase];
+}
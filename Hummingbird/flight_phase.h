@@ -0,0 +1,50 @@
+/*
+ * flight_phase.h
+ *
+ * Created: 10/19/2026
+ *
+ * Works out what the kite is doing from the filtered altitude and vertical
+ * speed (see altitude.h), and what that means for how often we sample,
+ * transmit and log.
+ */
+
+#ifndef FLIGHT_PHASE_H_
+#define FLIGHT_PHASE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum flight_phase {
+  PHASE_PAD,      // on the ground waiting, tracking ground pressure
+  PHASE_LAUNCH,   // just left the ground
+  PHASE_CLIMBING,
+  PHASE_STEADY,   // flying, not going anywhere much
+  PHASE_DESCENT,
+  PHASE_LANDED,   // back on the ground after a flight
+  PHASE_COUNT
+} flight_phase;
+
+typedef struct phase_policy {
+  uint16_t sample_period_ms;
+  uint16_t transmit_period_ms;
+  uint16_t log_period_ms;
+  uint8_t tx_power_dbm;
+  bool radio_sleep; // sleep the radio between packets
+} phase_policy;
+
+void flight_phase_init(void);
+/*
+Feed the altitude filter output for a reading taken at now_ms (systime_ms),
+returns the phase after it
+*/
+flight_phase flight_phase_update(float altitude_m, float vertical_speed_ms,
+                                 uint32_t now_ms);
+
+flight_phase flight_phase_current(void);
+const phase_policy *flight_phase_policy(flight_phase phase);
+
+// what the decisions are made on
+float flight_phase_height_m(void);          // above the ground reference
+float flight_phase_vertical_speed_ms(void); // up is positive
+
+#endif /* FLIGHT_PHASE_H_ */
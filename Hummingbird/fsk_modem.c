@@ -0,0 +1,67 @@
+/*
+ * fsk_modem.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "fsk_modem.h"
+
+// FXOSC / 2^19, the frequency synthesizer step
+#define FSTEP_SHIFT 19
+
+// length byte in front of the payload and the CRC after it
+static const uint8_t FRAMING_BYTES = 1 + 2;
+
+bool fsk_modem_valid(const fsk_modem *modem) {
+  uint8_t mantissa = (modem->rx_bandwidth >> 3) & 0x03;
+  uint8_t exponent = modem->rx_bandwidth & 0x07;
+  return modem->bit_rate >= FSK_MIN_BIT_RATE &&
+         modem->bit_rate <= FSK_MAX_BIT_RATE && modem->deviation_hz >= 600 &&
+         modem->deviation_hz + modem->bit_rate / 2 <= FSK_MAX_BANDWIDTH_HZ &&
+         mantissa < 3 && exponent >= 1 && modem->preamble_length >= 2;
+}
+
+// FXOSC / (mantissa * 2^(exponent + 2)), page 89 of the HopeRF manual
+uint32_t fsk_rx_bandwidth_hz(uint8_t rx_bandwidth) {
+  uint32_t mantissa = 16 + 4 * ((rx_bandwidth >> 3) & 0x03);
+  uint8_t exponent = rx_bandwidth & 0x07;
+  return FSK_FXOSC_HZ / (mantissa << (exponent + 2));
+}
+
+uint16_t fsk_bit_rate_register(const fsk_modem *modem) {
+  return (uint16_t)((FSK_FXOSC_HZ + modem->bit_rate / 2) / modem->bit_rate);
+}
+
+uint16_t fsk_deviation_register(const fsk_modem *modem) {
+  return (uint16_t)(((uint64_t)modem->deviation_hz << FSTEP_SHIFT) /
+                    FSK_FXOSC_HZ);
+}
+
+void fsk_modem_from_registers(fsk_modem *modem, uint16_t bit_rate,
+                              uint16_t deviation, uint8_t rx_bandwidth,
+                              uint16_t preamble_length) {
+  modem->bit_rate = bit_rate > 0 ? FSK_FXOSC_HZ / bit_rate : 0;
+  modem->deviation_hz =
+      (uint32_t)(((uint64_t)deviation * FSK_FXOSC_HZ) >> FSTEP_SHIFT);
+  modem->rx_bandwidth = rx_bandwidth;
+  modem->preamble_length = preamble_length;
+}
+
+bool fsk_modem_compatible(const fsk_modem *receiver, const fsk_modem *sender) {
+  return fsk_bit_rate_register(receiver) == fsk_bit_rate_register(sender) &&
+         fsk_deviation_register(receiver) == fsk_deviation_register(sender);
+}
+
+// about 10 dB for a BER of 0.1%, page 21 of the SX1276 datasheet
+int8_t fsk_snr_limit(void) { return 40; }
+
+// a bit is BITRATE / 32 us, so a byte is BITRATE / 4
+uint32_t fsk_byte_us(const fsk_modem *modem) {
+  return (fsk_bit_rate_register(modem) + 3) / 4;
+}
+
+uint32_t fsk_airtime_us(const fsk_modem *modem, uint8_t length) {
+  uint32_t bytes =
+      modem->preamble_length + FSK_SYNC_LENGTH + FRAMING_BYTES + length;
+  return (uint32_t)(((uint64_t)bytes * fsk_bit_rate_register(modem) + 3) / 4);
+}
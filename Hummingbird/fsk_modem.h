@@ -0,0 +1,72 @@
+/*
+ * fsk_modem.h
+ *
+ * Created: 10/19/2026
+ *
+ * FSK modem settings for the RFM95's other modem, the fast one for bulk
+ * transfers at close range, and their time on air. Packets are the packet
+ * engine's variable length format:
+ *
+ *   [preamble][sync word][length][payload][crc16]
+ *
+ * with FSK_SYNC_LENGTH bytes of sync word and the CRC on. The bit rate
+ * register is FXOSC / bit rate, so the times come from that rather than the
+ * rate asked for, the same on every end.
+ *
+ * No hardware dependencies, the simulator and the ground build it too.
+ */
+
+#ifndef FSK_MODEM_H_
+#define FSK_MODEM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FSK_FXOSC_HZ 32000000ul
+#define FSK_SYNC_LENGTH 3
+#define FSK_MAX_BIT_RATE 300000ul
+#define FSK_MIN_BIT_RATE 1200ul
+// page 47 of the SX1276 datasheet, deviation + bit rate / 2 at most this
+#define FSK_MAX_BANDWIDTH_HZ 250000ul
+
+// RX_BW register codes: mantissa (bits 4-3) 16, 20 or 24, exponent (bits 2-0)
+#define FSK_RX_BW_250 0x01
+#define FSK_RX_BW_125 0x02
+#define FSK_RX_BW_62_5 0x03
+
+typedef struct fsk_modem {
+  uint32_t bit_rate;     // bits per second
+  uint32_t deviation_hz; // frequency deviation
+  uint8_t rx_bandwidth;  // RX_BW register code, single sided
+  uint16_t preamble_length; // bytes
+} fsk_modem;
+
+// 250 kbps, modulation index 1, the most a 250 kHz channel takes
+#define FSK_MODEM_DEFAULT {250000, 125000, FSK_RX_BW_250, 5}
+
+bool fsk_modem_valid(const fsk_modem *modem);
+uint32_t fsk_rx_bandwidth_hz(uint8_t rx_bandwidth);
+// BITRATE and FDEV register values, 16 bits each
+uint16_t fsk_bit_rate_register(const fsk_modem *modem);
+uint16_t fsk_deviation_register(const fsk_modem *modem);
+// and back again, for the simulator
+void fsk_modem_from_registers(fsk_modem *modem, uint16_t bit_rate,
+                              uint16_t deviation, uint8_t rx_bandwidth,
+                              uint16_t preamble_length);
+// a receiver hears a sender if the bit rate and deviation are the same
+bool fsk_modem_compatible(const fsk_modem *receiver, const fsk_modem *sender);
+/*
+The lowest SNR in the receive bandwidth the demodulator copes with, in
+quarter dB like lora_snr_limit
+*/
+int8_t fsk_snr_limit(void);
+
+// us per byte on air, rounded up
+uint32_t fsk_byte_us(const fsk_modem *modem);
+/*
+Time on air in us of a packet with length bytes of payload (RadioHead's
+header included), preamble to CRC
+*/
+uint32_t fsk_airtime_us(const fsk_modem *modem, uint8_t length);
+
+#endif /* FSK_MODEM_H_ */
@@ -0,0 +1,70 @@
+/*
+ * hop.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "hop.h"
+#include <string.h>
+
+#define CHANNEL(n) HOP_FRF(HOP_FIRST_HZ + (n) * HOP_SPACING_HZ)
+
+// no float math on the way to the radio
+static const uint32_t CHANNEL_FRF[HOP_CHANNELS] = {
+    CHANNEL(0),  CHANNEL(1),  CHANNEL(2),  CHANNEL(3),  CHANNEL(4),
+    CHANNEL(5),  CHANNEL(6),  CHANNEL(7),  CHANNEL(8),  CHANNEL(9),
+    CHANNEL(10), CHANNEL(11), CHANNEL(12), CHANNEL(13), CHANNEL(14),
+    CHANNEL(15), CHANNEL(16), CHANNEL(17), CHANNEL(18), CHANNEL(19),
+    CHANNEL(20), CHANNEL(21), CHANNEL(22), CHANNEL(23), CHANNEL(24),
+    CHANNEL(25), CHANNEL(26), CHANNEL(27), CHANNEL(28), CHANNEL(29),
+    CHANNEL(30), CHANNEL(31), CHANNEL(32), CHANNEL(33), CHANNEL(34),
+    CHANNEL(35), CHANNEL(36), CHANNEL(37), CHANNEL(38), CHANNEL(39),
+    CHANNEL(40), CHANNEL(41), CHANNEL(42), CHANNEL(43), CHANNEL(44),
+    CHANNEL(45), CHANNEL(46), CHANNEL(47), CHANNEL(48), CHANNEL(49),
+    CHANNEL(50), CHANNEL(51), CHANNEL(52), CHANNEL(53), CHANNEL(54),
+    CHANNEL(55), CHANNEL(56), CHANNEL(57), CHANNEL(58), CHANNEL(59),
+    CHANNEL(60), CHANNEL(61), CHANNEL(62), CHANNEL(63),
+};
+
+uint32_t hop_channel_frf(uint8_t channel) {
+  return CHANNEL_FRF[channel % HOP_CHANNELS];
+}
+
+void hop_init(hop_sequence *hop, uint8_t device_id, uint32_t flight,
+              uint16_t dwell_ms, uint32_t now_ms) {
+  memset(hop, 0, sizeof(*hop));
+  hop->dwell_ms = dwell_ms;
+  hop->arrived_ms = now_ms;
+  for (uint8_t i = 0; i < HOP_CHANNELS; i++) {
+    hop->order[i] = i;
+  }
+  // Fisher-Yates on xorshift, spread out so nearby seeds don't start alike
+  uint32_t random = (flight << 8 | device_id) * 2654435761u | 1;
+  for (uint8_t i = HOP_CHANNELS - 1; i > 0; i--) {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    uint8_t j = random % (i + 1);
+    uint8_t swap = hop->order[i];
+    hop->order[i] = hop->order[j];
+    hop->order[j] = swap;
+  }
+}
+
+uint8_t hop_channel(const hop_sequence *hop) {
+  return hop->order[hop->position];
+}
+
+uint32_t hop_next(hop_sequence *hop) {
+  hop->position = (hop->position + 1) % HOP_CHANNELS;
+  hop->hops++;
+  return hop_channel_frf(hop_channel(hop));
+}
+
+uint32_t hop_packet(hop_sequence *hop, uint32_t now_ms) {
+  if (hop->dwell_ms == 0 || now_ms - hop->arrived_ms >= hop->dwell_ms) {
+    hop->arrived_ms = now_ms;
+    return hop_next(hop);
+  }
+  return hop_channel_frf(hop_channel(hop));
+}
@@ -0,0 +1,60 @@
+/*
+ * hop.h
+ *
+ * Created: 10/19/2026
+ *
+ * Frequency hopping over HOP_CHANNELS 125 kHz channels, 200 kHz apart from
+ * 902.3 MHz (the US915 upstream plan), so one busy or jammed frequency and
+ * the other kites on the band only take out a packet here and there. The
+ * channels' FRF register values are worked out at compile time, the radio
+ * gets them as they are.
+ *
+ * Each kite goes through every channel in its own order, shuffled from its
+ * device id and flight number, so two kites only land on the same channel
+ * by chance. With a dwell of 0 each packet goes on the next channel,
+ * otherwise it stays on one until dwell_ms is up. A packet never hops
+ * inside itself, so none is on air for longer than HOP_MAX_DWELL_MS (FCC
+ * 15.247's limit per channel), see TELEMETRY_HOP_PACKET.
+ *
+ * The ground has to hear every channel at once, like a gateway, and answers
+ * on the channel the packet came in on. It doesn't need to know the order.
+ *
+ * No hardware dependencies, the simulated kites use it too.
+ */
+
+#ifndef HOP_H_
+#define HOP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HOP_CHANNELS 64
+#define HOP_FIRST_HZ 902300000ul
+#define HOP_SPACING_HZ 200000ul
+#define HOP_MAX_DWELL_MS 400
+
+// the RFM95's FRF for a carrier frequency, in 32 MHz / 2^19 steps
+#define HOP_FRF(frequency_hz)                                                  \
+  ((uint32_t)(((uint64_t)(frequency_hz) << 19) / 32000000))
+
+typedef struct hop_sequence {
+  uint8_t order[HOP_CHANNELS]; // channel numbers, in the order they're used
+  uint8_t position; // in order, of the channel we're on
+  uint16_t dwell_ms; // 0 for a new channel every packet
+  uint32_t arrived_ms; // on this channel since
+
+  uint32_t hops;
+} hop_sequence;
+
+// FRF of channel 0 to HOP_CHANNELS - 1
+uint32_t hop_channel_frf(uint8_t channel);
+// on the first channel of the order for this kite and flight
+void hop_init(hop_sequence *hop, uint8_t device_id, uint32_t flight,
+              uint16_t dwell_ms, uint32_t now_ms);
+uint8_t hop_channel(const hop_sequence *hop);
+// on to the next channel in the order, returns its FRF
+uint32_t hop_next(hop_sequence *hop);
+// where a packet starting now goes, hopping first if it's time
+uint32_t hop_packet(hop_sequence *hop, uint32_t now_ms);
+
+#endif /* HOP_H_ */
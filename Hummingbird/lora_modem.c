@@ -0,0 +1,143 @@
+/*
+ * lora_modem.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "lora_modem.h"
+
+// 500 kHz divided by these, 7.8 kHz is really 7812.5 Hz and so on
+static const uint8_t BANDWIDTH_DIVISORS[LORA_BW_COUNT] = {
+    64, 48, 32, 24, 16, 12, 8, 4, 2, 1,
+};
+
+// the datasheet wants LowDataRateOptimize on past this
+static const uint32_t LOW_DATA_RATE_SYMBOL_US = 16000;
+
+// MODEM_CONFIG_3 AGC auto on (bit 2), LNA gain set by the internal AGC loop
+static const uint8_t CONFIG_3_AGC_AUTO = 0x04;
+
+static const uint8_t PACKED_CRC = 0x01;
+static const uint8_t PACKED_IMPLICIT_HEADER = 0x02;
+
+bool lora_modem_valid(const lora_modem *modem) {
+  return modem->spreading_factor >= LORA_MIN_SPREADING_FACTOR &&
+         modem->spreading_factor <= LORA_MAX_SPREADING_FACTOR &&
+         modem->bandwidth < LORA_BW_COUNT &&
+         modem->coding_rate >= LORA_CR_4_5 &&
+         modem->coding_rate <= LORA_CR_4_8 &&
+         modem->preamble_length >= LORA_MIN_PREAMBLE &&
+         modem->low_data_rate <= LORA_LDRO_ON;
+}
+
+uint32_t lora_bandwidth_hz(uint8_t bandwidth) {
+  return 500000ul / BANDWIDTH_DIVISORS[bandwidth < LORA_BW_COUNT ? bandwidth
+                                                                : LORA_BW_500];
+}
+
+// 2^SF / (500 kHz / divisor) = 2^(SF + 1) * divisor us
+uint32_t lora_symbol_us(const lora_modem *modem) {
+  uint8_t bandwidth =
+      modem->bandwidth < LORA_BW_COUNT ? modem->bandwidth : LORA_BW_500;
+  return ((uint32_t)2 << modem->spreading_factor) *
+         BANDWIDTH_DIVISORS[bandwidth];
+}
+
+bool lora_low_data_rate_on(const lora_modem *modem) {
+  if (modem->low_data_rate == LORA_LDRO_AUTO) {
+    return lora_symbol_us(modem) > LOW_DATA_RATE_SYMBOL_US;
+  }
+  return modem->low_data_rate == LORA_LDRO_ON;
+}
+
+uint32_t lora_bit_rate(const lora_modem *modem) {
+  // SF bits per symbol, 4 of every 4 + CR of them data
+  return (uint32_t)((uint64_t)modem->spreading_factor * 4 * 1000000 /
+                    ((uint64_t)lora_symbol_us(modem) * (4 + modem->coding_rate)));
+}
+
+int8_t lora_snr_limit(uint8_t spreading_factor) {
+  // 2.5 dB per step, page 27 of the SX1276 datasheet
+  return -30 - 10 * (int8_t)(spreading_factor - LORA_MIN_SPREADING_FACTOR);
+}
+
+bool lora_modem_compatible(const lora_modem *receiver,
+                           const lora_modem *sender) {
+  return receiver->spreading_factor == sender->spreading_factor &&
+         receiver->bandwidth == sender->bandwidth &&
+         receiver->implicit_header == sender->implicit_header &&
+         lora_low_data_rate_on(receiver) == lora_low_data_rate_on(sender);
+}
+
+/*
+Tpacket = (Npreamble + 4.25) * Tsym + Npayload * Tsym, with
+
+  Npayload = 8 + max(ceil((8 PL - 4 SF + 28 + 16 CRC - 20 IH)
+                          / (4 (SF - 2 DE))) * (CR + 4), 0)
+
+Tsym is a multiple of 4 us from SF7 up, so the quarter symbol is exact.
+*/
+uint32_t lora_airtime_us(const lora_modem *modem, uint8_t length) {
+  int32_t sf = modem->spreading_factor;
+  int32_t numerator = 8 * (int32_t)length - 4 * sf + 28 +
+                      (modem->crc ? 16 : 0) - (modem->implicit_header ? 20 : 0);
+  int32_t denominator = 4 * (sf - (lora_low_data_rate_on(modem) ? 2 : 0));
+  uint32_t payload_symbols = 8;
+  if (numerator > 0) {
+    payload_symbols += (uint32_t)((numerator + denominator - 1) / denominator) *
+                       (modem->coding_rate + 4);
+  }
+
+  uint64_t symbol = lora_symbol_us(modem);
+  uint64_t airtime = (uint64_t)modem->preamble_length * symbol +
+                     symbol * 17 / 4 + payload_symbols * symbol;
+  return airtime > UINT32_MAX ? UINT32_MAX : (uint32_t)airtime;
+}
+
+/*
+See pages 106-107 of the HopeRF 95/96/97/98(W) manual
+
+MODEM_CONFIG_1: bandwidth (bits 7-4), coding rate (bits 3-1), implicit
+header (bit 0)
+MODEM_CONFIG_2: spreading factor (bits 7-4), TX continuous (bit 3, off),
+payload CRC (bit 2), RX timeout MSB (bits 1-0, left 0)
+MODEM_CONFIG_3: LowDataRateOptimize (bit 3), AGC auto (bit 2, always on)
+*/
+void lora_modem_to_registers(const lora_modem *modem, uint8_t config[3]) {
+  config[0] = (uint8_t)(modem->bandwidth << 4 | modem->coding_rate << 1 |
+                        (modem->implicit_header ? 0x01 : 0));
+  config[1] = (uint8_t)(modem->spreading_factor << 4 | (modem->crc ? 0x04 : 0));
+  config[2] = (lora_low_data_rate_on(modem) ? 0x08 : 0) | CONFIG_3_AGC_AUTO;
+}
+
+void lora_modem_from_registers(lora_modem *modem, const uint8_t config[3],
+                               uint16_t preamble_length) {
+  modem->bandwidth = config[0] >> 4;
+  modem->coding_rate = (config[0] >> 1) & 0x07;
+  modem->implicit_header = config[0] & 0x01;
+  modem->spreading_factor = config[1] >> 4;
+  modem->crc = (config[1] >> 2) & 0x01;
+  modem->low_data_rate = (config[2] & 0x08) ? LORA_LDRO_ON : LORA_LDRO_OFF;
+  modem->preamble_length = preamble_length;
+}
+
+void lora_modem_pack(const lora_modem *modem, uint8_t *out) {
+  out[0] = modem->spreading_factor;
+  out[1] = modem->bandwidth;
+  out[2] = modem->coding_rate;
+  out[3] = modem->preamble_length & 0xff;
+  out[4] = modem->preamble_length >> 8;
+  out[5] = (modem->crc ? PACKED_CRC : 0) |
+           (modem->implicit_header ? PACKED_IMPLICIT_HEADER : 0) |
+           modem->low_data_rate << 2;
+}
+
+void lora_modem_unpack(lora_modem *modem, const uint8_t *in) {
+  modem->spreading_factor = in[0];
+  modem->bandwidth = in[1];
+  modem->coding_rate = in[2];
+  modem->preamble_length = in[3] | in[4] << 8;
+  modem->crc = in[5] & PACKED_CRC;
+  modem->implicit_header = in[5] & PACKED_IMPLICIT_HEADER;
+  modem->low_data_rate = (in[5] >> 2) & 0x03;
+}
@@ -0,0 +1,106 @@
+/*
+ * lora_modem.h
+ *
+ * Created: 10/19/2026
+ *
+ * LoRa modem settings and their exact time on air, from the formula in
+ * section 4.1.1.7 of the SX1276 datasheet (AN1200.13 has the same thing).
+ *
+ * Every bandwidth is 500 kHz divided by a whole number, so a symbol is a
+ * whole number of microseconds and so is the whole packet: no floats, and
+ * the firmware, the simulator and the ground tools all get the same answer.
+ *
+ * No hardware dependencies, the ground tools build it too.
+ */
+
+#ifndef LORA_MODEM_H_
+#define LORA_MODEM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// MODEM_CONFIG_1 bandwidth codes, page 106 of the HopeRF manual
+typedef enum lora_bandwidth {
+  LORA_BW_7_8 = 0,
+  LORA_BW_10_4 = 1,
+  LORA_BW_15_6 = 2,
+  LORA_BW_20_8 = 3,
+  LORA_BW_31_25 = 4,
+  LORA_BW_41_7 = 5,
+  LORA_BW_62_5 = 6,
+  LORA_BW_125 = 7,
+  LORA_BW_250 = 8,
+  LORA_BW_500 = 9,
+  LORA_BW_COUNT
+} lora_bandwidth;
+
+// coding rate 4/(4 + n)
+typedef enum lora_coding_rate {
+  LORA_CR_4_5 = 1,
+  LORA_CR_4_6 = 2,
+  LORA_CR_4_7 = 3,
+  LORA_CR_4_8 = 4,
+} lora_coding_rate;
+
+typedef enum lora_low_data_rate {
+  LORA_LDRO_AUTO, // on when a symbol is longer than 16 ms, as Semtech asks
+  LORA_LDRO_OFF,
+  LORA_LDRO_ON,
+} lora_low_data_rate;
+
+#define LORA_MIN_SPREADING_FACTOR 7 // SF6 needs implicit headers, not supported
+#define LORA_MAX_SPREADING_FACTOR 12
+#define LORA_MIN_PREAMBLE 6
+
+typedef struct lora_modem {
+  uint8_t spreading_factor; // 7 to 12
+  uint8_t bandwidth;        // lora_bandwidth
+  uint8_t coding_rate;      // lora_coding_rate
+  uint16_t preamble_length; // symbols, the radio adds 4.25 more
+  bool crc;
+  bool implicit_header;
+  uint8_t low_data_rate; // lora_low_data_rate
+} lora_modem;
+
+// what RadioHead calls Bw125Cr45Sf128, which the kite starts out on
+#define LORA_MODEM_DEFAULT                                                     \
+  {7, LORA_BW_125, LORA_CR_4_5, 8, true, false, LORA_LDRO_AUTO}
+
+bool lora_modem_valid(const lora_modem *modem);
+uint32_t lora_bandwidth_hz(uint8_t bandwidth);
+uint32_t lora_symbol_us(const lora_modem *modem);
+// whether LowDataRateOptimize ends up on, with LORA_LDRO_AUTO resolved
+bool lora_low_data_rate_on(const lora_modem *modem);
+// payload bits per second on air, header and preamble not counted
+uint32_t lora_bit_rate(const lora_modem *modem);
+/*
+The lowest SNR the demodulator copes with, in quarter dB like the radio's
+PKT_SNR register: -7.5 dB at SF7 down to -20 dB at SF12
+*/
+int8_t lora_snr_limit(uint8_t spreading_factor);
+/*
+Whether a receiver with one set of settings hears a sender with another.
+Coding rate and CRC come from the explicit header and the preamble only has
+to be long enough, so spreading factor, bandwidth, header mode and
+LowDataRateOptimize are what have to agree.
+*/
+bool lora_modem_compatible(const lora_modem *receiver,
+                           const lora_modem *sender);
+
+/*
+Time on air in us of a packet with length bytes of payload (everything
+written to the FIFO, RadioHead's header included), preamble to CRC.
+*/
+uint32_t lora_airtime_us(const lora_modem *modem, uint8_t length);
+
+// MODEM_CONFIG_1..3 register values, and back again
+void lora_modem_to_registers(const lora_modem *modem, uint8_t config[3]);
+void lora_modem_from_registers(lora_modem *modem, const uint8_t config[3],
+                               uint16_t preamble_length);
+
+// packed for the uplink: [sf][bw][cr][preamble u16 LE][flags]
+#define LORA_MODEM_PACKED 6
+void lora_modem_pack(const lora_modem *modem, uint8_t *out);
+void lora_modem_unpack(lora_modem *modem, const uint8_t *in);
+
+#endif /* LORA_MODEM_H_ */
@@ -0,0 +1,27 @@
+/*
+ * profile.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "profile.h"
+#include "systime.h"
+#include <string.h>
+
+static profile_stats stats[PROFILE_STAGE_COUNT];
+
+uint32_t profile_begin(void) { return systime_us(); }
+
+void profile_end(profile_stage stage, uint32_t start_us) {
+  uint32_t elapsed = systime_us() - start_us;
+  profile_stats *s = &stats[stage];
+  s->count++;
+  s->total_us += elapsed;
+  if (elapsed > s->max_us) {
+    s->max_us = elapsed;
+  }
+}
+
+const profile_stats *profile_get(profile_stage stage) { return &stats[stage]; }
+
+void profile_reset(void) { memset(stats, 0, sizeof(stats)); }
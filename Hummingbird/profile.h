@@ -0,0 +1,41 @@
+/*
+ * profile.h
+ *
+ * Created: 10/19/2026
+ *
+ * Per stage timing of the telemetry pipeline, in microseconds of systime.
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+
+typedef enum profile_stage {
+  PROFILE_ACQUIRE, // BMP388 + battery ADC
+  PROFILE_ALTITUDE, // altitude table and Kalman filter
+  PROFILE_CODEC, // delta compressing samples for the radio and log
+  PROFILE_FEC, // repair packets for the radio
+  PROFILE_CRC,
+  PROFILE_RADIO, // loading and starting the RFM95
+  PROFILE_FLASH, // appending to the flash log
+  PROFILE_ERASE, // starting erases ahead of the flash log, in idle time
+  PROFILE_UPLINK, // handling a command from the ground
+  PROFILE_PRETRIGGER, // emptying the BMP388 FIFO into the pre-trigger buffer
+  PROFILE_STAGE_COUNT
+} profile_stage;
+
+typedef struct profile_stats {
+  uint32_t count;
+  uint32_t max_us;
+  uint64_t total_us;
+} profile_stats;
+
+// returns the start time to hand to profile_end
+uint32_t profile_begin(void);
+void profile_end(profile_stage stage, uint32_t start_us);
+
+const profile_stats *profile_get(profile_stage stage);
+void profile_reset(void);
+
+#endif /* PROFILE_H_ */
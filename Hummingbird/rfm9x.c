@@ -9,11 +9,15 @@
 #include "atmel_start.h"
 #include "atmel_start_pins.h"
 #include "error.h"
+#include "hpl_sercom_config.h"
+#include <string.h>
 
 static void spi_write_register(uint8_t address, uint8_t value);
 static uint8_t spi_read_register(uint8_t address);
-static void rfm9x_set_frequency(float);
-static void rfm9x_set_power(uint8_t);
+static void rfm9x_set_mode(uint8_t mode);
+static void rfm9x_wait_packet_sent(void);
+static void spi_read_fifo(uint8_t *data, uint8_t length);
+static void spi_write_fifo(const uint8_t *data, uint8_t length);
 
 static const uint8_t WNR_MASK = 0x80;
 
@@ -26,53 +30,110 @@ static const uint8_t RFM95_REG_FRF_LSB = 0x08;
 static const uint8_t RFM95_REG_PA_CONFIG = 0x09;
 static const uint8_t RFM95_REG_FIFO_ADDRESS = 0x0d;
 static const uint8_t RFM95_REG_FIFO_TX_ADDRESS = 0x0e;
+static const uint8_t RFM95_REG_FIFO_RX_ADDRESS = 0x0f;
+static const uint8_t RFM95_REG_FIFO_RX_CURRENT_ADDRESS = 0x10;
+static const uint8_t RFM95_REG_IRQ_FLAGS = 0x12;
+static const uint8_t RFM95_REG_RX_NB_BYTES = 0x13;
+static const uint8_t RFM95_REG_PKT_SNR = 0x19;
+static const uint8_t RFM95_REG_PKT_RSSI = 0x1a;
 static const uint8_t RFM95_REG_MODEM_CONFIG_1 = 0x1d;
 static const uint8_t RFM95_REG_MODEM_CONFIG_2 = 0x1e;
+static const uint8_t RFM95_REG_SYMB_TIMEOUT_LSB = 0x1f;
 static const uint8_t RFM95_REG_PREAMBLE_MSB = 0x20;
 static const uint8_t RFM95_REG_PREAMBLE_LSB = 0x21;
 static const uint8_t RFM95_REG_PAYLOAD_LENGTH = 0x22;
 static const uint8_t RFM95_REG_MODEM_CONFIG_3 = 0x26;
+static const uint8_t RFM95_REG_RSSI_WIDEBAND = 0x2c;
+static const uint8_t RFM95_REG_DIO_MAPPING_1 = 0x40;
 static const uint8_t RFM95_REG_PA_DAC = 0x4d;
 // const static uint8_t RFM95_REG_VERSION = 0x42;
 
+// FSK mode registers, pages 86-96, 0x0d to 0x3f mean something else in LoRa
+static const uint8_t FSK_REG_BITRATE_MSB = 0x02;
+static const uint8_t FSK_REG_BITRATE_LSB = 0x03;
+static const uint8_t FSK_REG_FDEV_MSB = 0x04;
+static const uint8_t FSK_REG_FDEV_LSB = 0x05;
+static const uint8_t FSK_REG_RSSI_VALUE = 0x11;
+static const uint8_t FSK_REG_RX_BW = 0x12;
+static const uint8_t FSK_REG_PREAMBLE_MSB = 0x25;
+static const uint8_t FSK_REG_PREAMBLE_LSB = 0x26;
+static const uint8_t FSK_REG_SYNC_CONFIG = 0x27;
+static const uint8_t FSK_REG_SYNC_VALUE_1 = 0x28;
+static const uint8_t FSK_REG_PACKET_CONFIG_1 = 0x30;
+static const uint8_t FSK_REG_PACKET_CONFIG_2 = 0x31;
+static const uint8_t FSK_REG_PAYLOAD_LENGTH = 0x32;
+static const uint8_t FSK_REG_FIFO_THRESH = 0x35;
+static const uint8_t FSK_REG_IRQ_FLAGS_2 = 0x3f;
+
 // Modes
 static const uint8_t OP_MODE_SLEEP = 0x00;      // 000 SLEEP
 static const uint8_t OP_MODE_STANDBY = 0x01;    // 001 Standby
 static const uint8_t OP_MODE_TX = 0x03;         // 011 Transmit
+static const uint8_t OP_MODE_RX_CONTINUOUS = 0x05; // 101 Receive continuous
+static const uint8_t OP_MODE_RX_SINGLE = 0x06;  // 110 Receive single
+static const uint8_t OP_MODE_CAD = 0x07;        // 111 Channel activity detection
 static const uint8_t OP_MODE_LONG_RANGE = 0x80; // 1000 0000
-
-// Config, defaults to Bw125Cr45Sf128
-
+static const uint8_t OP_MODE_MASK = 0x07;
+
+// FSK IRQ flags 2, page 96
+static const uint8_t FSK_IRQ_FIFO_LEVEL = 0x20;
+static const uint8_t FSK_IRQ_FIFO_OVERRUN = 0x10; // write 1 to empty the FIFO
+static const uint8_t FSK_IRQ_PACKET_SENT = 0x08;
+
+// auto restart RX after a packet, sync word on, FSK_SYNC_LENGTH bytes
+static const uint8_t FSK_SYNC_CONFIG = 0x40 | 0x10 | (FSK_SYNC_LENGTH - 1);
+static const uint8_t FSK_SYNC_WORD[FSK_SYNC_LENGTH] = {0x2d, 0xd4, 0x4b};
+// variable length, whitening, CRC on
+static const uint8_t FSK_PACKET_CONFIG_1 = 0x80 | 0x40 | 0x10;
+// packet mode
+static const uint8_t FSK_PACKET_CONFIG_2 = 0x40;
+static const uint8_t FSK_FIFO_SIZE = 64;
 /*
-See page 106 of HopeRF 95/96/97/98(W) manual
-
-signal bandwidth (bits 7-4): 0111 = 125 kHZ
-coding rate (bits 3-1): 001 = 4/5
-implicit header mode (bit 0): 0 = explicit header mode
+FifoLevel is set while there are more than this many bytes in the FIFO.
+TX starts as soon as the FIFO isn't empty (bit 7).
 */
-static const uint8_t RFM95_CONFIG_1 = 0x72;
-/*
-See page 107 of HopeRF 95/96/97/98(W) manual
+static const uint8_t FSK_FIFO_THRESHOLD = 31;
+static const uint8_t FSK_TX_START_FIFO_NOT_EMPTY = 0x80;
 
-Spreading factor (bits 7-4): 0111 = 128 chips / symbol
-TX continuous mode (bit 3): 0 = normal mode
-RX Payload CRC (bit 2): 1 = Header CRC on
-RX Timeout MSB (bits 1-0): 0 = ??? (I don't think this is used)
-*/
-static const uint8_t RFM95_CONFIG_2 = 0x74;
 /*
-See page 107 of HopeRF 95/96/97/98(W) manual
-
-Unused (bits 7-4)
-Mobile  node (bit 3): 0 = static node
-AGC Auto On (bit 2): 1 =  LNA Gain set by internal AGC loop
-Reserved (bits 1-0): 0 = ??
+SERCOM4 BAUD register values, BAUD = 8 MHz / (2 * rate) - 1. At 250 kbps FSK
+drains the FIFO far faster than the LoRa rate can fill it, so the bus runs at
+4 MHz in FSK mode.
 */
-static const uint8_t RFM95_CONFIG_3 = 0x04;
+static const uint32_t SPI_BAUD_FSK = 0;
+
+// IRQ flags, page 111
+static const uint8_t IRQ_RX_TIMEOUT = 0x80;
+static const uint8_t IRQ_RX_DONE = 0x40;
+static const uint8_t IRQ_PAYLOAD_CRC_ERROR = 0x20;
+static const uint8_t IRQ_CAD_DONE = 0x04;
+static const uint8_t IRQ_CAD_DETECTED = 0x01;
+
+// most backoff slots after a busy check, doubling from 2 up to this
+static const uint8_t LBT_MAX_SLOTS = 32;
+
+// DIO0 (LORA_INT) mapping, bits 7-6 of RegDioMapping1, page 69
+static const uint8_t DIO0_RX_DONE = 0x00;
+
+// RSSI offset for the high frequency port (the 915 MHz band), page 87
+static const int16_t RSSI_OFFSET = -157;
+
+// the RadioHead header rfm9x_send puts in front of every packet
+static const uint8_t HEADER_LENGTH = 4;
 
 // globals :gulp:
 
 static struct io_descriptor *io;
+// which receive mode we put the radio in, 0 when not receiving
+static uint8_t receive_mode;
+static lora_modem modem = LORA_MODEM_DEFAULT;
+static bool fsk;
+static fsk_modem fsk_settings = FSK_MODEM_DEFAULT;
+static uint32_t random_state;
+static uint8_t busy_in_row;
+static rfm9x_lbt_stats lbt_stats;
+// what's in the FRF registers
+static uint32_t frf;
 
 void rfm9x_init() {
   spi_m_sync_get_io_descriptor(&SPI_1, &io);
@@ -82,6 +143,7 @@ void rfm9x_init() {
   delay_ms(10);
   gpio_set_pin_level(LORA_RESET, true);
   delay_ms(10);
+  fsk = false;
 
   uint8_t new_mode = OP_MODE_SLEEP | OP_MODE_LONG_RANGE;
   spi_write_register(RFM95_REG_OP_MODE, new_mode);
@@ -95,20 +157,34 @@ void rfm9x_init() {
   spi_write_register(RFM95_REG_FIFO_TX_ADDRESS, 0);
 
   // set mode to idle
-  spi_write_register(RFM95_REG_OP_MODE, OP_MODE_STANDBY);
-
-  // set modem config Bandwidth: 125, Coding Rate: 4/5, Spreading Factor
-  // 128, AGC enabled
-  spi_write_register(RFM95_REG_MODEM_CONFIG_1, RFM95_CONFIG_1);
-  spi_write_register(RFM95_REG_MODEM_CONFIG_2, RFM95_CONFIG_2);
-  spi_write_register(RFM95_REG_MODEM_CONFIG_3, RFM95_CONFIG_3);
-
-  // set preamble to 8
-  spi_write_register(RFM95_REG_PREAMBLE_MSB, 0);
-  spi_write_register(RFM95_REG_PREAMBLE_LSB, 8);
-
-  // set frequency magic with FRF registers
-  rfm9x_set_frequency(915.0);
+  rfm9x_set_mode(OP_MODE_STANDBY);
+
+  // Bandwidth: 125, Coding Rate: 4/5, Spreading Factor 128, preamble 8,
+  // AGC enabled
+  const lora_modem initial = LORA_MODEM_DEFAULT;
+  rfm9x_set_modem(&initial);
+
+  rfm9x_set_frequency(RFM9X_FREQUENCY_HZ);
+
+  /*
+  The wideband RSSI's low bit is noise, different on every kite, but only
+  with the receiver running (Semtech's SX1276Random). In standby it holds
+  still. A millisecond between reads gives it time to change.
+  */
+  rfm9x_set_mode(OP_MODE_RX_CONTINUOUS);
+  random_state = 0;
+  for (uint8_t i = 0; i < 32; i++) {
+    delay_ms(1);
+    random_state = random_state << 1 |
+                   (spi_read_register(RFM95_REG_RSSI_WIDEBAND) & 0x01);
+  }
+  rfm9x_set_mode(OP_MODE_STANDBY);
+  spi_write_register(RFM95_REG_IRQ_FLAGS, 0xff); // anything it heard
+  if (random_state == 0) {
+    random_state = 0x2545f491; // xorshift never leaves 0
+  }
+  busy_in_row = 0;
+  memset(&lbt_stats, 0, sizeof(lbt_stats));
 
   // disable PA since I don't think I need lots of power
 
@@ -117,64 +193,427 @@ void rfm9x_init() {
 }
 
 void rfm9x_send(uint8_t *data, uint8_t length) {
-  // wait for packet sent?
-  // set mode to standby
-  spi_write_register(RFM95_REG_OP_MODE, OP_MODE_STANDBY);
-  // wait for Channel Activity Detected to be false?
+  rfm9x_send_flags(data, length, 0x00);
+}
+
+/*
+The length byte, header and as much as fits go in first, then the rest in
+pieces each time the FIFO drains down to the threshold
+*/
+static void fsk_send(const uint8_t *data, uint8_t length, uint8_t flags) {
+  rfm9x_set_mode(OP_MODE_STANDBY);
+  spi_write_register(FSK_REG_IRQ_FLAGS_2, FSK_IRQ_FIFO_OVERRUN);
+
+  uint8_t first[FSK_FIFO_SIZE];
+  first[0] = HEADER_LENGTH + length;
+  first[1] = 0xff;
+  first[2] = 0xff;
+  first[3] = 0x00;
+  first[4] = flags;
+  uint8_t room = FSK_FIFO_SIZE - 1 - HEADER_LENGTH;
+  uint8_t sent = length < room ? length : room;
+  memcpy(first + 1 + HEADER_LENGTH, data, sent);
+  spi_write_fifo(first, 1 + HEADER_LENGTH + sent);
+  rfm9x_set_mode(OP_MODE_TX);
+
+  while (sent < length) {
+    while (spi_read_register(FSK_REG_IRQ_FLAGS_2) & FSK_IRQ_FIFO_LEVEL) {
+    }
+    uint8_t piece = FSK_FIFO_SIZE - FSK_FIFO_THRESHOLD - 1;
+    if (length - sent < piece) {
+      piece = length - sent;
+    }
+    spi_write_fifo(data + sent, piece);
+    sent += piece;
+  }
+}
 
-  // set the FIFO to 0
+static void set_bus_fast(bool fast) {
+  spi_m_sync_disable(&SPI_1);
+  spi_m_sync_set_baudrate(&SPI_1,
+                          fast ? SPI_BAUD_FSK : CONF_SERCOM_4_SPI_BAUD_RATE);
+  spi_m_sync_enable(&SPI_1);
+}
+
+/*
+LoRa only, everything but going into TX. The FIFO only takes writes in
+standby, so the packet can't go in while the one before is still on air.
+Instead it goes in as one burst on the fast bus, a fraction of a ms for a
+full FIFO, where a register write at a time at the LoRa rate took 3.2 ms a
+byte.
+*/
+static void load_fifo(const uint8_t *data, uint8_t length, uint8_t flags) {
+  rfm9x_set_mode(OP_MODE_STANDBY);
+
+  // RadioHead's header: to, from, id (broadcast, no id) and flags
+  const uint8_t header[] = {0xff, 0xff, 0x00, flags};
+  set_bus_fast(true);
   spi_write_register(RFM95_REG_FIFO_ADDRESS, 0);
+  spi_write_fifo(header, HEADER_LENGTH);
+  spi_write_fifo(data, length);
+  spi_write_register(RFM95_REG_PAYLOAD_LENGTH, HEADER_LENGTH + length);
+  // clear TxDone from the last packet
+  spi_write_register(RFM95_REG_IRQ_FLAGS, 0xff);
+  set_bus_fast(false);
+}
+
+static void write_frf(uint32_t new_frf) {
+  spi_write_register(RFM95_REG_FRF_MSB, (new_frf >> 16) & 0xff);
+  spi_write_register(RFM95_REG_FRF_MID, (new_frf >> 8) & 0xff);
+  // the carrier moves when the LSB is written
+  spi_write_register(RFM95_REG_FRF_LSB, new_frf & 0xff);
+  frf = new_frf;
+}
 
-  // sending is done by writing to the RH_RF95_REG_00_FIFO register
+void rfm9x_send_flags(uint8_t *data, uint8_t length, uint8_t flags) {
+  if (fsk) {
+    rfm9x_wait_packet_sent();
+    fsk_send(data, length, flags);
+    return;
+  }
+  load_fifo(data, length, flags);
+  // set the mode to TX
+  rfm9x_set_mode(OP_MODE_TX);
+}
 
-  // send 4 "header" bytes for radiohead compatibility
-  // header to (default to 0xff)
-  spi_write_register(RFM95_REG_FIFO, 0xff);
-  // header from (default to 0xff)
-  spi_write_register(RFM95_REG_FIFO, 0xff);
-  // header id (default 0x00)
-  spi_write_register(RFM95_REG_FIFO, 0x00);
-  // header flags (default 0x00)
-  spi_write_register(RFM95_REG_FIFO, 0x00);
+void rfm9x_sleep(void) {
+  rfm9x_wait_packet_sent();
+  rfm9x_set_mode(OP_MODE_SLEEP);
+}
 
-  // write data to FIFO register
-  for (uint8_t i = 0; i < length; i++) {
-    spi_write_register(RFM95_REG_FIFO, data[i]);
+bool rfm9x_set_modem(const lora_modem *new_modem) {
+  if (!lora_modem_valid(new_modem) || new_modem->implicit_header) {
+    return false;
+  }
+  if (fsk) {
+    modem = *new_modem; // for when it goes back to LoRa
+    return true;
   }
+  uint8_t config[3];
+  lora_modem_to_registers(new_modem, config);
+  rfm9x_standby();
+  spi_write_register(RFM95_REG_MODEM_CONFIG_1, config[0]);
+  spi_write_register(RFM95_REG_MODEM_CONFIG_2, config[1]);
+  spi_write_register(RFM95_REG_MODEM_CONFIG_3, config[2]);
+  spi_write_register(RFM95_REG_PREAMBLE_MSB, new_modem->preamble_length >> 8);
+  spi_write_register(RFM95_REG_PREAMBLE_LSB, new_modem->preamble_length & 0xff);
+  modem = *new_modem;
+  return true;
+}
 
-  // write payload len to RH_RF95_REG_22_PAYLOAD_LENGTH (which is length + 4)
-  spi_write_register(RFM95_REG_PAYLOAD_LENGTH, length + 4);
+const lora_modem *rfm9x_modem(void) { return &modem; }
 
-  // set the mode to TX
-  spi_write_register(RFM95_REG_OP_MODE, OP_MODE_TX);
+/*
+LongRangeMode only changes in sleep. The LoRa and FSK registers from 0x0d up
+are separate pages, so each mode keeps its own settings across the switch.
+*/
+static void switch_modem(bool to_fsk) {
+  rfm9x_wait_packet_sent();
+  rfm9x_set_mode(OP_MODE_SLEEP);
+  fsk = to_fsk;
+  rfm9x_set_mode(OP_MODE_SLEEP);
+  rfm9x_set_mode(OP_MODE_STANDBY);
+
+  set_bus_fast(to_fsk);
+}
+
+bool rfm9x_set_fsk(const fsk_modem *settings) {
+  if (!fsk_modem_valid(settings)) {
+    return false;
+  }
+  if (!fsk) {
+    switch_modem(true);
+  }
+  rfm9x_standby();
+  uint16_t bit_rate = fsk_bit_rate_register(settings);
+  uint16_t deviation = fsk_deviation_register(settings);
+  spi_write_register(FSK_REG_BITRATE_MSB, bit_rate >> 8);
+  spi_write_register(FSK_REG_BITRATE_LSB, bit_rate & 0xff);
+  spi_write_register(FSK_REG_FDEV_MSB, deviation >> 8);
+  spi_write_register(FSK_REG_FDEV_LSB, deviation & 0xff);
+  spi_write_register(FSK_REG_RX_BW, settings->rx_bandwidth);
+  spi_write_register(FSK_REG_PREAMBLE_MSB, settings->preamble_length >> 8);
+  spi_write_register(FSK_REG_PREAMBLE_LSB, settings->preamble_length & 0xff);
+  spi_write_register(FSK_REG_SYNC_CONFIG, FSK_SYNC_CONFIG);
+  for (uint8_t i = 0; i < FSK_SYNC_LENGTH; i++) {
+    spi_write_register(FSK_REG_SYNC_VALUE_1 + i, FSK_SYNC_WORD[i]);
+  }
+  spi_write_register(FSK_REG_PACKET_CONFIG_1, FSK_PACKET_CONFIG_1);
+  spi_write_register(FSK_REG_PACKET_CONFIG_2, FSK_PACKET_CONFIG_2);
+  spi_write_register(FSK_REG_PAYLOAD_LENGTH, 0xff); // longest it will take
+  spi_write_register(FSK_REG_FIFO_THRESH,
+                     FSK_TX_START_FIFO_NOT_EMPTY | FSK_FIFO_THRESHOLD);
+  fsk_settings = *settings;
+  return true;
+}
+
+void rfm9x_set_lora(void) {
+  if (!fsk) {
+    return;
+  }
+  switch_modem(false);
+  spi_write_register(RFM95_REG_FIFO_TX_ADDRESS, 0);
+  const lora_modem settings = modem;
+  rfm9x_set_modem(&settings);
+}
+
+bool rfm9x_fsk(void) { return fsk; }
+
+bool rfm9x_channel_active(void) {
+  rfm9x_wait_packet_sent();
+  rfm9x_set_mode(OP_MODE_STANDBY);
+  rfm9x_set_mode(OP_MODE_CAD);
+  // a couple of symbols, then it drops back to standby by itself
+  uint8_t flags;
+  do {
+    flags = spi_read_register(RFM95_REG_IRQ_FLAGS);
+  } while (!(flags & IRQ_CAD_DONE));
+  spi_write_register(RFM95_REG_IRQ_FLAGS, 0xff);
+  lbt_stats.checks++;
+  return flags & IRQ_CAD_DETECTED;
+}
+
+static uint32_t random_next(void) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+/*
+The channel is checked with the packet already loaded, so it goes on air as
+soon after the check as it can
+*/
+bool rfm9x_send_lbt(uint8_t *data, uint8_t length, uint8_t flags,
+                    uint32_t *backoff_ms) {
+  if (fsk) {
+    rfm9x_send_flags(data, length, flags);
+    return true;
+  }
+  rfm9x_wait_packet_sent();
+  load_fifo(data, length, flags);
+  bool busy = rfm9x_channel_active();
+  if (busy) {
+    lbt_stats.busy++;
+  }
+  if (busy && ++busy_in_row >= RFM9X_LBT_ATTEMPTS) {
+    lbt_stats.forced++;
+    busy = false;
+  }
+  if (!busy) {
+    busy_in_row = 0;
+    rfm9x_set_mode(OP_MODE_TX);
+    return true;
+  }
+  // binary exponential, in slots of this packet's time on air
+  uint32_t slots = 1ul << busy_in_row;
+  if (slots > LBT_MAX_SLOTS) {
+    slots = LBT_MAX_SLOTS;
+  }
+  uint32_t slot_ms = rfm9x_airtime_us(length) / 1000 + 1;
+  *backoff_ms = (1 + random_next() % slots) * slot_ms;
+  lbt_stats.backoff_ms += *backoff_ms;
+  return false;
+}
+
+const rfm9x_lbt_stats *rfm9x_lbt(void) { return &lbt_stats; }
+
+uint32_t rfm9x_airtime_us(uint8_t length) {
+  if (fsk) {
+    return fsk_airtime_us(&fsk_settings, length + HEADER_LENGTH);
+  }
+  return lora_airtime_us(&modem, length + HEADER_LENGTH);
+}
+
+void rfm9x_standby(void) {
+  rfm9x_wait_packet_sent();
+  rfm9x_set_mode(OP_MODE_STANDBY);
+}
+
+static void rfm9x_start_receive(uint8_t mode) {
+  rfm9x_wait_packet_sent();
+  rfm9x_set_mode(OP_MODE_STANDBY);
+  if (fsk) {
+    // DIO0 is PayloadReady with the same mapping
+    spi_write_register(RFM95_REG_DIO_MAPPING_1, DIO0_RX_DONE);
+    spi_write_register(FSK_REG_IRQ_FLAGS_2, FSK_IRQ_FIFO_OVERRUN);
+    rfm9x_set_mode(OP_MODE_RX_CONTINUOUS);
+    receive_mode = OP_MODE_RX_CONTINUOUS;
+    return;
+  }
+  spi_write_register(RFM95_REG_DIO_MAPPING_1, DIO0_RX_DONE);
+  spi_write_register(RFM95_REG_FIFO_RX_ADDRESS, 0);
+  spi_write_register(RFM95_REG_FIFO_ADDRESS, 0);
+  spi_write_register(RFM95_REG_IRQ_FLAGS, 0xff);
+  rfm9x_set_mode(mode);
+  receive_mode = mode;
+}
+
+void rfm9x_receive(void) { rfm9x_start_receive(OP_MODE_RX_CONTINUOUS); }
+
+void rfm9x_receive_single(uint8_t timeout_symbols) {
+  if (fsk) {
+    rfm9x_receive();
+    return;
+  }
+  // the top two bits of the timeout live in MODEM_CONFIG_2, keep them 0
+  spi_write_register(RFM95_REG_SYMB_TIMEOUT_LSB, timeout_symbols);
+  rfm9x_start_receive(OP_MODE_RX_SINGLE);
+}
+
+/*
+PayloadReady only comes up for a packet that passed its CRC, the packet
+engine throws the rest away. There's no SNR in FSK mode.
+*/
+static rfm9x_receive_status fsk_poll(rfm9x_packet *packet) {
+  if (!gpio_get_pin_level(LORA_INT)) {
+    return RFM9X_RX_NOTHING;
+  }
+  uint8_t length;
+  spi_read_fifo(&length, 1);
+  if (length < HEADER_LENGTH || length >= FSK_FIFO_SIZE) {
+    spi_write_register(FSK_REG_IRQ_FLAGS_2, FSK_IRQ_FIFO_OVERRUN);
+    return RFM9X_RX_CRC_ERROR; // not one of ours, or more than we can take
+  }
+  uint8_t header[HEADER_LENGTH];
+  spi_read_fifo(header, HEADER_LENGTH);
+  packet->from = header[1];
+  packet->flags = header[3];
+  packet->length = length - HEADER_LENGTH;
+  spi_read_fifo(packet->data, packet->length);
+  packet->snr_db = 0;
+  packet->rssi_dbm = -(int16_t)spi_read_register(FSK_REG_RSSI_VALUE) / 2;
+  return RFM9X_RX_PACKET;
+}
+
+/*
+DIO0 goes high on RxDone, so while nothing has arrived polling is just a pin
+read. RxTimeout is on DIO1 which isn't wired up, in single mode that needs a
+look at the IRQ flags.
+*/
+rfm9x_receive_status rfm9x_poll(rfm9x_packet *packet) {
+  if (fsk) {
+    return fsk_poll(packet);
+  }
+  uint8_t flags;
+  if (gpio_get_pin_level(LORA_INT)) {
+    flags = spi_read_register(RFM95_REG_IRQ_FLAGS);
+  } else if (receive_mode == OP_MODE_RX_SINGLE) {
+    flags = spi_read_register(RFM95_REG_IRQ_FLAGS);
+    if (!(flags & IRQ_RX_TIMEOUT)) {
+      return RFM9X_RX_NOTHING;
+    }
+    spi_write_register(RFM95_REG_IRQ_FLAGS, 0xff);
+    receive_mode = 0;
+    return RFM9X_RX_TIMEOUT;
+  } else {
+    return RFM9X_RX_NOTHING;
+  }
+  spi_write_register(RFM95_REG_IRQ_FLAGS, 0xff);
+
+  if (!(flags & IRQ_RX_DONE)) {
+    return RFM9X_RX_NOTHING;
+  }
+  if (receive_mode == OP_MODE_RX_SINGLE) {
+    receive_mode = 0; // back in standby
+  }
+  if (flags & IRQ_PAYLOAD_CRC_ERROR) {
+    return RFM9X_RX_CRC_ERROR;
+  }
+
+  uint8_t length = spi_read_register(RFM95_REG_RX_NB_BYTES);
+  if (length < HEADER_LENGTH) {
+    return RFM9X_RX_CRC_ERROR; // too short to be one of ours
+  }
+  spi_write_register(RFM95_REG_FIFO_ADDRESS,
+                     spi_read_register(RFM95_REG_FIFO_RX_CURRENT_ADDRESS));
+  uint8_t header[HEADER_LENGTH];
+  spi_read_fifo(header, HEADER_LENGTH);
+  packet->from = header[1];
+  packet->flags = header[3];
+  packet->length = length - HEADER_LENGTH;
+  spi_read_fifo(packet->data, packet->length);
+
+  // SNR is in quarter dB, below 0 dB the packet is under the noise floor and
+  // the RSSI needs correcting by it, page 87
+  int8_t snr = (int8_t)spi_read_register(RFM95_REG_PKT_SNR);
+  packet->snr_db = snr / 4;
+  packet->rssi_dbm = RSSI_OFFSET + spi_read_register(RFM95_REG_PKT_RSSI);
+  if (snr < 0) {
+    packet->rssi_dbm += snr / 4;
+  }
+  return RFM9X_RX_PACKET;
+}
+
+/*
+The radio drops back to standby by itself once a packet is out, in LoRa mode.
+FSK stays in TX until told otherwise.
+*/
+static void rfm9x_wait_packet_sent(void) {
+  if (fsk) {
+    if ((spi_read_register(RFM95_REG_OP_MODE) & OP_MODE_MASK) != OP_MODE_TX) {
+      return;
+    }
+    while (!(spi_read_register(FSK_REG_IRQ_FLAGS_2) & FSK_IRQ_PACKET_SENT)) {
+    }
+    rfm9x_set_mode(OP_MODE_STANDBY);
+    return;
+  }
+  while ((spi_read_register(RFM95_REG_OP_MODE) & OP_MODE_MASK) == OP_MODE_TX) {
+  }
+}
+
+/*
+LongRangeMode can only be changed from sleep, writing a mode without it while
+asleep would drop the radio into FSK, so it stays set unless we're meant to
+be in FSK
+*/
+static void rfm9x_set_mode(uint8_t mode) {
+  if (mode != OP_MODE_RX_CONTINUOUS && mode != OP_MODE_RX_SINGLE) {
+    receive_mode = 0;
+  }
+  spi_write_register(RFM95_REG_OP_MODE, (fsk ? 0 : OP_MODE_LONG_RANGE) | mode);
 }
 
 /*
-input: frequency in MHz
+input: frequency in Hz
 
-transforms and writes frequency into FRF registers
+transforms and writes frequency into FRF registers, which only take in sleep
+or standby
 */
-static void rfm9x_set_frequency(float frequency) {
-  // crystal freq 32 * 100000
-  // 2^19 = 524288
-  // F_step = 3200000 / 524288
-  float f_step = 61.03515625;
-  uint32_t frf = (frequency * 1000000.0f) / f_step;
-  spi_write_register(RFM95_REG_FRF_MSB, (frf >> 16) & 0xff);
-  spi_write_register(RFM95_REG_FRF_MID, (frf >> 8) & 0xff);
-  spi_write_register(RFM95_REG_FRF_LSB, frf & 0xff);
-}
-
-static void rfm9x_set_power(uint8_t power_level) {
-  // if power level over over 20, need to set RFM95_REG_PA_DAC to 0x87
-  // ref: page 79
+void rfm9x_set_frequency(uint32_t frequency_hz) {
+  rfm9x_standby();
+  write_frf(HOP_FRF(frequency_hz));
+}
+
+void rfm9x_set_channel(uint32_t channel_frf) {
+  if (channel_frf == frf) {
+    return;
+  }
+  rfm9x_standby();
+  write_frf(channel_frf);
+}
+
+uint32_t rfm9x_channel(void) { return frf; }
+
+void rfm9x_set_power(uint8_t power_level) {
+  // ref: page 79, OutputPower only reaches 17 dBm on PA_BOOST, the last 3 dB
+  // come from the +20 dBm setting in RFM95_REG_PA_DAC
   if ((power_level < 5) || (power_level > 20)) {
     error(RFM95_INVALID_POWER);
   }
   const uint8_t USE_PA_BOOST = 0x80; // use PA_BOOST output pin, page 88
-  uint8_t new_reg_value =
-      USE_PA_BOOST | (power_level - 2); // datasheet says subtract 2
-  spi_write_register(RFM95_REG_PA_CONFIG, new_reg_value);
+  const uint8_t PA_DAC_DEFAULT = 0x84;
+  const uint8_t PA_DAC_20_DBM = 0x87;
+  uint8_t output_power;
+  if (power_level > 17) {
+    spi_write_register(RFM95_REG_PA_DAC, PA_DAC_20_DBM);
+    output_power = power_level - 5;
+  } else {
+    spi_write_register(RFM95_REG_PA_DAC, PA_DAC_DEFAULT);
+    output_power = power_level - 2; // datasheet says subtract 2
+  }
+  spi_write_register(RFM95_REG_PA_CONFIG, USE_PA_BOOST | output_power);
 }
 
 static void spi_write_register(uint8_t address, uint8_t value) {
@@ -196,6 +635,24 @@ static uint8_t spi_read_register(uint8_t address) {
   return result;
 }
 
+// burst read, the FIFO address pointer moves along by itself
+static void spi_read_fifo(uint8_t *data, uint8_t length) {
+  uint8_t address = RFM95_REG_FIFO;
+  gpio_set_pin_level(LORA_CS, false);
+  io_write(io, &address, 1);
+  io_read(io, data, length);
+  gpio_set_pin_level(LORA_CS, true);
+}
+
+// burst write, into the FIFO like the read
+static void spi_write_fifo(const uint8_t *data, uint8_t length) {
+  uint8_t address = RFM95_REG_FIFO | WNR_MASK;
+  gpio_set_pin_level(LORA_CS, false);
+  io_write(io, &address, 1);
+  io_write(io, data, length);
+  gpio_set_pin_level(LORA_CS, true);
+}
+
 /*
 const uint8_t RFM95_REG_OP_MODE[] = {0x01};
 const uint8_t RFM95_REG_VERSION[] = {0x42};
@@ -9,10 +9,115 @@
 #ifndef RFN9X_H_
 #define RFN9X_H_
 
+#include "fsk_modem.h"
+#include "hop.h"
+#include "lora_modem.h"
 #include <stdbool.h>
 #include <stdint.h>
 
+// the FIFO is 256 bytes, less RadioHead's 4 byte header
+#define RFM9X_MAX_PAYLOAD 251
+
+typedef struct rfm9x_packet {
+  uint8_t from; // RadioHead header from address
+  uint8_t flags; // RadioHead header flags
+  uint8_t length;
+  int16_t rssi_dbm;
+  int8_t snr_db;
+  uint8_t data[RFM9X_MAX_PAYLOAD];
+} rfm9x_packet;
+
+typedef struct rfm9x_lbt_stats {
+  uint32_t checks; // CAD runs
+  uint32_t busy; // found someone on air
+  uint32_t backoff_ms; // total handed back to wait
+  uint32_t forced; // sent anyway after RFM9X_LBT_ATTEMPTS busy in a row
+} rfm9x_lbt_stats;
+
+#define RFM9X_LBT_ATTEMPTS 6
+
+// where rfm9x_init puts the carrier
+#define RFM9X_FREQUENCY_HZ 915000000ul
+
+typedef enum rfm9x_receive_status {
+  RFM9X_RX_NOTHING,
+  RFM9X_RX_PACKET,
+  RFM9X_RX_CRC_ERROR, // something arrived but was damaged, it's gone now
+  RFM9X_RX_TIMEOUT,   // single mode gave up
+} rfm9x_receive_status;
+
 void rfm9x_init(void);
 void rfm9x_send(uint8_t *data, uint8_t length);
+// same, with flags in the RadioHead header, the low 4 bits are free to use
+void rfm9x_send_flags(uint8_t *data, uint8_t length, uint8_t flags);
+// wait for any packet in flight, then put the radio to sleep until the next send
+void rfm9x_sleep(void);
+// same, but stay in standby, ready to go again quickly
+void rfm9x_standby(void);
+
+/*
+Receiving. Both wait for any packet in flight first. Continuous mode keeps
+listening until told otherwise, single mode stops after one packet or
+timeout_symbols symbols without a preamble. Single mode is LoRa only, in FSK
+mode it listens continuously.
+*/
+void rfm9x_receive(void);
+void rfm9x_receive_single(uint8_t timeout_symbols);
+// check for a received packet, fills in packet when it returns RFM9X_RX_PACKET
+rfm9x_receive_status rfm9x_poll(rfm9x_packet *packet);
+
+// TX power in dBm on PA_BOOST, 5 to 20
+void rfm9x_set_power(uint8_t power_level);
+// carrier frequency in Hz, waits for any packet in flight first
+void rfm9x_set_frequency(uint32_t frequency_hz);
+/*
+The same from an FRF register value, one of hop_channel_frf's. Does nothing
+if the radio is on it already.
+*/
+void rfm9x_set_channel(uint32_t channel_frf);
+uint32_t rfm9x_channel(void);
+/*
+Spreading factor, bandwidth, coding rate, preamble, CRC and
+LowDataRateOptimize. Waits for any packet in flight, then leaves the radio
+in standby. Returns false without changing anything for settings that
+lora_modem_valid turns down, or implicit headers, which receiving relies on
+not having.
+*/
+bool rfm9x_set_modem(const lora_modem *modem);
+const lora_modem *rfm9x_modem(void);
+
+/*
+FSK mode, for bulk transfers at close range: the same send, receive and
+poll calls go over the FSK packet engine instead of LoRa. Packets over the
+64 byte FSK FIFO are streamed into it as it drains, received packets can
+only be as long as the FIFO. Waits for any packet in flight and leaves the
+radio in standby. Returns false without changing anything for settings that
+fsk_modem_valid turns down.
+*/
+bool rfm9x_set_fsk(const fsk_modem *settings);
+// back to LoRa on the rfm9x_set_modem settings, if not there already
+void rfm9x_set_lora(void);
+bool rfm9x_fsk(void);
+
+/*
+Channel activity detection: true if LoRa on the current settings is on air.
+Takes a couple of symbols and leaves the radio in standby, so not while
+receiving.
+*/
+bool rfm9x_channel_active(void);
+/*
+Listen before talk, rfm9x_send_flags for a shared channel: the packet only
+goes if CAD finds no one else on air. Otherwise it returns false with a
+random time to wait before trying again in backoff_ms, in slots of the
+packet's time on air, up to twice as many slots with each busy try in a row.
+After RFM9X_LBT_ATTEMPTS busy tries in a row it goes anyway, so nothing waits
+forever. In FSK mode, where CAD doesn't work, it always goes.
+*/
+bool rfm9x_send_lbt(uint8_t *data, uint8_t length, uint8_t flags,
+                    uint32_t *backoff_ms);
+const rfm9x_lbt_stats *rfm9x_lbt(void);
+
+// time on air of rfm9x_send(data, length) with the current settings
+uint32_t rfm9x_airtime_us(uint8_t length);
 
 #endif /* RFN9X_H_ */
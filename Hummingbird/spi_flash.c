@@ -6,10 +6,19 @@
  */ 
 #include "atmel_start.h"
 #include "atmel_start_pins.h"
+#include "crc32.h"
 #include "error.h"
+#include "spi_flash.h"
+#include "systime.h"
 #include <stdint.h>
 
-static void spi_flash_transfer(uint8_t *write, uint8_t write_len, uint8_t *read, uint8_t read_len);
+static void spi_flash_transfer(const uint8_t *write, uint8_t write_len, uint8_t *read, uint8_t read_len);
+static void spi_flash_write_enable(void);
+static void spi_flash_command_address(uint8_t command, uint32_t address);
+static uint8_t spi_flash_status(const uint8_t *command);
+static bool spi_flash_preempt(uint32_t address, uint32_t length);
+static bool spi_flash_read_crc32_hardware(uint32_t address, uint8_t *data, uint16_t length, uint32_t *crc);
+static void spi_flash_resume(void);
 
 static const uint8_t W25_CMD_POWER_ON[] = {
 	0xAB,
@@ -19,21 +28,58 @@ static const uint8_t W25_CMD_POWER_ON[] = {
 };
 static const uint8_t W25_CMD_READ_MANUFACTER_ID[] = {0x90, 0x00, 0x00};
 static const uint8_t W25_CMD_READ_JEDEC_ID[] = {0x9F};
+static const uint8_t W25_CMD_WRITE_ENABLE[] = {0x06};
+static const uint8_t W25_CMD_READ_STATUS_1[] = {0x05};
+static const uint8_t W25_CMD_READ_STATUS_2[] = {0x35};
+static const uint8_t W25_CMD_SUSPEND[] = {0x75};
+static const uint8_t W25_CMD_RESUME[] = {0x7A};
+static const uint8_t W25_CMD_CHIP_ERASE[] = {0xC7};
+static const uint8_t W25_CMD_READ_DATA = 0x03;
+static const uint8_t W25_CMD_PAGE_PROGRAM = 0x02;
+static const uint8_t W25_CMD_SECTOR_ERASE = 0x20;
+
+static const uint8_t W25_STATUS_BUSY = 0x01;
+static const uint8_t W25_STATUS_2_SUSPENDED = 0x80;
+
+static const uint32_t NO_ERASE = UINT32_MAX;
+// tSUS, the least the chip allows from a resume to the next suspend
+static const uint32_t W25_RESUME_TO_SUSPEND_US = 20;
 
 static const uint8_t JEDEC_ID[] = {0xEF, 0x70, 0x17};
 static const uint8_t MANUFACTURER_ID[] = {0x00, 0x16, 0xEF };
 static const uint8_t ID = 0x16;
+// bytes read for the boot check of the CRC hardware, in two reads split here
+#define CRC_CHECK_LENGTH 16
+static const uint16_t CRC_CHECK_SPLIT = 7;
 
 
 static struct io_descriptor *io;
 
+// sector being erased in the background, and whether it's suspended for now
+static uint32_t erasing = NO_ERASE;
+static bool suspended;
+static uint32_t resumed_us;
+// spi_flash_batch_begin calls not ended yet, the erase stays suspended
+static uint8_t batches;
+// false once the CRC hardware failed its boot check or a transfer
+static bool crc_hardware;
+
 
 void spi_flash_init(void) {
 	spi_m_sync_get_io_descriptor(&SPI_0, &io);
 	spi_m_sync_enable(&SPI_0);
+	erasing = NO_ERASE;
+	suspended = false;
+	resumed_us = systime_us() - W25_RESUME_TO_SUSPEND_US;
+	batches = 0;
 
 	uint8_t result;
 	spi_flash_transfer(W25_CMD_POWER_ON, sizeof(W25_CMD_POWER_ON), &result, 1);
+	if (result != ID) {
+		// a reset can leave an erase going, which the chip ignores commands for
+		spi_flash_wait();
+		spi_flash_transfer(W25_CMD_POWER_ON, sizeof(W25_CMD_POWER_ON), &result, 1);
+	}
 	if (result != ID) {
 		error(SPI_FLASH_INIT_FAIL);
 	}
@@ -46,6 +92,10 @@ void spi_flash_init(void) {
 		}
 	}
 	
+	// an erase suspended before a reset stays suspended, finish it
+	suspended = spi_flash_status(W25_CMD_READ_STATUS_2) & W25_STATUS_2_SUSPENDED;
+	spi_flash_wait();
+
 	uint8_t jedec_id[3];
 	spi_flash_transfer(W25_CMD_READ_JEDEC_ID, sizeof(W25_CMD_READ_JEDEC_ID), jedec_id, sizeof(jedec_id));
 	for(int i = 0; i < sizeof(JEDEC_ID); i++) {
@@ -53,11 +103,198 @@ void spi_flash_init(void) {
 			error(SPI_FLASH_INIT_FAIL);
 		}
 	}
+
+	/*
+	The CRC hardware, against the CPU on what the chip starts with. The DMAC
+	read goes in two, carrying the CRC over as the segments of a download do.
+	*/
+	uint8_t check[CRC_CHECK_LENGTH];
+	uint32_t crc = crc32_init();
+	crc_hardware = crc32_self_test() &&
+		spi_flash_read_crc32_hardware(0, check, CRC_CHECK_SPLIT, &crc) &&
+		spi_flash_read_crc32_hardware(CRC_CHECK_SPLIT, check + CRC_CHECK_SPLIT, sizeof(check) - CRC_CHECK_SPLIT, &crc) &&
+		crc == crc32_software_update(crc32_init(), check, sizeof(check));
+}
+
+void spi_flash_read(uint32_t address, uint8_t *data, uint32_t length) {
+	bool preempted = spi_flash_preempt(address, length);
+	spi_flash_command_address(W25_CMD_READ_DATA, address);
+	while (length > 0) {
+		// io_read takes a 16 bit length
+		uint16_t chunk = length > 0x8000 ? 0x8000 : length;
+		io_read(io, data, chunk);
+		data += chunk;
+		length -= chunk;
+	}
+	gpio_set_pin_level(FLASH_CS, true);
+	if (preempted && batches == 0) {
+		spi_flash_resume();
+	}
+}
+
+static bool spi_flash_read_crc32_hardware(uint32_t address, uint8_t *data, uint16_t length, uint32_t *crc) {
+	bool preempted = spi_flash_preempt(address, length);
+	spi_flash_command_address(W25_CMD_READ_DATA, address);
+	bool read = crc32_spi_read(&SPI_0, data, length, crc);
+	gpio_set_pin_level(FLASH_CS, true);
+	if (preempted && batches == 0) {
+		spi_flash_resume();
+	}
+	return read;
+}
+
+uint32_t spi_flash_read_crc32(uint32_t address, uint8_t *data, uint16_t length, uint32_t crc) {
+	if (crc_hardware && spi_flash_read_crc32_hardware(address, data, length, &crc)) {
+		return crc;
+	}
+	// the hardware failed a check or this transfer, the long way from now on
+	crc_hardware = false;
+	spi_flash_read(address, data, length);
+	return crc32_software_update(crc, data, length);
+}
+
+bool spi_flash_crc_hardware(void) {
+	return crc_hardware;
+}
+
+void spi_flash_page_program(uint32_t address, const uint8_t *data, uint16_t length) {
+	bool preempted = spi_flash_preempt(address, 1);
+	spi_flash_write_enable();
+	spi_flash_command_address(W25_CMD_PAGE_PROGRAM, address);
+	io_write(io, data, length);
+	gpio_set_pin_level(FLASH_CS, true);
+	while (spi_flash_status(W25_CMD_READ_STATUS_1) & W25_STATUS_BUSY) {
+	}
+	if (preempted && batches == 0) {
+		spi_flash_resume();
+	}
+}
+
+void spi_flash_batch_begin(void) {
+	batches++;
+}
+
+void spi_flash_batch_end(void) {
+	batches--;
+	if (batches == 0 && suspended) {
+		spi_flash_resume();
+	}
+}
+
+void spi_flash_sector_erase(uint32_t address) {
+	spi_flash_sector_erase_start(address);
+	spi_flash_wait();
+}
+
+void spi_flash_sector_erase_start(uint32_t address) {
+	spi_flash_wait();
+	spi_flash_write_enable();
+	spi_flash_command_address(W25_CMD_SECTOR_ERASE, address);
+	gpio_set_pin_level(FLASH_CS, true);
+	erasing = address - address % SPI_FLASH_SECTOR_SIZE;
+}
+
+void spi_flash_chip_erase(void) {
+	spi_flash_wait();
+	spi_flash_write_enable();
+	uint8_t unused;
+	spi_flash_transfer(W25_CMD_CHIP_ERASE, sizeof(W25_CMD_CHIP_ERASE), &unused, 0);
+	spi_flash_wait();
+}
+
+bool spi_flash_busy(void) {
+	if (suspended) {
+		return true;
+	}
+	if (spi_flash_status(W25_CMD_READ_STATUS_1) & W25_STATUS_BUSY) {
+		return true;
+	}
+	erasing = NO_ERASE;
+	return false;
+}
+
+void spi_flash_wait(void) {
+	if (suspended) {
+		spi_flash_resume();
+	}
+	while (spi_flash_busy()) {
+	}
+}
+
+static uint8_t spi_flash_status(const uint8_t *command) {
+	uint8_t status;
+	spi_flash_transfer(command, 1, &status, 1);
+	return status;
+}
+
+/*
+Get the chip ready to read or program length bytes from address. Reads and
+programs go first: a background erase of another sector is suspended, and
+true returned for the caller to resume it when done. Anything else, or an
+erase of the sector they're in, is waited for.
+*/
+static bool spi_flash_preempt(uint32_t address, uint32_t length) {
+	if (!spi_flash_busy()) {
+		return false;
+	}
+	bool overlaps = erasing != NO_ERASE && address < erasing + SPI_FLASH_SECTOR_SIZE &&
+	                erasing < address + length;
+	if (erasing == NO_ERASE || overlaps) {
+		spi_flash_wait();
+		return false;
+	}
+	if (!suspended) {
+		// not within tSUS of the last resume, the chip doesn't allow it
+		uint32_t since = systime_us() - resumed_us;
+		if (since < W25_RESUME_TO_SUSPEND_US) {
+			delay_us(W25_RESUME_TO_SUSPEND_US - since);
+		}
+		uint8_t unused;
+		spi_flash_transfer(W25_CMD_SUSPEND, sizeof(W25_CMD_SUSPEND), &unused, 0);
+		// tSUS, 20 us, or the erase finished before it got there
+		while (spi_flash_status(W25_CMD_READ_STATUS_1) & W25_STATUS_BUSY) {
+		}
+		suspended = spi_flash_status(W25_CMD_READ_STATUS_2) & W25_STATUS_2_SUSPENDED;
+		if (!suspended) {
+			erasing = NO_ERASE;
+			return false;
+		}
+	}
+	return true;
+}
+
+static void spi_flash_resume(void) {
+	uint8_t unused;
+	spi_flash_transfer(W25_CMD_RESUME, sizeof(W25_CMD_RESUME), &unused, 0);
+	suspended = false;
+	resumed_us = systime_us();
+}
+
+static void spi_flash_write_enable(void) {
+	uint8_t unused;
+	spi_flash_transfer(W25_CMD_WRITE_ENABLE, sizeof(W25_CMD_WRITE_ENABLE), &unused, 0);
+}
+
+/*
+Select the chip and send a command followed by a 24 bit address, leaves
+FLASH_CS low for the caller to transfer data and deselect
+*/
+static void spi_flash_command_address(uint8_t command, uint32_t address) {
+	uint8_t header[] = {
+		command,
+		(address >> 16) & 0xff,
+		(address >> 8) & 0xff,
+		address & 0xff,
+	};
+	gpio_set_pin_level(FLASH_CS, false);
+	io_write(io, header, sizeof(header));
 }
 
-static void spi_flash_transfer(uint8_t *write, uint8_t write_len, uint8_t *read, uint8_t read_len) {
+static void spi_flash_transfer(const uint8_t *write, uint8_t write_len, uint8_t *read, uint8_t read_len) {
 	gpio_set_pin_level(FLASH_CS, false);
 	io_write(io, write, write_len);
-	io_read(io, read, read_len);
+	if (read_len > 0) {
+		io_read(io, read, read_len);
+	}
 	gpio_set_pin_level(FLASH_CS, true);
 }
@@ -9,8 +9,56 @@
 #ifndef SPI_FLASH_H_
 #define SPI_FLASH_H_
 
+#include <stdbool.h>
+#include <stdint.h>
 
+// W25Q64: 8 MB, programmed in 256 byte pages, erased in 4 KB sectors
+#define SPI_FLASH_SIZE (8UL * 1024 * 1024)
+#define SPI_FLASH_PAGE_SIZE 256
+#define SPI_FLASH_SECTOR_SIZE 4096
+
+/*
+Checks the chip's IDs, error() if they're off, and the CRC hardware, which
+spi_flash_read_crc32 stops using if it's off.
+*/
 void spi_flash_init(void);
 
+void spi_flash_read(uint32_t address, uint8_t *data, uint32_t length);
+/*
+spi_flash_read with the DMAC moving the bytes and taking their CRC-32 on the
+way, see crc32.h. Returns crc updated with them. Once the hardware has failed
+its boot check or a transfer, it's spi_flash_read and the CRC on the CPU.
+*/
+uint32_t spi_flash_read_crc32(uint32_t address, uint8_t *data, uint16_t length, uint32_t crc);
+// false once spi_flash_read_crc32 has gone over to the CPU
+bool spi_flash_crc_hardware(void);
+/*
+Program up to one page, wrapping within the page like the chip does. Bits can
+only go from 1 to 0, the page must be erased first. Waits for completion.
+*/
+void spi_flash_page_program(uint32_t address, const uint8_t *data, uint16_t length);
+// Erase the 4 KB sector containing address. Waits for completion.
+void spi_flash_sector_erase(uint32_t address);
+/*
+Start erasing the 4 KB sector containing address and return. Reads and page
+programs of other sectors meanwhile suspend it and resume it when they're
+done, other commands wait for it to finish.
+*/
+void spi_flash_sector_erase_start(uint32_t address);
+/*
+Reads and page programs between these leave a background erase suspended
+once they've suspended it, and spi_flash_batch_end resumes it. For runs of
+them close together: a suspend has to wait out tSUS after the last resume,
+and an erase resumed for that little between each one gets nowhere. They
+nest.
+*/
+void spi_flash_batch_begin(void);
+void spi_flash_batch_end(void);
+void spi_flash_chip_erase(void);
+
+// programming or erasing, including an erase suspended for a read
+bool spi_flash_busy(void);
+void spi_flash_wait(void);
+
 
-#endif /* SPI_FLASH_H_ */
\ No newline at end of file
+#endif /* SPI_FLASH_H_ */
@@ -0,0 +1,44 @@
+/*
+ * systime.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "systime.h"
+#include "atmel_start.h"
+#include <hri_d21.h>
+
+static uint32_t last_us;
+static uint64_t elapsed_us;
+
+void systime_init(void) {
+  hri_pm_set_APBCMASK_TC4_bit(PM);
+  hri_pm_set_APBCMASK_TC5_bit(PM);
+  // GCLK0 is the 8 MHz OSC8M, divide by 8 for 1 tick per microsecond
+  hri_gclk_write_CLKCTRL_reg(GCLK, GCLK_CLKCTRL_ID_TC4_TC5 |
+                                       GCLK_CLKCTRL_GEN_GCLK0 |
+                                       GCLK_CLKCTRL_CLKEN);
+
+  hri_tc_write_CTRLA_reg(TC4, TC_CTRLA_SWRST);
+  hri_tc_wait_for_sync(TC4);
+  hri_tc_write_CTRLA_reg(TC4, TC_CTRLA_MODE_COUNT32 |
+                                  TC_CTRLA_PRESCALER_DIV8 | TC_CTRLA_ENABLE);
+  hri_tc_wait_for_sync(TC4);
+
+  last_us = systime_us();
+  elapsed_us = 0;
+}
+
+uint32_t systime_us(void) {
+  // COUNT has to be synchronised from the TC clock domain before reading
+  hri_tc_write_READREQ_reg(TC4, TC_READREQ_RREQ | TC_READREQ_ADDR(0x10));
+  hri_tc_wait_for_sync(TC4);
+  return hri_tccount32_read_COUNT_reg(TC4);
+}
+
+uint32_t systime_ms(void) {
+  uint32_t now = systime_us();
+  elapsed_us += (uint32_t)(now - last_us);
+  last_us = now;
+  return (uint32_t)(elapsed_us / 1000);
+}
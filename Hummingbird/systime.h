@@ -0,0 +1,23 @@
+/*
+ * systime.h
+ *
+ * Created: 10/19/2026
+ *
+ * Free running system time. delay_ms owns SysTick, so this runs TC4/TC5 as a
+ * 32 bit counter at 1 MHz.
+ */
+
+#ifndef SYSTIME_H_
+#define SYSTIME_H_
+
+#include <stdint.h>
+
+void systime_init(void);
+
+// microseconds, wraps every ~71 minutes so only use it for intervals
+uint32_t systime_us(void);
+
+// milliseconds since systime_init, must be called at least once per wrap
+uint32_t systime_ms(void);
+
+#endif /* SYSTIME_H_ */
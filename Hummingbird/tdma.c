@@ -0,0 +1,121 @@
+/*
+ * tdma.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "tdma.h"
+#include <string.h>
+
+void tdma_init(tdma_schedule *tdma, uint32_t timing_ms) {
+  memset(tdma, 0, sizeof(*tdma));
+  tdma->timing_ms = timing_ms;
+}
+
+bool tdma_configure(tdma_schedule *tdma, uint8_t slots, uint16_t frame_ms,
+                    uint8_t device_id) {
+  if (slots > TDMA_MAX_SLOTS || (slots > 0 && frame_ms < slots)) {
+    return false;
+  }
+  tdma->slots = slots;
+  tdma->frame_ms = frame_ms;
+  tdma->slot = slots > 0 ? device_id % slots : 0;
+  tdma->synced = false; // a new frame doesn't line up with the old anchor
+  return true;
+}
+
+void tdma_beacon(tdma_schedule *tdma, uint32_t now_ms, uint16_t position_ms) {
+  if (tdma->slots == 0 || position_ms >= tdma->frame_ms) {
+    return;
+  }
+  uint32_t anchor = now_ms - position_ms;
+  if (tdma->synced) {
+    // how far our frame had drifted from the ground's, either way
+    int32_t error = (int32_t)(anchor - tdma->anchor_ms) % tdma->frame_ms;
+    if (error > tdma->frame_ms / 2) {
+      error -= tdma->frame_ms;
+    } else if (error < -(tdma->frame_ms / 2)) {
+      error += tdma->frame_ms;
+    }
+    tdma->correction_ms = error;
+    uint32_t size = error < 0 ? -error : error;
+    if (size > tdma->max_correction_ms) {
+      tdma->max_correction_ms = size;
+    }
+  }
+  tdma->anchor_ms = anchor;
+  tdma->beacon_ms = now_ms;
+  tdma->synced = true;
+  tdma->beacons++;
+}
+
+bool tdma_running(tdma_schedule *tdma, uint32_t now_ms) {
+  if (tdma->synced && now_ms - tdma->beacon_ms > TDMA_HOLDOVER_MS) {
+    tdma->synced = false; // the guards would be eating the slot by now
+  }
+  return tdma->slots > 0 && tdma->synced;
+}
+
+uint32_t tdma_guard_ms(const tdma_schedule *tdma, uint32_t now_ms) {
+  // both ends' crystals, either way
+  uint64_t drift_us =
+      (uint64_t)(now_ms - tdma->beacon_ms) * 2 * TDMA_CLOCK_PPM / 1000;
+  return tdma->timing_ms + (uint32_t)((drift_us + 999) / 1000);
+}
+
+// where our slot opens and closes in the frame now is in, guards taken off
+static void slot_window(const tdma_schedule *tdma, uint32_t now_ms,
+                        uint32_t *open_ms, uint32_t *close_ms) {
+  uint32_t slot_ms = tdma->frame_ms / tdma->slots;
+  uint32_t guard = tdma_guard_ms(tdma, now_ms);
+  uint32_t frame_start = now_ms - (now_ms - tdma->anchor_ms) % tdma->frame_ms;
+  uint32_t start = frame_start + tdma->slot * slot_ms;
+  *open_ms = start + guard;
+  *close_ms = start + slot_ms - guard;
+}
+
+uint32_t tdma_slot_us(tdma_schedule *tdma, uint32_t now_ms,
+                      uint32_t reply_us) {
+  if (!tdma_running(tdma, now_ms)) {
+    return UINT32_MAX;
+  }
+  uint32_t slot_ms = tdma->frame_ms / tdma->slots;
+  uint32_t guards = 2 * tdma_guard_ms(tdma, now_ms);
+  if (slot_ms <= guards || (slot_ms - guards) * 1000 <= reply_us) {
+    return 0;
+  }
+  return (slot_ms - guards) * 1000 - reply_us;
+}
+
+uint32_t tdma_available_us(tdma_schedule *tdma, uint32_t now_ms,
+                           uint32_t reply_us) {
+  if (!tdma_running(tdma, now_ms)) {
+    return UINT32_MAX;
+  }
+  uint32_t open;
+  uint32_t close;
+  slot_window(tdma, now_ms, &open, &close);
+  if ((int32_t)(now_ms - open) < 0 || (int32_t)(close - now_ms) <= 0) {
+    return 0;
+  }
+  uint32_t left_us = (close - now_ms) * 1000;
+  return left_us > reply_us ? left_us - reply_us : 0;
+}
+
+uint32_t tdma_wait_ms(tdma_schedule *tdma, uint32_t now_ms,
+                      uint32_t airtime_us, uint32_t reply_us) {
+  uint32_t available = tdma_available_us(tdma, now_ms, reply_us);
+  if (available == UINT32_MAX || available >= airtime_us) {
+    return 0;
+  }
+  if (airtime_us > tdma_slot_us(tdma, now_ms, reply_us)) {
+    return UINT32_MAX;
+  }
+  uint32_t open;
+  uint32_t close;
+  slot_window(tdma, now_ms, &open, &close);
+  if ((int32_t)(open - now_ms) > 0) {
+    return open - now_ms;
+  }
+  return open + tdma->frame_ms - now_ms; // too late in this one
+}
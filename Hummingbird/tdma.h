@@ -0,0 +1,85 @@
+/*
+ * tdma.h
+ *
+ * Created: 10/19/2026
+ *
+ * Time slots on a channel shared by several kites, so their packets stop
+ * drifting into each other. The ground sets up a frame of frame_ms cut into
+ * slots equal slots, and each kite only sends in slot device id % slots.
+ *
+ * The ground's clock is the reference. It answers packets with a beacon (an
+ * UPLINK_TDMA_BEACON) saying how far into its frame it is as the beacon
+ * ends, and the kite puts the frame start on its own clock from that. Each
+ * beacon moves it again, which takes out the drift since the last one.
+ *
+ * A guard at both ends of the slot covers how late a beacon can be noticed
+ * (timing_ms) and both crystals drifting apart at TDMA_CLOCK_PPM since the
+ * last beacon. A packet only starts if it and the ground's answer after it
+ * (reply_us, from the airtime calculation) are done before the closing guard.
+ * Until the first beacon, or once TDMA_HOLDOVER_MS goes by without one, the
+ * schedule is out of sync and doesn't hold anything back.
+ *
+ * Times in ms on the caller's clock, airtimes in us. No hardware
+ * dependencies, the simulated kites use it too.
+ */
+
+#ifndef TDMA_H_
+#define TDMA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TDMA_MAX_SLOTS 32
+#define TDMA_CLOCK_PPM 50
+#define TDMA_HOLDOVER_MS 600000
+
+typedef struct tdma_schedule {
+  uint8_t slots; // 0 for off
+  uint8_t slot; // ours
+  uint16_t frame_ms;
+  uint32_t timing_ms;
+
+  bool synced;
+  uint32_t anchor_ms; // a frame started here
+  uint32_t beacon_ms; // when the last beacon came in
+
+  uint32_t beacons;
+  int32_t correction_ms; // the last beacon's, where it moved the frame
+  uint32_t max_correction_ms;
+} tdma_schedule;
+
+// off to start with
+void tdma_init(tdma_schedule *tdma, uint32_t timing_ms);
+/*
+slots of frame_ms / slots each, ours from device_id. 0 slots turns it off.
+Returns false, leaving it as it was, for more than TDMA_MAX_SLOTS or a frame
+shorter than a ms per slot.
+*/
+bool tdma_configure(tdma_schedule *tdma, uint8_t slots, uint16_t frame_ms,
+                    uint8_t device_id);
+// a beacon heard at now_ms, position_ms into the ground's frame
+void tdma_beacon(tdma_schedule *tdma, uint32_t now_ms, uint16_t position_ms);
+// in sync, sending only in our slot
+bool tdma_running(tdma_schedule *tdma, uint32_t now_ms);
+// each end of the slot, grows from timing_ms the longer since a beacon
+uint32_t tdma_guard_ms(const tdma_schedule *tdma, uint32_t now_ms);
+/*
+The longest packet that fits in our slot at all with reply_us after it,
+UINT32_MAX if the schedule isn't running
+*/
+uint32_t tdma_slot_us(tdma_schedule *tdma, uint32_t now_ms,
+                      uint32_t reply_us);
+/*
+The longest packet that can start now and still leave reply_us before our
+slot closes: 0 outside it, UINT32_MAX if the schedule isn't running
+*/
+uint32_t tdma_available_us(tdma_schedule *tdma, uint32_t now_ms,
+                           uint32_t reply_us);
+/*
+How long until a packet of airtime_us and its reply fit in our slot, 0 if
+they do now, UINT32_MAX if they never will
+*/
+uint32_t tdma_wait_ms(tdma_schedule *tdma, uint32_t now_ms,
+                      uint32_t airtime_us, uint32_t reply_us);
+
+#endif /* TDMA_H_ */
@@ -0,0 +1,1279 @@
+/*
+ * telemetry.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "telemetry.h"
+#include "atmel_start.h"
+#include "atmel_start_pins.h"
+#include "adr.h"
+#include "airtime_budget.h"
+#include "altitude.h"
+#include "arq.h"
+#include "bmp388.h"
+#include "crc.h"
+#include "crc32.h"
+#include "delta_codec.h"
+#include "fec.h"
+#include "flash_log.h"
+#include "flight_phase.h"
+#include "hop.h"
+#include "profile.h"
+#include "rfm9x.h"
+#include "spi_flash.h"
+#include "systime.h"
+#include "tdma.h"
+#include "uplink.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+static float read_voltage(void);
+static void flush_samples(void);
+static void log_values(const int32_t *values);
+static uint32_t listen_window_ms(void);
+
+static const uint8_t VERSION = 3;
+static const uint8_t DEVICE_ID	= 1;
+static const uint8_t DATAPOINT_TO_CRC = offsetof(Datapoint, crc8);
+
+/*
+Readings not sent yet, oldest first. Normally the next packet takes them all,
+when the airtime budget runs short the rest wait for the one after.
+*/
+#define RADIO_BACKLOG 64
+static const uint8_t MIN_RADIO_BLOCK = TELEMETRY_MIN_RADIO_BLOCK;
+
+/*
+Airtime budget: 10% of the time on air, which leaves the channel to the
+ground most of the time, saved up to 4 s so one packet at SF12 still fits.
+No dwell limit at 915 MHz on a single channel, HOP_MAX_DWELL_MS while
+hopping. The one budget covers every channel, so hopping gets no more time on
+air than staying on one.
+*/
+static const uint16_t DUTY_CYCLE_PERMILLE = 100;
+static const uint32_t BURST_US = 4000000;
+static const uint32_t DWELL_US = 0;
+
+/*
+Forward error correction, 2 repair packets after every 8 data packets, so
+any 2 lost out of the 10 come back on the ground. The ground can change it
+with UPLINK_SET_FEC.
+*/
+static const uint8_t FEC_DATA_PACKETS = 8;
+static const uint8_t FEC_REPAIR_PACKETS = 2;
+
+/*
+How long to listen for a command after each packet: the ground's turnaround
+plus the airtime of the longest command with the current settings, from
+about 250 ms at SF7 125 kHz to over a second at SF12.
+*/
+static const uint32_t LISTEN_TURNAROUND_MS = 200;
+static const uint32_t LISTEN_POLL_MS = 5;
+// download segments between acknowledgements on FSK
+static const uint8_t FSK_BURST_SEGMENTS = 16;
+// flash sectors kept erased ahead of the log, 8 KB
+static const uint8_t ERASE_AHEAD_SECTORS = 2;
+/*
+Readings wait in RAM to fill a block, which goes onto a page of the log in
+one program (see flash_log.h), but no longer than this. A reset loses at most
+that much of the log. With the battery about to give out the block goes as
+the voltage drops, and then every LOW_BATTERY_FLUSH_MS rather than a program
+per reading.
+*/
+static const uint32_t LOG_FLUSH_MS = 120000;
+static const float LOW_BATTERY_V = 3.5f;
+static const uint32_t LOW_BATTERY_FLUSH_MS = 10000;
+/*
+Pre-trigger buffer: on the ground the BMP388 runs by itself at 12.5 Hz (the
+most oversampling there is) into its FIFO, which is emptied into a ring of
+the last 30 s every 4 s, well before its 73 readings fill. When the kite
+leaves the ground the ring goes into the log ahead of the launch, so that
+comes out at full rate without logging the hours on the pad at it.
+*/
+#define PRETRIGGER_READINGS 375
+static const uint8_t PRETRIGGER_ODR = 4; // 200 Hz >> 4
+static const uint8_t PRETRIGGER_OSR = 5; // x32
+static const uint32_t PRETRIGGER_PERIOD_MS = 80;
+static const uint32_t PRETRIGGER_DRAIN_MS = 4000;
+#define PRETRIGGER_BATCH 16
+
+static Datapoint datapoint = {0};
+static uint32_t packet_number = 0;
+static uint32_t sample_ms;
+
+/*
+Every reading goes into the backlog and is packed in after the next
+Datapoint, as many as the airtime budget allows. The logged ones are packed
+into flash_samples until that's a full record.
+*/
+static uint8_t packet[RFM9X_MAX_PAYLOAD];
+static int32_t backlog[RADIO_BACKLOG][SAMPLE_CHANNELS];
+static uint8_t backlog_first;
+static uint8_t backlog_count;
+static airtime_budget budget;
+// slots on a shared channel, set up from the ground
+static tdma_schedule tdma;
+// or spread over a channel table, also from the ground
+static bool hopping;
+static hop_sequence hop;
+static fec_encoder fec;
+// repairs of the last group still to go, they go before the next data packet
+static uint8_t repairs_pending;
+static uint8_t repairs_sent;
+// flash log download, see arq.h
+static arq_sender transfer;
+static bool transferring;
+static uint32_t transfer_start;
+static uint32_t transfer_length; // of the log, the CRC-32 comes after
+static uint32_t transfer_crc; // of the log up to transfer_checked
+static uint32_t transfer_checked;
+static uint32_t next_segment_ms;
+static uint8_t burst_segments; // since the last poll
+static uint8_t segment_data[ARQ_MAX_SEGMENT_BYTES];
+// with its summary and Datapoint records, a block fills a page of the log
+static uint8_t flash_block[FLASH_LOG_MAX_PAYLOAD - 2 * FLASH_LOG_OVERHEAD -
+                           sizeof(block_summary) - sizeof(Datapoint)];
+static delta_encoder flash_samples;
+static block_summary flash_summary;
+// under LOW_BATTERY_V since this boot
+static bool battery_low;
+static Datapoint block_datapoint; // as it was at the block's first reading
+// readings out of the FIFO while on the ground, oldest first
+static bool pretriggering;
+static int32_t pretrigger[PRETRIGGER_READINGS][SAMPLE_CHANNELS];
+static uint16_t pretrigger_first;
+static uint16_t pretrigger_count;
+static uint32_t next_drain_ms;
+static bmp_reading pretrigger_latest; // for sample()
+static uint32_t pretrigger_logged;
+
+static uint32_t next_sample_ms;
+static uint32_t next_transmit_ms;
+static uint32_t next_log_ms;
+static bool have_reading;
+static uint8_t tx_power_dbm;
+// check the channel is clear before each packet
+static bool listen_before_talk;
+// packet[] waiting on a busy channel, to go again at retry_ms
+static uint8_t held_length;
+static uint8_t held_flags;
+static uint32_t retry_ms;
+
+static bool listening;
+static uint32_t listen_until_ms;
+// set from the ground, zero fields fall through to the flight phase policy
+static phase_policy override;
+static phase_policy effective_policy;
+/*
+Modem change from the ground, applied at the end of the listen window after
+the next packet, which carries the acknowledgement with the old settings
+*/
+static bool modem_pending;
+static bool modem_acknowledged;
+static lora_modem pending_modem;
+// to FSK for a download, the same way
+static bool fsk_pending;
+static bool fsk_acknowledged;
+// spreading factor, bandwidth and power from the ground's link reports
+static adr_state adr;
+static uint16_t packets_since_uplink;
+
+/*
+Every boot is a flight of its own in the log, unless the last one logged
+nothing or the directory is full, when the ground sees the last flight
+number again.
+*/
+static void begin_flight(void) {
+  datapoint.flight_number = flash_log_begin_flight();
+  // the first sectors now, before there's anything to log
+  while (flash_log_erase_ahead(ERASE_AHEAD_SECTORS) || spi_flash_busy()) {
+  }
+}
+
+void telemetry_init(void) {
+  systime_init();
+  adc_sync_enable_channel(&ADC_0, 0);
+
+  rfm9x_init();
+  bmp388_init();
+  spi_flash_init();
+  flash_log_init();
+  begin_flight();
+  altitude_filter_init();
+  flight_phase_init();
+
+  datapoint.device_id = DEVICE_ID;
+  datapoint.version	= VERSION;
+  backlog_first = 0;
+  backlog_count = 0;
+  battery_low = false;
+  // sample() starts it after the first reading
+  pretriggering = false;
+  pretrigger_logged = 0;
+  delta_encoder_begin(&flash_samples, SAMPLE_CHANNELS, flash_block,
+                      sizeof(flash_block));
+
+  uint32_t now = systime_ms();
+  airtime_budget_init(&budget, DUTY_CYCLE_PERMILLE, BURST_US, DWELL_US, now);
+  fec_encoder_begin(&fec, FEC_DATA_PACKETS, FEC_REPAIR_PACKETS);
+  // a beacon is picked up at the next poll of the listen window
+  tdma_init(&tdma, LISTEN_POLL_MS);
+  hopping = false;
+  repairs_pending = 0;
+  transferring = false;
+  next_sample_ms = now;
+  next_transmit_ms = now;
+  next_log_ms = now;
+  have_reading = false;
+  tx_power_dbm = 0;
+  listening = false;
+  modem_pending = false;
+  modem_acknowledged = false;
+  fsk_pending = false;
+  fsk_acknowledged = false;
+  listen_before_talk = false;
+  held_length = 0;
+  memset(&override, 0, sizeof(override));
+  adr_reset(&adr);
+  adr_limit(&adr, 0, 0);
+  packets_since_uplink = 0;
+}
+
+static bool due(uint32_t now, uint32_t deadline) {
+  return (int32_t)(now - deadline) >= 0;
+}
+
+// the flight phase's policy with anything the ground asked for on top
+static const phase_policy *current_policy(void) {
+  phase_policy *policy = &effective_policy;
+  *policy = *flight_phase_policy(flight_phase_current());
+  if (override.sample_period_ms != 0) {
+    policy->sample_period_ms = override.sample_period_ms;
+  }
+  if (override.transmit_period_ms != 0) {
+    policy->transmit_period_ms = override.transmit_period_ms;
+  }
+  if (override.log_period_ms != 0) {
+    policy->log_period_ms = override.log_period_ms;
+  }
+  if (override.tx_power_dbm != 0) {
+    policy->tx_power_dbm = override.tx_power_dbm;
+  } else if (adr.running) {
+    policy->tx_power_dbm = adr.power_dbm;
+  }
+  return policy;
+}
+
+static void sample_values(int32_t *values) {
+  values[SAMPLE_TIME_MS] = (int32_t)sample_ms;
+  values[SAMPLE_PRESSURE] = lround(datapoint.pressure * SAMPLE_PRESSURE_SCALE);
+  values[SAMPLE_TEMPERATURE] =
+      lround(datapoint.temperature * SAMPLE_TEMPERATURE_SCALE);
+}
+
+static void backlog_push(const int32_t *values) {
+  if (backlog_count == RADIO_BACKLOG) {
+    // out of room, the oldest only makes it to the flash log
+    backlog_first = (backlog_first + 1) % RADIO_BACKLOG;
+    backlog_count--;
+  }
+  uint8_t last = (backlog_first + backlog_count) % RADIO_BACKLOG;
+  memcpy(backlog[last], values, sizeof(backlog[last]));
+  backlog_count++;
+}
+
+// as much of the backlog as fits in capacity bytes, returns the block length
+static uint16_t pack_backlog(uint8_t *block, uint16_t capacity) {
+  delta_encoder encoder;
+  delta_encoder_begin(&encoder, SAMPLE_CHANNELS, block, capacity);
+  while (backlog_count > 0 &&
+         delta_encoder_add(&encoder, backlog[backlog_first])) {
+    backlog_first = (backlog_first + 1) % RADIO_BACKLOG;
+    backlog_count--;
+  }
+  return delta_encoder_finish(&encoder);
+}
+
+static uint8_t repair_length(uint8_t data_length) {
+  return FEC_REPAIR_HEADER + data_length + 2; // length byte and crc8
+}
+
+// the ground's answer goes in our TDMA slot too, after the packet
+static uint32_t reply_us(void) { return listen_window_ms() * 1000; }
+
+/*
+Sending only in our TDMA slot, as long as it holds a Datapoint with a couple
+of readings, and the repair packet for it if there are any. A slot too short
+for the modem settings is ignored, rather than never sending again.
+*/
+static bool slotted(uint32_t now) {
+  uint8_t smallest = sizeof(Datapoint) + MIN_RADIO_BLOCK;
+  if (fec.repair_packets > 0) {
+    smallest = repair_length(smallest);
+  }
+  uint32_t slot = tdma_slot_us(&tdma, now, reply_us());
+  return slot != UINT32_MAX && slot >= rfm9x_airtime_us(smallest);
+}
+
+// the longest packet that will ever go, by the budget and our slot
+static uint32_t max_airtime_us(void) {
+  uint32_t now = systime_ms();
+  uint32_t max = airtime_budget_max_us(&budget);
+  uint32_t slot = slotted(now) ? tdma_slot_us(&tdma, now, reply_us()) : max;
+  return slot < max ? slot : max;
+}
+
+// the longest packet that can go right now
+static uint32_t available_us(uint32_t now) {
+  uint32_t available = airtime_budget_available_us(&budget, now);
+  uint32_t slot =
+      slotted(now) ? tdma_available_us(&tdma, now, reply_us()) : available;
+  return slot < available ? slot : available;
+}
+
+// a packet of airtime_us held up, count it if the budget is why
+static void defer(uint32_t now, uint32_t airtime_us) {
+  if (airtime_us > airtime_budget_available_us(&budget, now)) {
+    budget.deferred++;
+  }
+}
+
+/*
+Until a packet of airtime_us fits the budget and our slot, 0 if it does now,
+UINT32_MAX if it never fits the budget
+*/
+static uint32_t send_wait_ms(uint32_t now, uint32_t airtime_us) {
+  uint32_t wait = airtime_budget_wait_ms(&budget, now, airtime_us);
+  uint32_t slot_wait =
+      slotted(now) ? tdma_wait_ms(&tdma, now, airtime_us, reply_us()) : 0;
+  if (wait == UINT32_MAX || slot_wait == UINT32_MAX) {
+    return wait; // bigger than the slot, max_airtime_us keeps those out
+  }
+  return slot_wait > wait ? slot_wait : wait;
+}
+
+/*
+A data packet this long fits in available airtime, and if it's protected its
+repairs will fit in the budget at all
+*/
+static bool packet_fits(uint8_t length, uint32_t available) {
+  if (rfm9x_airtime_us(length) > available) {
+    return false;
+  }
+  return fec.repair_packets == 0 ||
+         (length <= FEC_MAX_PACKET &&
+          rfm9x_airtime_us(repair_length(length)) <= max_airtime_us());
+}
+
+/*
+The longest packet the airtime budget and our slot allow right now, 0 if
+that's not even a Datapoint and MIN_RADIO_BLOCK. Airtime only grows with
+length, so a binary search over the lengths.
+*/
+static uint8_t budget_packet_length(uint32_t now) {
+  uint32_t available = available_us(now);
+  uint8_t low = sizeof(Datapoint) + MIN_RADIO_BLOCK;
+  uint8_t high = RFM9X_MAX_PAYLOAD;
+  if (!packet_fits(low, available)) {
+    return 0;
+  }
+  while (low < high) {
+    uint8_t middle = low + (high - low + 1) / 2;
+    if (packet_fits(middle, available)) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+  return low;
+}
+
+// until there's room for the next repair or smallest data packet
+static uint32_t budget_wait_ms(uint32_t now, uint32_t otherwise_ms) {
+  uint8_t length = repairs_pending > 0
+                       ? repair_length(fec.symbol_length - 1)
+                       : sizeof(Datapoint) + MIN_RADIO_BLOCK;
+  uint32_t wait = send_wait_ms(now, rfm9x_airtime_us(length));
+  return wait == UINT32_MAX ? otherwise_ms : wait;
+}
+
+static bool on_ground(flight_phase phase) {
+  return phase == PHASE_PAD || phase == PHASE_LANDED;
+}
+
+static void pretrigger_push(const bmp_reading *reading) {
+  if (pretrigger_count == PRETRIGGER_READINGS) {
+    pretrigger_first = (pretrigger_first + 1) % PRETRIGGER_READINGS;
+    pretrigger_count--;
+  }
+  int32_t *values =
+      pretrigger[(pretrigger_first + pretrigger_count) % PRETRIGGER_READINGS];
+  values[SAMPLE_PRESSURE] = lround(reading->pressure * SAMPLE_PRESSURE_SCALE);
+  values[SAMPLE_TEMPERATURE] =
+      lround(reading->temperature * SAMPLE_TEMPERATURE_SCALE);
+  pretrigger_count++;
+}
+
+// everything in the FIFO into the ring
+static void pretrigger_drain(uint32_t now) {
+  uint32_t start = profile_begin();
+  bmp_reading readings[PRETRIGGER_BATCH];
+  uint16_t drained = 0;
+  uint8_t count;
+  do {
+    count = bmp388_read_fifo(readings, PRETRIGGER_BATCH);
+    for (uint8_t i = 0; i < count; i++) {
+      pretrigger_push(&readings[i]);
+    }
+    if (count > 0) {
+      pretrigger_latest = readings[count - 1];
+    }
+    drained += count;
+  } while (count == PRETRIGGER_BATCH);
+  // the FIFO doesn't say when, the newest was taken about now
+  for (uint16_t i = 0; i < drained && i < pretrigger_count; i++) {
+    int32_t *values = pretrigger[(pretrigger_first + pretrigger_count - 1 - i) %
+                                 PRETRIGGER_READINGS];
+    values[SAMPLE_TIME_MS] = (int32_t)(now - i * PRETRIGGER_PERIOD_MS);
+  }
+  next_drain_ms = now + PRETRIGGER_DRAIN_MS;
+  profile_end(PROFILE_PRETRIGGER, start);
+}
+
+static void pretrigger_start(uint32_t now, const bmp_reading *latest) {
+  pretrigger_first = 0;
+  pretrigger_count = 0;
+  pretrigger_latest = *latest;
+  next_drain_ms = now + PRETRIGGER_DRAIN_MS;
+  pretriggering = bmp388_start_fifo(PRETRIGGER_ODR, PRETRIGGER_OSR);
+  if (!pretriggering) {
+    bmp388_stop_fifo(); // forced readings it is
+  }
+}
+
+/*
+Off the ground: the readings since the last one logged go into the log, up
+to the one sample() just took, which is logged as usual. Then it's back to
+forced readings at the flight phase's rate.
+*/
+static void pretrigger_commit(uint32_t now) {
+  bmp388_stop_fifo();
+  pretriggering = false;
+  uint32_t logged_ms = flash_summary.last_ms;
+  for (; pretrigger_count > 0; pretrigger_count--) {
+    const int32_t *values = pretrigger[pretrigger_first];
+    pretrigger_first = (pretrigger_first + 1) % PRETRIGGER_READINGS;
+    uint32_t time_ms = values[SAMPLE_TIME_MS];
+    if ((int32_t)(time_ms - logged_ms) > 0 && (int32_t)(time_ms - now) < 0) {
+      log_values(values);
+      pretrigger_logged++;
+    }
+  }
+}
+
+static void sample(uint32_t now) {
+  gpio_toggle_pin_level(LED2);
+
+  uint32_t start = profile_begin();
+  bmp_reading reading = {0};
+  if (pretriggering) {
+    // in normal mode, the newest reading is the FIFO's
+    pretrigger_drain(now);
+    reading = pretrigger_latest;
+  } else {
+    bmp388_get_reading(&reading);
+  }
+
+  datapoint.battery_voltage = read_voltage();
+  datapoint.temperature = reading.temperature;
+  datapoint.pressure = reading.pressure;
+  profile_end(PROFILE_ACQUIRE, start);
+
+  start = profile_begin();
+  uint32_t pressure = reading.pressure * (1 << ALTITUDE_PRESSURE_SHIFT);
+  altitude_filter_update(altitude_from_pressure_cm(pressure), now);
+  float altitude = altitude_filter_m();
+  float vertical_speed = altitude_filter_vertical_speed_ms();
+  profile_end(PROFILE_ALTITUDE, start);
+
+  flight_phase previous = flight_phase_current();
+  flight_phase phase = flight_phase_update(altitude, vertical_speed, now);
+  datapoint.altitude = altitude;
+  datapoint.vertical_speed = vertical_speed * 100;
+  datapoint.phase = phase;
+  sample_ms = now;
+
+  int32_t values[SAMPLE_CHANNELS];
+  sample_values(values);
+  backlog_push(values);
+  if (pretriggering && !on_ground(phase)) {
+    pretrigger_commit(now);
+  } else if (!pretriggering && on_ground(phase)) {
+    pretrigger_start(now, &reading);
+  }
+  if (phase != previous) {
+    // let the ground and the log know straight away
+    next_transmit_ms = now;
+    next_log_ms = now;
+  }
+  next_sample_ms = now + current_policy()->sample_period_ms;
+  have_reading = true;
+}
+
+static uint32_t listen_window_ms(void) {
+  uint32_t airtime_us =
+      rfm9x_airtime_us(UPLINK_OVERHEAD + UPLINK_MAX_ARGUMENTS);
+  return LISTEN_TURNAROUND_MS + (airtime_us + 999) / 1000;
+}
+
+/*
+Lost touch with the ground on settings of its choosing, most likely it missed
+the acknowledgement that switched them. Both ends go back to where they
+started, straight away since there is no one to tell.
+*/
+static void link_fallback(void) {
+  const lora_modem initial = LORA_MODEM_DEFAULT;
+  if (rfm9x_fsk()) {
+    transferring = false; // back on LoRa at the end of the listen window
+  }
+  if (!adr.running && lora_modem_compatible(rfm9x_modem(), &initial)) {
+    return;
+  }
+  adr_reset(&adr);
+  pending_modem = initial;
+  modem_pending = true;
+  modem_acknowledged = true;
+}
+
+/*
+Send what's in packet and listen for the ground after it, unless it's a
+segment in the middle of a burst. With listen before talk another kite on air
+holds it back until retry_ms, when it's sent again as it is.
+*/
+static void send_packet(const phase_policy *policy, uint8_t length,
+                        uint8_t flags) {
+  uint32_t start = profile_begin();
+  if (policy->tx_power_dbm != tx_power_dbm) {
+    rfm9x_set_power(policy->tx_power_dbm);
+    tx_power_dbm = policy->tx_power_dbm;
+  }
+  held_length = 0;
+  // FSK downloads stay on the one frequency
+  rfm9x_set_channel(hopping && !rfm9x_fsk()
+                        ? hop_packet(&hop, systime_ms())
+                        : HOP_FRF(RFM9X_FREQUENCY_HZ));
+  uint32_t backoff_ms;
+  if (!listen_before_talk) {
+    rfm9x_send_flags(packet, length, flags);
+  } else if (!rfm9x_send_lbt(packet, length, flags, &backoff_ms)) {
+    held_length = length;
+    held_flags = flags;
+    retry_ms = systime_ms() + backoff_ms;
+    profile_end(PROFILE_RADIO, start);
+    return;
+  }
+  // from when it went on air
+  airtime_budget_spend(&budget, systime_ms(), rfm9x_airtime_us(length));
+  if ((flags & ARQ_SEGMENT_FLAG) && !(flags & ARQ_POLL_FLAG)) {
+    profile_end(PROFILE_RADIO, start);
+    return;
+  }
+  // give the ground a chance to answer
+  rfm9x_receive();
+  listening = true;
+  listen_until_ms = systime_ms() + listen_window_ms();
+  profile_end(PROFILE_RADIO, start);
+
+  if (++packets_since_uplink > ADR_SILENCE_PACKETS) {
+    link_fallback();
+    packets_since_uplink = 0;
+  }
+}
+
+static bool transmit_repair(const phase_policy *policy, uint32_t now) {
+  uint32_t airtime = rfm9x_airtime_us(repair_length(fec.symbol_length - 1));
+  if (airtime > available_us(now)) {
+    defer(now, airtime);
+    return false;
+  }
+  uint32_t start = profile_begin();
+  uint8_t length = fec_encoder_repair(&fec, repairs_sent, DEVICE_ID, packet);
+  profile_end(PROFILE_FEC, start);
+  send_packet(policy, length, FEC_REPAIR_FLAG);
+  repairs_sent++;
+  repairs_pending--;
+  return true;
+}
+
+/*
+Returns false, sending nothing, if the airtime budget doesn't have room for a
+packet yet
+*/
+static bool transmit(const phase_policy *policy) {
+  uint32_t now = systime_ms();
+  if (repairs_pending > 0 &&
+      rfm9x_airtime_us(repair_length(fec.symbol_length - 1)) >
+          max_airtime_us()) {
+    repairs_pending = 0; // slower modem settings since, they'll never fit
+  }
+  if (repairs_pending > 0) {
+    return transmit_repair(policy, now);
+  }
+  uint8_t length = budget_packet_length(now);
+  if (length == 0) {
+    defer(now, rfm9x_airtime_us(sizeof(Datapoint) + MIN_RADIO_BLOCK));
+    return false;
+  }
+  datapoint.packet_number = packet_number;
+
+  uint32_t start = profile_begin();
+  uint8_t* raw = (uint8_t*) &datapoint;
+  crc_t crc = crc_init();
+  crc = crc_update(crc, raw, DATAPOINT_TO_CRC);
+  crc = crc_finalize(crc);
+  datapoint.crc8 = crc;
+  profile_end(PROFILE_CRC, start);
+
+  start = profile_begin();
+  uint16_t block_length =
+      pack_backlog(packet + sizeof(Datapoint), length - sizeof(Datapoint));
+  memcpy(packet, raw, sizeof(Datapoint));
+  profile_end(PROFILE_CODEC, start);
+
+  length = sizeof(Datapoint) + block_length;
+  start = profile_begin();
+  if (fec_encoder_add(&fec, packet_number, packet, length)) {
+    repairs_pending = fec.repair_packets;
+    repairs_sent = 0;
+  }
+  profile_end(PROFILE_FEC, start);
+
+  send_packet(policy, length, 0x00);
+  if (modem_pending) {
+    modem_acknowledged = true;
+  }
+  if (fsk_pending) {
+    fsk_acknowledged = true;
+  }
+  packet_number++;
+  return true;
+}
+
+// segments sent for each one that asks to be acknowledged
+static uint8_t burst_length(void) {
+  return rfm9x_fsk() ? FSK_BURST_SEGMENTS : 1;
+}
+
+/*
+Long enough for a burst of segments to go out and the acknowledgement to come
+back in the listen window after it, twice over so one after the next can
+cover it
+*/
+static uint32_t segment_timeout_ms(void) {
+  uint32_t airtime_us = burst_length() * rfm9x_airtime_us(
+                                             transfer.segment_bytes +
+                                             ARQ_SEGMENT_OVERHEAD);
+  return 2 * ((airtime_us + 999) / 1000 + listen_window_ms());
+}
+
+/*
+The biggest segments, in steps of MIN_RADIO_BLOCK, that fit in the airtime
+budget on the current modem settings, 0 if not even the smallest does
+*/
+static uint8_t segment_bytes(void) {
+  uint8_t bytes = ARQ_MAX_SEGMENT_BYTES;
+  while (bytes > 0 &&
+         rfm9x_airtime_us(bytes + ARQ_SEGMENT_OVERHEAD) > max_airtime_us()) {
+    bytes -= MIN_RADIO_BLOCK;
+  }
+  return bytes;
+}
+
+// cut the transfer into segments for the modem settings it goes out on
+static void begin_segments(uint8_t id) {
+  uint8_t bytes = segment_bytes();
+  // sequence numbers are 16 bits
+  uint32_t most = (uint32_t)UINT16_MAX * bytes - UPLINK_TRANSFER_CRC_BYTES;
+  if (transfer_length > most) {
+    transfer_length = most;
+  }
+  arq_sender_begin(&transfer, id, bytes,
+                   transfer_length + UPLINK_TRANSFER_CRC_BYTES, 0);
+  transfer_crc = crc32_init();
+  transfer_checked = 0;
+  transfer.timeout_ms = segment_timeout_ms();
+  burst_segments = 0;
+  next_segment_ms = systime_ms();
+}
+
+/*
+The flash log from start to end, only up to the head: the log never changes
+what's behind it. On FSK it waits for the switch, after the acknowledgement.
+*/
+static void begin_transfer(uint8_t id, uint32_t start, uint32_t end,
+                           bool fsk) {
+  if (end > flash_log_head()) {
+    end = flash_log_head();
+  }
+  transfer_start = start;
+  transfer_length = end > start ? end - start : 0;
+  begin_segments(id);
+  transferring = true;
+  fsk_pending = fsk && !rfm9x_fsk();
+  fsk_acknowledged = false;
+}
+
+// flash log pages from first, or up to the head if pages is 0
+static bool start_transfer(uint8_t id, uint16_t first, uint16_t pages,
+                           bool fsk) {
+  if (segment_bytes() == 0) {
+    return false;
+  }
+  flush_samples(); // so the download has everything up to now
+  uint32_t start = (uint32_t)first * SPI_FLASH_PAGE_SIZE;
+  begin_transfer(id, start,
+                 pages == 0 ? flash_log_head()
+                            : start + (uint32_t)pages * SPI_FLASH_PAGE_SIZE,
+                 fsk);
+  return true;
+}
+
+/*
+When the readings on the page at address start, by the summary it starts
+with. A page without one (a reset cut its block short) goes by the next
+one's, up to end. False if there's none.
+*/
+static bool page_time(uint32_t address, uint32_t end, uint32_t *time_ms) {
+  block_summary summary;
+  for (; address < end; address += SPI_FLASH_PAGE_SIZE) {
+    if (flash_log_page_record(address, FLASH_LOG_SUMMARY, &summary,
+                              sizeof(summary))) {
+      *time_ms = summary.first_ms;
+      return true;
+    }
+  }
+  return false;
+}
+
+// binary search start to end for the first page with readings only after
+static uint32_t seek(uint32_t start, uint32_t end, uint32_t time_ms) {
+  uint32_t low = start / SPI_FLASH_PAGE_SIZE;
+  uint32_t high = (end + SPI_FLASH_PAGE_SIZE - 1) / SPI_FLASH_PAGE_SIZE;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    uint32_t first_ms;
+    if (!page_time(middle * SPI_FLASH_PAGE_SIZE, end, &first_ms) ||
+        first_ms > time_ms) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return low * SPI_FLASH_PAGE_SIZE;
+}
+
+/*
+The pages of a flight's log with its readings from from_s to to_s (0 for
+the end) seconds after it started, found from the flight directory and the
+block summaries. A flight that isn't there is an empty transfer.
+*/
+static bool start_flight_transfer(uint8_t id, uint16_t number, uint16_t from_s,
+                                  uint16_t to_s, bool fsk) {
+  if (segment_bytes() == 0) {
+    return false;
+  }
+  flush_samples();
+  flash_log_flight flight = {0};
+  // one suspend of any erase ahead for all the reads the search takes
+  spi_flash_batch_begin();
+  if (!flash_log_flight_find(number, &flight)) {
+    flight.end = 0;
+  }
+  uint32_t start = seek(flight.start, flight.end, from_s * 1000u);
+  if (start > flight.start) {
+    start -= SPI_FLASH_PAGE_SIZE; // readings before and from from_s
+  }
+  uint32_t end = to_s == 0 ? flight.end : seek(start, flight.end, to_s * 1000u);
+  spi_flash_batch_end();
+  begin_transfer(id, start, end, fsk);
+  return true;
+}
+
+/*
+Segments go out the first time in order, so the CRC-32 is taken as they're
+read, by the DMAC, and is whole by the time the one with it goes. Repeats
+just read the log again.
+*/
+static void read_segment(uint32_t offset, uint8_t length) {
+  uint8_t log_bytes = 0;
+  if (offset < transfer_length) {
+    log_bytes = transfer_length - offset < length ? transfer_length - offset
+                                                  : length;
+  }
+  if (offset == transfer_checked && log_bytes > 0) {
+    transfer_crc = spi_flash_read_crc32(transfer_start + offset, segment_data,
+                                        log_bytes, transfer_crc);
+    transfer_checked += log_bytes;
+  } else if (log_bytes > 0) {
+    spi_flash_read(transfer_start + offset, segment_data, log_bytes);
+  }
+  uint32_t crc = crc32_finalize(transfer_crc);
+  for (uint8_t i = log_bytes; i < length; i++) {
+    uint32_t byte = offset + i - transfer_length;
+    segment_data[i] = crc >> (8 * byte);
+  }
+}
+
+/*
+The next segment of a download, when there's no Datapoint due. Sets
+next_segment_ms for when to try again.
+*/
+static void transmit_segment(const phase_policy *policy, uint32_t now) {
+  if (arq_sender_done(&transfer)) {
+    transferring = false;
+    return;
+  }
+  uint16_t sequence;
+  if (!arq_sender_next(&transfer, now, &sequence)) {
+    // UINT32_MAX is waiting on acks, each listen window could bring one
+    uint32_t wait = arq_sender_wait_ms(&transfer, now);
+    next_segment_ms = now + (wait < transfer.timeout_ms ? wait
+                                                        : transfer.timeout_ms);
+    return;
+  }
+  uint32_t offset = (uint32_t)sequence * transfer.segment_bytes;
+  uint8_t length = transfer.segment_bytes;
+  uint32_t stream_length = transfer_length + UPLINK_TRANSFER_CRC_BYTES;
+  if (stream_length - offset < length) {
+    length = stream_length - offset;
+  }
+  uint32_t airtime = rfm9x_airtime_us(length + ARQ_SEGMENT_OVERHEAD);
+  uint32_t wait = send_wait_ms(now, airtime);
+  if (wait == UINT32_MAX) {
+    transferring = false; // slower modem settings since, it'll never fit
+    return;
+  }
+  if (wait > 0) {
+    defer(now, airtime);
+    next_segment_ms = now + wait;
+    return;
+  }
+
+  // ask for an acknowledgement at the end of a burst or when it runs dry
+  arq_sender after = transfer;
+  arq_sender_sent(&after, sequence, now);
+  uint16_t following;
+  uint8_t flags = ARQ_SEGMENT_FLAG;
+  if (++burst_segments >= burst_length() ||
+      !arq_sender_next(&after, now, &following)) {
+    flags |= ARQ_POLL_FLAG;
+    burst_segments = 0;
+  }
+
+  uint32_t start = profile_begin();
+  read_segment(offset, length);
+  profile_end(PROFILE_FLASH, start);
+  arq_segment segment = {
+      .device_id = DEVICE_ID,
+      .transfer = transfer.transfer,
+      .segment_bytes = transfer.segment_bytes,
+      .sequence = sequence,
+      .segments = transfer.segments,
+      .data = segment_data,
+      .length = length,
+  };
+  send_packet(policy, arq_segment_encode(&segment, packet), flags);
+  arq_sender_sent(&transfer, sequence, systime_ms());
+  next_segment_ms = now;
+}
+
+// hopping, TELEMETRY_HOP_PACKET stays within the dwell limit on modem
+static bool fits_dwell(const lora_modem *modem) {
+  return lora_airtime_us(modem, TELEMETRY_HOP_PACKET) <=
+         HOP_MAX_DWELL_MS * 1000ul;
+}
+
+static void apply_command(const uplink_command *command) {
+  switch (command->type) {
+  case UPLINK_PING:
+    break;
+  case UPLINK_SET_POWER: {
+    uint8_t power = command->length >= 1 ? command->arguments[0] : 0;
+    if (power != 0 && (power < 5 || power > 20)) {
+      return; // rfm9x_set_power would stop everything
+    }
+    override.tx_power_dbm = power;
+    break;
+  }
+  case UPLINK_SET_PERIODS:
+    override.sample_period_ms = uplink_argument_u16(command, 0);
+    override.transmit_period_ms = uplink_argument_u16(command, 2);
+    override.log_period_ms = uplink_argument_u16(command, 4);
+    break;
+  case UPLINK_SET_FEC:
+    if (command->length < 2 ||
+        !fec_encoder_begin(&fec, command->arguments[0],
+                           command->arguments[1])) {
+      return;
+    }
+    repairs_pending = 0;
+    break;
+  case UPLINK_SET_MODEM: {
+    if (command->length < LORA_MODEM_PACKED) {
+      return;
+    }
+    lora_modem requested;
+    lora_modem_unpack(&requested, command->arguments);
+    if (!lora_modem_valid(&requested) || requested.implicit_header) {
+      return; // rfm9x_set_modem would turn it down after the acknowledgement
+    }
+    if (hopping && !fits_dwell(&requested)) {
+      return;
+    }
+    pending_modem = requested;
+    modem_pending = true;
+    modem_acknowledged = false;
+    adr_reset(&adr); // until the next link report
+    break;
+  }
+  case UPLINK_CLEAR_OVERRIDES:
+    memset(&override, 0, sizeof(override));
+    break;
+  case UPLINK_SET_LBT:
+    if (command->length < 1) {
+      return;
+    }
+    listen_before_talk = command->arguments[0] != 0;
+    break;
+  case UPLINK_SET_TDMA:
+    if (command->length < 3 ||
+        !tdma_configure(&tdma, command->arguments[0],
+                        uplink_argument_u16(command, 1), DEVICE_ID)) {
+      return;
+    }
+    break;
+  case UPLINK_SET_HOPPING:
+    if (command->length < 3) {
+      return;
+    }
+    if (command->arguments[0] != 0 &&
+        !fits_dwell(modem_pending ? &pending_modem : rfm9x_modem())) {
+      return; // too slow to stay on one channel, leave it unacknowledged
+    }
+    hopping = command->arguments[0] != 0;
+    if (hopping) {
+      hop_init(&hop, DEVICE_ID, datapoint.flight_number,
+               uplink_argument_u16(command, 1), systime_ms());
+    }
+    // back on RFM9X_FREQUENCY_HZ from the next packet when it's off
+    budget.dwell_us = hopping ? HOP_MAX_DWELL_MS * 1000ul : DWELL_US;
+    adr_limit(&adr, hopping ? TELEMETRY_HOP_PACKET : 0,
+              hopping ? HOP_MAX_DWELL_MS * 1000ul : 0);
+    break;
+  case UPLINK_START_TRANSFER:
+    if (command->length < 5 ||
+        !start_transfer(command->arguments[0],
+                        uplink_argument_u16(command, 1),
+                        uplink_argument_u16(command, 3),
+                        command->length >= 6 && command->arguments[5] != 0)) {
+      return;
+    }
+    break;
+  case UPLINK_FLIGHT_TRANSFER:
+    if (command->length < 7 ||
+        !start_flight_transfer(
+            command->arguments[0], uplink_argument_u16(command, 1),
+            uplink_argument_u16(command, 3), uplink_argument_u16(command, 5),
+            command->length >= 8 && command->arguments[7] != 0)) {
+      return;
+    }
+    break;
+  case UPLINK_FORMAT_LOG:
+    // the chip erase stops everything for a while, never in the air
+    if (command->length < 4 ||
+        uplink_argument_u16(command, 0) != datapoint.flight_number ||
+        uplink_argument_u16(command, 2) != UPLINK_FORMAT_KEY ||
+        !on_ground(flight_phase_current()) || transferring) {
+      return;
+    }
+    flash_log_format();
+    begin_flight();
+    break;
+  case UPLINK_LINK_REPORT: {
+    if (command->length < ADR_REPORT_PACKED) {
+      return;
+    }
+    // with the power pinned from the ground the report says nothing new
+    adr_report report;
+    adr_report_unpack(&report, command->arguments);
+    if (override.tx_power_dbm == 0 &&
+        adr_update(&adr, rfm9x_modem(), &report)) {
+      pending_modem = *rfm9x_modem();
+      adr_apply(&adr, &pending_modem);
+      modem_pending = true;
+      modem_acknowledged = false;
+    }
+    // acknowledged with the next packet when it's due, nothing to hurry
+    datapoint.command_sequence = command->sequence;
+    return;
+  }
+  default:
+    return; // unknown, leave it unacknowledged
+  }
+  datapoint.command_sequence = command->sequence;
+
+  // new periods take effect now rather than after the old ones run out
+  uint32_t now = systime_ms();
+  next_sample_ms = now;
+  next_transmit_ms = now;
+  next_log_ms = now;
+}
+
+static void handle_uplink(const rfm9x_packet *packet) {
+  uplink_command command;
+  if (!uplink_parse(packet->data, packet->length, DEVICE_ID, &command)) {
+    return;
+  }
+  datapoint.uplink_snr = packet->snr_db;
+  packets_since_uplink = 0;
+  if (command.type == UPLINK_TRANSFER_ACK) {
+    if (transferring && command.length >= ARQ_ACK_PACKED) {
+      arq_ack ack;
+      arq_ack_unpack(&ack, command.arguments);
+      arq_sender_ack(&transfer, &ack);
+      transferring = !arq_sender_done(&transfer);
+    }
+    listen_until_ms = systime_ms(); // the ground only ever sends one
+    return;
+  }
+  if (command.type == UPLINK_TDMA_BEACON) {
+    if (command.length >= 2) {
+      tdma_beacon(&tdma, systime_ms(), uplink_argument_u16(&command, 0));
+    }
+    listen_until_ms = systime_ms();
+    return;
+  }
+  if (command.sequence == datapoint.command_sequence) {
+    return; // a repeat, the acknowledgement went missing
+  }
+  apply_command(&command);
+}
+
+static void listen(const phase_policy *policy) {
+  rfm9x_packet packet;
+  if (rfm9x_poll(&packet) == RFM9X_RX_PACKET) {
+    uint32_t start = profile_begin();
+    handle_uplink(&packet);
+    profile_end(PROFILE_UPLINK, start);
+  }
+  if (!due(systime_ms(), listen_until_ms)) {
+    return;
+  }
+
+  listening = false;
+  if (modem_pending && modem_acknowledged) {
+    rfm9x_set_modem(&pending_modem);
+    modem_pending = false;
+  }
+  if (fsk_pending && fsk_acknowledged) {
+    const fsk_modem bulk = FSK_MODEM_DEFAULT;
+    fsk_pending = false;
+    if (transferring && rfm9x_set_fsk(&bulk)) {
+      begin_segments(transfer.transfer); // nothing sent yet, bigger ones fit
+    }
+  }
+  if (!transferring && rfm9x_fsk()) {
+    rfm9x_set_lora();
+  }
+  if (policy->radio_sleep) {
+    rfm9x_sleep();
+  } else {
+    rfm9x_standby();
+  }
+}
+
+static void flush_samples(void) {
+  uint16_t length = delta_encoder_finish(&flash_samples);
+  if (length > 0) {
+    flash_summary.samples = flash_samples.samples;
+    uint32_t start = profile_begin();
+    // on one page, which then starts with a summary
+    uint16_t size = 3 * FLASH_LOG_OVERHEAD + sizeof(block_summary) +
+                    sizeof(Datapoint) + length;
+    if (size > SPI_FLASH_PAGE_SIZE - flash_log_head() % SPI_FLASH_PAGE_SIZE) {
+      flash_log_new_page();
+    }
+    flash_log_append(FLASH_LOG_SUMMARY, &flash_summary, sizeof(block_summary));
+    flash_log_append(FLASH_LOG_DATAPOINT, &block_datapoint, sizeof(Datapoint));
+    flash_log_append(FLASH_LOG_SAMPLES, flash_block, length);
+    // the next block won't fit in what's left, or not for a while
+    flash_log_flush();
+    profile_end(PROFILE_FLASH, start);
+  }
+  delta_encoder_begin(&flash_samples, SAMPLE_CHANNELS, flash_block,
+                      sizeof(flash_block));
+}
+
+/*
+Readings are logged compressed, with a summary for seeking and a full
+Datapoint for the battery, phase and so on from the start of every block
+*/
+static void log_values(const int32_t *values) {
+  uint32_t start = profile_begin();
+  bool added = delta_encoder_add(&flash_samples, values);
+  profile_end(PROFILE_CODEC, start);
+  if (!added) {
+    flush_samples();
+    start = profile_begin();
+    delta_encoder_add(&flash_samples, values);
+    profile_end(PROFILE_CODEC, start);
+  }
+
+  int32_t pressure = values[SAMPLE_PRESSURE];
+  if (flash_samples.samples == 1) {
+    block_datapoint = datapoint;
+    flash_summary.first_ms = values[SAMPLE_TIME_MS];
+    flash_summary.min_pressure = pressure;
+    flash_summary.max_pressure = pressure;
+  }
+  flash_summary.last_ms = values[SAMPLE_TIME_MS];
+  if (pressure < flash_summary.min_pressure) {
+    flash_summary.min_pressure = pressure;
+  }
+  if (pressure > flash_summary.max_pressure) {
+    flash_summary.max_pressure = pressure;
+  }
+}
+
+static void log_datapoint(void) {
+  int32_t values[SAMPLE_CHANNELS];
+  sample_values(values);
+  log_values(values);
+}
+
+// log the block being encoded before it's full, see LOG_FLUSH_MS
+static void flush_log(uint32_t now) {
+  // it doesn't come back up, so once is enough, and no flapping about it
+  bool dropped = !battery_low && datapoint.battery_voltage < LOW_BATTERY_V;
+  battery_low |= dropped;
+  uint32_t timeout = battery_low ? LOW_BATTERY_FLUSH_MS : LOG_FLUSH_MS;
+  if (flash_samples.samples > 0 &&
+      (dropped || due(now, flash_summary.first_ms + timeout))) {
+    flush_samples();
+  }
+}
+
+/*
+Erase flash ahead of the log between steps. Appending or reading a download
+segment meanwhile suspends the erase, so logging only waits for page programs.
+*/
+static void erase_ahead(void) {
+  uint32_t start = profile_begin();
+  if (flash_log_erase_ahead(ERASE_AHEAD_SECTORS)) {
+    profile_end(PROFILE_ERASE, start);
+  }
+}
+
+void telemetry_step(void) {
+  uint32_t now = systime_ms();
+  if (pretriggering && due(now, next_drain_ms)) {
+    pretrigger_drain(now);
+  }
+  if (due(now, next_sample_ms)) {
+    sample(now);
+  }
+  if (!have_reading) {
+    return;
+  }
+
+  if (listening) {
+    listen(current_policy());
+  }
+  const phase_policy *policy = current_policy();
+  now = systime_ms();
+  if (!listening && held_length > 0) {
+    // nothing else goes until it's out, in our next slot if this one closed
+    if (due(now, retry_ms)) {
+      uint32_t wait = send_wait_ms(now, rfm9x_airtime_us(held_length));
+      if (wait == 0 || wait == UINT32_MAX) {
+        send_packet(policy, held_length, held_flags);
+      } else {
+        retry_ms = now + wait;
+      }
+    }
+  } else if (!listening && due(now, next_transmit_ms)) {
+    // with readings or repairs left over, go again as soon as the budget allows
+    bool sent = transmit(policy);
+    if (sent && backlog_count == 0 && repairs_pending == 0) {
+      next_transmit_ms = now + policy->transmit_period_ms;
+    } else {
+      next_transmit_ms = now + budget_wait_ms(now, policy->transmit_period_ms);
+    }
+  } else if (!listening && transferring && !fsk_pending &&
+             due(now, next_segment_ms)) {
+    transmit_segment(policy, now);
+  }
+  if (due(now, next_log_ms)) {
+    log_datapoint();
+    next_log_ms = now + policy->log_period_ms;
+  }
+  flush_log(now);
+  erase_ahead();
+}
+
+void telemetry_shutdown(void) {
+  flush_samples();
+  spi_flash_wait();
+}
+
+const airtime_budget *telemetry_airtime_budget(void) { return &budget; }
+
+const tdma_schedule *telemetry_tdma(void) { return &tdma; }
+
+const hop_sequence *telemetry_hopping(void) {
+  return hopping ? &hop : NULL;
+}
+
+uint32_t telemetry_pretrigger_logged(void) { return pretrigger_logged; }
+
+uint32_t telemetry_delay_ms(void) {
+  uint32_t now = systime_ms();
+  if (listening) {
+    return due(now, listen_until_ms) ? 0 : LISTEN_POLL_MS;
+  }
+  uint32_t deadlines[] = {next_sample_ms, next_transmit_ms, next_log_ms,
+                          next_segment_ms, retry_ms,
+                          flash_summary.first_ms + LOG_FLUSH_MS, next_drain_ms};
+  // a held packet goes before anything else is sent
+  bool held = held_length > 0;
+  bool waiting[] = {true, !held, true, !held && transferring && !fsk_pending,
+                    held, flash_samples.samples > 0, pretriggering};
+  uint32_t delay = UINT32_MAX;
+  for (uint8_t i = 0; i < sizeof(deadlines) / sizeof(deadlines[0]); i++) {
+    if (!waiting[i]) {
+      continue;
+    }
+    if (due(now, deadlines[i])) {
+      return 0;
+    }
+    if (deadlines[i] - now < delay) {
+      delay = deadlines[i] - now;
+    }
+  }
+  return delay;
+}
+
+static float read_voltage(void) {
+  uint16_t raw_battery_voltage;
+
+  adc_sync_read_channel(&ADC_0, 0, ((uint8_t *)&raw_battery_voltage), 2);
+  adc_sync_read_channel(&ADC_0, 0, ((uint8_t *)&raw_battery_voltage), 2);
+
+  float battery_voltage = (float)raw_battery_voltage;
+  battery_voltage *= 2;    // we divided by 2, so multiply back
+  battery_voltage *= 3.3;  // Multiply by 3.3V, our reference voltage
+  battery_voltage /= 4096; // convert to voltage
+  return battery_voltage;
+}
@@ -0,0 +1,96 @@
+/*
+ * telemetry.h
+ *
+ * Created: 10/19/2026
+ *
+ * The acquisition -> CRC -> radio -> flash pipeline. How often each stage
+ * runs depends on the flight phase, see flight_phase.h.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "airtime_budget.h"
+#include "crc.h"
+#include "fec.h"
+#include "hop.h"
+#include "tdma.h"
+#include <stdint.h>
+
+typedef struct Datapoint {
+  double temperature; // 8 bytes
+  double pressure; //8 bytes 
+  float battery_voltage; // 4 bytes
+  uint32_t packet_number; // 4 bytes
+  uint32_t flight_number; // 4 bytes
+  uint8_t device_id; // 1 bytes
+  uint8_t version; // 1 bytes
+  int16_t vertical_speed; // 2 bytes, cm/s up from the altitude filter
+  float altitude; // 4 bytes, m standard atmosphere from the altitude filter
+  uint8_t phase; // 1 bytes, flight_phase
+  uint8_t command_sequence; // 1 bytes, last uplink command applied
+  int8_t uplink_snr; // 1 bytes, dB, of the last command heard
+  crc_t crc8; // 1 bytes
+} Datapoint;
+
+// don't bother with a packet that can't carry at least a couple of readings
+#define TELEMETRY_MIN_RADIO_BLOCK 16
+
+/*
+Hopping, a packet stays on one channel from start to end, so on air for no
+longer than HOP_MAX_DWELL_MS. The smallest data packet and its FEC repair
+packet (RadioHead's 4 byte header, the repair header, length byte and CRC
+included) have to fit that on the modem settings in use: the kite turns
+hopping or UPLINK_SET_MODEM down otherwise, and ADR on both ends keeps to
+settings they fit.
+*/
+#define TELEMETRY_HOP_PACKET                                                   \
+  (4 + FEC_REPAIR_HEADER + sizeof(Datapoint) + TELEMETRY_MIN_RADIO_BLOCK + 2)
+
+/*
+Compressed readings (see delta_codec.h) follow the Datapoint in every radio
+packet, as many of the ones not sent yet as the airtime budget allows, and
+make up FLASH_LOG_SAMPLES records in the flash log.
+*/
+typedef enum sample_channel {
+  SAMPLE_TIME_MS, // systime_ms when it was taken
+  SAMPLE_PRESSURE, // 1/100 Pa
+  SAMPLE_TEMPERATURE, // 1/100 C
+  SAMPLE_CHANNELS
+} sample_channel;
+
+#define SAMPLE_PRESSURE_SCALE 100
+#define SAMPLE_TEMPERATURE_SCALE 100
+
+/*
+Logged as a FLASH_LOG_SUMMARY record ahead of the Datapoint and
+FLASH_LOG_SAMPLES records of each block, all three on one page. So the first
+record of every page of readings says when they start, and a download can
+seek to a time without reading the pages in between.
+*/
+typedef struct block_summary {
+  uint32_t first_ms; // SAMPLE_TIME_MS of the block's first reading
+  uint32_t last_ms;
+  int32_t min_pressure; // SAMPLE_PRESSURE
+  int32_t max_pressure;
+  uint16_t samples;
+} block_summary;
+
+// bring up the sensors, radio and flash log
+void telemetry_init(void);
+// run whichever of sampling, sending and logging are due
+void telemetry_step(void);
+// how long until telemetry_step has something to do
+uint32_t telemetry_delay_ms(void);
+// get everything logged so far onto flash, before the power goes
+void telemetry_shutdown(void);
+// the radio's airtime budget, for seeing how close to it the link runs
+const airtime_budget *telemetry_airtime_budget(void);
+// the TDMA schedule, for its beacons and corrections
+const tdma_schedule *telemetry_tdma(void);
+// the hop sequence, NULL while the ground hasn't turned hopping on
+const hop_sequence *telemetry_hopping(void);
+// readings from the pre-trigger buffer logged on leaving the ground
+uint32_t telemetry_pretrigger_logged(void);
+
+#endif /* TELEMETRY_H_ */
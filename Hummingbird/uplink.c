@@ -0,0 +1,56 @@
+/*
+ * uplink.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "uplink.h"
+#include "crc.h"
+#include <string.h>
+
+static crc_t command_crc(const uint8_t *data, uint8_t length) {
+  crc_t crc = crc_init();
+  crc = crc_update(crc, data, length);
+  return crc_finalize(crc);
+}
+
+bool uplink_parse(const uint8_t *data, uint8_t length, uint8_t device_id,
+                  uplink_command *command) {
+  if (length < UPLINK_OVERHEAD) {
+    return false;
+  }
+  uint8_t arguments = data[3];
+  if (arguments > UPLINK_MAX_ARGUMENTS ||
+      length != UPLINK_OVERHEAD + arguments ||
+      command_crc(data, length - 1) != data[length - 1] ||
+      data[0] != device_id) {
+    return false;
+  }
+  command->sequence = data[1];
+  command->type = data[2];
+  command->length = arguments;
+  memcpy(command->arguments, &data[4], arguments);
+  return true;
+}
+
+uint8_t uplink_encode(const uplink_command *command, uint8_t device_id,
+                      uint8_t *out) {
+  uint8_t arguments = command->length < UPLINK_MAX_ARGUMENTS
+                          ? command->length
+                          : UPLINK_MAX_ARGUMENTS;
+  out[0] = device_id;
+  out[1] = command->sequence;
+  out[2] = command->type;
+  out[3] = arguments;
+  memcpy(&out[4], command->arguments, arguments);
+  uint8_t length = UPLINK_OVERHEAD + arguments;
+  out[length - 1] = command_crc(out, length - 1);
+  return length;
+}
+
+uint16_t uplink_argument_u16(const uplink_command *command, uint8_t offset) {
+  if (offset + 2 > command->length) {
+    return 0;
+  }
+  return command->arguments[offset] | command->arguments[offset + 1] << 8;
+}
@@ -0,0 +1,99 @@
+/*
+ * uplink.h
+ *
+ * Created: 10/19/2026
+ *
+ * Commands from the ground, received in the listen window after each
+ * telemetry packet. After the RadioHead header a command is
+ *
+ *   [device id][sequence][command][argument length][arguments...][crc8]
+ *
+ * with multi byte arguments little endian. The kite reports the sequence
+ * number of the last command it applied in every Datapoint, so the ground
+ * keeps repeating a command until it sees it acknowledged. Repeats of the
+ * last applied command are acknowledged again but not reapplied.
+ *
+ * UPLINK_TRANSFER_ACK and UPLINK_TDMA_BEACON are the exceptions: they
+ * aren't numbered (their sequence is 0), aren't acknowledged, and are acted
+ * on every time they arrive.
+ *
+ * No hardware dependencies, the ground side builds it to encode commands.
+ */
+
+#ifndef UPLINK_H_
+#define UPLINK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define UPLINK_OVERHEAD 5
+#define UPLINK_MAX_ARGUMENTS 8
+// a flash log transfer ends with the CRC-32 (crc32.h) of the bytes before it
+#define UPLINK_TRANSFER_CRC_BYTES 4
+// UPLINK_FORMAT_LOG's confirmation, so nothing else can pass for one
+#define UPLINK_FORMAT_KEY 0xF0A7
+
+typedef enum uplink_type {
+  UPLINK_PING = 0x00,            // nothing, just to get an acknowledgement
+  UPLINK_SET_POWER = 0x01,       // [dBm], 5 to 20, 0 for the phase's own
+  UPLINK_SET_PERIODS = 0x02,     // [sample ms u16][transmit ms u16][log ms u16]
+                                 // 0 leaves the phase's own period
+  UPLINK_SET_MODEM = 0x03,       // lora_modem_pack, applied after the
+                                 // acknowledgement has gone out
+  UPLINK_CLEAR_OVERRIDES = 0x04, // back to the flight phase policies
+  UPLINK_LINK_REPORT = 0x05,     // adr_report_pack, see adr.h
+  UPLINK_SET_FEC = 0x06,         // [data packets][repair packets], see fec.h,
+                                 // 0 repair packets turns it off
+  UPLINK_START_TRANSFER = 0x07,  // [transfer id][first page u16][pages u16]
+                                 // of the flash log over arq.h, 0 pages
+                                 // for everything up to the head, then
+                                 // optionally [fsk] 1 to send it on
+                                 // FSK_MODEM_DEFAULT after the
+                                 // acknowledgement, back to LoRa when done,
+                                 // with UPLINK_TRANSFER_CRC_BYTES after
+                                 // the pages, little endian
+  UPLINK_TRANSFER_ACK = 0x08,    // arq_ack_pack, see arq.h
+  UPLINK_SET_LBT = 0x09,         // [on], listen before talk on a shared
+                                 // channel, off to start with
+  UPLINK_SET_TDMA = 0x0a,        // [slots][frame ms u16], see tdma.h, 0
+                                 // slots turns it off
+  UPLINK_TDMA_BEACON = 0x0b,     // [position ms u16] into the ground's
+                                 // frame as the beacon ends
+  UPLINK_SET_HOPPING = 0x0c,     // [on][dwell ms u16], see hop.h, off
+                                 // to start with
+  UPLINK_FLIGHT_TRANSFER = 0x0d, // [transfer id][flight u16][from s u16]
+                                 // [to s u16] of the flash log like
+                                 // START_TRANSFER, only the pages with
+                                 // that flight's readings from and to
+                                 // seconds after it started, flight 0 for
+                                 // the current one, to 0 for its end,
+                                 // then optionally [fsk]
+  UPLINK_FORMAT_LOG = 0x0e,      // [flight u16][UPLINK_FORMAT_KEY u16],
+                                 // erases the whole flash log and starts
+                                 // again from flight 1, only on the
+                                 // ground, with no transfer going and
+                                 // flight the current one
+} uplink_type;
+
+typedef struct uplink_command {
+  uint8_t sequence;
+  uint8_t type;
+  uint8_t length;
+  uint8_t arguments[UPLINK_MAX_ARGUMENTS];
+} uplink_command;
+
+/*
+Check and unpack a received command. Returns false if it is damaged, the
+wrong size or for another device.
+*/
+bool uplink_parse(const uint8_t *data, uint8_t length, uint8_t device_id,
+                  uplink_command *command);
+// pack a command for sending, returns its length (at most UPLINK_OVERHEAD +
+// UPLINK_MAX_ARGUMENTS)
+uint8_t uplink_encode(const uplink_command *command, uint8_t device_id,
+                      uint8_t *out);
+
+// little endian argument at offset
+uint16_t uplink_argument_u16(const uplink_command *command, uint8_t offset);
+
+#endif /* UPLINK_H_ */
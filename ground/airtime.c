@@ -0,0 +1,58 @@
+/*
+ * airtime.c
+ *
+ * Created: 10/19/2026
+ *
+ * Time on air for every spreading factor and bandwidth the kite supports,
+ * with the firmware's own lora_modem.c, for picking settings from the
+ * ground:
+ *
+ *   airtime [payload bytes] [coding rate 1-4] [preamble]
+ *
+ * The payload is what rfm9x_send is given; RadioHead's 4 byte header is
+ * added. Defaults are a 104 byte telemetry packet (Datapoint and a full
+ * radio block), 4/5 and an 8 symbol preamble.
+ *
+ *   cc -O2 -I../Hummingbird -o airtime airtime.c ../Hummingbird/lora_modem.c
+ */
+
+#include "lora_modem.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const uint8_t HEADER_LENGTH = 4;
+
+int main(int argc, char **argv) {
+  int payload = argc > 1 ? atoi(argv[1]) : 104;
+  int coding_rate = argc > 2 ? atoi(argv[2]) : LORA_CR_4_5;
+  int preamble = argc > 3 ? atoi(argv[3]) : 8;
+  if (payload < 0 || payload + HEADER_LENGTH > 255 ||
+      coding_rate < LORA_CR_4_5 || coding_rate > LORA_CR_4_8 ||
+      preamble < LORA_MIN_PREAMBLE || preamble > UINT16_MAX) {
+    fprintf(stderr,
+            "usage: %s [payload bytes, 0-251] [coding rate 1-4] [preamble]\n",
+            argv[0]);
+    return 2;
+  }
+
+  printf("%d byte payload, CR 4/%d, %d symbol preamble\n\n", payload,
+         4 + coding_rate, preamble);
+  printf("%4s %10s %10s %12s %10s %5s\n", "SF", "BW kHz", "symbol us",
+         "airtime ms", "bit/s", "LDRO");
+  for (uint8_t sf = LORA_MIN_SPREADING_FACTOR; sf <= LORA_MAX_SPREADING_FACTOR;
+       sf++) {
+    for (uint8_t bw = 0; bw < LORA_BW_COUNT; bw++) {
+      lora_modem modem = LORA_MODEM_DEFAULT;
+      modem.spreading_factor = sf;
+      modem.bandwidth = bw;
+      modem.coding_rate = (uint8_t)coding_rate;
+      modem.preamble_length = (uint16_t)preamble;
+      printf("%4u %10.1f %10u %12.3f %10u %5s\n", sf,
+             lora_bandwidth_hz(bw) / 1000.0, lora_symbol_us(&modem),
+             lora_airtime_us(&modem, (uint8_t)(payload + HEADER_LENGTH)) /
+                 1000.0,
+             lora_bit_rate(&modem), lora_low_data_rate_on(&modem) ? "on" : "");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,246 @@
+/*
+ * archive_bench.c
+ *
+ * Created: 10/19/2026
+ *
+ * Compares the two usual queries, "pressure over flight 42" and "battery
+ * minimum across all flights", on a CSV export and on a columnar archive of
+ * the same synthetic flights:
+ *
+ *   archive_bench [work dir] [flights] [rows per flight]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "telemetry_archive.h"
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// not in C99's math.h
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct pressure_stats {
+  uint64_t count;
+  double min;
+  double max;
+  double sum;
+} pressure_stats;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void stats_add(pressure_stats *stats, double pressure) {
+  if (stats->count == 0 || pressure < stats->min) {
+    stats->min = pressure;
+  }
+  if (stats->count == 0 || pressure > stats->max) {
+    stats->max = pressure;
+  }
+  stats->sum += pressure;
+  stats->count++;
+}
+
+/*
+Something kite shaped: climb a few hundred metres, wander, come back down,
+while the battery sags.
+*/
+static void synthetic_row(uint32_t flight, uint32_t packet, uint32_t rows,
+                          archive_row *row) {
+  double t = (double)packet / rows;
+  double altitude = 300.0 * sin(M_PI * t) + 15.0 * sin(40.0 * t + flight);
+  row->flight_number = flight;
+  row->packet_number = packet;
+  row->pressure = 101325.0 * pow(1.0 - altitude / 44330.0, 5.255);
+  row->temperature = 18.0 - 0.0065 * altitude + 0.01 * (flight % 7);
+  row->battery_voltage = 4.15f - 0.5f * (float)t - 0.001f * (flight % 13);
+}
+
+static int generate(const char *csv_path, const char *archive_path,
+                    uint32_t flights, uint32_t rows) {
+  FILE *csv = fopen(csv_path, "w");
+  if (csv == NULL) {
+    return -1;
+  }
+  static archive_writer writer;
+  if (archive_writer_open(&writer, archive_path) != 0) {
+    fclose(csv);
+    return -1;
+  }
+
+  fprintf(csv, "flight_number,packet_number,temperature,pressure,"
+               "battery_voltage\n");
+  for (uint32_t flight = 1; flight <= flights; flight++) {
+    for (uint32_t packet = 0; packet < rows; packet++) {
+      archive_row row;
+      synthetic_row(flight, packet, rows, &row);
+      fprintf(csv, "%u,%u,%.4f,%.4f,%.4f\n", row.flight_number,
+              row.packet_number, row.temperature, row.pressure,
+              (double)row.battery_voltage);
+      // round trip through the CSV text so both sides hold the same values
+      char line[128];
+      snprintf(line, sizeof(line), "%u,%u,%.4f,%.4f,%.4f", row.flight_number,
+               row.packet_number, row.temperature, row.pressure,
+               (double)row.battery_voltage);
+      archive_parse_csv_row(line, &row);
+      if (archive_writer_append(&writer, &row) != 0) {
+        fclose(csv);
+        return -1;
+      }
+    }
+  }
+
+  fclose(csv);
+  return archive_writer_close(&writer);
+}
+
+static int csv_scan(const char *csv_path, uint32_t flight,
+                    pressure_stats *stats, float *battery_min) {
+  FILE *csv = fopen(csv_path, "r");
+  if (csv == NULL) {
+    return -1;
+  }
+  char line[256];
+  *battery_min = FLT_MAX;
+  while (fgets(line, sizeof(line), csv) != NULL) {
+    archive_row row;
+    if (archive_parse_csv_row(line, &row) != 0) {
+      continue;
+    }
+    if (stats != NULL && row.flight_number == flight) {
+      stats_add(stats, row.pressure);
+    }
+    if (row.battery_voltage < *battery_min) {
+      *battery_min = row.battery_voltage;
+    }
+  }
+  fclose(csv);
+  return 0;
+}
+
+static void archive_flight_pressure(const archive *archive, uint32_t flight,
+                                    pressure_stats *stats) {
+  const archive_chunk *chunk = NULL;
+  while ((chunk = archive_next_chunk(archive, flight, chunk)) != NULL) {
+    const double *pressure = archive->pressure + chunk->first_row;
+    for (uint32_t i = 0; i < chunk->row_count; i++) {
+      stats_add(stats, pressure[i]);
+    }
+  }
+}
+
+static float archive_battery_scan(const archive *archive) {
+  float minimum = FLT_MAX;
+  for (uint64_t i = 0; i < archive->rows; i++) {
+    if (archive->battery[i] < minimum) {
+      minimum = archive->battery[i];
+    }
+  }
+  return minimum;
+}
+
+static float archive_battery_index(const archive *archive) {
+  float minimum = FLT_MAX;
+  for (uint64_t c = 0; c < archive->chunk_count; c++) {
+    if (archive->chunks[c].battery_min < minimum) {
+      minimum = archive->chunks[c].battery_min;
+    }
+  }
+  return minimum;
+}
+
+static void report(const char *name, double seconds, uint64_t bytes) {
+  printf("  %-28s %10.3f ms %12.1f MB/s\n", name, seconds * 1e3,
+         seconds > 0 ? bytes / seconds / 1e6 : 0.0);
+}
+
+int main(int argc, char **argv) {
+  const char *dir = argc > 1 ? argv[1] : "/tmp/hummingbird_archive_bench";
+  uint32_t flights = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 100;
+  uint32_t rows = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 10) : 20000;
+  const uint32_t FLIGHT = 42 <= flights ? 42 : 1;
+
+  char csv_path[512];
+  char archive_path[512];
+  snprintf(csv_path, sizeof(csv_path), "%s.csv", dir);
+  snprintf(archive_path, sizeof(archive_path), "%s.archive", dir);
+  remove(csv_path);
+  const char *columns[] = {"pressure.col", "temperature.col", "battery.col",
+                           "packet_number.col", "chunks.idx"};
+  for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+    char name[600];
+    snprintf(name, sizeof(name), "%s/%s", archive_path, columns[i]);
+    remove(name);
+  }
+
+  printf("generating %u flights x %u rows\n", flights, rows);
+  if (generate(csv_path, archive_path, flights, rows) != 0) {
+    fprintf(stderr, "generate: %s\n", strerror(errno));
+    return 1;
+  }
+
+  archive archive;
+  if (archive_open(&archive, archive_path) != 0) {
+    fprintf(stderr, "%s: %s\n", archive_path, strerror(errno));
+    return 1;
+  }
+
+  FILE *csv = fopen(csv_path, "r");
+  fseek(csv, 0, SEEK_END);
+  uint64_t csv_bytes = (uint64_t)ftell(csv);
+  fclose(csv);
+
+  printf("pressure over flight %u\n", FLIGHT);
+  pressure_stats csv_stats = {0};
+  float csv_battery;
+  double start = now_seconds();
+  csv_scan(csv_path, FLIGHT, &csv_stats, &csv_battery);
+  report("csv parse", now_seconds() - start, csv_bytes);
+
+  pressure_stats archive_stats = {0};
+  start = now_seconds();
+  archive_flight_pressure(&archive, FLIGHT, &archive_stats);
+  report("archive column", now_seconds() - start,
+         archive_stats.count * sizeof(double));
+  printf("  %llu samples, %.2f .. %.2f Pa (csv %llu, %.2f .. %.2f Pa)\n",
+         (unsigned long long)archive_stats.count, archive_stats.min,
+         archive_stats.max, (unsigned long long)csv_stats.count, csv_stats.min,
+         csv_stats.max);
+
+  printf("battery minimum across all flights\n");
+  start = now_seconds();
+  csv_scan(csv_path, 0, NULL, &csv_battery);
+  report("csv parse", now_seconds() - start, csv_bytes);
+
+  start = now_seconds();
+  float scan_battery = archive_battery_scan(&archive);
+  report("archive column", now_seconds() - start,
+         archive.rows * sizeof(float));
+
+  start = now_seconds();
+  float index_battery = archive_battery_index(&archive);
+  report("archive chunk index", now_seconds() - start,
+         archive.chunk_count * sizeof(archive_chunk));
+  printf("  %.4f V (csv %.4f V, index %.4f V)\n", (double)scan_battery,
+         (double)csv_battery, (double)index_battery);
+
+  int mismatch = csv_stats.count != archive_stats.count ||
+                 csv_stats.min != archive_stats.min ||
+                 csv_stats.max != archive_stats.max ||
+                 csv_battery != scan_battery || scan_battery != index_battery;
+  archive_close(&archive);
+  if (mismatch) {
+    fprintf(stderr, "archive and csv disagree\n");
+    return 1;
+  }
+  return 0;
+}
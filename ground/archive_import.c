@@ -0,0 +1,60 @@
+/*
+ * archive_import.c
+ *
+ * Created: 10/19/2026
+ *
+ * Append decoded telemetry CSV to a columnar archive:
+ *
+ *   archive_import flights.csv archive/
+ *
+ * Expects "flight_number,packet_number,temperature,pressure,battery_voltage"
+ * rows, anything that doesn't parse (like a header line) is skipped.
+ */
+
+#include "telemetry_archive.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <telemetry.csv> <archive dir>\n", argv[0]);
+    return 2;
+  }
+
+  FILE *csv = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+  if (csv == NULL) {
+    fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+    return 1;
+  }
+
+  static archive_writer writer;
+  if (archive_writer_open(&writer, argv[2]) != 0) {
+    fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+    return 1;
+  }
+
+  char line[256];
+  unsigned long imported = 0;
+  unsigned long skipped = 0;
+  while (fgets(line, sizeof(line), csv) != NULL) {
+    archive_row row;
+    if (archive_parse_csv_row(line, &row) != 0) {
+      skipped++;
+      continue;
+    }
+    if (archive_writer_append(&writer, &row) != 0) {
+      fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+      return 1;
+    }
+    imported++;
+  }
+
+  if (archive_writer_close(&writer) != 0) {
+    fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+    return 1;
+  }
+  printf("imported %lu rows, skipped %lu lines\n", imported, skipped);
+  return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * log_decode.c
+ *
+ * Created: 10/19/2026
+ *
+ * Turn a dump of the kite's flash log into CSV, one row per logged reading:
+ *
+ *   log_decode flash.bin > flight.csv
+ *   log_decode --part window.bin > window.csv
+ *
+ * Readings come out of the compressed FLASH_LOG_SAMPLES records, the battery
+ * voltage, phase and flight number from the Datapoint record logged at the
+ * start of each block. A dump of the whole flash starts with the flight
+ * directory (see log_index.c), which is skipped; --part is for pages from
+ * the middle of the log, like an UPLINK_FLIGHT_TRANSFER download. Builds
+ * against the firmware's own codec and headers:
+ *
+ *   cc -O2 -I../Hummingbird -o log_decode log_decode.c \
+ *       ../Hummingbird/delta_codec.c ../Hummingbird/crc.c
+ */
+
+#include "crc.h"
+#include "delta_codec.h"
+#include "flash_log.h"
+#include "telemetry.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct decode_stats {
+  unsigned long records;
+  unsigned long readings;
+  unsigned long bad_records;
+  unsigned long sample_bytes;
+} decode_stats;
+
+// as flash_log.c, which never writes a CRC of 0xFF
+static crc_t record_crc(const uint8_t *record, uint8_t length) {
+  crc_t crc = crc_init();
+  crc = crc_update(crc, record, length + FLASH_LOG_OVERHEAD - 1);
+  crc = crc_finalize(crc);
+  return crc == FLASH_LOG_ERASED ? 0x00 : crc;
+}
+
+static void print_samples(const uint8_t *block, uint8_t length,
+                          const Datapoint *status, decode_stats *stats) {
+  delta_decoder decoder;
+  if (!delta_decoder_begin(&decoder, SAMPLE_CHANNELS, block, length)) {
+    stats->bad_records++;
+    return;
+  }
+  int32_t values[SAMPLE_CHANNELS];
+  while (delta_decoder_next(&decoder, values)) {
+    printf("%u,%.2f,%.2f,%.3f,%u,%u\n", (uint32_t)values[SAMPLE_TIME_MS],
+           values[SAMPLE_PRESSURE] / (double)SAMPLE_PRESSURE_SCALE,
+           values[SAMPLE_TEMPERATURE] / (double)SAMPLE_TEMPERATURE_SCALE,
+           (double)status->battery_voltage, status->phase,
+           status->flight_number);
+    stats->readings++;
+  }
+  if (decoder.decoded != decoder.samples) {
+    stats->bad_records++;
+  }
+  stats->sample_bytes += length;
+}
+
+/*
+Walk the records of one page, same rules as flash_log_next: stop at the first
+erased or damaged record and carry on with the next page. Returns false on
+an erased page, which is where the log ends.
+*/
+static bool decode_page(const uint8_t *page, Datapoint *status,
+                        decode_stats *stats) {
+  if (page[0] == FLASH_LOG_ERASED) {
+    return false;
+  }
+  uint16_t offset = 0;
+  while (offset + FLASH_LOG_OVERHEAD <= SPI_FLASH_PAGE_SIZE &&
+         page[offset] != FLASH_LOG_ERASED) {
+    uint8_t type = page[offset];
+    uint8_t length = page[offset + 1];
+    uint16_t size = length + FLASH_LOG_OVERHEAD;
+    if (offset + size > SPI_FLASH_PAGE_SIZE ||
+        record_crc(&page[offset], length) != page[offset + size - 1]) {
+      stats->bad_records++;
+      break;
+    }
+
+    const uint8_t *payload = &page[offset + 2];
+    if (type == FLASH_LOG_DATAPOINT && length == sizeof(Datapoint)) {
+      memcpy(status, payload, sizeof(Datapoint));
+    } else if (type == FLASH_LOG_SAMPLES) {
+      print_samples(payload, length, status, stats);
+    }
+    stats->records++;
+    offset += size;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  bool part = argc == 3 && strcmp(argv[1], "--part") == 0;
+  if (argc != 2 && !part) {
+    fprintf(stderr, "usage: %s [--part] <flash image>\n", argv[0]);
+    return 2;
+  }
+  const char *path = argv[argc - 1];
+  FILE *image = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  if (image == NULL) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return 1;
+  }
+
+  printf("time_ms,pressure_pa,temperature_c,battery_voltage,phase,"
+         "flight_number\n");
+  Datapoint status = {0};
+  decode_stats stats = {0};
+  uint8_t page[SPI_FLASH_PAGE_SIZE];
+  for (uint32_t skip = part ? 0 : FLASH_LOG_START; skip > 0;
+       skip -= sizeof(page)) {
+    if (fread(page, 1, sizeof(page), image) != sizeof(page)) {
+      break;
+    }
+  }
+  while (fread(page, 1, sizeof(page), image) == sizeof(page) &&
+         decode_page(page, &status, &stats)) {
+  }
+  fclose(image);
+
+  fprintf(stderr, "%lu records, %lu readings in %lu bytes (%.2f B each), "
+                  "%lu bad records\n",
+          stats.records, stats.readings, stats.sample_bytes,
+          stats.readings > 0 ? (double)stats.sample_bytes / stats.readings : 0,
+          stats.bad_records);
+  return 0;
+}
@@ -0,0 +1,311 @@
+/*
+ * log_index.c
+ *
+ * Created: 10/19/2026
+ *
+ * Lists the flights in a dump of the kite's flash log from its flight
+ * directory, and the blocks of one flight from their summary records:
+ *
+ *   log_index flash.bin              # flights
+ *   log_index flash.bin 3            # flight 3's blocks
+ *   log_index flash.bin 3 600 900    # its pages with readings 600 to 900 s in
+ *
+ * The last one finds the pages as the kite does for UPLINK_FLIGHT_TRANSFER,
+ * by binary search on the summary at the start of each page, and gives the
+ * first page and page count to ask for with UPLINK_START_TRANSFER. Builds
+ * against the firmware's headers:
+ *
+ *   cc -O2 -I../Hummingbird -o log_index log_index.c ../Hummingbird/crc.c
+ */
+
+#include "crc.h"
+#include "flash_log.h"
+#include "telemetry.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FLIGHTS (FLASH_LOG_START / FLASH_LOG_DIRECTORY_ENTRY)
+
+typedef struct log_image {
+  uint8_t *data;
+  uint32_t length;
+  uint32_t head; // the first page that starts erased
+} log_image;
+
+// as flash_log.c, which never writes a CRC of 0xFF
+static crc_t log_crc(const uint8_t *data, uint16_t length) {
+  crc_t crc = crc_init();
+  crc = crc_update(crc, data, length);
+  crc = crc_finalize(crc);
+  return crc == FLASH_LOG_ERASED ? 0x00 : crc;
+}
+
+static bool erased(const uint8_t *data, uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    if (data[i] != 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// a dump can stop at the head, what's past it reads as erased
+static bool page_starts_erased(const log_image *image, uint32_t address) {
+  return address >= image->length ||
+         image->data[address] == FLASH_LOG_ERASED;
+}
+
+static void find_head(log_image *image) {
+  uint32_t low = FLASH_LOG_START / SPI_FLASH_PAGE_SIZE;
+  uint32_t high = SPI_FLASH_SIZE / SPI_FLASH_PAGE_SIZE;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (page_starts_erased(image, middle * SPI_FLASH_PAGE_SIZE)) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  image->head = low * SPI_FLASH_PAGE_SIZE;
+}
+
+// the valid directory entries in order, returns how many
+static int read_directory(const log_image *image, flash_log_flight *flights) {
+  uint32_t end = image->length < FLASH_LOG_START ? image->length
+                                                 : FLASH_LOG_START;
+  int count = 0;
+  for (uint32_t address = 0; address + FLASH_LOG_DIRECTORY_ENTRY <= end;
+       address += FLASH_LOG_DIRECTORY_ENTRY) {
+    const uint8_t *entry = &image->data[address];
+    if (erased(entry, FLASH_LOG_DIRECTORY_ENTRY)) {
+      break;
+    }
+    if (log_crc(entry, 6) != entry[6]) {
+      continue; // torn by a reset
+    }
+    flash_log_flight *flight = &flights[count];
+    flight->number = entry[0] | (uint32_t)entry[1] << 8 |
+                     (uint32_t)entry[2] << 16 | (uint32_t)entry[3] << 24;
+    flight->start = (uint32_t)(entry[4] | entry[5] << 8) * SPI_FLASH_PAGE_SIZE;
+    if (count > 0) {
+      flights[count - 1].end = flight->start;
+    }
+    flight->end = image->head;
+    count++;
+  }
+  return count;
+}
+
+// the summary the page at address starts with, if it does
+static bool page_summary(const log_image *image, uint32_t address,
+                         block_summary *summary) {
+  if (address + SPI_FLASH_PAGE_SIZE > image->length) {
+    return false;
+  }
+  const uint8_t *record = &image->data[address];
+  uint8_t length = sizeof(block_summary);
+  if (record[0] != FLASH_LOG_SUMMARY || record[1] != length ||
+      log_crc(record, length + FLASH_LOG_OVERHEAD - 1) !=
+          record[length + FLASH_LOG_OVERHEAD - 1]) {
+    return false;
+  }
+  memcpy(summary, &record[2], length);
+  return true;
+}
+
+// as telemetry.c: a page without a summary goes by the next one's
+static bool page_time(const log_image *image, uint32_t address, uint32_t end,
+                      uint32_t *time_ms) {
+  block_summary summary;
+  for (; address < end; address += SPI_FLASH_PAGE_SIZE) {
+    if (page_summary(image, address, &summary)) {
+      *time_ms = summary.first_ms;
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint32_t seek(const log_image *image, uint32_t start, uint32_t end,
+                     uint32_t time_ms, int *reads) {
+  uint32_t low = start / SPI_FLASH_PAGE_SIZE;
+  uint32_t high = (end + SPI_FLASH_PAGE_SIZE - 1) / SPI_FLASH_PAGE_SIZE;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    uint32_t first_ms;
+    (*reads)++;
+    if (!page_time(image, middle * SPI_FLASH_PAGE_SIZE, end, &first_ms) ||
+        first_ms > time_ms) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return low * SPI_FLASH_PAGE_SIZE;
+}
+
+/*
+Every summary record of a flight, same rules as flash_log_next: stop at the
+first erased or damaged record of a page and carry on with the next one.
+Calls each with its address.
+*/
+static void walk_summaries(const log_image *image,
+                           const flash_log_flight *flight,
+                           void (*each)(uint32_t, const block_summary *,
+                                        void *),
+                           void *context) {
+  for (uint32_t page = flight->start;
+       page < flight->end && page + SPI_FLASH_PAGE_SIZE <= image->length;
+       page += SPI_FLASH_PAGE_SIZE) {
+    const uint8_t *data = &image->data[page];
+    uint16_t offset = 0;
+    while (offset + FLASH_LOG_OVERHEAD <= SPI_FLASH_PAGE_SIZE &&
+           data[offset] != FLASH_LOG_ERASED) {
+      uint8_t length = data[offset + 1];
+      uint16_t size = length + FLASH_LOG_OVERHEAD;
+      if (offset + size > SPI_FLASH_PAGE_SIZE ||
+          log_crc(&data[offset], size - 1) != data[offset + size - 1]) {
+        break;
+      }
+      if (data[offset] == FLASH_LOG_SUMMARY &&
+          length == sizeof(block_summary)) {
+        block_summary summary;
+        memcpy(&summary, &data[offset + 2], sizeof(summary));
+        each(page + offset, &summary, context);
+      }
+      offset += size;
+    }
+  }
+}
+
+typedef struct flight_totals {
+  uint32_t blocks;
+  uint32_t samples;
+  uint32_t first_ms;
+  uint32_t last_ms;
+  int32_t min_pressure;
+  int32_t max_pressure;
+} flight_totals;
+
+static void add_block(uint32_t address, const block_summary *summary,
+                      void *context) {
+  (void)address;
+  flight_totals *totals = context;
+  if (totals->blocks == 0) {
+    totals->first_ms = summary->first_ms;
+    totals->min_pressure = summary->min_pressure;
+    totals->max_pressure = summary->max_pressure;
+  }
+  totals->blocks++;
+  totals->samples += summary->samples;
+  totals->last_ms = summary->last_ms;
+  if (summary->min_pressure < totals->min_pressure) {
+    totals->min_pressure = summary->min_pressure;
+  }
+  if (summary->max_pressure > totals->max_pressure) {
+    totals->max_pressure = summary->max_pressure;
+  }
+}
+
+static void print_block(uint32_t address, const block_summary *summary,
+                        void *context) {
+  (void)context;
+  printf("%u,%u,%.3f,%.3f,%u,%.2f,%.2f\n", address / SPI_FLASH_PAGE_SIZE,
+         address % SPI_FLASH_PAGE_SIZE, summary->first_ms / 1e3,
+         summary->last_ms / 1e3, summary->samples,
+         summary->min_pressure / (double)SAMPLE_PRESSURE_SCALE,
+         summary->max_pressure / (double)SAMPLE_PRESSURE_SCALE);
+}
+
+static void list_flights(const log_image *image,
+                         const flash_log_flight *flights, int count) {
+  printf("flight,first_page,pages,blocks,samples,first_s,last_s,"
+         "min_pressure_pa,max_pressure_pa\n");
+  for (int i = 0; i < count; i++) {
+    const flash_log_flight *flight = &flights[i];
+    flight_totals totals = {0};
+    walk_summaries(image, flight, add_block, &totals);
+    printf("%u,%u,%u,%u,%u,%.3f,%.3f,%.2f,%.2f\n", flight->number,
+           flight->start / SPI_FLASH_PAGE_SIZE,
+           (flight->end - flight->start) / SPI_FLASH_PAGE_SIZE, totals.blocks,
+           totals.samples, totals.first_ms / 1e3, totals.last_ms / 1e3,
+           totals.min_pressure / (double)SAMPLE_PRESSURE_SCALE,
+           totals.max_pressure / (double)SAMPLE_PRESSURE_SCALE);
+  }
+}
+
+static void print_window(const log_image *image,
+                         const flash_log_flight *flight, uint32_t from_s,
+                         uint32_t to_s) {
+  int reads = 0;
+  uint32_t start = seek(image, flight->start, flight->end, from_s * 1000,
+                        &reads);
+  if (start > flight->start) {
+    start -= SPI_FLASH_PAGE_SIZE; // readings before and from from_s
+  }
+  uint32_t end = to_s == 0 ? flight->end
+                           : seek(image, start, flight->end, to_s * 1000,
+                                  &reads);
+  uint32_t pages = (end - start + SPI_FLASH_PAGE_SIZE - 1) /
+                   SPI_FLASH_PAGE_SIZE;
+  printf("first_page,pages,bytes,flight_bytes,pages_read\n");
+  printf("%u,%u,%u,%u,%d\n", start / SPI_FLASH_PAGE_SIZE, pages,
+         end - start, flight->end - flight->start, reads);
+}
+
+static bool load(log_image *image, const char *path) {
+  FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return false;
+  }
+  image->data = malloc(SPI_FLASH_SIZE);
+  image->length = fread(image->data, 1, SPI_FLASH_SIZE, file);
+  fclose(file);
+  find_head(image);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2 && argc != 3 && argc != 5) {
+    fprintf(stderr, "usage: %s <flash image> [flight [from_s to_s]]\n",
+            argv[0]);
+    return 2;
+  }
+  log_image image;
+  if (!load(&image, argv[1])) {
+    return 1;
+  }
+  static flash_log_flight flights[MAX_FLIGHTS];
+  int count = read_directory(&image, flights);
+  if (argc == 2) {
+    list_flights(&image, flights, count);
+    free(image.data);
+    return 0;
+  }
+
+  uint32_t number = strtoul(argv[2], NULL, 0);
+  const flash_log_flight *flight = NULL;
+  for (int i = 0; i < count; i++) {
+    if (flights[i].number == number) {
+      flight = &flights[i];
+    }
+  }
+  if (flight == NULL) {
+    fprintf(stderr, "%s: no flight %u in the directory\n", argv[1], number);
+    free(image.data);
+    return 1;
+  }
+  if (argc == 3) {
+    printf("page,offset,first_s,last_s,samples,min_pressure_pa,"
+           "max_pressure_pa\n");
+    walk_summaries(&image, flight, print_block, NULL);
+  } else {
+    print_window(&image, flight, strtoul(argv[3], NULL, 0),
+                 strtoul(argv[4], NULL, 0));
+  }
+  free(image.data);
+  return 0;
+}
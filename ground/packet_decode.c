@@ -0,0 +1,164 @@
+/*
+ * packet_decode.c
+ *
+ * Created: 10/19/2026
+ *
+ * Turn the packets a ground receiver heard into CSV, one row per reading,
+ * putting back lost packets from the kite's repair packets (fec.h) on the
+ * way. Input is one packet per line, the RadioHead header flags and then the
+ * payload, both in hex (what `replay --capture-dir` writes):
+ *
+ *   01 0100000000080200f3...
+ *
+ *   packet_decode flight.pkt > flight.csv
+ *
+ * Builds against the firmware's own codecs and headers:
+ *
+ *   cc -O2 -I../Hummingbird -o packet_decode packet_decode.c \
+ *       ../Hummingbird/fec.c ../Hummingbird/delta_codec.c ../Hummingbird/crc.c
+ */
+
+#include "arq.h"
+#include "crc.h"
+#include "delta_codec.h"
+#include "fec.h"
+#include "telemetry.h"
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct decode_stats {
+  unsigned long packets;
+  unsigned long repairs;
+  unsigned long recovered;
+  unsigned long readings;
+  unsigned long bad_packets;
+} decode_stats;
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// hex pairs up to the end of the line or a space, returns how many bytes
+static int parse_hex(const char *text, uint8_t *out, int capacity,
+                     const char **end) {
+  int length = 0;
+  while (length < capacity) {
+    int high = hex_digit(text[0]);
+    int low = high < 0 ? -1 : hex_digit(text[1]);
+    if (low < 0) {
+      break;
+    }
+    out[length++] = (uint8_t)(high << 4 | low);
+    text += 2;
+  }
+  *end = text;
+  return length;
+}
+
+static void print_packet(const uint8_t *data, uint8_t length, bool recovered,
+                         decode_stats *stats) {
+  Datapoint datapoint;
+  if (length < sizeof(Datapoint)) {
+    stats->bad_packets++;
+    return;
+  }
+  memcpy(&datapoint, data, sizeof(datapoint));
+  crc_t crc = crc_init();
+  crc = crc_update(crc, data, offsetof(Datapoint, crc8));
+  if (crc_finalize(crc) != datapoint.crc8) {
+    stats->bad_packets++;
+    return;
+  }
+
+  delta_decoder decoder;
+  if (length == sizeof(Datapoint) ||
+      !delta_decoder_begin(&decoder, SAMPLE_CHANNELS, data + sizeof(Datapoint),
+                           length - sizeof(Datapoint))) {
+    return;
+  }
+  int32_t values[SAMPLE_CHANNELS];
+  while (delta_decoder_next(&decoder, values)) {
+    printf("%u,%.2f,%.2f,%.3f,%u,%u,%u,%d\n", (uint32_t)values[SAMPLE_TIME_MS],
+           values[SAMPLE_PRESSURE] / (double)SAMPLE_PRESSURE_SCALE,
+           values[SAMPLE_TEMPERATURE] / (double)SAMPLE_TEMPERATURE_SCALE,
+           (double)datapoint.battery_voltage, datapoint.phase,
+           datapoint.flight_number, datapoint.packet_number, recovered);
+    stats->readings++;
+  }
+  if (decoder.decoded != decoder.samples) {
+    stats->bad_packets++;
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <packets>\n", argv[0]);
+    return 2;
+  }
+  FILE *input = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+  if (input == NULL) {
+    fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+    return 1;
+  }
+
+  printf("time_ms,pressure_pa,temperature_c,battery_voltage,phase,"
+         "flight_number,packet_number,recovered\n");
+  static fec_decoder fec;
+  fec_decoder_init(&fec);
+  decode_stats stats = {0};
+  char line[1024];
+  while (fgets(line, sizeof(line), input) != NULL) {
+    const char *end;
+    uint8_t flags;
+    uint8_t packet[UINT8_MAX];
+    if (parse_hex(line, &flags, 1, &end) != 1 || *end != ' ') {
+      continue;
+    }
+    int length = parse_hex(end + 1, packet, sizeof(packet), &end);
+    stats.packets++;
+    if (flags & ARQ_SEGMENT_FLAG) {
+      continue; // flash log download, not readings
+    }
+
+    if (!(flags & FEC_REPAIR_FLAG)) {
+      Datapoint datapoint;
+      if (length >= (int)sizeof(Datapoint)) {
+        memcpy(&datapoint, packet, sizeof(datapoint));
+        fec_decoder_data(&fec, datapoint.packet_number, packet, length);
+      }
+      print_packet(packet, length, false, &stats);
+      continue;
+    }
+    stats.repairs++;
+    int recovered = fec_decoder_repair(&fec, packet, length);
+    if (recovered < 0) {
+      stats.bad_packets++;
+    }
+    for (int i = 0; i < recovered; i++) {
+      uint8_t data_length;
+      const uint8_t *data =
+          fec_decoder_packet(&fec, fec.recovered[i], &data_length);
+      print_packet(data, data_length, true, &stats);
+      stats.recovered++;
+    }
+  }
+  fclose(input);
+
+  fprintf(stderr, "%lu packets (%lu repairs), %lu recovered, %lu readings, "
+                  "%lu bad packets\n",
+          stats.packets, stats.repairs, stats.recovered, stats.readings,
+          stats.bad_packets);
+  return 0;
+}
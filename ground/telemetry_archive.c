@@ -0,0 +1,462 @@
+/*
+ * telemetry_archive.c
+ *
+ * Created: 10/19/2026
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "telemetry_archive.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *const FILE_NAMES[ARCHIVE_FILE_COUNT] = {
+    "pressure.col", "temperature.col", "battery.col", "packet_number.col",
+    "chunks.idx",
+};
+
+static const uint16_t FILE_WIDTHS[ARCHIVE_FILE_COUNT] = {
+    sizeof(double), sizeof(double), sizeof(float), sizeof(uint32_t),
+    sizeof(archive_chunk),
+};
+
+/*
+The chunk index first: it is the commit record, the columns are only good up
+to the rows its chunks cover
+*/
+static const archive_column OPEN_ORDER[ARCHIVE_FILE_COUNT] = {
+    ARCHIVE_CHUNKS, ARCHIVE_PRESSURE, ARCHIVE_TEMPERATURE, ARCHIVE_BATTERY,
+    ARCHIVE_PACKET_NUMBER,
+};
+
+static int file_path(char *out, const char *dir, archive_column column) {
+  int written = snprintf(out, PATH_MAX, "%s/%s", dir, FILE_NAMES[column]);
+  if (written < 0 || written >= PATH_MAX) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  return 0;
+}
+
+static int write_all(int fd, const void *data, size_t length) {
+  const uint8_t *bytes = data;
+  while (length > 0) {
+    ssize_t written = write(fd, bytes, length);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    bytes += written;
+    length -= (size_t)written;
+  }
+  return 0;
+}
+
+static int write_header(int fd, archive_column column, uint64_t count) {
+  archive_header header = {0};
+  header.magic = ARCHIVE_MAGIC;
+  header.version = ARCHIVE_VERSION;
+  header.width = FILE_WIDTHS[column];
+  header.count = count;
+  if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+    return -1;
+  }
+  return 0;
+}
+
+/*
+Read and check the header of an archive file, returns the value count or -1
+*/
+static int64_t read_header(int fd, archive_column column) {
+  archive_header header;
+  if (pread(fd, &header, sizeof(header), 0) != sizeof(header)) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION ||
+      header.width != FILE_WIDTHS[column]) {
+    errno = EINVAL;
+    return -1;
+  }
+  return (int64_t)header.count;
+}
+
+// rows covered by the first count chunks of the index, -1 if it's short
+static int64_t committed_rows(int fd, uint64_t count) {
+  if (count == 0) {
+    return 0;
+  }
+  archive_chunk last;
+  off_t at = sizeof(archive_header) + (count - 1) * sizeof(archive_chunk);
+  if (pread(fd, &last, sizeof(last), at) != sizeof(last)) {
+    errno = EINVAL;
+    return -1;
+  }
+  return (int64_t)(last.first_row + last.row_count);
+}
+
+int archive_writer_open(archive_writer *writer, const char *path) {
+  memset(writer, 0, sizeof(*writer));
+  for (int i = 0; i < ARCHIVE_FILE_COUNT; i++) {
+    writer->fd[i] = -1;
+  }
+
+  if (mkdir(path, 0777) != 0 && errno != EEXIST) {
+    return -1;
+  }
+
+  for (int k = 0; k < ARCHIVE_FILE_COUNT; k++) {
+    archive_column i = OPEN_ORDER[k];
+    char name[PATH_MAX];
+    if (file_path(name, path, i) != 0) {
+      goto fail;
+    }
+    writer->fd[i] = open(name, O_RDWR | O_CREAT, 0666);
+    if (writer->fd[i] < 0) {
+      goto fail;
+    }
+
+    struct stat st;
+    if (fstat(writer->fd[i], &st) != 0) {
+      goto fail;
+    }
+    uint64_t count = 0;
+    if (st.st_size == 0) {
+      if (write_header(writer->fd[i], i, 0) != 0) {
+        goto fail;
+      }
+    } else {
+      int64_t existing = read_header(writer->fd[i], i);
+      if (existing < 0) {
+        goto fail;
+      }
+      count = (uint64_t)existing;
+    }
+
+    if (i == ARCHIVE_CHUNKS) {
+      int64_t rows = committed_rows(writer->fd[i], count);
+      if (rows < 0) {
+        goto fail;
+      }
+      writer->chunks = count;
+      writer->rows = (uint64_t)rows;
+    } else if (count < writer->rows) {
+      errno = EINVAL; // a column short of committed rows, damaged
+      goto fail;
+    } else if (count > writer->rows) {
+      // an append that died before its chunk went into the index
+      count = writer->rows;
+      if (write_header(writer->fd[i], i, count) != 0) {
+        goto fail;
+      }
+    }
+
+    // drop anything past the last committed value
+    off_t end = sizeof(archive_header) + count * FILE_WIDTHS[i];
+    if (ftruncate(writer->fd[i], end) != 0 ||
+        lseek(writer->fd[i], end, SEEK_SET) != end) {
+      goto fail;
+    }
+  }
+  return 0;
+
+fail:;
+  int saved = errno;
+  for (int i = 0; i < ARCHIVE_FILE_COUNT; i++) {
+    if (writer->fd[i] >= 0) {
+      close(writer->fd[i]);
+      writer->fd[i] = -1;
+    }
+  }
+  errno = saved;
+  return -1;
+}
+
+/*
+Cut every file back to rows values and chunks index entries, headers
+included, after a flush that failed partway. The chunk stays in memory for
+the next flush to write whole.
+*/
+static void roll_back(archive_writer *writer, uint64_t rows, uint64_t chunks) {
+  int saved = errno;
+  writer->rows = rows;
+  writer->chunks = chunks;
+  for (int i = 0; i < ARCHIVE_FILE_COUNT; i++) {
+    uint64_t count = i == ARCHIVE_CHUNKS ? chunks : rows;
+    off_t end = sizeof(archive_header) + count * FILE_WIDTHS[i];
+    // best effort, archive_writer_open cuts back whatever this can't
+    if (ftruncate(writer->fd[i], end) == 0) {
+      lseek(writer->fd[i], end, SEEK_SET);
+    }
+    write_header(writer->fd[i], (archive_column)i, count);
+  }
+  errno = saved;
+}
+
+static int flush_chunk(archive_writer *writer) {
+  uint32_t n = writer->chunk.row_count;
+  if (n == 0) {
+    return 0;
+  }
+  uint64_t rows = writer->rows;
+  uint64_t chunks = writer->chunks;
+
+  if (write_all(writer->fd[ARCHIVE_PRESSURE], writer->pressure,
+                n * sizeof(double)) != 0 ||
+      write_all(writer->fd[ARCHIVE_TEMPERATURE], writer->temperature,
+                n * sizeof(double)) != 0 ||
+      write_all(writer->fd[ARCHIVE_BATTERY], writer->battery,
+                n * sizeof(float)) != 0 ||
+      write_all(writer->fd[ARCHIVE_PACKET_NUMBER], writer->packet_number,
+                n * sizeof(uint32_t)) != 0 ||
+      write_all(writer->fd[ARCHIVE_CHUNKS], &writer->chunk,
+                sizeof(archive_chunk)) != 0) {
+    roll_back(writer, rows, chunks);
+    return -1;
+  }
+
+  /*
+  The chunk index's count last, it commits the chunk. A crash before it
+  leaves columns ahead of the index, which archive_writer_open cuts back.
+  Everything before it goes to disk first, or a power cut could leave the
+  count on disk without the values it covers.
+  */
+  for (int i = 0; i < ARCHIVE_CHUNKS; i++) {
+    if (write_header(writer->fd[i], (archive_column)i, rows + n) != 0) {
+      roll_back(writer, rows, chunks);
+      return -1;
+    }
+  }
+  for (int i = 0; i < ARCHIVE_FILE_COUNT; i++) {
+    if (fsync(writer->fd[i]) != 0) {
+      roll_back(writer, rows, chunks);
+      return -1;
+    }
+  }
+  if (write_header(writer->fd[ARCHIVE_CHUNKS], ARCHIVE_CHUNKS, chunks + 1) !=
+      0) {
+    roll_back(writer, rows, chunks);
+    return -1;
+  }
+  writer->rows = rows + n;
+  writer->chunks = chunks + 1;
+
+  memset(&writer->chunk, 0, sizeof(writer->chunk));
+  return 0;
+}
+
+int archive_writer_append(archive_writer *writer, const archive_row *row) {
+  archive_chunk *chunk = &writer->chunk;
+  if (chunk->row_count > 0 &&
+      (chunk->flight_number != row->flight_number ||
+       chunk->row_count == ARCHIVE_CHUNK_ROWS)) {
+    if (flush_chunk(writer) != 0) {
+      return -1;
+    }
+  }
+
+  uint32_t i = chunk->row_count;
+  if (i == 0) {
+    chunk->flight_number = row->flight_number;
+    chunk->first_row = writer->rows;
+    chunk->pressure_min = chunk->pressure_max = row->pressure;
+    chunk->temperature_min = chunk->temperature_max = row->temperature;
+    chunk->battery_min = chunk->battery_max = row->battery_voltage;
+    chunk->packet_min = chunk->packet_max = row->packet_number;
+  } else {
+    if (row->pressure < chunk->pressure_min) {
+      chunk->pressure_min = row->pressure;
+    }
+    if (row->pressure > chunk->pressure_max) {
+      chunk->pressure_max = row->pressure;
+    }
+    if (row->temperature < chunk->temperature_min) {
+      chunk->temperature_min = row->temperature;
+    }
+    if (row->temperature > chunk->temperature_max) {
+      chunk->temperature_max = row->temperature;
+    }
+    if (row->battery_voltage < chunk->battery_min) {
+      chunk->battery_min = row->battery_voltage;
+    }
+    if (row->battery_voltage > chunk->battery_max) {
+      chunk->battery_max = row->battery_voltage;
+    }
+    if (row->packet_number < chunk->packet_min) {
+      chunk->packet_min = row->packet_number;
+    }
+    if (row->packet_number > chunk->packet_max) {
+      chunk->packet_max = row->packet_number;
+    }
+  }
+
+  writer->pressure[i] = row->pressure;
+  writer->temperature[i] = row->temperature;
+  writer->battery[i] = row->battery_voltage;
+  writer->packet_number[i] = row->packet_number;
+  chunk->row_count++;
+  return 0;
+}
+
+int archive_writer_close(archive_writer *writer) {
+  int result = flush_chunk(writer);
+  // the last commit too, the rest went down before it
+  if (writer->fd[ARCHIVE_CHUNKS] >= 0 &&
+      fsync(writer->fd[ARCHIVE_CHUNKS]) != 0) {
+    result = -1;
+  }
+  for (int i = 0; i < ARCHIVE_FILE_COUNT; i++) {
+    if (writer->fd[i] >= 0 && close(writer->fd[i]) != 0) {
+      result = -1;
+    }
+    writer->fd[i] = -1;
+  }
+  return result;
+}
+
+int archive_open(archive *archive, const char *path) {
+  memset(archive, 0, sizeof(*archive));
+
+  for (int k = 0; k < ARCHIVE_FILE_COUNT; k++) {
+    archive_column i = OPEN_ORDER[k];
+    char name[PATH_MAX];
+    if (file_path(name, path, i) != 0) {
+      goto fail;
+    }
+    int fd = open(name, O_RDONLY);
+    if (fd < 0) {
+      goto fail;
+    }
+    int64_t count = read_header(fd, i);
+    if (i == ARCHIVE_CHUNKS) {
+      int64_t rows = count < 0 ? -1 : committed_rows(fd, (uint64_t)count);
+      if (rows < 0) {
+        close(fd);
+        errno = EINVAL;
+        goto fail;
+      }
+      archive->chunk_count = (uint64_t)count;
+      archive->rows = (uint64_t)rows;
+    } else if (count >= 0 && (uint64_t)count >= archive->rows) {
+      count = (int64_t)archive->rows; // past the index is uncommitted
+    } else {
+      close(fd);
+      errno = EINVAL;
+      goto fail;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        (uint64_t)st.st_size <
+            sizeof(archive_header) + (uint64_t)count * FILE_WIDTHS[i]) {
+      close(fd);
+      errno = EINVAL;
+      goto fail;
+    }
+
+    size_t size = sizeof(archive_header) + (size_t)count * FILE_WIDTHS[i];
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+      goto fail;
+    }
+    archive->map[i] = map;
+    archive->map_size[i] = size;
+  }
+
+  const uint8_t *const *base = (const uint8_t *const *)archive->map;
+  archive->pressure =
+      (const double *)(base[ARCHIVE_PRESSURE] + sizeof(archive_header));
+  archive->temperature =
+      (const double *)(base[ARCHIVE_TEMPERATURE] + sizeof(archive_header));
+  archive->battery =
+      (const float *)(base[ARCHIVE_BATTERY] + sizeof(archive_header));
+  archive->packet_number =
+      (const uint32_t *)(base[ARCHIVE_PACKET_NUMBER] + sizeof(archive_header));
+  archive->chunks =
+      (const archive_chunk *)(base[ARCHIVE_CHUNKS] + sizeof(archive_header));
+
+  // an index pointing past the columns means the archive is damaged
+  for (uint64_t c = 0; c < archive->chunk_count; c++) {
+    if (archive->chunks[c].first_row + archive->chunks[c].row_count >
+        archive->rows) {
+      errno = EINVAL;
+      goto fail;
+    }
+  }
+  return 0;
+
+fail:;
+  int saved = errno;
+  archive_close(archive);
+  errno = saved;
+  return -1;
+}
+
+void archive_close(archive *archive) {
+  for (int i = 0; i < ARCHIVE_FILE_COUNT; i++) {
+    if (archive->map[i] != NULL) {
+      munmap(archive->map[i], archive->map_size[i]);
+    }
+  }
+  memset(archive, 0, sizeof(*archive));
+}
+
+const archive_chunk *archive_next_chunk(const archive *archive,
+                                        uint32_t flight_number,
+                                        const archive_chunk *previous) {
+  const archive_chunk *chunk =
+      previous == NULL ? archive->chunks : previous + 1;
+  const archive_chunk *end = archive->chunks + archive->chunk_count;
+  for (; chunk < end; chunk++) {
+    if (chunk->flight_number == flight_number) {
+      return chunk;
+    }
+  }
+  return NULL;
+}
+
+int archive_parse_csv_row(const char *line, archive_row *row) {
+  char *end;
+  const char *p = line;
+
+  unsigned long flight = strtoul(p, &end, 10);
+  if (end == p || *end != ',') {
+    return -1;
+  }
+  p = end + 1;
+  unsigned long packet = strtoul(p, &end, 10);
+  if (end == p || *end != ',') {
+    return -1;
+  }
+  p = end + 1;
+  double temperature = strtod(p, &end);
+  if (end == p || *end != ',') {
+    return -1;
+  }
+  p = end + 1;
+  double pressure = strtod(p, &end);
+  if (end == p || *end != ',') {
+    return -1;
+  }
+  p = end + 1;
+  float battery = strtof(p, &end);
+  if (end == p) {
+    return -1;
+  }
+
+  row->flight_number = (uint32_t)flight;
+  row->packet_number = (uint32_t)packet;
+  row->temperature = temperature;
+  row->pressure = pressure;
+  row->battery_voltage = battery;
+  return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * telemetry_archive.h
+ *
+ * Created: 10/19/2026
+ *
+ * Columnar on-disk archive for decoded flight telemetry.
+ *
+ * An archive is a directory holding one file per column plus a chunk index:
+ *
+ *   pressure.col       double[]   Pa
+ *   temperature.col    double[]   deg C
+ *   battery.col        float[]    V
+ *   packet_number.col  uint32_t[]
+ *   chunks.idx         archive_chunk[]
+ *
+ * Every file starts with a 32 byte archive_header followed by fixed-width,
+ * little endian values, so a reader can mmap a file and use it as an array
+ * without parsing anything. Rows are grouped into chunks of at most
+ * ARCHIVE_CHUNK_ROWS rows that never span two flights; each chunk entry holds
+ * the flight number, the row range and min/max of every column, so queries
+ * only touch the column bytes of the chunks they need (or none at all, for
+ * min/max queries).
+ *
+ * The chunk index commits: a chunk's column values go down first and its
+ * index entry and count last, so the columns are only good up to the rows
+ * the index covers. Anything past that is from an append that died, which
+ * readers ignore and the next writer cuts off. The columns and the index
+ * entry are synced to disk before the count goes in, so that holds across a
+ * power cut as well as a crash. A chunk that fails to go down is cut back
+ * out of every file and written again whole by the next append or close.
+ */
+
+#ifndef TELEMETRY_ARCHIVE_H_
+#define TELEMETRY_ARCHIVE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARCHIVE_MAGIC 0x43524148u // "HARC" little endian
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_CHUNK_ROWS 4096
+
+typedef enum archive_column {
+  ARCHIVE_PRESSURE,
+  ARCHIVE_TEMPERATURE,
+  ARCHIVE_BATTERY,
+  ARCHIVE_PACKET_NUMBER,
+  ARCHIVE_CHUNKS, // the chunk index, not a data column
+  ARCHIVE_FILE_COUNT
+} archive_column;
+
+typedef struct archive_header {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t width; // bytes per value
+  uint64_t count; // number of values following the header
+  uint8_t reserved[16];
+} archive_header;
+
+typedef struct archive_chunk {
+  uint32_t flight_number;
+  uint32_t row_count;
+  uint64_t first_row;
+  double pressure_min;
+  double pressure_max;
+  double temperature_min;
+  double temperature_max;
+  float battery_min;
+  float battery_max;
+  uint32_t packet_min;
+  uint32_t packet_max;
+} archive_chunk;
+
+typedef struct archive_row {
+  uint32_t flight_number;
+  uint32_t packet_number;
+  double temperature;
+  double pressure;
+  float battery_voltage;
+} archive_row;
+
+typedef struct archive_writer {
+  int fd[ARCHIVE_FILE_COUNT];
+  uint64_t rows;
+  uint64_t chunks;
+  archive_chunk chunk; // chunk being filled
+  double pressure[ARCHIVE_CHUNK_ROWS];
+  double temperature[ARCHIVE_CHUNK_ROWS];
+  float battery[ARCHIVE_CHUNK_ROWS];
+  uint32_t packet_number[ARCHIVE_CHUNK_ROWS];
+} archive_writer;
+
+typedef struct archive {
+  void *map[ARCHIVE_FILE_COUNT];
+  size_t map_size[ARCHIVE_FILE_COUNT];
+  uint64_t rows;
+  uint64_t chunk_count;
+  const double *pressure;
+  const double *temperature;
+  const float *battery;
+  const uint32_t *packet_number;
+  const archive_chunk *chunks;
+} archive;
+
+/*
+Writing. archive_writer_open creates the directory if needed and appends to
+an existing archive. Returns 0 on success, -1 with errno set on failure.
+*/
+int archive_writer_open(archive_writer *writer, const char *path);
+int archive_writer_append(archive_writer *writer, const archive_row *row);
+int archive_writer_close(archive_writer *writer);
+
+/*
+Reading. Everything is mmapped read-only; the column pointers in archive are
+valid until archive_close.
+*/
+int archive_open(archive *archive, const char *path);
+void archive_close(archive *archive);
+
+/*
+Iterate the chunks of one flight, pass NULL to get the first one. Returns NULL
+once there are no more.
+*/
+const archive_chunk *archive_next_chunk(const archive *archive,
+                                        uint32_t flight_number,
+                                        const archive_chunk *previous);
+
+/*
+Parse one "flight_number,packet_number,temperature,pressure,battery_voltage"
+CSV line. Returns 0 on success, -1 if the line is not a data row.
+*/
+int archive_parse_csv_row(const char *line, archive_row *row);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_ARCHIVE_H_ */
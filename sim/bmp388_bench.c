@@ -0,0 +1,218 @@
+/*
+ * bmp388_bench.c
+ *
+ * Created: 10/19/2026
+ *
+ * Runs bmp388.c against the BMP388 model through the traces, one reading at a
+ * time in forced mode and in batches out of the FIFO in normal mode, for a
+ * few different parts' calibrations:
+ *
+ *   bmp388_bench [trace.csv ...]
+ *
+ * Every reading is checked against the model's compensation of the raw
+ * values it reported (exact is bit for bit) and against the trace. Bus time
+ * and bytes per reading are simulated time and SPI_2 traffic, the rest of
+ * the driver's cost is CPU the simulation doesn't see.
+ */
+
+#include "bmp388.h"
+#include "sim_bmp388.h"
+#include "trace.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct bench_mode {
+  const char *name;
+  bool fifo;
+  uint8_t odr; // FIFO, 200 Hz >> odr
+  uint8_t osr; // FIFO, the most that fits the period
+  uint32_t period_ms; // forced
+} bench_mode;
+
+static const bench_mode MODES[] = {
+    {"forced", false, 0, 0, 200},  {"forced", false, 0, 0, 50},
+    {"fifo", true, 0, 0, 0},       {"fifo", true, 1, 1, 0},
+    {"fifo", true, 2, 3, 0},       {"fifo", true, 3, 4, 0},
+    {"fifo", true, 4, 5, 0},
+};
+
+// how often the FIFO is emptied, well before 512 bytes fill at 200 Hz
+static const uint64_t FIFO_READ_US = 250000;
+#define FIFO_BATCH 32
+
+// conversions the model sampled the trace for, in order
+#define HISTORY 1024
+static trace_sample history[HISTORY];
+static uint32_t history_count;
+
+typedef struct bench_result {
+  uint32_t readings;
+  uint32_t exact;
+  double max_pressure_diff; // against the model's own compensation
+  double max_temperature_diff;
+  double max_pressure_error; // against the trace
+  uint64_t bus_us;
+  uint64_t bus_bytes;
+  uint32_t dropped;
+  bool config_error;
+} bench_result;
+
+static void environment(void *context, uint64_t time_us, double *pressure_pa,
+                        double *temperature_c) {
+  trace_sample s = trace_at(context, time_us / 1e6);
+  *pressure_pa = s.pressure_pa;
+  *temperature_c = s.temperature_c;
+  history[history_count++ % HISTORY] = s;
+}
+
+// the calibration of another part, a few coefficients nudged from the first
+static void other_part(uint8_t *nvm, int part) {
+  static const int16_t NUDGE[][4] = {{0, 0, 0, 0},
+                                     {-310, 420, -95, 1800},
+                                     {520, -260, 140, -2400}};
+  uint16_t t1 = (nvm[0] | nvm[1] << 8) + NUDGE[part][0];
+  uint16_t t2 = (nvm[2] | nvm[3] << 8) + NUDGE[part][1];
+  uint16_t p1 = (nvm[5] | nvm[6] << 8) + NUDGE[part][2];
+  uint16_t p5 = (nvm[11] | nvm[12] << 8) + NUDGE[part][3];
+  nvm[0] = t1 & 0xFF;
+  nvm[1] = t1 >> 8;
+  nvm[2] = t2 & 0xFF;
+  nvm[3] = t2 >> 8;
+  nvm[5] = p1 & 0xFF;
+  nvm[6] = p1 >> 8;
+  nvm[11] = p5 & 0xFF;
+  nvm[12] = p5 >> 8;
+}
+
+static void check(const sim_bmp388 *bmp, const bmp_reading *reading,
+                  const trace_sample *sampled, bench_result *result) {
+  uint32_t raw_pressure;
+  uint32_t raw_temperature;
+  sim_bmp388_raw(bmp, sampled->pressure_pa, sampled->temperature_c,
+                 &raw_pressure, &raw_temperature);
+  double pressure;
+  double temperature;
+  sim_bmp388_compensate(bmp, raw_pressure, raw_temperature, &pressure,
+                        &temperature);
+  double pressure_diff = fabs(reading->pressure - pressure);
+  double temperature_diff = fabs(reading->temperature - temperature);
+  double error = fabs(reading->pressure - sampled->pressure_pa);
+  if (pressure_diff == 0 && temperature_diff == 0) {
+    result->exact++;
+  }
+  result->max_pressure_diff = fmax(result->max_pressure_diff, pressure_diff);
+  result->max_temperature_diff =
+      fmax(result->max_temperature_diff, temperature_diff);
+  result->max_pressure_error = fmax(result->max_pressure_error, error);
+  result->readings++;
+}
+
+static void bench(const trace *t, const bench_mode *mode, int part,
+                  bench_result *result) {
+  memset(result, 0, sizeof(*result));
+  sim_reset();
+  sim_bmp388 bmp;
+  sim_bmp388_init(&bmp, environment, (void *)t);
+  uint8_t nvm[SIM_BMP388_NVM_LENGTH];
+  memcpy(nvm, bmp.nvm, sizeof(nvm));
+  other_part(nvm, part);
+  sim_bmp388_set_nvm(&bmp, nvm);
+  sim_bmp388_attach(&bmp);
+  bmp388_init();
+  history_count = 0;
+
+  uint64_t end_us = (uint64_t)(trace_duration_s(t) * 1e6);
+  uint64_t bytes = sim_spi_bytes(&SPI_2);
+  if (!mode->fifo) {
+    while (sim_time_us() < end_us) {
+      uint64_t start = sim_time_us();
+      bmp_reading reading;
+      bmp388_get_reading(&reading);
+      result->bus_us += sim_time_us() - start;
+      check(&bmp, &reading, &history[(history_count - 1) % HISTORY], result);
+      uint64_t next = start + mode->period_ms * 1000ull;
+      if (next > sim_time_us()) {
+        sim_advance_us(next - sim_time_us());
+      }
+    }
+  } else {
+    if (!bmp388_start_fifo(mode->odr, mode->osr)) {
+      result->config_error = true;
+      return;
+    }
+    uint32_t next = 0; // the conversion the next reading came from
+    while (sim_time_us() < end_us) {
+      sim_advance_us(FIFO_READ_US);
+      uint64_t start = sim_time_us();
+      bmp_reading readings[FIFO_BATCH];
+      uint8_t count;
+      do {
+        count = bmp388_read_fifo(readings, FIFO_BATCH);
+        for (uint8_t i = 0; i < count; i++) {
+          check(&bmp, &readings[i], &history[next++ % HISTORY], result);
+        }
+      } while (count == FIFO_BATCH);
+      result->bus_us += sim_time_us() - start;
+    }
+    bmp388_stop_fifo();
+  }
+  result->bus_bytes = sim_spi_bytes(&SPI_2) - bytes;
+  result->dropped = bmp.fifo_dropped;
+}
+
+static int run(const trace *t) {
+  int failures = 0;
+  printf("%s\n", t->name);
+  printf("  %6s %8s %4s %4s %9s %7s %9s %9s %7s %7s %6s\n", "mode",
+         "rate", "osr", "part", "readings", "exact", "max dPa", "max dC",
+         "err Pa", "bus us", "B each");
+  for (size_t m = 0; m < sizeof(MODES) / sizeof(MODES[0]); m++) {
+    const bench_mode *mode = &MODES[m];
+    for (int part = 0; part < 3; part++) {
+      bench_result r;
+      bench(t, mode, part, &r);
+      double rate = mode->fifo ? 200.0 / (1 << mode->odr)
+                               : 1000.0 / mode->period_ms;
+      printf("  %6s %5.1f Hz %4d %4d", mode->name, rate,
+             mode->fifo ? 1 << mode->osr : 4, part);
+      if (r.config_error) {
+        printf("  OSR doesn't fit the period\n");
+        failures++;
+        continue;
+      }
+      printf(" %9u %6.2f%% %9.1e %9.1e %7.3f %7.0f %6.1f\n", r.readings,
+             100.0 * r.exact / r.readings, r.max_pressure_diff,
+             r.max_temperature_diff, r.max_pressure_error,
+             (double)r.bus_us / r.readings,
+             (double)r.bus_bytes / r.readings);
+      // a reading off by more than rounding isn't the datasheet formula
+      if (r.max_pressure_diff > 1e-6 || r.max_temperature_diff > 1e-9 ||
+          r.dropped > 0) {
+        printf("  %u frames dropped, compensation off\n", r.dropped);
+        failures++;
+      }
+    }
+  }
+  printf("\n");
+  return failures;
+}
+
+int main(int argc, char **argv) {
+  int failures = 0;
+  int runs = argc > 1 ? argc - 1 : TRACE_KIND_COUNT;
+  for (int i = 0; i < runs; i++) {
+    trace t;
+    if (argc > 1) {
+      if (trace_load_csv(&t, argv[i + 1]) != 0) {
+        fprintf(stderr, "%s: can't load trace\n", argv[i + 1]);
+        return 1;
+      }
+    } else {
+      trace_synthetic(&t, (trace_kind)i);
+    }
+    failures += run(&t);
+    trace_free(&t);
+  }
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * codec_bench.c
+ *
+ * Created: 10/19/2026
+ *
+ * Compression benchmark for delta_codec. Samples traces at the rates the
+ * flight phases use, packs the readings (time, pressure, temperature) into
+ * radio sized and flash log sized blocks, decodes them again and reports
+ * bytes per reading against the raw 12 bytes and the 40 byte Datapoint:
+ *
+ *   codec_bench [trace.csv ...]
+ *
+ * Time per reading is host time. The simulator has no CPU model, so M0+
+ * cycles come from PROFILE_CODEC on the board (8 cycles per us at 8 MHz).
+ */
+
+#include "delta_codec.h"
+#include "flash_log.h"
+#include "telemetry.h"
+#include "trace.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const uint32_t PERIODS_MS[] = {200, 500, 2000, 10000};
+
+// a radio block after the Datapoint, flash blocks fill a log record
+static const uint16_t BLOCK_SIZES[] = {64, FLASH_LOG_MAX_PAYLOAD};
+
+static const uint16_t RAW_BYTES = SAMPLE_CHANNELS * sizeof(int32_t);
+
+typedef struct bench_result {
+  uint32_t readings;
+  uint32_t blocks;
+  uint64_t bytes;
+  double encode_s;
+  double decode_s;
+  uint32_t mismatches;
+} bench_result;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int32_t *quantize(const trace *t, uint32_t period_ms, uint32_t *count) {
+  *count = (uint32_t)(trace_duration_s(t) * 1000 / period_ms) + 1;
+  int32_t *values = malloc(sizeof(int32_t) * SAMPLE_CHANNELS * *count);
+  for (uint32_t i = 0; i < *count; i++) {
+    trace_sample s = trace_at(t, i * period_ms / 1000.0);
+    int32_t *v = &values[i * SAMPLE_CHANNELS];
+    v[SAMPLE_TIME_MS] = (int32_t)(i * period_ms);
+    v[SAMPLE_PRESSURE] = lround(s.pressure_pa * SAMPLE_PRESSURE_SCALE);
+    v[SAMPLE_TEMPERATURE] = lround(s.temperature_c * SAMPLE_TEMPERATURE_SCALE);
+  }
+  return values;
+}
+
+static void bench(const int32_t *values, uint32_t count, uint16_t block_size,
+                  bench_result *result) {
+  memset(result, 0, sizeof(*result));
+  uint8_t *blocks = malloc((size_t)block_size * count);
+  uint16_t *lengths = malloc(sizeof(uint16_t) * count);
+
+  double start = now_seconds();
+  delta_encoder encoder;
+  delta_encoder_begin(&encoder, SAMPLE_CHANNELS, blocks, block_size);
+  for (uint32_t i = 0; i < count; i++) {
+    const int32_t *v = &values[i * SAMPLE_CHANNELS];
+    if (!delta_encoder_add(&encoder, v)) {
+      lengths[result->blocks++] = delta_encoder_finish(&encoder);
+      delta_encoder_begin(&encoder, SAMPLE_CHANNELS,
+                          blocks + (size_t)result->blocks * block_size,
+                          block_size);
+      delta_encoder_add(&encoder, v);
+    }
+  }
+  lengths[result->blocks++] = delta_encoder_finish(&encoder);
+  result->encode_s = now_seconds() - start;
+
+  start = now_seconds();
+  uint32_t index = 0;
+  for (uint32_t b = 0; b < result->blocks; b++) {
+    delta_decoder decoder;
+    delta_decoder_begin(&decoder, SAMPLE_CHANNELS,
+                        blocks + (size_t)b * block_size, lengths[b]);
+    int32_t decoded[SAMPLE_CHANNELS];
+    while (delta_decoder_next(&decoder, decoded)) {
+      if (index >= count ||
+          memcmp(decoded, &values[index * SAMPLE_CHANNELS],
+                 sizeof(decoded)) != 0) {
+        result->mismatches++;
+      }
+      index++;
+    }
+    result->bytes += lengths[b];
+  }
+  result->decode_s = now_seconds() - start;
+  result->readings = index;
+  if (index != count) {
+    result->mismatches++;
+  }
+
+  free(blocks);
+  free(lengths);
+}
+
+static int run(const trace *t) {
+  int failures = 0;
+  printf("%s\n", t->name);
+  printf("  %6s %6s %9s %7s %8s %10s %10s %10s\n", "period", "block",
+         "readings", "B each", "vs raw", "vs packet", "enc ns", "dec ns");
+  for (size_t p = 0; p < sizeof(PERIODS_MS) / sizeof(PERIODS_MS[0]); p++) {
+    uint32_t count;
+    int32_t *values = quantize(t, PERIODS_MS[p], &count);
+    for (size_t b = 0; b < sizeof(BLOCK_SIZES) / sizeof(BLOCK_SIZES[0]); b++) {
+      bench_result r;
+      bench(values, count, BLOCK_SIZES[b], &r);
+      double each = (double)r.bytes / r.readings;
+      printf("  %4u ms %6u %9u %7.2f %7.1fx %9.1fx %10.0f %10.0f\n",
+             PERIODS_MS[p], BLOCK_SIZES[b], r.readings, each,
+             RAW_BYTES / each, sizeof(Datapoint) / each,
+             r.encode_s * 1e9 / r.readings, r.decode_s * 1e9 / r.readings);
+      if (r.mismatches > 0) {
+        printf("  %u readings did not round trip\n", r.mismatches);
+        failures++;
+      }
+    }
+    free(values);
+  }
+  printf("\n");
+  return failures;
+}
+
+int main(int argc, char **argv) {
+  int failures = 0;
+  int runs = argc > 1 ? argc - 1 : TRACE_KIND_COUNT;
+  for (int i = 0; i < runs; i++) {
+    trace t;
+    if (argc > 1) {
+      if (trace_load_csv(&t, argv[i + 1]) != 0) {
+        fprintf(stderr, "%s: can't load trace\n", argv[i + 1]);
+        return 1;
+      }
+    } else {
+      trace_synthetic(&t, (trace_kind)i);
+    }
+    failures += run(&t);
+    trace_free(&t);
+  }
+  return failures > 0 ? 1 : 0;
+}
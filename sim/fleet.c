@@ -0,0 +1,200 @@
+/*
+ * fleet.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "fleet.h"
+#include "rfm9x.h"
+#include "telemetry.h"
+#include "uplink.h"
+#include <string.h>
+
+static const uint64_t PERIOD_US = 5000000;
+// crystals are good to about this, either way
+static const double CLOCK_PPM = 50;
+// a Datapoint and a block of samples, behind the RadioHead header
+static const uint8_t PACKET_LENGTH = 4 + sizeof(Datapoint) + 24;
+static const int CAD_SYMBOLS = 2;
+// as rfm9x_send_lbt
+static const uint32_t LBT_MAX_SLOTS = 32;
+// as telemetry.c and ground_station.c
+static const uint32_t LISTEN_TURNAROUND_US = 200000;
+static const uint32_t LISTEN_POLL_MS = 5;
+static const uint32_t GROUND_TURNAROUND_US = 50000;
+static const uint8_t HEADER_LENGTH = 4;
+// spread over while waiting for a first beacon
+static const uint32_t JOIN_JITTER_US = 1000000;
+// as telemetry.c
+static const uint32_t FLIGHT = 42;
+
+// xorshift, the same fleet on every run
+static uint32_t random_next(fleet *fleet) {
+  fleet->random ^= fleet->random << 13;
+  fleet->random ^= fleet->random >> 17;
+  fleet->random ^= fleet->random << 5;
+  return fleet->random;
+}
+
+static void hook(void *context, uint64_t until_us) {
+  fleet_advance(context, until_us);
+}
+
+void fleet_init(fleet *fleet, sim_channel *channel, uint8_t kites,
+                bool listen_before_talk, uint64_t start_us) {
+  memset(fleet, 0, sizeof(*fleet));
+  fleet->channel = channel;
+  fleet->modem = (lora_modem)LORA_MODEM_DEFAULT;
+  fleet->length = PACKET_LENGTH;
+  fleet->listen_before_talk = listen_before_talk;
+  fleet->kites = kites > FLEET_MAX_KITES ? FLEET_MAX_KITES : kites;
+  fleet->random = 0x6d2b79f5;
+  for (uint8_t i = 0; i < fleet->kites; i++) {
+    fleet_kite *kite = &fleet->kite[i];
+    double drift = (random_next(fleet) / 4294967296.0 * 2 - 1) * CLOCK_PPM;
+    kite->period_us = (uint64_t)(PERIOD_US * (1 + drift / 1e6));
+    kite->clock_ppm = -drift; // slow by as much as the period is long
+    kite->next_us = start_us + random_next(fleet) % PERIOD_US;
+    kite->frf = HOP_FRF(RFM9X_FREQUENCY_HZ);
+  }
+  channel->advance = hook;
+  channel->advance_context = fleet;
+}
+
+void fleet_tdma(fleet *fleet, uint8_t slots, uint16_t frame_ms) {
+  fleet->tdma = true;
+  fleet->reply_us =
+      LISTEN_TURNAROUND_US +
+      lora_airtime_us(&fleet->modem, HEADER_LENGTH + UPLINK_OVERHEAD +
+                                         UPLINK_MAX_ARGUMENTS);
+  for (uint8_t i = 0; i < fleet->kites; i++) {
+    fleet_kite *kite = &fleet->kite[i];
+    kite->clock_offset_ms = random_next(fleet);
+    tdma_init(&kite->tdma, LISTEN_POLL_MS);
+    tdma_configure(&kite->tdma, slots, frame_ms, (uint8_t)(2 + i));
+  }
+}
+
+uint32_t fleet_max_correction_ms(const fleet *fleet) {
+  uint32_t max = 0;
+  for (uint8_t i = 0; i < fleet->kites; i++) {
+    if (fleet->kite[i].tdma.max_correction_ms > max) {
+      max = fleet->kite[i].tdma.max_correction_ms;
+    }
+  }
+  return max;
+}
+
+static uint8_t source(const fleet *fleet, const fleet_kite *kite) {
+  return (uint8_t)(1 + (kite - fleet->kite));
+}
+
+// the kite's own clock at time_us on ours
+static uint32_t local_ms(const fleet_kite *kite, uint64_t time_us) {
+  uint64_t local_us = (uint64_t)(time_us * (1 + kite->clock_ppm / 1e6));
+  return kite->clock_offset_ms + (uint32_t)(local_us / 1000);
+}
+
+void fleet_hopping(fleet *fleet, uint16_t dwell_ms) {
+  fleet->hopping = true;
+  for (uint8_t i = 0; i < fleet->kites; i++) {
+    fleet_kite *kite = &fleet->kite[i];
+    hop_init(&kite->hop, (uint8_t)(2 + i), FLIGHT, dwell_ms,
+             local_ms(kite, kite->next_us));
+  }
+}
+
+// the ground's beacon in the listen window after a packet it heard
+static void beacon(fleet *fleet, fleet_kite *kite) {
+  uint64_t end_us =
+      kite->end_us + GROUND_TURNAROUND_US +
+      lora_airtime_us(&fleet->modem, HEADER_LENGTH + UPLINK_OVERHEAD + 2);
+  uint16_t position = end_us / 1000 % kite->tdma.frame_ms;
+  uint64_t noticed_us = end_us + random_next(fleet) % (LISTEN_POLL_MS * 1000);
+  tdma_beacon(&kite->tdma, local_ms(kite, noticed_us), position);
+}
+
+static void finish(fleet *fleet, fleet_kite *kite) {
+  kite->on_air = false;
+  if (sim_channel_active(fleet->channel, source(fleet, kite), &fleet->modem,
+                         kite->frf, kite->start_us, kite->end_us)) {
+    fleet->collided++;
+  } else {
+    fleet->heard++;
+    if (fleet->tdma && kite->tdma.slots > 0) {
+      beacon(fleet, kite);
+    }
+  }
+}
+
+static void try_send(fleet *fleet, fleet_kite *kite) {
+  uint64_t now = kite->next_us;
+  uint64_t airtime = lora_airtime_us(&fleet->modem, fleet->length);
+  if (fleet->tdma) {
+    uint32_t wait = tdma_wait_ms(&kite->tdma, local_ms(kite, now),
+                                 (uint32_t)airtime, fleet->reply_us);
+    if (wait != 0 && wait != UINT32_MAX) {
+      kite->next_us = now + (uint64_t)wait * 1000; // near enough on ours
+      return;
+    }
+  }
+  if (fleet->hopping) {
+    kite->frf = hop_packet(&kite->hop, local_ms(kite, now));
+  }
+  if (fleet->listen_before_talk) {
+    uint64_t cad_end =
+        now + (uint64_t)(CAD_SYMBOLS * lora_symbol_us(&fleet->modem));
+    if (sim_channel_active(fleet->channel, source(fleet, kite),
+                           &fleet->modem, kite->frf, now, cad_end)) {
+      fleet->busy++;
+      if (++kite->busy_in_row < RFM9X_LBT_ATTEMPTS) {
+        uint32_t slots = 1ul << kite->busy_in_row;
+        if (slots > LBT_MAX_SLOTS) {
+          slots = LBT_MAX_SLOTS;
+        }
+        uint64_t slot_us = (airtime / 1000 + 1) * 1000;
+        kite->next_us = cad_end + (1 + random_next(fleet) % slots) * slot_us;
+        return;
+      }
+      fleet->forced++;
+    }
+    now = cad_end;
+  }
+  kite->busy_in_row = 0;
+  kite->on_air = true;
+  kite->start_us = now;
+  kite->end_us = now + airtime;
+  kite->next_us = now + kite->period_us;
+  if (fleet->tdma && !kite->tdma.synced) {
+    // or two out of sync on the same period could collide every time
+    kite->next_us += random_next(fleet) % JOIN_JITTER_US;
+  }
+  sim_channel_transmit(fleet->channel, source(fleet, kite), false,
+                       &fleet->modem, kite->frf, kite->start_us, kite->end_us);
+  fleet->sent++;
+  fleet->airtime_us += airtime;
+}
+
+void fleet_advance(fleet *fleet, uint64_t until_us) {
+  while (true) {
+    // whatever comes first, packet ends before starts at the same time
+    fleet_kite *next = NULL;
+    uint64_t next_us = UINT64_MAX;
+    for (uint8_t i = 0; i < fleet->kites; i++) {
+      fleet_kite *kite = &fleet->kite[i];
+      uint64_t at = kite->on_air ? kite->end_us : kite->next_us;
+      if (at < next_us || (at == next_us && kite->on_air)) {
+        next = kite;
+        next_us = at;
+      }
+    }
+    if (next == NULL || next_us > until_us) {
+      return;
+    }
+    if (next->on_air) {
+      finish(fleet, next);
+    } else {
+      try_send(fleet, next);
+    }
+  }
+}
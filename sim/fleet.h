@@ -0,0 +1,80 @@
+/*
+ * fleet.h
+ *
+ * Created: 10/19/2026
+ *
+ * Other kites on the replayed kite's frequency, to see what sharing the
+ * channel does. Each sends a Datapoint sized packet on the default LoRa
+ * settings every 5 s on its own slightly off clock, starting at a random
+ * point. With listen before talk each checks the channel for two symbols
+ * first and backs off the way rfm9x_send_lbt does while it's busy.
+ *
+ * They are on the channel as sources 1 up (the replayed kite is 0), played
+ * out as the channel is asked about. The ground hears one of their packets
+ * if nothing else on the same settings was on air during it.
+ *
+ * With TDMA they run tdma.c on their own clocks, as device ids 2 up (the
+ * replayed kite is 1), and get a beacon back for every packet heard, noticed
+ * up to a listen poll late. The ground's answers aren't put on the channel.
+ *
+ * Hopping, each goes through hop.h's channels in its own order from its
+ * device id, the same way the replayed kite does.
+ */
+
+#ifndef FLEET_H_
+#define FLEET_H_
+
+#include "hop.h"
+#include "lora_modem.h"
+#include "sim_channel.h"
+#include "tdma.h"
+
+#define FLEET_MAX_KITES 31
+
+typedef struct fleet_kite {
+  uint64_t period_us;
+  uint64_t next_us; // next go at sending
+  bool on_air;
+  uint64_t start_us;
+  uint64_t end_us;
+  uint8_t busy_in_row;
+  double clock_ppm; // how fast its crystal runs
+  uint32_t clock_offset_ms; // its clock when ours was at 0
+  tdma_schedule tdma;
+  hop_sequence hop;
+  uint32_t frf; // the channel it's on
+} fleet_kite;
+
+typedef struct fleet {
+  sim_channel *channel;
+  lora_modem modem;
+  uint8_t length; // RadioHead header included
+  bool listen_before_talk;
+  uint8_t kites;
+  fleet_kite kite[FLEET_MAX_KITES];
+  uint32_t random;
+  bool tdma;
+  uint32_t reply_us; // the listen window after each packet
+  bool hopping;
+
+  uint32_t sent;
+  uint32_t heard;
+  uint32_t collided;
+  uint32_t busy; // CAD found the channel in use
+  uint32_t forced; // sent anyway after RFM9X_LBT_ATTEMPTS
+  uint64_t airtime_us;
+} fleet;
+
+// kites of them, hooked onto channel from start_us
+void fleet_init(fleet *fleet, sim_channel *channel, uint8_t kites,
+                bool listen_before_talk, uint64_t start_us);
+// TDMA on frames of frame_ms for all of them, to be synced from the ground
+void fleet_tdma(fleet *fleet, uint8_t slots, uint16_t frame_ms);
+// all of them hopping, a new channel every packet for a dwell of 0
+void fleet_hopping(fleet *fleet, uint16_t dwell_ms);
+// the biggest correction any of their beacons made
+uint32_t fleet_max_correction_ms(const fleet *fleet);
+// play out everything up to until_us, through sim_channel_advance
+void fleet_advance(fleet *fleet, uint64_t until_us);
+
+#endif /* FLEET_H_ */
@@ -0,0 +1,478 @@
+/*
+ * ground_station.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "ground_station.h"
+#include "crc32.h"
+#include <math.h>
+#include <string.h>
+
+// RadioHead header in front of everything, to and from both broadcast
+static const uint8_t HEADER[4] = {0xff, 0xff, 0x00, 0x00};
+
+// free space loss at 1 m and 915 MHz
+static const double PATH_LOSS_1M_DB = 31.7;
+
+void ground_station_init(ground_station *ground, sim_rfm95 *radio) {
+  memset(ground, 0, sizeof(*ground));
+  ground->radio = radio;
+  sim_rfm95_modem(radio, &ground->modem);
+  ground->turnaround_us = 50000;
+  // open field with the kite low over the grass
+  ground->path_loss_exponent = 3.5;
+  ground->noise_figure_db = 6;
+  ground->fading_db = 2;
+  ground->power_dbm = 20;
+  ground->random = 0x2545f491;
+  ground->adr_enabled = true;
+  adr_reset(&ground->adr);
+  ground->next_sequence = 1; // the kite starts out having acknowledged 0
+  ground->next_transfer = 1;
+  ground->fsk_modem = (fsk_modem)FSK_MODEM_DEFAULT;
+  fec_decoder_init(&ground->fec);
+}
+
+bool ground_station_queue(ground_station *ground, uint64_t at_us, uint8_t type,
+                          const uint8_t *arguments, uint8_t length) {
+  if (ground->queued == GROUND_STATION_QUEUE || length > UPLINK_MAX_ARGUMENTS) {
+    return false;
+  }
+  // in time order, behind anything already due at the same time
+  uint8_t position = ground->queued;
+  while (position > 0 && ground->queue[position - 1].at_us > at_us) {
+    position--;
+  }
+  memmove(&ground->queue[position + 1], &ground->queue[position],
+          (ground->queued - position) * sizeof(ground->queue[0]));
+  ground->queued++;
+  ground_command *entry = &ground->queue[position];
+  memset(entry, 0, sizeof(*entry));
+  entry->at_us = at_us;
+  entry->command.sequence = ground->next_sequence++;
+  entry->command.type = type;
+  entry->command.length = length;
+  memcpy(entry->command.arguments, arguments, length);
+  ground->commands++;
+  return true;
+}
+
+// xorshift, the same fading on every run
+static double uniform(ground_station *ground) {
+  ground->random ^= ground->random << 13;
+  ground->random ^= ground->random >> 17;
+  ground->random ^= ground->random << 5;
+  return ground->random / 4294967296.0;
+}
+
+// near enough normal, sum of four uniforms scaled to unit variance
+static double fading(ground_station *ground) {
+  double sum = 0;
+  for (int i = 0; i < 4; i++) {
+    sum += uniform(ground);
+  }
+  return (sum - 2) * sqrt(3) * ground->fading_db;
+}
+
+static double rssi_dbm(const ground_station *ground, int power_dbm,
+                       uint64_t time_us) {
+  double range = ground->range_m != NULL
+                     ? ground->range_m(ground->range_context, time_us)
+                     : 1;
+  if (range < 1) {
+    range = 1;
+  }
+  return power_dbm - PATH_LOSS_1M_DB -
+         10 * ground->path_loss_exponent * log10(range);
+}
+
+static double snr_db(const ground_station *ground, double rssi,
+                     uint32_t bandwidth_hz) {
+  double noise = -174 + 10 * log10(bandwidth_hz) + ground->noise_figure_db;
+  return rssi - noise;
+}
+
+// what the receiver lets in, FSK's is single sided
+static uint32_t bandwidth_hz(const ground_station *ground) {
+  return ground->fsk ? 2 * fsk_rx_bandwidth_hz(ground->fsk_modem.rx_bandwidth)
+                     : lora_bandwidth_hz(ground->modem.bandwidth);
+}
+
+static void reset_window(ground_station *ground) {
+  ground->window_heard = 0;
+  ground->window_snr = 0;
+  ground->window_rssi_dbm = 0;
+}
+
+static bool report_queued(const ground_station *ground) {
+  for (int i = 0; i < ground->queued; i++) {
+    if (ground->queue[i].command.type == UPLINK_LINK_REPORT) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void queue_report(ground_station *ground, uint32_t packet_number,
+                         uint64_t now_us) {
+  adr_report report;
+  uint32_t sent = packet_number - ground->window_first_packet + 1;
+  report.heard = ground->window_heard;
+  report.sent = sent > UINT8_MAX ? UINT8_MAX : (uint8_t)sent;
+  report.snr = (int8_t)(ground->window_snr / ground->window_heard);
+  report.rssi_dbm = (int16_t)(ground->window_rssi_dbm / ground->window_heard);
+  uint8_t arguments[ADR_REPORT_PACKED];
+  adr_report_pack(&report, arguments);
+  if (ground_station_queue(ground, now_us, UPLINK_LINK_REPORT, arguments,
+                           sizeof(arguments))) {
+    reset_window(ground);
+  }
+}
+
+// the same rules the kite applies, so we end up on the same settings
+static void follow(ground_station *ground, const uplink_command *command) {
+  switch (command->type) {
+  case UPLINK_SET_POWER:
+    ground->power_pinned = command->length >= 1 && command->arguments[0] != 0;
+    break;
+  case UPLINK_SET_MODEM:
+    // the kite switches once its acknowledgement is out, follow it
+    lora_modem_unpack(&ground->modem, command->arguments);
+    adr_reset(&ground->adr);
+    break;
+  case UPLINK_CLEAR_OVERRIDES:
+    ground->power_pinned = false;
+    break;
+  case UPLINK_SET_TDMA:
+    ground->tdma_slots = command->arguments[0];
+    ground->tdma_frame_ms = uplink_argument_u16(command, 1);
+    break;
+  case UPLINK_SET_HOPPING:
+    // ADR keeps every packet on one channel within the dwell limit
+    adr_limit(&ground->adr, command->arguments[0] ? TELEMETRY_HOP_PACKET : 0,
+              command->arguments[0] ? HOP_MAX_DWELL_MS * 1000ul : 0);
+    break;
+  case UPLINK_START_TRANSFER:
+    if (command->length >= 6 && command->arguments[5] != 0) {
+      ground->fsk = true;
+      reset_window(ground);
+    }
+    break;
+  case UPLINK_FLIGHT_TRANSFER:
+    if (command->length >= 8 && command->arguments[7] != 0) {
+      ground->fsk = true;
+      reset_window(ground);
+    }
+    break;
+  case UPLINK_LINK_REPORT: {
+    adr_report report;
+    adr_report_unpack(&report, command->arguments);
+    if (!ground->power_pinned &&
+        adr_update(&ground->adr, &ground->modem, &report)) {
+      adr_apply(&ground->adr, &ground->modem);
+      ground->adr_changes++;
+      reset_window(ground);
+    }
+    break;
+  }
+  }
+}
+
+static void acknowledged(ground_station *ground, uint64_t now_us) {
+  ground_command *entry = &ground->queue[0];
+  ground->acknowledged++;
+  ground->latency_us += now_us - entry->first_sent_us;
+  follow(ground, &entry->command);
+  ground->queued--;
+  memmove(&ground->queue[0], &ground->queue[1],
+          ground->queued * sizeof(ground->queue[0]));
+}
+
+// answer a kite packet that ended at end_us, returns false if it didn't go
+static bool transmit_command(ground_station *ground,
+                             const uplink_command *command, uint64_t end_us) {
+  uint8_t packet[sizeof(HEADER) + UPLINK_OVERHEAD + UPLINK_MAX_ARGUMENTS];
+  memcpy(packet, HEADER, sizeof(HEADER));
+  uint8_t length = sizeof(HEADER) + uplink_encode(command, ground->device_id,
+                                                  packet + sizeof(HEADER));
+  uint64_t start_us = end_us + ground->turnaround_us;
+  double rssi = rssi_dbm(ground, ground->power_dbm, start_us);
+  double snr = snr_db(ground, rssi, bandwidth_hz(ground)) + fading(ground);
+  if (snr < INT8_MIN) {
+    snr = INT8_MIN;
+  }
+  if (ground->extra_loss > 0 && uniform(ground) < ground->extra_loss) {
+    return true; // went out, lost on the way
+  }
+  // on the channel the kite's packet went out on
+  uint32_t frf = sim_rfm95_frf(ground->radio);
+  if (ground->fsk) {
+    return sim_rfm95_deliver_fsk(ground->radio, packet, length,
+                                 &ground->fsk_modem, frf, start_us,
+                                 (int16_t)lround(rssi), (int8_t)floor(snr));
+  }
+  return sim_rfm95_deliver(ground->radio, packet, length, &ground->modem, frf,
+                           start_us, (int16_t)lround(rssi),
+                           (int8_t)floor(snr));
+}
+
+static void send_command(ground_station *ground, uint64_t end_us) {
+  ground_command *entry = &ground->queue[0];
+  if (transmit_command(ground, &entry->command, end_us)) {
+    if (entry->first_sent_us == 0) {
+      entry->first_sent_us = end_us + ground->turnaround_us;
+    }
+    ground->transmissions++;
+  }
+}
+
+// how far into our frame it is as the beacon ends, to line the kite up
+static void send_beacon(ground_station *ground, uint64_t end_us) {
+  uplink_command beacon = {.sequence = 0,
+                           .type = UPLINK_TDMA_BEACON,
+                           .length = 2};
+  uint8_t length = sizeof(HEADER) + UPLINK_OVERHEAD + beacon.length;
+  uint64_t beacon_end_us = end_us + ground->turnaround_us +
+                           lora_airtime_us(&ground->modem, length);
+  uint16_t position = beacon_end_us / 1000 % ground->tdma_frame_ms;
+  beacon.arguments[0] = position & 0xff;
+  beacon.arguments[1] = position >> 8;
+  if (transmit_command(ground, &beacon, end_us)) {
+    ground->beacons++;
+  }
+}
+
+// anyone else on the packet's channel at any point until it ended at end_us
+static bool collided(ground_station *ground, const lora_modem *modem,
+                     uint64_t end_us) {
+  return ground->channel != NULL &&
+         sim_channel_active(ground->channel, ground->radio->source, modem,
+                            sim_rfm95_frf(ground->radio),
+                            ground->radio->tx_start_us, end_us);
+}
+
+// arguments after the transfer id, which is the next one
+static bool request_download(ground_station *ground, uint64_t at_us,
+                             uint8_t type, const uint8_t *arguments,
+                             uint8_t length, uint8_t *image,
+                             uint32_t capacity) {
+  uint8_t transfer = ground->next_transfer;
+  uint8_t command[UPLINK_MAX_ARGUMENTS] = {transfer};
+  memcpy(&command[1], arguments, length);
+  if (!ground_station_queue(ground, at_us, type, command, length + 1)) {
+    return false;
+  }
+  ground->next_transfer++;
+  arq_receiver_begin(&ground->download, transfer);
+  ground->image = image;
+  ground->image_capacity = capacity;
+  ground->image_length = 0;
+  ground->image_verified = false;
+  ground->download_type = type;
+  memmove(ground->download_arguments, arguments, length);
+  ground->download_length = length;
+  return true;
+}
+
+// link model, true if a packet ending at end_us gets through
+static bool link_heard(ground_station *ground, uint64_t end_us, double *snr,
+                       double *rssi) {
+  const lora_modem initial = LORA_MODEM_DEFAULT;
+  if ((ground->adr.running ||
+       !lora_modem_compatible(&ground->modem, &initial)) &&
+      end_us - ground->last_heard_us > (uint64_t)ADR_SILENCE_MS * 1000) {
+    // lost the kite, it will go back to the defaults as well
+    ground->modem = initial;
+    adr_reset(&ground->adr);
+    reset_window(ground);
+    ground->fallbacks++;
+  }
+  if (ground->fsk &&
+      end_us - ground->last_heard_us > (uint64_t)ADR_SILENCE_MS * 1000) {
+    // the kite gave up on FSK too, start the download over
+    ground->fsk = false;
+    reset_window(ground);
+    ground->fallbacks++;
+    if (!ground_station_download_done(ground)) {
+      request_download(ground, end_us, ground->download_type,
+                       ground->download_arguments, ground->download_length,
+                       ground->image, ground->image_capacity);
+    }
+  }
+
+  lora_modem sent_with;
+  sim_rfm95_modem(ground->radio, &sent_with);
+  fsk_modem sent_fsk;
+  bool kite_fsk = sim_rfm95_fsk(ground->radio, &sent_fsk);
+  if (kite_fsk != ground->fsk ||
+      (kite_fsk ? !fsk_modem_compatible(&ground->fsk_modem, &sent_fsk)
+                : !lora_modem_compatible(&ground->modem, &sent_with))) {
+    ground->mismatched++;
+    return false;
+  }
+  if (collided(ground, kite_fsk ? NULL : &sent_with, end_us)) {
+    ground->collisions++;
+    return false;
+  }
+  int power = sim_rfm95_tx_power_dbm(ground->radio);
+  *rssi = rssi_dbm(ground, power, end_us);
+  *snr = snr_db(ground, *rssi, bandwidth_hz(ground)) + fading(ground);
+  int8_t limit = kite_fsk ? fsk_snr_limit()
+                           : lora_snr_limit(sent_with.spreading_factor);
+  if (*snr * 4 < limit ||
+      (ground->extra_loss > 0 && uniform(ground) < ground->extra_loss)) {
+    ground->lost++;
+    return false;
+  }
+  ground->heard++;
+  ground->last_heard_us = end_us;
+  return true;
+}
+
+static void hear_repair(ground_station *ground, const uint8_t *data,
+                        uint8_t length) {
+  ground->repairs_heard++;
+  int recovered = fec_decoder_repair(&ground->fec, data, length);
+  for (int i = 0; i < recovered; i++) {
+    uint8_t packet_length;
+    const uint8_t *packet = fec_decoder_packet(
+        &ground->fec, ground->fec.recovered[i], &packet_length);
+    ground->recovered++;
+    if (ground->on_recovered != NULL) {
+      ground->on_recovered(ground->recovered_context, packet, packet_length);
+    }
+  }
+}
+
+bool ground_station_download(ground_station *ground, uint64_t at_us,
+                             uint16_t first_page, uint16_t pages, bool fsk,
+                             uint8_t *image, uint32_t capacity) {
+  uint8_t arguments[] = {first_page & 0xff, first_page >> 8, pages & 0xff,
+                         pages >> 8, fsk};
+  return request_download(ground, at_us, UPLINK_START_TRANSFER, arguments,
+                          sizeof(arguments), image, capacity);
+}
+
+bool ground_station_download_flight(ground_station *ground, uint64_t at_us,
+                                    uint16_t flight, uint16_t from_s,
+                                    uint16_t to_s, bool fsk, uint8_t *image,
+                                    uint32_t capacity) {
+  uint8_t arguments[] = {flight & 0xff, flight >> 8, from_s & 0xff,
+                         from_s >> 8,   to_s & 0xff, to_s >> 8,
+                         fsk};
+  return request_download(ground, at_us, UPLINK_FLIGHT_TRANSFER, arguments,
+                          sizeof(arguments), image, capacity);
+}
+
+bool ground_station_download_done(const ground_station *ground) {
+  return arq_receiver_done(&ground->download);
+}
+
+// takes the CRC-32 off the end of a finished download and checks it
+static void check_image(ground_station *ground) {
+  if (ground->image_length < UPLINK_TRANSFER_CRC_BYTES) {
+    return;
+  }
+  ground->image_length -= UPLINK_TRANSFER_CRC_BYTES;
+  const uint8_t *end = ground->image + ground->image_length;
+  uint32_t sent = 0;
+  for (int i = 0; i < UPLINK_TRANSFER_CRC_BYTES; i++) {
+    sent |= (uint32_t)end[i] << (8 * i);
+  }
+  uint32_t crc =
+      crc32_update(crc32_init(), ground->image, ground->image_length);
+  ground->image_verified = crc32_finalize(crc) == sent;
+}
+
+// keep it, and if it polls say what we have in the listen window after it
+static void hear_segment(ground_station *ground, const uint8_t *data,
+                         uint8_t length, uint8_t flags, uint64_t end_us) {
+  arq_segment segment;
+  if (!arq_segment_parse(data, length, &segment)) {
+    return;
+  }
+  ground->device_id = segment.device_id;
+  ground->segments_heard++;
+  uint32_t offset = (uint32_t)segment.sequence * segment.segment_bytes;
+  if (offset + segment.length > ground->image_capacity) {
+    return; // no room, leave it unacknowledged
+  }
+  if (arq_receiver_segment(&ground->download, &segment)) {
+    memcpy(ground->image + offset, segment.data, segment.length);
+    if (offset + segment.length > ground->image_length) {
+      ground->image_length = offset + segment.length;
+    }
+    if (arq_receiver_done(&ground->download)) {
+      check_image(ground);
+    }
+  }
+  if (ground->download.segments == 0 || !(flags & ARQ_POLL_FLAG)) {
+    return; // not ours, or more to come first
+  }
+  // repeats too, the acknowledgement for the first one may have been lost
+  uplink_command ack = {.sequence = 0,
+                        .type = UPLINK_TRANSFER_ACK,
+                        .length = ARQ_ACK_PACKED};
+  arq_ack state;
+  arq_receiver_ack(&ground->download, &state);
+  arq_ack_pack(&state, ack.arguments);
+  if (transmit_command(ground, &ack, end_us)) {
+    ground->transfer_acks++;
+  }
+  if (ground->fsk && arq_receiver_done(&ground->download)) {
+    ground->fsk = false; // the kite goes back with that acknowledgement
+    reset_window(ground);
+  }
+}
+
+bool ground_station_hear(ground_station *ground, const uint8_t *data,
+                         uint8_t length, uint8_t flags, uint64_t end_us) {
+  double snr;
+  double rssi;
+  if (!link_heard(ground, end_us, &snr, &rssi)) {
+    return false;
+  }
+  if (flags & ARQ_SEGMENT_FLAG) {
+    hear_segment(ground, data, length, flags, end_us);
+    return true;
+  }
+  if (flags & FEC_REPAIR_FLAG) {
+    hear_repair(ground, data, length);
+    if (ground->queued > 0 && ground->queue[0].at_us <= end_us) {
+      send_command(ground, end_us);
+    }
+    return true;
+  }
+  if (length < sizeof(Datapoint)) {
+    return true;
+  }
+  Datapoint datapoint;
+  memcpy(&datapoint, data, sizeof(datapoint));
+  ground->device_id = datapoint.device_id;
+  fec_decoder_data(&ground->fec, datapoint.packet_number, data, length);
+
+  if (ground->window_heard == 0) {
+    ground->window_first_packet = datapoint.packet_number;
+  }
+  double quarter_db = snr * 4 > INT8_MAX ? INT8_MAX : snr * 4;
+  ground->window_snr += lround(quarter_db);
+  ground->window_rssi_dbm += lround(rssi);
+  ground->window_heard++;
+
+  if (ground->queued > 0 && ground->queue[0].first_sent_us != 0 &&
+      datapoint.command_sequence == ground->queue[0].command.sequence) {
+    acknowledged(ground, end_us);
+  }
+  if (ground->adr_enabled && !ground->fsk &&
+      ground->window_heard >= ADR_REPORT_PACKETS &&
+      !report_queued(ground)) {
+    queue_report(ground, datapoint.packet_number, end_us);
+  }
+  if (ground->queued > 0 && ground->queue[0].at_us <= end_us) {
+    send_command(ground, end_us);
+  } else if (ground->tdma_slots > 0 && !ground->fsk) {
+    send_beacon(ground, end_us);
+  }
+  return true;
+}
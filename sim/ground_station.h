@@ -0,0 +1,158 @@
+/*
+ * ground_station.h
+ *
+ * Created: 10/19/2026
+ *
+ * The other end of the link. Hears the kite's packets (fed from the radio
+ * model's on_transmit) and answers with queued uplink commands, repeating
+ * each one after every packet until a Datapoint acknowledges it.
+ *
+ * Between the two is a log distance path loss model: the kite is range_m
+ * away, SNR comes from the power on each end, the bandwidth's noise floor
+ * and a little random fading, and packets under the demodulator's SNR limit
+ * are lost. Every ADR_REPORT_PACKETS packets heard the ground sends a link
+ * report and follows the kite's adaptive data rate (adr.h) on the
+ * acknowledgement. Repair packets (fec.h) put back data packets that were
+ * lost, which are handed to on_recovered.
+ *
+ * A download asks the kite for its flash log and acknowledges the segments
+ * (arq.h) heard when one polls, straight away in the listen window after it.
+ * On FSK both ends switch once the request is acknowledged and back to LoRa
+ * when it's all in, or after ADR_SILENCE_MS without a word, when the ground
+ * asks again. extra_loss drops that fraction of packets both ways on top of
+ * the link model, to see the retransmissions at work.
+ *
+ * On a shared channel a kite packet is lost if anyone else was on air on
+ * the same frequency and settings (or at all, on FSK) at any point during
+ * it. Once the kite acknowledges UPLINK_SET_TDMA the ground answers every
+ * Datapoint it has nothing else for with a beacon, its frames counted from
+ * time 0.
+ *
+ * The ground listens on every channel in hop.h's table at once, like a
+ * gateway, so hopping needs nothing from it but to answer on the channel
+ * each packet went out on. A packet stays on one channel from start to end.
+ */
+
+#ifndef GROUND_STATION_H_
+#define GROUND_STATION_H_
+
+#include "adr.h"
+#include "arq.h"
+#include "fec.h"
+#include "sim_rfm95.h"
+#include "telemetry.h"
+#include "uplink.h"
+
+#define GROUND_STATION_QUEUE 16
+
+typedef double (*ground_station_range)(void *context, uint64_t time_us);
+typedef void (*ground_station_packet)(void *context, const uint8_t *data,
+                                      uint8_t length);
+
+typedef struct ground_command {
+  uint64_t at_us; // not sent before this
+  uplink_command command;
+  uint64_t first_sent_us;
+} ground_command;
+
+typedef struct ground_station {
+  sim_rfm95 *radio; // the kite's, commands are delivered to it
+  uint8_t device_id; // whoever we last heard
+  lora_modem modem;
+  bool fsk; // on fsk_modem for a download instead
+  fsk_modem fsk_modem;
+  uint32_t turnaround_us; // end of a kite packet to the start of our answer
+
+  // link
+  ground_station_range range_m; // NULL for right next to each other
+  void *range_context;
+  double path_loss_exponent;
+  double noise_figure_db;
+  double fading_db; // standard deviation
+  int power_dbm;
+  double extra_loss; // 0 to 1
+  sim_channel *channel; // NULL for the kite on its own
+  uint32_t random;
+  uint8_t tdma_slots; // 0 for no TDMA
+  uint16_t tdma_frame_ms;
+
+  // adaptive data rate, off to leave the kite on its own settings
+  bool adr_enabled;
+  adr_state adr;
+  bool power_pinned; // SET_POWER from us, the kite holds its ADR
+  uint64_t last_heard_us;
+  uint32_t window_first_packet;
+  uint8_t window_heard;
+  int32_t window_snr; // quarter dB, summed
+  int32_t window_rssi_dbm;
+
+  fec_decoder fec;
+  ground_station_packet on_recovered;
+  void *recovered_context;
+
+  // flash log download
+  arq_receiver download;
+  uint8_t next_transfer;
+  uint8_t *image;
+  uint32_t image_capacity;
+  uint32_t image_length; // the furthest a segment reached, less the CRC-32
+                         // once it's done
+  bool image_verified; // done and the CRC-32 at its end matched
+  // what was asked for, to ask again
+  uint8_t download_type;
+  uint8_t download_arguments[UPLINK_MAX_ARGUMENTS];
+  uint8_t download_length;
+
+  ground_command queue[GROUND_STATION_QUEUE];
+  uint8_t queued;
+  uint8_t next_sequence;
+
+  uint32_t commands;
+  uint32_t acknowledged;
+  uint32_t transmissions;
+  uint64_t latency_us; // total, first send to acknowledgement
+  uint32_t heard; // data and repair packets
+  uint32_t lost; // under the SNR limit
+  uint32_t collisions; // someone else on air at the same time
+  uint32_t repairs_heard;
+  uint32_t recovered; // data packets put back from repairs
+  uint32_t segments_heard;
+  uint32_t transfer_acks;
+  uint32_t beacons;
+  uint32_t mismatched; // sent with settings we weren't listening with
+  uint32_t adr_changes;
+  uint32_t fallbacks;
+} ground_station;
+
+// talks to the kite with its radio's current modem settings
+void ground_station_init(ground_station *ground, sim_rfm95 *radio);
+// returns false if the queue is full
+bool ground_station_queue(ground_station *ground, uint64_t at_us, uint8_t type,
+                          const uint8_t *arguments, uint8_t length);
+/*
+Ask for the flash log pages from first_page, or up to the head if pages is 0,
+to go into image, on FSK_MODEM_DEFAULT if fsk. Returns false if the command
+queue is full.
+*/
+bool ground_station_download(ground_station *ground, uint64_t at_us,
+                             uint16_t first_page, uint16_t pages, bool fsk,
+                             uint8_t *image, uint32_t capacity);
+/*
+The same for the pages of flight (0 for the current one) with its readings
+from from_s to to_s seconds in, to_s 0 for all the rest
+*/
+bool ground_station_download_flight(ground_station *ground, uint64_t at_us,
+                                    uint16_t flight, uint16_t from_s,
+                                    uint16_t to_s, bool fsk, uint8_t *image,
+                                    uint32_t capacity);
+// every segment of the last download is in
+bool ground_station_download_done(const ground_station *ground);
+/*
+The kite sent a packet (after the RadioHead header, with the header's flags)
+that finished at end_us, with whatever modem settings and power its radio
+has now. Returns true if it was heard.
+*/
+bool ground_station_hear(ground_station *ground, const uint8_t *data,
+                         uint8_t length, uint8_t flags, uint64_t end_us);
+
+#endif /* GROUND_STATION_H_ */
@@ -0,0 +1,374 @@
+/*
+ * log_crash.c
+ *
+ * Created: 10/19/2026
+ *
+ * Power loss test for flash_log. Each run appends random records to a log
+ * that already has some in it, cuts the power at a random byte of the
+ * programming and erasing that takes (sim_w25_cut_power), boots again and
+ * checks what flash_log_init and flash_log_next make of it:
+ *
+ *   log_crash [--runs 2000] [--seed 1] [--image flash.bin]
+ *
+ * Every record that was flushed to flash before the power went has to read
+ * back intact and in order. Of the ones still in RAM or being programmed,
+ * the first few may have made it whole, the rest not at all, and never a
+ * torn one. Then the log has to take more records and keep all of them
+ * across a shutdown and another boot, each boot starting the next flight in
+ * the flight directory. --image runs on a memory mapped file, which is left
+ * with the last run in it.
+ *
+ * First the directory is filled, a boot at a time, and the boots after that
+ * have to carry on the last flight, as one after a boot that logged nothing
+ * has to.
+ *
+ * Sectors are erased ahead of the log as the firmware does, so appends
+ * suspend erases and the longest one shows what that leaves of the erase
+ * time. Now and then the log is flushed early, as telemetry.c does after
+ * each block, so pages get programmed a piece at a time too.
+ */
+
+#include "flash_log.h"
+#include "sim_w25.h"
+#include "spi_flash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_RECORDS 256
+
+// records already in the log when the test starts, and appended in it
+static const int BEFORE_RECORDS = 40;
+static const int DURING_RECORDS = 120;
+static const int AFTER_RECORDS = 40;
+static const uint8_t ERASE_AHEAD_SECTORS = 2;
+// between appends, as a flight leaves the erases ahead time to get on
+static const uint64_t IDLE_US = 10000;
+// appends followed by a flush, as if they ended a block
+static const uint32_t FLUSH_ONE_IN = 6;
+// appends followed by a look up of the flight, as a download request does
+static const uint32_t FIND_ONE_IN = 4;
+
+typedef struct expected_record {
+  uint8_t type;
+  uint8_t length;
+  uint8_t data[FLASH_LOG_MAX_PAYLOAD];
+  uint32_t end; // the log's head after it
+} expected_record;
+
+static expected_record expected[MAX_RECORDS];
+
+typedef struct crash_result {
+  uint32_t runs;
+  uint32_t unflushed_kept; // not flushed at the cut and survived whole
+  uint32_t unflushed_lost; // not flushed at the cut and gone, as allowed
+  uint32_t most_bytes_lost; // of those in one cut
+  uint32_t lost; // a flushed record missing or changed
+  uint32_t torn; // a record read back that was never written like that
+  uint32_t lost_after; // appended after recovery and gone after a boot
+  uint32_t bad_flights; // a boot that didn't get the next flight number
+} crash_result;
+
+static uint32_t random_state;
+
+static uint32_t next_random(void) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+static void make_record(expected_record *record) {
+  record->type = next_random() % 2 ? FLASH_LOG_SAMPLES : FLASH_LOG_DATAPOINT;
+  // mostly Datapoint sized, now and then up to a whole page
+  record->length = next_random() % 4 == 0
+                       ? 1 + next_random() % FLASH_LOG_MAX_PAYLOAD
+                       : 20 + next_random() % 24;
+  for (int i = 0; i < record->length; i++) {
+    record->data[i] = next_random();
+  }
+}
+
+static uint64_t longest_append_us;
+
+/*
+And erase ahead after it, as telemetry.c does between steps, so the next one
+may have to suspend the erase. Now and then the flight is looked up in the
+directory while it goes, a run of reads one after the other.
+*/
+static bool append(expected_record *record) {
+  uint64_t start = sim_time_us();
+  bool appended = flash_log_append(record->type, record->data, record->length);
+  if (sim_time_us() - start > longest_append_us) {
+    longest_append_us = sim_time_us() - start;
+  }
+  if (next_random() % FLUSH_ONE_IN == 0) {
+    flash_log_flush();
+  }
+  record->end = flash_log_head();
+  flash_log_erase_ahead(ERASE_AHEAD_SECTORS);
+  if (next_random() % FIND_ONE_IN == 0) {
+    flash_log_flight flight;
+    flash_log_flight_find(0, &flight);
+  }
+  sim_advance_us(IDLE_US);
+  return appended;
+}
+
+// as telemetry_init
+static void open_log(void) {
+  flash_log_init();
+  while (flash_log_erase_ahead(ERASE_AHEAD_SECTORS) || spi_flash_busy()) {
+  }
+}
+
+// starting a flight, as telemetry_init, returns false if it isn't number
+static bool boot(uint32_t number, crash_result *result) {
+  spi_flash_init();
+  open_log();
+  flash_log_flight flight;
+  if (flash_log_begin_flight() != number ||
+      !flash_log_flight_find(0, &flight) || flight.start != flash_log_head()) {
+    result->bad_flights++;
+    return false;
+  }
+  return true;
+}
+
+static bool same(const flash_log_record *read, const expected_record *record) {
+  return read->type == record->type && read->length == record->length &&
+         memcmp(read->data, record->data, record->length) == 0;
+}
+
+/*
+Reads the whole log back against expected[0, count). The first durable have
+to be there, any after them that are have to follow on without a gap.
+Returns false on anything else, *kept is how many past durable made it.
+*/
+static bool check(int count, int durable, int *kept, crash_result *result,
+                  uint32_t *lost) {
+  static flash_log_record read;
+  uint32_t cursor = 0;
+  int next = 0;
+  bool ok = true;
+  bool gap = false;
+  *kept = 0;
+  while (flash_log_next(&cursor, &read)) {
+    while (next < count && !same(&read, &expected[next])) {
+      if (next < durable) {
+        (*lost)++;
+        ok = false;
+      } else {
+        gap = true;
+      }
+      next++;
+    }
+    if (next == count) {
+      result->torn++;
+      return false;
+    }
+    if (next >= durable) {
+      if (gap) {
+        (*lost)++; // the one before it never made it
+        ok = false;
+      }
+      (*kept)++;
+    }
+    next++;
+  }
+  for (; next < durable; next++) {
+    (*lost)++;
+    ok = false;
+  }
+  return ok;
+}
+
+static bool run(sim_w25 *flash, crash_result *result) {
+  memset(flash->memory, 0xFF, SIM_W25_SIZE);
+  sim_w25_power_on(flash);
+  bool ok = boot(1, result);
+
+  int count = 0;
+  for (int i = 0; i < BEFORE_RECORDS; i++) {
+    make_record(&expected[count]);
+    append(&expected[count++]);
+  }
+  flash_log_flush();
+
+  // how much work the next records would take, then cut somewhere in it
+  uint32_t saved_random = random_state;
+  uint32_t head = flash_log_head();
+  uint64_t start_work = flash->work;
+  static uint8_t image[SIM_W25_SIZE];
+  memcpy(image, flash->memory, SIM_W25_SIZE);
+  for (int i = 0; i < DURING_RECORDS; i++) {
+    make_record(&expected[count + i]);
+    append(&expected[count + i]);
+  }
+  uint64_t work = flash->work - start_work;
+  memcpy(flash->memory, image, SIM_W25_SIZE);
+  random_state = saved_random;
+  open_log();
+  if (flash_log_head() != head) {
+    printf("  head moved on a clean boot: %u to %u\n", head, flash_log_head());
+    return false;
+  }
+  uint64_t cut = next_random() % work;
+  sim_w25_cut_power(flash, cut);
+
+  int durable = count; // on flash before the cut, so they have to survive
+  for (int i = 0; i < DURING_RECORDS && flash->powered; i++) {
+    uint32_t flushed = flash_log_head() - flash_log_pending();
+    while (durable < count && expected[durable].end <= flushed) {
+      durable++;
+    }
+    make_record(&expected[count]);
+    append(&expected[count]);
+    count++;
+  }
+  if (flash->powered) {
+    return ok; // cut past the end, nothing to see
+  }
+  result->runs++;
+
+  sim_w25_power_on(flash);
+  ok &= boot(2, result);
+  int kept;
+  uint32_t lost = 0;
+  ok &= check(count, durable, &kept, result, &lost);
+  result->lost += lost;
+  result->unflushed_kept += kept;
+  result->unflushed_lost += count - durable - kept;
+  uint32_t bytes = 0;
+  for (int i = durable + kept; i < count; i++) {
+    bytes += expected[i].length + FLASH_LOG_OVERHEAD;
+  }
+  if (bytes > result->most_bytes_lost) {
+    result->most_bytes_lost = bytes;
+  }
+  count = durable + kept; // the rest isn't in the log
+
+  for (int i = 0; i < AFTER_RECORDS && count < MAX_RECORDS; i++) {
+    make_record(&expected[count]);
+    if (!append(&expected[count])) {
+      break;
+    }
+    count++;
+  }
+  // a clean shutdown
+  flash_log_flush();
+  ok &= boot(3, result);
+  lost = 0;
+  if (!check(count, count, &kept, result, &lost)) {
+    result->lost_after += lost;
+    ok = false;
+  }
+  return ok;
+}
+
+/*
+Boots a blank log until the directory is full, a record in each flight but
+the first boot's, which the next boot has to carry on, then twice more. Those boots have to carry on the last flight and it has to take
+in what's logged after them.
+*/
+static bool fill_directory(sim_w25 *flash) {
+  const uint32_t flights = FLASH_LOG_START / FLASH_LOG_DIRECTORY_ENTRY;
+  memset(flash->memory, 0xFF, SIM_W25_SIZE);
+  sim_w25_power_on(flash);
+  crash_result ignored = {0};
+  expected_record record;
+  for (uint32_t number = 1; number <= flights; number++) {
+    // the first twice, nothing logged in it the first time
+    if ((number == 1 && !boot(number, &ignored)) || !boot(number, &ignored)) {
+      printf("  flight %u didn't start\n", number);
+      return false;
+    }
+    make_record(&record);
+    append(&record);
+    flash_log_flush();
+  }
+  flash_log_flight last;
+  if (!flash_log_flight_find(flights, &last)) {
+    return false;
+  }
+  for (int i = 0; i < 2; i++) {
+    spi_flash_init();
+    open_log();
+    flash_log_flight flight;
+    if (flash_log_begin_flight() != flights || !flash_log_directory_full() ||
+        !flash_log_flight_find(0, &flight) || flight.start != last.start) {
+      printf("  the boot on a full directory didn't carry on flight %u\n",
+             flights);
+      return false;
+    }
+    make_record(&record);
+    append(&record);
+    flash_log_flush();
+    if (!flash_log_flight_find(0, &flight) || flight.end != flash_log_head()) {
+      printf("  flight %u doesn't reach the head\n", flights);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int runs = 2000;
+  uint32_t seed = 1;
+  const char *image = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+      runs = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--image") == 0 && i + 1 < argc) {
+      image = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--runs n] [--seed n] [--image file]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  sim_reset();
+  sim_w25 flash;
+  if (image != NULL) {
+    if (!sim_w25_init_file(&flash, image)) {
+      fprintf(stderr, "%s: can't map it\n", image);
+      return 1;
+    }
+  } else {
+    sim_w25_init(&flash);
+  }
+  sim_w25_attach(&flash);
+
+  random_state = seed * 2654435761u | 1;
+  bool full_ok = fill_directory(&flash);
+  crash_result result = {0};
+  int failures = 0;
+  for (int i = 0; i < runs; i++) {
+    if (!run(&flash, &result)) {
+      failures++;
+    }
+  }
+  uint32_t programs = flash.page_programs;
+  uint32_t suspends = flash.suspends;
+  uint32_t violations = flash.suspend_violations;
+  sim_w25_free(&flash);
+
+  printf("%u power cuts: %u lost, %u torn read back, %u lost after "
+         "recovery, %u boots without the next flight\n",
+         result.runs, result.lost, result.torn, result.lost_after,
+         result.bad_flights);
+  printf("not flushed at the cut: %u kept whole, %u gone, at most %u bytes "
+         "in one cut\n",
+         result.unflushed_kept, result.unflushed_lost, result.most_bytes_lost);
+  printf("%u page programs, %u erases suspended, %u suspend violations "
+         "(the suspended sector touched, or within tSUS of a resume), "
+         "longest append %.1f ms\n",
+         programs, suspends, violations, longest_append_us / 1e3);
+  printf("%d of %d runs failed\n", failures, runs);
+  printf("full directory: %s\n",
+         full_ok ? "the last flight carries on" : "failed");
+  return failures > 0 || violations > 0 || !full_ok ? 1 : 0;
+}
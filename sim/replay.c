@@ -0,0 +1,1041 @@
+/*
+ * replay.c
+ *
+ * Created: 10/19/2026
+ *
+ * End to end pipeline benchmark. Replays pressure/temperature traces through
+ * the simulated BMP388 while the real telemetry code runs against the
+ * simulated radio and flash, as fast as the host allows, and reports
+ * throughput, per stage latency and what ended up on air and on flash.
+ *
+ *   replay [--csv] [--fixed] [--no-fec] [--download] [--fsk] [--loss p]
+ *          [--window from_s to_s] [--kites n] [--lbt] [--tdma]
+ *          [--hop dwell_ms] [--format] [--flash-dir dir]
+ *          [--capture-dir dir]
+ *          [trace.csv ...]
+ *
+ * Without trace files the canonical set (pad idle, fast ascent, long soaring,
+ * landing) is replayed. --csv prints one machine readable line per trace for
+ * tracking regressions. --flash-dir saves each run's flash log as
+ * dir/<trace>.bin, for ground/log_decode, and --capture-dir the packets the
+ * ground heard as dir/<trace>.pkt, for ground/packet_decode.
+ *
+ * The kite flies out from 100 m to 2 km from the ground station and back
+ * over each trace. The ground sends link reports and the kite adapts its
+ * data rate and power (adr.h); --fixed leaves it on its starting settings for
+ * comparison. Delivered samples per mJ radiated is the figure of merit.
+ * Samples in data packets the ground put back from repair packets (fec.h)
+ * count as delivered, --no-fec has the ground turn repairs off first thing.
+ *
+ * --download has the ground ask for the whole flash log once the trace is
+ * over, with the kite back at the nearest point, and runs on until it's all
+ * down (arq.h), checking it byte for byte against the flash and by the
+ * CRC-32 the kite ends it with. --fsk does the
+ * download on the FSK bulk settings (fsk_modem.h) instead of LoRa. --loss
+ * drops that fraction of packets both ways on top of the link model.
+ * --window asks for only the flight's readings from from_s to to_s instead
+ * (UPLINK_FLIGHT_TRANSFER), which has to come down as a piece of the flash
+ * with every block that has readings in the window in it.
+ *
+ * --kites puts n - 1 more kites (fleet.h) on the same channel, and --lbt has
+ * all of them listen before talk, the replayed one by an uplink command at
+ * the start. --tdma gives each of them a TDMA_SLOT_MS slot (tdma.h) the same
+ * way instead, in a frame of one slot per kite. --hop has them all hop over
+ * hop.h's channels, a new one every packet for a dwell of 0.
+ *
+ * --format has the ground erase the log (UPLINK_FORMAT_LOG) nine tenths of
+ * the way through, which the kite only does on the ground.
+ *
+ * A ground station answers the kite's packets with a few uplink commands
+ * (a ping, a power override, clearing it again and a switch to SF8) spread
+ * over the trace, to exercise the listen windows and report how long
+ * acknowledgements take.
+ */
+
+#include "delta_codec.h"
+#include "fec.h"
+#include "fleet.h"
+#include "flash_log.h"
+#include "flight_phase.h"
+#include "ground_station.h"
+#include "profile.h"
+#include "rfm9x.h"
+#include "sim_bmp388.h"
+#include "sim_channel.h"
+#include "sim_hal.h"
+#include "sim_rfm95.h"
+#include "sim_w25.h"
+#include "systime.h"
+#include "telemetry.h"
+#include "trace.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// the RadioHead header rfm9x_send puts in front of every payload
+#define RADIO_HEADER_LENGTH 4
+
+typedef struct replay_result {
+  const char *name;
+  uint32_t steps;
+  double sim_s;
+  double wall_s;
+  double init_s;
+  profile_stats stages[PROFILE_STAGE_COUNT];
+
+  uint32_t packets;
+  uint32_t aborted;
+  uint64_t air_bytes;
+  uint64_t airtime_us;
+  double max_pressure_error_pa;
+  double max_temperature_error_c;
+  // on-board altitude filter against the altitude the sensor actually saw
+  double max_altitude_error_m;
+  double altitude_error_squares;
+
+  // compressed readings, decoded again from the packets and the flash log
+  uint32_t radio_samples;
+  uint64_t radio_sample_bytes;
+  uint32_t logged_samples;
+  uint64_t logged_sample_bytes;
+  double max_sample_error_pa;
+  uint32_t bad_blocks;
+
+  uint64_t flash_bytes;
+  uint32_t page_programs;
+  uint32_t sector_erases;
+  uint32_t erases_inline; // the log's head got to a sector before it was
+  uint32_t suspends; // of erases, for a read or page program
+  uint32_t suspend_violations; // the suspended sector, or too soon, want 0
+  uint64_t flash_busy_us;
+
+  double phase_s[PHASE_COUNT];
+  uint32_t phase_changes;
+  // the pre-trigger buffer, logged at the first take-off
+  uint32_t launch_ms; // systime, 0 if it never left the ground
+  uint32_t pretrigger_logged;
+  uint32_t prelaunch_readings; // logged in the PRELAUNCH_S before it
+  double prelaunch_error_pa; // of those, against the trace at their time
+
+  // uplink, ground station commands and what the kite's receiver made of them
+  uint32_t commands;
+  uint32_t acknowledged;
+  uint32_t command_transmissions;
+  uint64_t command_latency_us;
+  uint32_t uplink_received;
+  uint32_t uplink_missed;
+  uint64_t rx_us;
+
+  // downlink as the ground station heard it
+  uint32_t ground_heard;
+  uint32_t ground_lost;
+  uint32_t ground_mismatched;
+  uint32_t delivered_samples;
+  double radiated_mj;
+  uint32_t adr_changes;
+  uint32_t adr_fallbacks;
+
+  // forward error correction
+  uint32_t repair_packets;
+  uint32_t repairs_heard;
+  uint32_t recovered_packets;
+  uint32_t recovered_samples;
+  uint32_t bad_recoveries; // not what was sent
+
+  // the kite's airtime budget, and packets that went out over it
+  uint32_t budget_deferred;
+  uint32_t budget_violations;
+
+  // flash log download after the trace
+  bool download_done;
+  bool download_matches;
+  bool download_verified; // by the CRC-32 the kite sent with it
+  uint32_t download_bytes;
+  uint32_t download_start; // where on the flash a window download matches
+  uint32_t window_blocks; // with readings in the window
+  uint32_t window_missing; // of those, not in the download
+  uint32_t log_bytes; // up to the head
+  uint32_t fifo_underruns;
+  double download_s;
+  uint32_t segments;
+  uint32_t segment_retransmissions;
+  uint32_t segments_heard;
+  uint32_t transfer_acks;
+
+  // shared channel
+  uint32_t collisions;
+  uint32_t cad_runs;
+  uint32_t cad_busy;
+  uint32_t backoff_ms;
+  uint32_t lbt_forced;
+  uint32_t fleet_sent;
+  uint32_t fleet_heard;
+  uint32_t fleet_busy;
+  double channel_use; // of the time, on air summed over every kite
+  uint32_t beacons;
+  uint32_t beacons_heard;
+  uint32_t tdma_correction_ms; // the biggest, ours and the others'
+  uint32_t fleet_correction_ms;
+  uint32_t hops;
+  // UPLINK_FORMAT_LOG
+  uint32_t chip_erases;
+  uint32_t flight_after; // the kite's flight at the end
+  uint32_t flight_start; // and its first byte
+} replay_result;
+
+static const char *const STAGE_NAMES[PROFILE_STAGE_COUNT] = {
+    "acquire",
+    "altitude",
+    "codec",
+    "fec",
+    "crc",
+    "radio",
+    "flash",
+    "erase",
+    "uplink",
+    "pretrig",
+};
+
+static const char *const PHASE_NAMES[PHASE_COUNT] = {
+    "pad", "launch", "climbing", "steady", "descent", "landed",
+};
+
+// what the BMP388 model was asked to measure, to check packets against
+// a minute of the pre-trigger buffer's, for the readings sent on the pad
+#define CONVERSION_HISTORY 1024
+
+typedef struct conversion {
+  double pressure_pa;
+  double temperature_c;
+} conversion;
+
+static conversion conversions[CONVERSION_HISTORY];
+static uint32_t conversion_count;
+
+static const trace *current_trace;
+static replay_result *current_result;
+static sim_bmp388 bmp;
+static sim_rfm95 radio;
+static sim_w25 flash;
+// the same budget as the kite's, charged with what the radio model measured
+static airtime_budget budget_check;
+static ground_station ground;
+static bool fixed_rate;
+// the last data packets sent, to check the ones the ground puts back
+static uint8_t sent[FEC_MAX_DATA][RFM9X_MAX_PAYLOAD];
+static uint8_t sent_length[FEC_MAX_DATA];
+static bool no_fec;
+static bool download;
+static bool download_fsk;
+static bool window;
+static uint16_t window_from_s;
+static uint16_t window_to_s;
+static double extra_loss;
+static uint8_t *image; // what the ground downloaded
+static uint32_t next_segment;
+static int kites = 1;
+static bool listen_before_talk;
+static bool tdma;
+static bool hopping;
+static uint16_t hop_dwell_ms;
+static bool format_log;
+static sim_channel channel;
+static fleet others;
+static FILE *capture;
+
+static const double NEAREST_M = 100;
+static const double FARTHEST_M = 2000;
+/*
+Each kite's TDMA slot: a packet at SF7 with a good backlog of readings, the
+listen window after it and the guards
+*/
+static const int TDMA_SLOT_MS = 500;
+// how far back from the launch to count logged readings
+static const uint32_t PRELAUNCH_S = 30;
+// give up on a download after this long
+static const uint64_t DOWNLOAD_LIMIT_US = 4 * 3600 * 1000000ull;
+
+static void environment(void *context, uint64_t time_us, double *pressure_pa,
+                        double *temperature_c) {
+  trace_sample s = trace_at(context, time_us / 1e6);
+  *pressure_pa = s.pressure_pa;
+  *temperature_c = s.temperature_c;
+  conversion *c = &conversions[conversion_count++ % CONVERSION_HISTORY];
+  c->pressure_pa = s.pressure_pa;
+  c->temperature_c = s.temperature_c;
+}
+
+static double battery(void *context) {
+  return trace_at(context, sim_time_us() / 1e6).battery_v;
+}
+
+// the recent conversion closest to a pressure the firmware reported
+static const conversion *closest_conversion(double pressure_pa) {
+  const conversion *best = NULL;
+  uint32_t history = conversion_count < CONVERSION_HISTORY ? conversion_count
+                                                           : CONVERSION_HISTORY;
+  for (uint32_t i = 0; i < history; i++) {
+    if (best == NULL || fabs(conversions[i].pressure_pa - pressure_pa) <
+                            fabs(best->pressure_pa - pressure_pa)) {
+      best = &conversions[i];
+    }
+  }
+  return best;
+}
+
+/*
+Decode a delta_codec block of readings, checking each one against what the
+sensor recently saw if check is set. Returns how many there were.
+*/
+static uint32_t check_samples(const uint8_t *block, uint16_t length,
+                              bool check) {
+  delta_decoder decoder;
+  if (!delta_decoder_begin(&decoder, SAMPLE_CHANNELS, block, length)) {
+    current_result->bad_blocks++;
+    return 0;
+  }
+  int32_t values[SAMPLE_CHANNELS];
+  uint32_t count = 0;
+  while (delta_decoder_next(&decoder, values)) {
+    count++;
+    if (!check) {
+      continue;
+    }
+    double pressure = values[SAMPLE_PRESSURE] / (double)SAMPLE_PRESSURE_SCALE;
+    const conversion *c = closest_conversion(pressure);
+    double error = c != NULL ? fabs(c->pressure_pa - pressure) : INFINITY;
+    if (error > current_result->max_sample_error_pa) {
+      current_result->max_sample_error_pa = error;
+    }
+  }
+  if (count != decoder.samples) {
+    current_result->bad_blocks++;
+  }
+  return count;
+}
+
+/*
+Check what went out against the trace, this is the end to end check that the
+driver's compensation gets back what the sensor saw
+*/
+static void on_transmit(void *context, const uint8_t *data, uint8_t length,
+                        uint64_t start_us, uint64_t airtime_us) {
+  (void)context;
+  if (length < RADIO_HEADER_LENGTH) {
+    return;
+  }
+  uint8_t flags = data[3];
+  const uint8_t *payload = data + RADIO_HEADER_LENGTH;
+  uint8_t payload_length = length - RADIO_HEADER_LENGTH;
+  bool heard = ground_station_hear(&ground, payload, payload_length, flags,
+                                   start_us + airtime_us);
+  if (heard && capture != NULL) {
+    fprintf(capture, "%02x ", flags);
+    for (uint8_t i = 0; i < payload_length; i++) {
+      fprintf(capture, "%02x", payload[i]);
+    }
+    fprintf(capture, "\n");
+  }
+  double power_mw = pow(10, sim_rfm95_tx_power_dbm(&radio) / 10.0);
+  current_result->radiated_mj += power_mw * airtime_us / 1e6;
+  uint32_t start_ms = (uint32_t)(start_us / 1000);
+  // hopping, nothing stays on one channel past the dwell limit either
+  budget_check.dwell_us =
+      telemetry_hopping() != NULL ? HOP_MAX_DWELL_MS * 1000ul : 0;
+  if (airtime_us > airtime_budget_available_us(&budget_check, start_ms)) {
+    current_result->budget_violations++;
+  }
+  airtime_budget_spend(&budget_check, start_ms, (uint32_t)airtime_us);
+  if (flags & FEC_REPAIR_FLAG) {
+    current_result->repair_packets++;
+    return;
+  }
+  arq_segment segment;
+  if ((flags & ARQ_SEGMENT_FLAG) &&
+      arq_segment_parse(payload, payload_length, &segment)) {
+    // new segments always go out in order
+    current_result->segments++;
+    if (segment.sequence < next_segment) {
+      current_result->segment_retransmissions++;
+    } else {
+      next_segment = segment.sequence + 1;
+    }
+    return;
+  }
+  if (payload_length < sizeof(Datapoint)) {
+    return;
+  }
+  Datapoint datapoint;
+  memcpy(&datapoint, payload, sizeof(datapoint));
+  uint8_t slot = datapoint.packet_number % FEC_MAX_DATA;
+  memcpy(sent[slot], payload, payload_length);
+  sent_length[slot] = payload_length;
+
+  // match it up with the recent conversion it came from
+  const conversion *c = closest_conversion(datapoint.pressure);
+  if (c == NULL) {
+    return;
+  }
+  double best_pressure = fabs(c->pressure_pa - datapoint.pressure);
+  double best_temperature = fabs(c->temperature_c - datapoint.temperature);
+  double true_pressure = c->pressure_pa;
+  if (best_pressure > current_result->max_pressure_error_pa) {
+    current_result->max_pressure_error_pa = best_pressure;
+  }
+  if (best_temperature > current_result->max_temperature_error_c) {
+    current_result->max_temperature_error_c = best_temperature;
+  }
+
+  double altitude = 44330.0 * (1.0 - pow(true_pressure / 101325.0, 1 / 5.255));
+  double altitude_error = fabs(datapoint.altitude - altitude);
+  if (altitude_error > current_result->max_altitude_error_m) {
+    current_result->max_altitude_error_m = altitude_error;
+  }
+  current_result->altitude_error_squares += altitude_error * altitude_error;
+
+  // and the readings batched in after it
+  const uint8_t *block = data + RADIO_HEADER_LENGTH + sizeof(Datapoint);
+  uint16_t block_length = length - RADIO_HEADER_LENGTH - sizeof(Datapoint);
+  if (block_length > 0) {
+    uint32_t samples = check_samples(block, block_length, true);
+    current_result->radio_samples += samples;
+    if (heard) {
+      current_result->delivered_samples += samples;
+    }
+    current_result->radio_sample_bytes += block_length;
+  }
+}
+
+/*
+A data packet the ground put back from repairs, it has to be exactly what was
+sent. The readings in it are older than the conversions kept for checking.
+*/
+static void on_recovered(void *context, const uint8_t *data, uint8_t length) {
+  (void)context;
+  current_result->recovered_packets++;
+  Datapoint datapoint;
+  memcpy(&datapoint, data, sizeof(datapoint));
+  uint8_t slot = datapoint.packet_number % FEC_MAX_DATA;
+  if (length < sizeof(Datapoint) || length != sent_length[slot] ||
+      memcmp(data, sent[slot], length) != 0) {
+    current_result->bad_recoveries++;
+    return;
+  }
+  if (length > sizeof(Datapoint)) {
+    uint32_t samples = check_samples(data + sizeof(Datapoint),
+                                     length - sizeof(Datapoint), false);
+    current_result->recovered_samples += samples;
+    current_result->delivered_samples += samples;
+  }
+}
+
+static double wall_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *flash_dir;
+static const char *capture_dir;
+
+// the log up to the write head, the rest of the chip is erased anyway
+static void save_flash(const char *name) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/%s.bin", flash_dir, name);
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    perror(path);
+    return;
+  }
+  uint32_t head = flash_log_head();
+  head += (SIM_W25_PAGE_SIZE - head % SIM_W25_PAGE_SIZE) % SIM_W25_PAGE_SIZE;
+  fwrite(flash.memory, 1, head, file);
+  fclose(file);
+}
+
+// out and back again over the trace, staying close once it's over
+static double range_m(void *context, uint64_t time_us) {
+  double progress = time_us / 1e6 / trace_duration_s(context);
+  if (progress > 1) {
+    progress = 1;
+  }
+  return NEAREST_M + (FARTHEST_M - NEAREST_M) * sin(M_PI * progress);
+}
+
+// after telemetry_init, so the ground starts on the kite's modem settings
+static void queue_commands(uint64_t end_us) {
+  static const uint8_t FULL_POWER[] = {20};
+  // one step slower, both ends have to make the switch together
+  lora_modem slower = LORA_MODEM_DEFAULT;
+  slower.spreading_factor = 8;
+  uint8_t modem[LORA_MODEM_PACKED];
+  lora_modem_pack(&slower, modem);
+
+  ground_station_init(&ground, &radio);
+  ground.range_m = range_m;
+  ground.range_context = (void *)current_trace;
+  ground.adr_enabled = !fixed_rate;
+  ground.on_recovered = on_recovered;
+  ground.extra_loss = extra_loss;
+  ground.channel = kites > 1 ? &channel : NULL;
+  if (listen_before_talk) {
+    static const uint8_t ON[] = {1};
+    ground_station_queue(&ground, 0, UPLINK_SET_LBT, ON, sizeof(ON));
+  }
+  if (tdma) {
+    uint16_t frame_ms = kites * TDMA_SLOT_MS;
+    uint8_t frame[] = {kites, frame_ms & 0xff, frame_ms >> 8};
+    ground_station_queue(&ground, 0, UPLINK_SET_TDMA, frame, sizeof(frame));
+  }
+  if (hopping) {
+    uint8_t on[] = {1, hop_dwell_ms & 0xff, hop_dwell_ms >> 8};
+    ground_station_queue(&ground, 0, UPLINK_SET_HOPPING, on, sizeof(on));
+  }
+  if (no_fec) {
+    static const uint8_t NO_REPAIRS[] = {8, 0};
+    ground_station_queue(&ground, 0, UPLINK_SET_FEC, NO_REPAIRS,
+                         sizeof(NO_REPAIRS));
+  }
+  ground_station_queue(&ground, end_us / 10, UPLINK_PING, NULL, 0);
+  ground_station_queue(&ground, end_us * 3 / 10, UPLINK_SET_POWER, FULL_POWER,
+                       sizeof(FULL_POWER));
+  ground_station_queue(&ground, end_us * 6 / 10, UPLINK_CLEAR_OVERRIDES, NULL,
+                       0);
+  ground_station_queue(&ground, end_us * 8 / 10, UPLINK_SET_MODEM, modem,
+                       sizeof(modem));
+  if (format_log) {
+    // a fresh chip's first flight, refused unless the kite is on the ground
+    uint16_t key = UPLINK_FORMAT_KEY;
+    uint8_t arguments[] = {1, 0, key & 0xff, key >> 8};
+    ground_station_queue(&ground, end_us * 9 / 10, UPLINK_FORMAT_LOG,
+                         arguments, sizeof(arguments));
+  }
+  if (window) {
+    ground_station_download_flight(&ground, end_us, 0, window_from_s,
+                                   window_to_s, download_fsk, image,
+                                   SIM_W25_SIZE);
+  } else if (download) {
+    ground_station_download(&ground, end_us, 0, 0, download_fsk, image,
+                            SIM_W25_SIZE);
+  }
+}
+
+/*
+A window of the flight comes down as the flash from some page on, and has to
+have every block with a reading in the window in it
+*/
+static void check_window(replay_result *result) {
+  uint32_t length = ground.image_length;
+  result->download_matches = false;
+  for (uint32_t start = FLASH_LOG_START;
+       result->download_done && start + length <= flash_log_head();
+       start += SIM_W25_PAGE_SIZE) {
+    if (memcmp(image, flash.memory + start, length) == 0) {
+      result->download_matches = true;
+      result->download_start = start;
+      break;
+    }
+  }
+
+  uint32_t from_ms = window_from_s * 1000u;
+  uint32_t to_ms = window_to_s == 0 ? UINT32_MAX : window_to_s * 1000u;
+  uint32_t cursor = 0;
+  static flash_log_record record;
+  while (flash_log_next(&cursor, &record)) {
+    delta_decoder decoder;
+    if (record.type != FLASH_LOG_SAMPLES ||
+        !delta_decoder_begin(&decoder, SAMPLE_CHANNELS, record.data,
+                             record.length)) {
+      continue;
+    }
+    int32_t values[SAMPLE_CHANNELS];
+    bool in_window = false;
+    while (delta_decoder_next(&decoder, values)) {
+      uint32_t time_ms = values[SAMPLE_TIME_MS];
+      in_window |= time_ms >= from_ms && time_ms <= to_ms;
+    }
+    if (in_window) {
+      result->window_blocks++;
+      if (!result->download_matches ||
+          record.address < result->download_start ||
+          record.address >= result->download_start + length) {
+        result->window_missing++;
+      }
+    }
+  }
+}
+
+/*
+The logged readings from just before the launch, which only the pre-trigger
+buffer has at more than the pad's rate. Each has to be what the trace was at
+the time it was logged with, give or take the FIFO's timing.
+*/
+static void check_prelaunch(const trace *t, const flash_log_record *record,
+                            replay_result *result) {
+  delta_decoder decoder;
+  if (result->launch_ms == 0 ||
+      !delta_decoder_begin(&decoder, SAMPLE_CHANNELS, record->data,
+                           record->length)) {
+    return;
+  }
+  uint32_t from_ms = result->launch_ms > PRELAUNCH_S * 1000
+                         ? result->launch_ms - PRELAUNCH_S * 1000
+                         : 0;
+  int32_t values[SAMPLE_CHANNELS];
+  while (delta_decoder_next(&decoder, values)) {
+    uint32_t time_ms = values[SAMPLE_TIME_MS];
+    if (time_ms < from_ms || time_ms >= result->launch_ms) {
+      continue;
+    }
+    result->prelaunch_readings++;
+    // systime started with the trace, give or take telemetry_init
+    trace_sample s = trace_at(t, time_ms / 1e3);
+    double error = fabs(values[SAMPLE_PRESSURE] / (double)SAMPLE_PRESSURE_SCALE -
+                        s.pressure_pa);
+    if (error > result->prelaunch_error_pa) {
+      result->prelaunch_error_pa = error;
+    }
+  }
+}
+
+// the same loop as main, until end_us or the download is in
+static void run(replay_result *result, uint64_t end_us, bool until_downloaded) {
+  flight_phase phase = flight_phase_current();
+  while (sim_time_us() < end_us &&
+         !(until_downloaded && ground_station_download_done(&ground))) {
+    uint64_t step_start = sim_time_us();
+    telemetry_step();
+    uint32_t delay = telemetry_delay_ms();
+    if (delay > 0) {
+      delay_ms(delay > UINT16_MAX ? UINT16_MAX : delay);
+    }
+    result->steps++;
+
+    if (flight_phase_current() != phase) {
+      if (result->launch_ms == 0 &&
+          (phase == PHASE_PAD || phase == PHASE_LANDED)) {
+        result->launch_ms = systime_ms();
+      }
+      phase = flight_phase_current();
+      result->phase_changes++;
+    }
+    result->phase_s[phase] += (sim_time_us() - step_start) / 1e6;
+  }
+}
+
+static void replay(const trace *t, replay_result *result) {
+  memset(result, 0, sizeof(*result));
+  result->name = t->name;
+  current_trace = t;
+  current_result = result;
+  conversion_count = 0;
+  next_segment = 0;
+
+  sim_reset();
+  sim_bmp388_init(&bmp, environment, (void *)t);
+  sim_bmp388_attach(&bmp);
+  sim_rfm95_init(&radio);
+  radio.on_transmit = on_transmit;
+  sim_rfm95_attach(&radio);
+  if (kites > 1) {
+    sim_channel_init(&channel);
+    fleet_init(&others, &channel, kites - 1, listen_before_talk, 0);
+    if (tdma) {
+      fleet_tdma(&others, kites, kites * TDMA_SLOT_MS);
+    }
+    if (hopping) {
+      fleet_hopping(&others, hop_dwell_ms);
+    }
+    radio.channel = &channel;
+  }
+  sim_w25_init(&flash);
+  sim_w25_attach(&flash);
+  sim_adc_source(battery, (void *)t);
+  if (capture_dir != NULL) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.pkt", capture_dir, t->name);
+    capture = fopen(path, "w");
+    if (capture == NULL) {
+      perror(path);
+    }
+  }
+
+  double wall_start = wall_seconds();
+  telemetry_init();
+  result->init_s = sim_time_us() / 1e6;
+  const airtime_budget *budget = telemetry_airtime_budget();
+  airtime_budget_init(&budget_check, budget->duty_permille, budget->burst_us,
+                      budget->dwell_us, (uint32_t)(sim_time_us() / 1000));
+  profile_reset();
+
+  uint64_t end_us = (uint64_t)(trace_duration_s(t) * 1e6);
+  queue_commands(end_us);
+  run(result, end_us, false);
+  if (download) {
+    run(result, end_us + DOWNLOAD_LIMIT_US, true);
+    result->download_s = (sim_time_us() - end_us) / 1e6;
+  }
+  telemetry_shutdown(); // switched off on landing
+  // let the last packet finish
+  sim_advance_us(10000000);
+  sim_rfm95_update(&radio);
+  if (kites > 1) {
+    sim_channel_advance(&channel, sim_time_us());
+  }
+
+  result->wall_s = wall_seconds() - wall_start;
+  result->sim_s = sim_time_us() / 1e6;
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    result->stages[i] = *profile_get((profile_stage)i);
+  }
+  result->packets = radio.packets;
+  result->budget_deferred = telemetry_airtime_budget()->deferred;
+  result->aborted = radio.aborted;
+  result->air_bytes = radio.bytes;
+  result->airtime_us = radio.airtime_us;
+  result->flash_bytes = flash.bytes_programmed;
+  result->page_programs = flash.page_programs;
+  result->sector_erases = flash.sector_erases;
+  result->erases_inline = flash_log_erases()->inline_erases;
+  result->suspends = flash.suspends;
+  result->suspend_violations = flash.suspend_violations;
+  result->chip_erases = flash.chip_erases;
+  flash_log_flight flight;
+  if (flash_log_flight_find(0, &flight)) {
+    result->flight_after = flight.number;
+    result->flight_start = flight.start;
+  }
+  result->flash_busy_us = flash.busy_us;
+  result->commands = ground.commands;
+  result->acknowledged = ground.acknowledged;
+  result->command_transmissions = ground.transmissions;
+  result->command_latency_us = ground.latency_us;
+  result->ground_heard = ground.heard;
+  result->ground_lost = ground.lost;
+  result->ground_mismatched = ground.mismatched;
+  result->adr_changes = ground.adr_changes;
+  result->adr_fallbacks = ground.fallbacks;
+  result->repairs_heard = ground.repairs_heard;
+  result->download_done = ground_station_download_done(&ground);
+  result->download_bytes = ground.image_length;
+  result->download_verified = ground.image_verified;
+  result->fifo_underruns = radio.underruns;
+  // behind the head when it started, so it can't have changed since
+  result->log_bytes = flash_log_head() - FLASH_LOG_START;
+  if (window) {
+    check_window(result);
+  } else {
+    result->download_matches =
+        result->download_done && ground.image_length <= flash_log_head() &&
+        memcmp(image, flash.memory, ground.image_length) == 0;
+  }
+  result->segments_heard = ground.segments_heard;
+  result->transfer_acks = ground.transfer_acks;
+  result->collisions = ground.collisions;
+  result->cad_runs = radio.cad_runs;
+  result->cad_busy = radio.cad_detected;
+  result->backoff_ms = rfm9x_lbt()->backoff_ms;
+  result->lbt_forced = rfm9x_lbt()->forced;
+  result->fleet_sent = others.sent;
+  result->fleet_heard = others.heard;
+  result->fleet_busy = others.busy;
+  result->channel_use =
+      (radio.airtime_us + (kites > 1 ? others.airtime_us : 0)) /
+      (double)sim_time_us();
+  result->beacons = ground.beacons;
+  result->beacons_heard = telemetry_tdma()->beacons;
+  result->tdma_correction_ms = telemetry_tdma()->max_correction_ms;
+  result->fleet_correction_ms = kites > 1 ? fleet_max_correction_ms(&others) : 0;
+  result->hops = telemetry_hopping() != NULL ? telemetry_hopping()->hops : 0;
+  result->uplink_received = radio.received;
+  result->uplink_missed = radio.missed;
+  result->rx_us = radio.rx_us;
+
+  result->pretrigger_logged = telemetry_pretrigger_logged();
+
+  uint32_t cursor = 0;
+  static flash_log_record record;
+  while (flash_log_next(&cursor, &record)) {
+    if (record.type == FLASH_LOG_SAMPLES) {
+      result->logged_samples += check_samples(record.data, record.length, false);
+      result->logged_sample_bytes += record.length;
+      check_prelaunch(t, &record, result);
+    }
+  }
+  if (flash_dir != NULL) {
+    save_flash(t->name);
+  }
+  if (capture != NULL) {
+    fclose(capture);
+    capture = NULL;
+  }
+  sim_w25_free(&flash);
+}
+
+static double mean_ms(const profile_stats *s) {
+  return s->count ? s->total_us / 1000.0 / s->count : 0;
+}
+
+static double bytes_per_sample(uint64_t bytes, uint32_t samples) {
+  return samples > 0 ? (double)bytes / samples : 0;
+}
+
+static double rms_altitude_error(const replay_result *r) {
+  uint32_t data_packets = r->packets - r->repair_packets;
+  return data_packets > 0 ? sqrt(r->altitude_error_squares / data_packets) : 0;
+}
+
+static double mean_latency_s(const replay_result *r) {
+  return r->acknowledged > 0 ? r->command_latency_us / 1e6 / r->acknowledged
+                             : 0;
+}
+
+static double samples_per_mj(const replay_result *r) {
+  return r->radiated_mj > 0 ? r->delivered_samples / r->radiated_mj : 0;
+}
+
+static void print_report(const replay_result *r) {
+  printf("%s: %u steps over %.0f s simulated in %.2f s (%.0fx), init %.2f s\n",
+         r->name, r->steps, r->sim_s, r->wall_s,
+         r->wall_s > 0 ? r->sim_s / r->wall_s : 0, r->init_s);
+  printf("  %-8s %8s %10s %10s %10s\n", "stage", "count", "mean ms", "max ms",
+         "total s");
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    const profile_stats *s = &r->stages[i];
+    printf("  %-8s %8u %10.2f %10.2f %10.2f\n", STAGE_NAMES[i], s->count,
+           mean_ms(s), s->max_us / 1000.0, s->total_us / 1e6);
+  }
+  printf("  air:   %u packets, %u aborted, %llu bytes, %.1f s on air (%.2f%% "
+         "duty)\n",
+         r->packets, r->aborted, (unsigned long long)r->air_bytes,
+         r->airtime_us / 1e6, 100.0 * r->airtime_us / 1e6 / r->sim_s);
+  printf("  flash: %llu bytes, %u page programs, %u sector erases (%u while "
+         "logging, %u suspended, %u violations), %.2f s busy\n",
+         (unsigned long long)r->flash_bytes, r->page_programs,
+         r->sector_erases, r->erases_inline, r->suspends,
+         r->suspend_violations, r->flash_busy_us / 1e6);
+  printf("  throughput: %.3f samples/s, %.1f air B/s, %.1f flash B/s\n",
+         r->stages[PROFILE_ACQUIRE].count / r->sim_s, r->air_bytes / r->sim_s,
+         r->flash_bytes / r->sim_s);
+  printf("  phases (%u changes):", r->phase_changes);
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    if (r->phase_s[i] > 0) {
+      printf(" %s %.0f s", PHASE_NAMES[i], r->phase_s[i]);
+    }
+  }
+  printf("\n");
+  if (r->launch_ms > 0) {
+    printf("  pre-trigger: %u readings logged at the launch at %.1f s, %u "
+           "from the %u s before it, %.2f Pa max off the trace\n",
+           r->pretrigger_logged, r->launch_ms / 1e3, r->prelaunch_readings,
+           PRELAUNCH_S, r->prelaunch_error_pa);
+  }
+  printf("  max error: %.3f Pa, %.4f C\n", r->max_pressure_error_pa,
+         r->max_temperature_error_c);
+  printf("  altitude filter: %.2f m rms, %.2f m max\n", rms_altitude_error(r),
+         r->max_altitude_error_m);
+  printf("  codec: radio %u readings %.2f B each, log %u readings %.2f B each, "
+         "%.3f Pa max error, %u bad blocks\n",
+         r->radio_samples, bytes_per_sample(r->radio_sample_bytes, r->radio_samples),
+         r->logged_samples,
+         bytes_per_sample(r->logged_sample_bytes, r->logged_samples),
+         r->max_sample_error_pa, r->bad_blocks);
+  printf("  uplink: %u/%u commands acknowledged, %.1f s mean latency, %u sent, "
+         "%u received, %u missed, %.1f s listening\n",
+         r->acknowledged, r->commands, mean_latency_s(r),
+         r->command_transmissions, r->uplink_received, r->uplink_missed,
+         r->rx_us / 1e6);
+  printf("  link: %u heard, %u lost, %u on other settings, %u adr changes, "
+         "%u fallbacks, %u samples delivered, %.0f mJ radiated (%.2f "
+         "samples/mJ)\n",
+         r->ground_heard, r->ground_lost, r->ground_mismatched, r->adr_changes,
+         r->adr_fallbacks, r->delivered_samples, r->radiated_mj,
+         samples_per_mj(r));
+  printf("  fec: %u repair packets, %u heard, %u data packets recovered with "
+         "%u samples, %u wrong\n",
+         r->repair_packets, r->repairs_heard, r->recovered_packets,
+         r->recovered_samples, r->bad_recoveries);
+  printf("  airtime budget: %u packets deferred, %u over budget\n",
+         r->budget_deferred, r->budget_violations);
+  if (kites > 1 || listen_before_talk) {
+    uint32_t sent = r->packets + r->fleet_sent;
+    printf("  channel: %d kites, %.1f%% of the time on air, %u of ours "
+           "collided, others %u/%u heard, %.3f goodput, %u/%u CAD busy "
+           "(others %u), %.1f s backed off, %u sent anyway\n",
+           kites, 100 * r->channel_use, r->collisions, r->fleet_heard,
+           r->fleet_sent,
+           sent > 0 ? (r->ground_heard + r->fleet_heard) / (double)sent : 0,
+           r->cad_busy, r->cad_runs, r->fleet_busy, r->backoff_ms / 1e3,
+           r->lbt_forced);
+  }
+  if (tdma) {
+    printf("  tdma: %d slots of %d ms, %u/%u beacons heard, biggest "
+           "correction %u ms (others %u ms)\n",
+           kites, TDMA_SLOT_MS, r->beacons_heard, r->beacons,
+           r->tdma_correction_ms, r->fleet_correction_ms);
+  }
+  if (hopping) {
+    printf("  hop: %u hops\n", r->hops);
+  }
+  if (format_log) {
+    printf("  format: %s, flight %u from %u, %u bytes logged\n",
+           r->chip_erases > 0 ? "done" : "not done", r->flight_after,
+           r->flight_start, r->log_bytes);
+  }
+  if (download) {
+    printf("  download%s: %u bytes in %.0f s (%.0f B/s), %u segments sent with "
+           "%u retransmissions, %u heard, %u acks, %u FIFO underruns, %s, "
+           "CRC-32 %s\n",
+           download_fsk ? " on FSK" : "", r->download_bytes, r->download_s,
+           r->download_s > 0 ? r->download_bytes / r->download_s : 0,
+           r->segments, r->segment_retransmissions, r->segments_heard,
+           r->transfer_acks, r->fifo_underruns,
+           !r->download_done      ? "incomplete"
+           : r->download_matches  ? "matches the flash"
+                                  : "DOES NOT MATCH the flash",
+           r->download_verified ? "good" : "BAD");
+  }
+  if (window) {
+    printf("  window %u-%u s: %u blocks with readings in it, %u missing, "
+           "from page %u, %.1f%% of the log\n",
+           window_from_s, window_to_s, r->window_blocks, r->window_missing,
+           r->download_start / SIM_W25_PAGE_SIZE,
+           r->log_bytes > 0 ? 100.0 * r->download_bytes / r->log_bytes : 0);
+  }
+  printf("\n");
+}
+
+static void print_csv_header(void) {
+  printf("trace,steps,sim_s,wall_s");
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    printf(",%s_mean_ms,%s_max_ms", STAGE_NAMES[i], STAGE_NAMES[i]);
+  }
+  printf(",packets,aborted,air_bytes,airtime_s,flash_bytes,page_programs,"
+         "sector_erases,max_pressure_error_pa,altitude_rms_m,altitude_max_m,"
+         "radio_bytes_per_sample,log_bytes_per_sample,bad_blocks,"
+         "commands_acknowledged,command_latency_s,uplink_missed,rx_s,"
+         "ground_heard,ground_lost,adr_changes,delivered_samples,radiated_mj,"
+         "samples_per_mj,budget_deferred,budget_violations,repair_packets,"
+         "recovered_packets,download_bytes,download_s,"
+         "segment_retransmissions,download_matches,collisions,fleet_sent,"
+         "fleet_heard,cad_busy\n");
+}
+
+static void print_csv(const replay_result *r) {
+  printf("%s,%u,%.3f,%.3f", r->name, r->steps, r->sim_s, r->wall_s);
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    printf(",%.3f,%.3f", mean_ms(&r->stages[i]), r->stages[i].max_us / 1000.0);
+  }
+  printf(",%u,%u,%llu,%.3f,%llu,%u,%u,%.3f,%.3f,%.3f", r->packets,
+         r->aborted, (unsigned long long)r->air_bytes, r->airtime_us / 1e6,
+         (unsigned long long)r->flash_bytes, r->page_programs,
+         r->sector_erases, r->max_pressure_error_pa, rms_altitude_error(r),
+         r->max_altitude_error_m);
+  printf(",%.3f,%.3f,%u,%u,%.3f,%u,%.3f",
+         bytes_per_sample(r->radio_sample_bytes, r->radio_samples),
+         bytes_per_sample(r->logged_sample_bytes, r->logged_samples),
+         r->bad_blocks, r->acknowledged, mean_latency_s(r), r->uplink_missed,
+         r->rx_us / 1e6);
+  printf(",%u,%u,%u,%u,%.1f,%.3f,%u,%u,%u,%u", r->ground_heard,
+         r->ground_lost, r->adr_changes, r->delivered_samples, r->radiated_mj,
+         samples_per_mj(r), r->budget_deferred, r->budget_violations,
+         r->repair_packets, r->recovered_packets);
+  printf(",%u,%.1f,%u,%d", r->download_bytes, r->download_s,
+         r->segment_retransmissions, r->download_matches);
+  printf(",%u,%u,%u,%u\n", r->collisions, r->fleet_sent, r->fleet_heard,
+         r->cad_busy);
+}
+
+int main(int argc, char **argv) {
+  bool csv = false;
+  int first_file = 1;
+  while (first_file < argc && strncmp(argv[first_file], "--", 2) == 0) {
+    if (strcmp(argv[first_file], "--csv") == 0) {
+      csv = true;
+    } else if (strcmp(argv[first_file], "--fixed") == 0) {
+      fixed_rate = true;
+    } else if (strcmp(argv[first_file], "--no-fec") == 0) {
+      no_fec = true;
+    } else if (strcmp(argv[first_file], "--download") == 0) {
+      download = true;
+    } else if (strcmp(argv[first_file], "--fsk") == 0) {
+      download = true;
+      download_fsk = true;
+    } else if (strcmp(argv[first_file], "--window") == 0 &&
+               first_file + 2 < argc) {
+      download = true;
+      window = true;
+      window_from_s = atoi(argv[++first_file]);
+      window_to_s = atoi(argv[++first_file]);
+    } else if (strcmp(argv[first_file], "--kites") == 0 &&
+               first_file + 1 < argc) {
+      kites = atoi(argv[++first_file]);
+      if (kites < 1 || kites > FLEET_MAX_KITES + 1) {
+        fprintf(stderr, "--kites: 1 to %d\n", FLEET_MAX_KITES + 1);
+        return 2;
+      }
+    } else if (strcmp(argv[first_file], "--lbt") == 0) {
+      listen_before_talk = true;
+    } else if (strcmp(argv[first_file], "--tdma") == 0) {
+      tdma = true;
+    } else if (strcmp(argv[first_file], "--hop") == 0 &&
+               first_file + 1 < argc) {
+      hopping = true;
+      hop_dwell_ms = atoi(argv[++first_file]);
+    } else if (strcmp(argv[first_file], "--loss") == 0 &&
+               first_file + 1 < argc) {
+      extra_loss = atof(argv[++first_file]);
+    } else if (strcmp(argv[first_file], "--format") == 0) {
+      format_log = true;
+    } else if (strcmp(argv[first_file], "--flash-dir") == 0 &&
+               first_file + 1 < argc) {
+      flash_dir = argv[++first_file];
+    } else if (strcmp(argv[first_file], "--capture-dir") == 0 &&
+               first_file + 1 < argc) {
+      capture_dir = argv[++first_file];
+    } else {
+      fprintf(stderr,
+              "usage: %s [--csv] [--fixed] [--no-fec] [--download] [--fsk] "
+              "[--loss p] [--window from_s to_s] [--kites n] [--lbt] "
+              "[--tdma] [--hop dwell_ms] [--format] "
+              "[--flash-dir dir] [--capture-dir dir] "
+              "[trace.csv ...]\n",
+              argv[0]);
+      return 2;
+    }
+    first_file++;
+  }
+
+  if (download) {
+    image = malloc(SIM_W25_SIZE);
+  }
+  if (csv) {
+    print_csv_header();
+  }
+
+  int files = argc - first_file;
+  int runs = files > 0 ? files : TRACE_KIND_COUNT;
+  for (int i = 0; i < runs; i++) {
+    trace t;
+    if (files > 0) {
+      if (trace_load_csv(&t, argv[first_file + i]) != 0) {
+        fprintf(stderr, "%s: can't load trace\n", argv[first_file + i]);
+        return 1;
+      }
+    } else {
+      trace_synthetic(&t, (trace_kind)i);
+    }
+
+    replay_result result;
+    replay(&t, &result);
+    if (csv) {
+      print_csv(&result);
+    } else {
+      print_report(&result);
+    }
+    trace_free(&t);
+  }
+  return 0;
+}
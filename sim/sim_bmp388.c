@@ -0,0 +1,499 @@
+/*
+ * sim_bmp388.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "sim_bmp388.h"
+#include <math.h>
+#include <string.h>
+
+enum {
+  REG_CHIP_ID = 0x00,
+  REG_ERR = 0x02,
+  REG_STATUS = 0x03,
+  REG_DATA = 0x04,
+  REG_SENSORTIME = 0x0C,
+  REG_EVENT = 0x10,
+  REG_INT_STATUS = 0x11,
+  REG_FIFO_LENGTH = 0x12,
+  REG_FIFO_DATA = 0x14,
+  REG_FIFO_WTM = 0x15,
+  REG_FIFO_CONFIG_1 = 0x17,
+  REG_FIFO_CONFIG_2 = 0x18,
+  REG_PWR_CTRL = 0x1B,
+  REG_OSR = 0x1C,
+  REG_ODR = 0x1D,
+  REG_CALIBRATION = 0x31,
+  REG_CMD = 0x7E,
+};
+
+static const uint8_t CHIP_ID = 0x50;
+static const uint8_t ERR_CONF = 0x04;
+static const uint8_t STATUS_CMD_RDY = 0x10;
+static const uint8_t STATUS_DRDY_PRESS = 0x20;
+static const uint8_t STATUS_DRDY_TEMP = 0x40;
+static const uint8_t EVENT_POR_DETECTED = 0x01;
+static const uint8_t INT_FIFO_WATERMARK = 0x01;
+static const uint8_t INT_FIFO_FULL = 0x02;
+static const uint8_t INT_DRDY = 0x08;
+static const uint8_t FIFO_MODE = 0x01;
+static const uint8_t FIFO_STOP_ON_FULL = 0x02;
+static const uint8_t FIFO_TIME_EN = 0x04;
+static const uint8_t FIFO_PRESS_EN = 0x08;
+static const uint8_t FIFO_TEMP_EN = 0x10;
+static const uint8_t FRAME_SENSOR = 0x80; // and empty, with nothing in it
+static const uint8_t FRAME_TEMPERATURE = 0x10;
+static const uint8_t FRAME_PRESSURE = 0x04;
+static const uint8_t FRAME_SENSORTIME = 0xA0;
+static const uint8_t FRAME_CONFIG_CHANGE = 0x48;
+static const uint8_t FRAME_CONFIG_ERROR = 0x44;
+static const uint8_t CMD_FIFO_FLUSH = 0xB0;
+static const uint8_t CMD_SOFTRESET = 0xB6;
+static const uint64_t ODR_BASE_US = 5000;
+
+/*
+Calibration of a typical part, little endian as laid out from 0x31: T1 T2 T3
+P1 P2 P3 P4 P5 P6 P7 P8 P9 P10 P11
+*/
+static const uint8_t DEFAULT_NVM[SIM_BMP388_NVM_LENGTH] = {
+    0x98, 0x6B, // par_t1  27544
+    0x40, 0x4A, // par_t2  19008
+    0xF9,       // par_t3  -7
+    0x7A, 0xFB, // par_p1  -1158
+    0x2F, 0xF5, // par_p2  -2769
+    0x23,       // par_p3  35
+    0x01,       // par_p4  1
+    0xB8, 0x5E, // par_p5  24248
+    0x5E, 0x76, // par_p6  30302
+    0x03,       // par_p7  3
+    0xF4,       // par_p8  -12
+    0x4E, 0x40, // par_p9  16462
+    0x0A,       // par_p10 10
+    0xEB,       // par_p11 -21
+};
+
+typedef struct calibration {
+  double t1, t2, t3;
+  double p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11;
+} calibration;
+
+static uint16_t u16(const uint8_t *nvm, int i) {
+  return (uint16_t)(nvm[i] | nvm[i + 1] << 8);
+}
+
+// BMP388 datasheet section 9.1
+static void load_calibration(const uint8_t *nvm, calibration *c) {
+  c->t1 = u16(nvm, 0) * 256.0;
+  c->t2 = u16(nvm, 2) / 1073741824.0;
+  c->t3 = (int8_t)nvm[4] / 281474976710656.0;
+  c->p1 = ((int16_t)u16(nvm, 5) - 16384) / 1048576.0;
+  c->p2 = ((int16_t)u16(nvm, 7) - 16384) / 536870912.0;
+  c->p3 = (int8_t)nvm[9] / 4294967296.0;
+  c->p4 = (int8_t)nvm[10] / 137438953472.0;
+  c->p5 = u16(nvm, 11) * 8.0;
+  c->p6 = u16(nvm, 13) / 64.0;
+  c->p7 = (int8_t)nvm[15] / 256.0;
+  c->p8 = (int8_t)nvm[16] / 32768.0;
+  c->p9 = (int16_t)u16(nvm, 17) / 281474976710656.0;
+  c->p10 = (int8_t)nvm[19] / 281474976710656.0;
+  c->p11 = (int8_t)nvm[20] / 36893488147419103232.0;
+}
+
+// BMP388 datasheet section 9.2
+static double compensate_temperature(const calibration *c, double raw) {
+  double d1 = raw - c->t1;
+  return d1 * c->t2 + d1 * d1 * c->t3;
+}
+
+// BMP388 datasheet section 9.3
+static double compensate_pressure(const calibration *c, double raw,
+                                  double t_lin) {
+  double t2 = t_lin * t_lin;
+  double t3 = t2 * t_lin;
+  double out1 = c->p5 + c->p6 * t_lin + c->p7 * t2 + c->p8 * t3;
+  double out2 = raw * (c->p1 + c->p2 * t_lin + c->p3 * t2 + c->p4 * t3);
+  double r2 = raw * raw;
+  double out3 = r2 * (c->p9 + c->p10 * t_lin) + r2 * raw * c->p11;
+  return out1 + out2 + out3;
+}
+
+static uint32_t clamp_raw(double raw) {
+  if (raw < 0) {
+    return 0;
+  }
+  if (raw > 0xFFFFFF) {
+    return 0xFFFFFF;
+  }
+  return (uint32_t)lround(raw);
+}
+
+/*
+Newton's method on the compensation polynomial, it is smooth and nearly
+linear over the sensor range so a handful of iterations is plenty
+*/
+static uint32_t invert(double (*f)(const calibration *, double, double),
+                       const calibration *c, double parameter, double target,
+                       double guess) {
+  double raw = guess;
+  for (int i = 0; i < 20; i++) {
+    double value = f(c, raw, parameter) - target;
+    double slope = (f(c, raw + 1, parameter) - f(c, raw - 1, parameter)) / 2;
+    if (slope == 0) {
+      break;
+    }
+    double step = value / slope;
+    raw -= step;
+    if (fabs(step) < 0.01) {
+      break;
+    }
+  }
+  return clamp_raw(raw);
+}
+
+static double temperature_at(const calibration *c, double raw, double unused) {
+  (void)unused;
+  return compensate_temperature(c, raw);
+}
+
+void sim_bmp388_compensate(const sim_bmp388 *bmp, uint32_t raw_pressure,
+                           uint32_t raw_temperature, double *pressure_pa,
+                           double *temperature_c) {
+  calibration c;
+  load_calibration(bmp->nvm, &c);
+  *temperature_c = compensate_temperature(&c, raw_temperature);
+  *pressure_pa = compensate_pressure(&c, raw_pressure, *temperature_c);
+}
+
+void sim_bmp388_raw(const sim_bmp388 *bmp, double pressure_pa,
+                    double temperature_c, uint32_t *raw_pressure,
+                    uint32_t *raw_temperature) {
+  calibration c;
+  load_calibration(bmp->nvm, &c);
+  *raw_temperature = invert(temperature_at, &c, 0, temperature_c,
+                            c.t1 + temperature_c / c.t2);
+  // the driver compensates pressure with the temperature it just computed
+  double t_lin = compensate_temperature(&c, *raw_temperature);
+  *raw_pressure =
+      invert(compensate_pressure, &c, t_lin, pressure_pa, 1 << 23);
+}
+
+/*
+Datasheet section 3.9.2, with OSR given as the register exponent
+*/
+static uint64_t conversion_time_us(uint8_t osr, bool pressure,
+                                   bool temperature) {
+  uint64_t t = 234;
+  if (pressure) {
+    t += 392 + (2020u << (osr & 0x07));
+  }
+  if (temperature) {
+    t += 163 + (2020u << ((osr >> 3) & 0x07));
+  }
+  return t;
+}
+
+static void reset_registers(sim_bmp388 *bmp) {
+  memset(bmp->regs, 0, sizeof(bmp->regs));
+  bmp->regs[REG_CHIP_ID] = CHIP_ID;
+  bmp->regs[REG_STATUS] = STATUS_CMD_RDY;
+  bmp->regs[REG_EVENT] = EVENT_POR_DETECTED;
+  bmp->regs[REG_FIFO_WTM] = 0x01;
+  bmp->regs[REG_FIFO_CONFIG_1] = FIFO_STOP_ON_FULL;
+  bmp->regs[REG_FIFO_CONFIG_2] = 0x02;
+  bmp->regs[REG_OSR] = 0x02;
+  memcpy(&bmp->regs[REG_CALIBRATION], bmp->nvm, SIM_BMP388_NVM_LENGTH);
+  bmp->converting = false;
+  bmp->period_us = 0;
+  bmp->fifo_length = 0;
+  bmp->subsampled = 0;
+}
+
+// header and payload length of the frame starting at fifo[at]
+static uint8_t frame_length(const sim_bmp388 *bmp, uint16_t at) {
+  uint8_t header = bmp->fifo[at];
+  if (header == FRAME_CONFIG_CHANGE || header == FRAME_CONFIG_ERROR) {
+    return 2;
+  }
+  return 1 + ((header & FRAME_TEMPERATURE) ? 3 : 0) +
+         ((header & FRAME_PRESSURE) ? 3 : 0);
+}
+
+static void put_24(uint8_t *out, uint32_t value) {
+  out[0] = value & 0xFF;
+  out[1] = (value >> 8) & 0xFF;
+  out[2] = (value >> 16) & 0xFF;
+}
+
+static void push_frame(sim_bmp388 *bmp, const uint8_t *frame, uint8_t length) {
+  uint16_t watermark =
+      (bmp->regs[REG_FIFO_WTM + 1] & 0x01) << 8 | bmp->regs[REG_FIFO_WTM];
+  if (bmp->fifo_length + length > SIM_BMP388_FIFO_LENGTH) {
+    if (bmp->regs[REG_FIFO_CONFIG_1] & FIFO_STOP_ON_FULL) {
+      bmp->fifo_dropped++;
+      return;
+    }
+    // the oldest frames make room
+    uint16_t room = 0;
+    while (bmp->fifo_length - room + length > SIM_BMP388_FIFO_LENGTH) {
+      room += frame_length(bmp, room);
+      bmp->fifo_dropped++;
+    }
+    bmp->fifo_length -= room;
+    memmove(bmp->fifo, bmp->fifo + room, bmp->fifo_length);
+  }
+  memcpy(bmp->fifo + bmp->fifo_length, frame, length);
+  bmp->fifo_length += length;
+  bmp->time_frame_read = 0;
+  bmp->fifo_frames++;
+  if (bmp->fifo_length + length > SIM_BMP388_FIFO_LENGTH) {
+    bmp->regs[REG_INT_STATUS] |= INT_FIFO_FULL;
+  }
+  if (watermark > 0 && bmp->fifo_length >= watermark) {
+    bmp->regs[REG_INT_STATUS] |= INT_FIFO_WATERMARK;
+  }
+}
+
+static void queue(sim_bmp388 *bmp, uint32_t raw_pressure,
+                  uint32_t raw_temperature) {
+  uint8_t config = bmp->regs[REG_FIFO_CONFIG_1];
+  uint8_t pwr_ctrl = bmp->regs[REG_PWR_CTRL];
+  if (!(config & FIFO_MODE)) {
+    return;
+  }
+  uint8_t every = 1 << (bmp->regs[REG_FIFO_CONFIG_2] & 0x07);
+  if (++bmp->subsampled < every) {
+    return;
+  }
+  bmp->subsampled = 0;
+  uint8_t frame[7] = {FRAME_SENSOR};
+  uint8_t length = 1;
+  if ((config & FIFO_TEMP_EN) && (pwr_ctrl & 0x02)) {
+    frame[0] |= FRAME_TEMPERATURE;
+    put_24(frame + length, raw_temperature);
+    length += 3;
+  }
+  if ((config & FIFO_PRESS_EN) && (pwr_ctrl & 0x01)) {
+    frame[0] |= FRAME_PRESSURE;
+    put_24(frame + length, raw_pressure);
+    length += 3;
+  }
+  if (length > 1) {
+    push_frame(bmp, frame, length);
+  }
+}
+
+static uint32_t sensortime(void) {
+  // 25.6 kHz, 24 bits
+  return (uint32_t)(sim_time_us() * 16 / 625) & 0xFFFFFF;
+}
+
+static void finish_conversion(sim_bmp388 *bmp) {
+  uint8_t pwr_ctrl = bmp->regs[REG_PWR_CTRL];
+  double pressure = 101325;
+  double temperature = 20;
+  if (bmp->environment != NULL) {
+    // sample the environment half way through the measurement
+    uint64_t middle = (bmp->conversion_start_us + bmp->conversion_end_us) / 2;
+    bmp->environment(bmp->environment_context, middle, &pressure,
+                     &temperature);
+  }
+  uint32_t raw_pressure;
+  uint32_t raw_temperature;
+  sim_bmp388_raw(bmp, pressure, temperature, &raw_pressure, &raw_temperature);
+
+  uint8_t status = bmp->regs[REG_STATUS];
+  if (pwr_ctrl & 0x01) {
+    put_24(&bmp->regs[REG_DATA], raw_pressure);
+    status |= STATUS_DRDY_PRESS;
+  }
+  if (pwr_ctrl & 0x02) {
+    put_24(&bmp->regs[REG_DATA + 3], raw_temperature);
+    status |= STATUS_DRDY_TEMP;
+  }
+  bmp->regs[REG_STATUS] = status;
+  bmp->regs[REG_INT_STATUS] |= INT_DRDY;
+  queue(bmp, raw_pressure, raw_temperature);
+  bmp->conversions++;
+
+  if (bmp->period_us > 0) {
+    // normal mode, on to the next one
+    uint64_t length = bmp->conversion_end_us - bmp->conversion_start_us;
+    bmp->conversion_start_us += bmp->period_us;
+    bmp->conversion_end_us = bmp->conversion_start_us + length;
+    return;
+  }
+  // forced mode drops back to sleep once done
+  bmp->regs[REG_PWR_CTRL] = pwr_ctrl & ~0x30;
+  bmp->converting = false;
+}
+
+static void update(sim_bmp388 *bmp) {
+  while (bmp->converting && sim_time_us() >= bmp->conversion_end_us) {
+    finish_conversion(bmp);
+  }
+}
+
+static void set_power(sim_bmp388 *bmp, uint8_t value) {
+  bmp->regs[REG_PWR_CTRL] = value & 0x33;
+  uint8_t mode = (value >> 4) & 0x03;
+  bool pressure = value & 0x01;
+  bool temperature = value & 0x02;
+  bmp->converting = false;
+  bmp->period_us = 0;
+  if (mode == 0 || !(pressure || temperature)) {
+    return;
+  }
+  uint64_t time =
+      conversion_time_us(bmp->regs[REG_OSR], pressure, temperature);
+  if (mode == 3) {
+    uint64_t period = ODR_BASE_US << (bmp->regs[REG_ODR] & 0x1F);
+    if (time > period) {
+      // OSR too high for ODR, it stays asleep
+      bmp->regs[REG_ERR] |= ERR_CONF;
+      bmp->regs[REG_PWR_CTRL] &= ~0x30;
+      bmp->config_errors++;
+      return;
+    }
+    bmp->period_us = period;
+  }
+  bmp->converting = true;
+  bmp->conversion_start_us = sim_time_us();
+  bmp->conversion_end_us = sim_time_us() + time;
+}
+
+static uint8_t read_fifo(sim_bmp388 *bmp) {
+  if (bmp->fifo_length > 0) {
+    uint8_t value = bmp->fifo[0];
+    memmove(bmp->fifo, bmp->fifo + 1, --bmp->fifo_length);
+    return value;
+  }
+  if ((bmp->regs[REG_FIFO_CONFIG_1] & FIFO_TIME_EN) &&
+      bmp->time_frame_read < sizeof(bmp->time_frame)) {
+    if (bmp->time_frame_read == 0) {
+      bmp->time_frame[0] = FRAME_SENSORTIME;
+      put_24(bmp->time_frame + 1, sensortime());
+    }
+    return bmp->time_frame[bmp->time_frame_read++];
+  }
+  return FRAME_SENSOR;
+}
+
+static uint8_t read_register(sim_bmp388 *bmp, uint8_t address) {
+  uint8_t value = bmp->regs[address];
+  switch (address) {
+  case REG_DATA:
+  case REG_DATA + 1:
+  case REG_DATA + 2:
+    bmp->regs[REG_STATUS] &= ~STATUS_DRDY_PRESS;
+    break;
+  case REG_DATA + 3:
+  case REG_DATA + 4:
+  case REG_DATA + 5:
+    bmp->regs[REG_STATUS] &= ~STATUS_DRDY_TEMP;
+    break;
+  case REG_SENSORTIME:
+  case REG_SENSORTIME + 1:
+  case REG_SENSORTIME + 2:
+    value = sensortime() >> (8 * (address - REG_SENSORTIME));
+    break;
+  case REG_ERR:
+  case REG_EVENT:
+  case REG_INT_STATUS:
+    bmp->regs[address] = 0; // cleared on read
+    break;
+  case REG_FIFO_LENGTH:
+    value = bmp->fifo_length & 0xFF;
+    break;
+  case REG_FIFO_LENGTH + 1:
+    value = bmp->fifo_length >> 8;
+    break;
+  case REG_FIFO_DATA:
+    value = read_fifo(bmp);
+    break;
+  }
+  return value;
+}
+
+static void write_register(sim_bmp388 *bmp, uint8_t address, uint8_t value) {
+  switch (address) {
+  case REG_CMD:
+    if (value == CMD_SOFTRESET) {
+      reset_registers(bmp);
+    } else if (value == CMD_FIFO_FLUSH) {
+      bmp->fifo_length = 0;
+      bmp->time_frame_read = 0;
+    }
+    break;
+  case REG_PWR_CTRL:
+    set_power(bmp, value);
+    break;
+  case REG_CHIP_ID:
+  case REG_ERR:
+  case REG_STATUS:
+  case REG_SENSORTIME:
+  case REG_SENSORTIME + 1:
+  case REG_SENSORTIME + 2:
+  case REG_EVENT:
+  case REG_INT_STATUS:
+  case REG_FIFO_LENGTH:
+  case REG_FIFO_LENGTH + 1:
+  case REG_FIFO_DATA:
+    break; // read only
+  default:
+    if (address < REG_CALIBRATION || address > 0x57) {
+      bmp->regs[address] = value;
+    }
+    break;
+  }
+}
+
+static void on_select(void *context) {
+  sim_bmp388 *bmp = context;
+  update(bmp);
+  bmp->byte_index = 0;
+}
+
+static uint8_t on_exchange(void *context, uint8_t mosi) {
+  sim_bmp388 *bmp = context;
+  uint8_t miso = 0xFF;
+  int index = bmp->byte_index++;
+  if (index == 0) {
+    bmp->read = mosi & 0x80;
+    bmp->address = mosi & 0x7F;
+  } else if (bmp->read) {
+    // one dummy byte, then auto incrementing reads, bar the FIFO's
+    if (index >= 2) {
+      miso = read_register(bmp, bmp->address);
+      if (bmp->address != REG_FIFO_DATA) {
+        bmp->address = (bmp->address + 1) & 0x7F;
+      }
+    }
+  } else if (index % 2 == 1) {
+    write_register(bmp, bmp->address, mosi);
+  } else {
+    // burst writes alternate address and data
+    bmp->address = mosi & 0x7F;
+  }
+  return miso;
+}
+
+void sim_bmp388_init(sim_bmp388 *bmp, sim_bmp388_environment environment,
+                     void *context) {
+  memset(bmp, 0, sizeof(*bmp));
+  memcpy(bmp->nvm, DEFAULT_NVM, sizeof(DEFAULT_NVM));
+  bmp->environment = environment;
+  bmp->environment_context = context;
+  reset_registers(bmp);
+}
+
+void sim_bmp388_set_nvm(sim_bmp388 *bmp,
+                        const uint8_t nvm[SIM_BMP388_NVM_LENGTH]) {
+  memcpy(bmp->nvm, nvm, SIM_BMP388_NVM_LENGTH);
+  memcpy(&bmp->regs[REG_CALIBRATION], nvm, SIM_BMP388_NVM_LENGTH);
+}
+
+void sim_bmp388_attach(sim_bmp388 *bmp) {
+  sim_spi_device device = {bmp, on_select, on_exchange, NULL};
+  sim_spi_attach(&SPI_2, BMP388_CS, &device);
+}
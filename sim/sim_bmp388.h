@@ -0,0 +1,88 @@
+/*
+ * sim_bmp388.h
+ *
+ * Created: 10/19/2026
+ *
+ * BMP388 on the simulated SPI_2. Raw ADC values are generated from the
+ * environment callback by inverting the datasheet compensation formulas
+ * with the model's own calibration NVM, so bmp388.c has to compensate
+ * correctly to get the environment back. sim_bmp388_set_nvm swaps in
+ * another part's calibration.
+ *
+ * Forced mode converts once and drops back to sleep, normal mode converts
+ * every 5 ms << ODR and flags a configuration error in ERR_REG instead if
+ * the conversion time for OSR doesn't fit. Either takes the datasheet's
+ * conversion time for OSR, sampling the environment half way through.
+ *
+ * With FIFO_CONFIG_1 enabling it, each conversion (every 2^subsampling in
+ * FIFO_CONFIG_2) is queued in the 512 byte FIFO as a frame: header 0x94,
+ * 0x90 or 0x84 for what's in it, the temperature, then the pressure.
+ * When full, new frames are dropped with fifo_stop_on_full, otherwise the
+ * oldest make room, counted in fifo_dropped either way. Reading FIFO_DATA
+ * past the end gives a sensor time frame (0xA0) if enabled, then 0x80.
+ * FIFO_LENGTH, the watermark and full flags in INT_STATUS (cleared on read),
+ * SENSORTIME and the fifo_flush command work as on the part.
+ */
+
+#ifndef SIM_BMP388_H_
+#define SIM_BMP388_H_
+
+#include "sim_hal.h"
+
+#define SIM_BMP388_NVM_LENGTH 21
+#define SIM_BMP388_FIFO_LENGTH 512
+
+typedef void (*sim_bmp388_environment)(void *context, uint64_t time_us,
+                                       double *pressure_pa,
+                                       double *temperature_c);
+
+typedef struct sim_bmp388 {
+  uint8_t regs[128];
+  uint8_t nvm[SIM_BMP388_NVM_LENGTH];
+
+  sim_bmp388_environment environment;
+  void *environment_context;
+
+  bool converting;
+  uint64_t conversion_start_us;
+  uint64_t conversion_end_us;
+  uint64_t period_us; // in normal mode, 0 in forced
+
+  uint8_t fifo[SIM_BMP388_FIFO_LENGTH];
+  uint16_t fifo_length;
+  uint8_t subsampled; // conversions since the last one queued
+  uint8_t time_frame_read; // bytes of the sensor time frame read so far
+  uint8_t time_frame[4];
+
+  // SPI transaction state
+  int byte_index;
+  uint8_t address;
+  bool read;
+
+  uint32_t conversions;
+  uint32_t fifo_frames;
+  uint32_t fifo_dropped;
+  uint32_t config_errors;
+} sim_bmp388;
+
+void sim_bmp388_init(sim_bmp388 *bmp, sim_bmp388_environment environment,
+                     void *context);
+// attach to SPI_2 / BMP388_CS
+void sim_bmp388_attach(sim_bmp388 *bmp);
+// another part's calibration NVM, as read from 0x31 from then on
+void sim_bmp388_set_nvm(sim_bmp388 *bmp,
+                        const uint8_t nvm[SIM_BMP388_NVM_LENGTH]);
+
+/*
+Raw 24 bit ADC values the chip would report for the given conditions, using
+the loaded calibration
+*/
+void sim_bmp388_raw(const sim_bmp388 *bmp, double pressure_pa,
+                    double temperature_c, uint32_t *raw_pressure,
+                    uint32_t *raw_temperature);
+// and back again, the datasheet's floating point compensation
+void sim_bmp388_compensate(const sim_bmp388 *bmp, uint32_t raw_pressure,
+                           uint32_t raw_temperature, double *pressure_pa,
+                           double *temperature_c);
+
+#endif /* SIM_BMP388_H_ */
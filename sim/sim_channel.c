@@ -0,0 +1,84 @@
+/*
+ * sim_channel.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "sim_channel.h"
+#include <string.h>
+
+void sim_channel_init(sim_channel *channel) {
+  memset(channel, 0, sizeof(*channel));
+  for (int from = 0; from < SIM_CHANNEL_RADIOS; from++) {
+    for (int to = 0; to < SIM_CHANNEL_RADIOS; to++) {
+      channel->links[from][to].path_loss_db = 100;
+    }
+  }
+  channel->random = 0x9e3779b9;
+}
+
+void sim_channel_link(sim_channel *channel, uint8_t a, uint8_t b,
+                      int16_t path_loss_db, double loss) {
+  sim_link link = {path_loss_db, loss};
+  channel->links[a][b] = link;
+  channel->links[b][a] = link;
+}
+
+bool sim_channel_carries(sim_channel *channel, uint8_t from, uint8_t to) {
+  // xorshift
+  channel->random ^= channel->random << 13;
+  channel->random ^= channel->random >> 17;
+  channel->random ^= channel->random << 5;
+  if (channel->random / 4294967296.0 < channel->links[from][to].loss) {
+    channel->dropped++;
+    return false;
+  }
+  channel->delivered++;
+  return true;
+}
+
+void sim_channel_advance(sim_channel *channel, uint64_t until_us) {
+  // the hook checks the channel itself, once is enough
+  if (channel->advance == NULL || channel->advancing) {
+    return;
+  }
+  channel->advancing = true;
+  channel->advance(channel->advance_context, until_us);
+  channel->advancing = false;
+}
+
+void sim_channel_transmit(sim_channel *channel, uint8_t source, bool fsk,
+                          const lora_modem *modem, uint32_t frf,
+                          uint64_t start_us, uint64_t end_us) {
+  sim_transmission *t = &channel->recent[channel->next];
+  channel->next = (channel->next + 1) % SIM_CHANNEL_HISTORY;
+  if (channel->count < SIM_CHANNEL_HISTORY) {
+    channel->count++;
+  }
+  t->source = source;
+  t->fsk = fsk;
+  t->modem = *modem;
+  t->frf = frf;
+  t->start_us = start_us;
+  t->end_us = end_us;
+  channel->transmissions++;
+}
+
+bool sim_channel_active(sim_channel *channel, uint8_t source,
+                        const lora_modem *modem, uint32_t frf,
+                        uint64_t from_us, uint64_t to_us) {
+  sim_channel_advance(channel, to_us);
+  for (uint8_t i = 0; i < channel->count; i++) {
+    const sim_transmission *t = &channel->recent[i];
+    if (t->source == source || t->frf != frf || t->end_us <= from_us ||
+        t->start_us >= to_us) {
+      continue;
+    }
+    if (modem == NULL ||
+        (!t->fsk && t->modem.spreading_factor == modem->spreading_factor &&
+         t->modem.bandwidth == modem->bandwidth)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,90 @@
+/*
+ * sim_channel.h
+ *
+ * Created: 10/19/2026
+ *
+ * The air on the band, shared by every kite on it: who transmitted when, on
+ * what frequency (the radio's FRF register value) and settings, for
+ * collisions at the ground and for channel activity detection. Only
+ * transmissions on the same frequency get in each other's way. Radios put
+ * their packets on it as they start. The last SIM_CHANNEL_HISTORY are kept,
+ * plenty to look back over a packet.
+ *
+ * Anything simulated on its own clock (the other kites in fleet.h) hooks
+ * advance to be played out up to the time asked about first.
+ *
+ * Radio models joined to it (sim_rfm95_join) also hear each other: a packet
+ * one of them sends is delivered to every other one as it goes out, its
+ * output power less the path loss set for that pair with sim_channel_link,
+ * and as often as that link's loss lets it. A packet
+ * that reaches a radio while anyone else was on air on its frequency is
+ * lost there, the same way the ground loses collided ones.
+ */
+
+#ifndef SIM_CHANNEL_H_
+#define SIM_CHANNEL_H_
+
+#include "lora_modem.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIM_CHANNEL_HISTORY 128
+#define SIM_CHANNEL_RADIOS 8
+
+struct sim_rfm95;
+
+typedef struct sim_transmission {
+  uint8_t source;
+  bool fsk; // modem is meaningless then
+  lora_modem modem;
+  uint32_t frf;
+  uint64_t start_us;
+  uint64_t end_us;
+} sim_transmission;
+
+// one way, from one joined radio to another
+typedef struct sim_link {
+  int16_t path_loss_db;
+  double loss; // fraction of packets dropped on the way
+} sim_link;
+
+typedef struct sim_channel {
+  sim_transmission recent[SIM_CHANNEL_HISTORY]; // oldest overwritten first
+  uint8_t next;
+  uint8_t count;
+
+  void (*advance)(void *context, uint64_t until_us);
+  void *advance_context;
+  bool advancing;
+
+  struct sim_rfm95 *radios[SIM_CHANNEL_RADIOS];
+  uint8_t radio_count;
+  sim_link links[SIM_CHANNEL_RADIOS][SIM_CHANNEL_RADIOS]; // [from][to]
+  uint32_t random;
+
+  uint32_t transmissions;
+  uint32_t delivered; // between joined radios
+  uint32_t dropped; // by a link's loss
+} sim_channel;
+
+void sim_channel_init(sim_channel *channel);
+// both ways between joined radios a and b, 100 dB and no loss until set
+void sim_channel_link(sim_channel *channel, uint8_t a, uint8_t b,
+                      int16_t path_loss_db, double loss);
+// whether a packet from joined radio from makes it to to, given the link
+bool sim_channel_carries(sim_channel *channel, uint8_t from, uint8_t to);
+// play out whoever hooked advance up to until_us
+void sim_channel_advance(sim_channel *channel, uint64_t until_us);
+void sim_channel_transmit(sim_channel *channel, uint8_t source, bool fsk,
+                          const lora_modem *modem, uint32_t frf,
+                          uint64_t start_us, uint64_t end_us);
+/*
+Someone other than source on air on frf at any point from from_us to to_us.
+With a modem, only LoRa on the same spreading factor and bandwidth counts,
+what CAD picks up.
+*/
+bool sim_channel_active(sim_channel *channel, uint8_t source,
+                        const lora_modem *modem, uint32_t frf,
+                        uint64_t from_us, uint64_t to_us);
+
+#endif /* SIM_CHANNEL_H_ */
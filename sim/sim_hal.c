@@ -0,0 +1,260 @@
+/*
+ * sim_hal.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "sim_hal.h"
+#include "crc32.h"
+#include "error.h"
+#include "systime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DEVICES 8
+
+// clocked bits per second on each bus, from Config/hpl_sercom_config.h
+#define SPI_0_BAUD 50000
+#define SPI_1_BAUD 5000
+#define SPI_2_BAUD 50000
+#define SERCOM_CLOCK_HZ 8000000
+struct spi_m_sync_descriptor SPI_0 = {{0}, SPI_0_BAUD};
+struct spi_m_sync_descriptor SPI_1 = {{1}, SPI_1_BAUD};
+struct spi_m_sync_descriptor SPI_2 = {{2}, SPI_2_BAUD};
+struct adc_sync_descriptor ADC_0;
+
+typedef struct attachment {
+  struct spi_m_sync_descriptor *spi;
+  uint8_t cs_pin;
+  sim_spi_device device;
+} attachment;
+
+typedef struct input {
+  bool (*read)(void *context);
+  void *context;
+} input;
+
+static uint64_t now_us;
+static uint64_t spi_bytes[3];
+static attachment attachments[MAX_DEVICES];
+static int attachment_count;
+static bool pin_levels[SIM_PIN_COUNT];
+static input inputs[SIM_PIN_COUNT];
+static double (*adc_volts)(void *context);
+static void *adc_context;
+
+uint64_t sim_time_us(void) { return now_us; }
+
+void sim_advance_us(uint64_t us) { now_us += us; }
+
+void sim_reset(void) {
+  now_us = 0;
+  memset(spi_bytes, 0, sizeof(spi_bytes));
+  SPI_0.baud = SPI_0_BAUD;
+  SPI_1.baud = SPI_1_BAUD;
+  SPI_2.baud = SPI_2_BAUD;
+  attachment_count = 0;
+  memset(inputs, 0, sizeof(inputs));
+  for (int i = 0; i < SIM_PIN_COUNT; i++) {
+    pin_levels[i] = true; // chip selects idle high
+  }
+  adc_volts = NULL;
+  adc_context = NULL;
+}
+
+void sim_spi_attach(struct spi_m_sync_descriptor *spi, uint8_t cs_pin,
+                    const sim_spi_device *device) {
+  if (attachment_count == MAX_DEVICES) {
+    fprintf(stderr, "sim: too many SPI devices\n");
+    exit(1);
+  }
+  attachments[attachment_count].spi = spi;
+  attachments[attachment_count].cs_pin = cs_pin;
+  attachments[attachment_count].device = *device;
+  attachment_count++;
+}
+
+uint64_t sim_spi_bytes(const struct spi_m_sync_descriptor *spi) {
+  return spi_bytes[spi->io.bus];
+}
+
+void sim_gpio_input(uint8_t pin, bool (*read)(void *context), void *context) {
+  inputs[pin].read = read;
+  inputs[pin].context = context;
+}
+
+void sim_adc_source(double (*volts)(void *context), void *context) {
+  adc_volts = volts;
+  adc_context = context;
+}
+
+void atmel_start_init(void) {}
+
+void wait_for_cdc_ready(void) {}
+
+int32_t cdcdf_acm_write(uint8_t *buf, uint32_t size) {
+  fwrite(buf, 1, size, stdout);
+  return 0;
+}
+
+int32_t spi_m_sync_get_io_descriptor(struct spi_m_sync_descriptor *const spi,
+                                     struct io_descriptor **io) {
+  *io = &spi->io;
+  return 0;
+}
+
+void spi_m_sync_enable(struct spi_m_sync_descriptor *spi) { (void)spi; }
+void spi_m_sync_disable(struct spi_m_sync_descriptor *spi) { (void)spi; }
+
+int32_t spi_m_sync_set_baudrate(struct spi_m_sync_descriptor *spi,
+                                const uint32_t baud_val) {
+  spi->baud = SERCOM_CLOCK_HZ / (2 * (baud_val + 1));
+  return 0;
+}
+
+static struct spi_m_sync_descriptor *bus(struct io_descriptor *io) {
+  // io is the first member of the descriptor
+  return (struct spi_m_sync_descriptor *)io;
+}
+
+static attachment *selected(struct spi_m_sync_descriptor *spi) {
+  for (int i = 0; i < attachment_count; i++) {
+    if (attachments[i].spi == spi && !pin_levels[attachments[i].cs_pin]) {
+      return &attachments[i];
+    }
+  }
+  return NULL;
+}
+
+static uint8_t clock_byte(struct spi_m_sync_descriptor *spi, uint8_t mosi) {
+  now_us += 8000000 / spi->baud;
+  spi_bytes[spi->io.bus]++;
+  attachment *device = selected(spi);
+  if (device == NULL) {
+    return 0xFF;
+  }
+  return device->device.exchange(device->device.context, mosi);
+}
+
+int32_t io_write(struct io_descriptor *const io_descr, const uint8_t *const buf,
+                 const uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    clock_byte(bus(io_descr), buf[i]);
+  }
+  return length;
+}
+
+int32_t io_read(struct io_descriptor *const io_descr, uint8_t *const buf,
+                const uint16_t length) {
+  for (uint16_t i = 0; i < length; i++) {
+    // the SERCOM clocks out its dummy byte while reading
+    buf[i] = clock_byte(bus(io_descr), 0xFF);
+  }
+  return length;
+}
+
+void gpio_set_pin_level(const uint8_t pin, const bool level) {
+  if (pin_levels[pin] == level) {
+    return;
+  }
+  pin_levels[pin] = level;
+  for (int i = 0; i < attachment_count; i++) {
+    if (attachments[i].cs_pin != pin) {
+      continue;
+    }
+    sim_spi_device *device = &attachments[i].device;
+    if (!level && device->select != NULL) {
+      device->select(device->context);
+    } else if (level && device->deselect != NULL) {
+      device->deselect(device->context);
+    }
+  }
+}
+
+void gpio_toggle_pin_level(const uint8_t pin) {
+  gpio_set_pin_level(pin, !pin_levels[pin]);
+}
+
+bool gpio_get_pin_level(const uint8_t pin) {
+  if (inputs[pin].read != NULL) {
+    return inputs[pin].read(inputs[pin].context);
+  }
+  return pin_levels[pin];
+}
+
+void delay_us(const uint16_t us) { now_us += us; }
+
+void delay_ms(const uint16_t ms) { now_us += (uint64_t)ms * 1000; }
+
+int32_t adc_sync_enable_channel(struct adc_sync_descriptor *const descr,
+                                const uint8_t channel) {
+  (void)descr;
+  (void)channel;
+  return 0;
+}
+
+int32_t adc_sync_read_channel(struct adc_sync_descriptor *const descr,
+                              const uint8_t channel, uint8_t *const buffer,
+                              const uint16_t length) {
+  (void)descr;
+  (void)channel;
+  // 12 bit result of half the battery voltage against 3.3 V
+  double volts = adc_volts != NULL ? adc_volts(adc_context) : 3.7;
+  double counts = volts / 2 / 3.3 * 4096;
+  uint16_t raw = counts < 0 ? 0 : counts > 4095 ? 4095 : (uint16_t)counts;
+  memcpy(buffer, &raw, length < sizeof(raw) ? length : sizeof(raw));
+  now_us += 20; // a conversion at the default ADC clock
+  return length;
+}
+
+// systime.c runs on TC4, here it is simply the simulated clock
+
+static uint64_t systime_start_us;
+
+void systime_init(void) { systime_start_us = now_us; }
+
+uint32_t systime_us(void) { return (uint32_t)now_us; }
+
+uint32_t systime_ms(void) {
+  return (uint32_t)((now_us - systime_start_us) / 1000);
+}
+
+/*
+crc32.c runs on the DSU and the DMAC's CRC engine, here it is done a bit at
+a time, to the same results
+*/
+
+uint32_t crc32_update(uint32_t crc, const void *data, size_t length) {
+  const uint8_t *bytes = data;
+  while (length-- > 0) {
+    crc ^= *bytes++;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+    }
+  }
+  return crc;
+}
+
+uint32_t crc32_software_update(uint32_t crc, const void *data,
+                              size_t length) {
+  return crc32_update(crc, data, length);
+}
+
+bool crc32_self_test(void) {
+  return crc32_finalize(crc32_update(crc32_init(), "123456789", 9)) ==
+         0xCBF43926;
+}
+
+bool crc32_spi_read(struct spi_m_sync_descriptor *spi, uint8_t *data,
+                    uint16_t length, uint32_t *crc) {
+  io_read(&spi->io, data, length);
+  *crc = crc32_update(*crc, data, length);
+  return true;
+}
+
+void error(ERROR_REASON reason) {
+  // the numbers are the ERROR_REASON values from error.h
+  fprintf(stderr, "firmware error %d at %.3f s\n", (int)reason, now_us / 1e6);
+  exit(1);
+}
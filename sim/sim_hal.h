@@ -0,0 +1,119 @@
+/*
+ * sim_hal.h
+ *
+ * Created: 10/19/2026
+ *
+ * Host stand-in for the Atmel Start HAL. Force included ahead of the firmware
+ * sources (-include sim_hal.h) so the generated atmel_start headers are
+ * skipped and the drivers talk to the simulated SPI buses, pins and clock
+ * below instead.
+ */
+
+#ifndef SIM_HAL_H_
+#define SIM_HAL_H_
+
+#define ATMEL_START_H_INCLUDED
+#define ATMEL_START_PINS_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// atmel_start_pins.h
+
+enum gpio_port { GPIO_PORTA, GPIO_PORTB };
+#define GPIO(port, pin) ((((port)&0x7u) << 5) + ((pin)&0x1Fu))
+
+#define BATT_V GPIO(GPIO_PORTA, 4)
+#define LORA_RESET GPIO(GPIO_PORTA, 6)
+#define LORA_INT GPIO(GPIO_PORTA, 7)
+#define BMP388_CS GPIO(GPIO_PORTA, 15)
+#define FLASH_CS GPIO(GPIO_PORTA, 19)
+#define LED2 GPIO(GPIO_PORTA, 27)
+#define LORA_CS GPIO(GPIO_PORTB, 11)
+
+#define SIM_PIN_COUNT 64
+
+// HAL drivers used by the firmware
+
+struct io_descriptor {
+  int bus;
+};
+
+struct spi_m_sync_descriptor {
+  struct io_descriptor io;
+  uint32_t baud;
+};
+
+struct adc_sync_descriptor {
+  int unused;
+};
+
+extern struct spi_m_sync_descriptor SPI_0; // flash
+extern struct spi_m_sync_descriptor SPI_1; // radio
+extern struct spi_m_sync_descriptor SPI_2; // barometer
+extern struct adc_sync_descriptor ADC_0;
+
+void atmel_start_init(void);
+void wait_for_cdc_ready(void);
+int32_t cdcdf_acm_write(uint8_t *buf, uint32_t size);
+
+int32_t spi_m_sync_get_io_descriptor(struct spi_m_sync_descriptor *const spi,
+                                     struct io_descriptor **io);
+void spi_m_sync_enable(struct spi_m_sync_descriptor *spi);
+void spi_m_sync_disable(struct spi_m_sync_descriptor *spi);
+// BAUD register value, from the 8 MHz GCLK every SERCOM runs on
+int32_t spi_m_sync_set_baudrate(struct spi_m_sync_descriptor *spi,
+                                const uint32_t baud_val);
+int32_t io_write(struct io_descriptor *const io_descr, const uint8_t *const buf,
+                 const uint16_t length);
+int32_t io_read(struct io_descriptor *const io_descr, uint8_t *const buf,
+                const uint16_t length);
+
+void gpio_set_pin_level(const uint8_t pin, const bool level);
+void gpio_toggle_pin_level(const uint8_t pin);
+bool gpio_get_pin_level(const uint8_t pin);
+
+void delay_us(const uint16_t us);
+void delay_ms(const uint16_t ms);
+
+int32_t adc_sync_enable_channel(struct adc_sync_descriptor *const descr,
+                                const uint8_t channel);
+int32_t adc_sync_read_channel(struct adc_sync_descriptor *const descr,
+                              const uint8_t channel, uint8_t *const buffer,
+                              const uint16_t length);
+
+// simulation control
+
+typedef struct sim_spi_device {
+  void *context;
+  void (*select)(void *context);
+  uint8_t (*exchange)(void *context, uint8_t mosi); // returns MISO
+  void (*deselect)(void *context);
+} sim_spi_device;
+
+uint64_t sim_time_us(void);
+void sim_advance_us(uint64_t us);
+
+// put all buses, pins and the clock back to power on
+void sim_reset(void);
+
+// connect a device to an SPI bus, selected while cs_pin is low
+void sim_spi_attach(struct spi_m_sync_descriptor *spi, uint8_t cs_pin,
+                    const sim_spi_device *device);
+uint64_t sim_spi_bytes(const struct spi_m_sync_descriptor *spi);
+
+// drive an input pin from a model, e.g. LORA_INT from the radio's DIO0
+void sim_gpio_input(uint8_t pin, bool (*read)(void *context), void *context);
+
+// battery voltage seen by ADC_0, in volts at the pack
+void sim_adc_source(double (*volts)(void *context), void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_HAL_H_ */
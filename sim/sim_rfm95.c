@@ -0,0 +1,795 @@
+/*
+ * sim_rfm95.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "sim_rfm95.h"
+#include <math.h>
+#include <string.h>
+
+enum {
+  REG_FIFO = 0x00,
+  REG_OP_MODE = 0x01,
+  REG_FRF_MSB = 0x06,
+  REG_FRF_MID = 0x07,
+  REG_FRF_LSB = 0x08,
+  REG_PA_CONFIG = 0x09,
+  REG_FIFO_ADDR_PTR = 0x0D,
+  REG_FIFO_TX_BASE_ADDR = 0x0E,
+  REG_FIFO_RX_BASE_ADDR = 0x0F,
+  REG_FIFO_RX_CURRENT_ADDR = 0x10,
+  REG_IRQ_FLAGS_MASK = 0x11,
+  REG_IRQ_FLAGS = 0x12,
+  REG_RX_NB_BYTES = 0x13,
+  REG_PKT_SNR = 0x19,
+  REG_PKT_RSSI = 0x1A,
+  REG_MODEM_CONFIG_1 = 0x1D,
+  REG_MODEM_CONFIG_2 = 0x1E,
+  REG_SYMB_TIMEOUT_LSB = 0x1F,
+  REG_PREAMBLE_MSB = 0x20,
+  REG_PREAMBLE_LSB = 0x21,
+  REG_PAYLOAD_LENGTH = 0x22,
+  REG_FIFO_RX_BYTE_ADDR = 0x25,
+  REG_MODEM_CONFIG_3 = 0x26,
+  REG_RSSI_WIDEBAND = 0x2C,
+  REG_DIO_MAPPING_1 = 0x40,
+  REG_VERSION = 0x42,
+  REG_PA_DAC = 0x4D,
+};
+
+// FSK page
+enum {
+  FSK_REG_BITRATE_MSB = 0x02,
+  FSK_REG_BITRATE_LSB = 0x03,
+  FSK_REG_FDEV_MSB = 0x04,
+  FSK_REG_FDEV_LSB = 0x05,
+  FSK_REG_RSSI_VALUE = 0x11,
+  FSK_REG_RX_BW = 0x12,
+  FSK_REG_PREAMBLE_MSB = 0x25,
+  FSK_REG_PREAMBLE_LSB = 0x26,
+  FSK_REG_FIFO_THRESH = 0x35,
+  FSK_REG_IRQ_FLAGS_2 = 0x3F,
+  FSK_PAGE_FIRST = 0x0D,
+  FSK_PAGE_LAST = 0x3F,
+};
+
+static const uint8_t MODE_MASK = 0x07;
+static const uint8_t LONG_RANGE_MODE = 0x80;
+static const uint8_t MODE_SLEEP = 0x00;
+static const uint8_t MODE_STANDBY = 0x01;
+static const uint8_t MODE_TX = 0x03;
+static const uint8_t MODE_RX_CONTINUOUS = 0x05;
+static const uint8_t MODE_RX_SINGLE = 0x06;
+static const uint8_t MODE_CAD = 0x07;
+static const uint8_t IRQ_RX_TIMEOUT = 0x80;
+static const uint8_t IRQ_RX_DONE = 0x40;
+static const uint8_t IRQ_PAYLOAD_CRC_ERROR = 0x20;
+static const uint8_t IRQ_VALID_HEADER = 0x10;
+static const uint8_t IRQ_TX_DONE = 0x08;
+static const uint8_t IRQ_CAD_DONE = 0x04;
+static const uint8_t IRQ_FHSS_CHANGE_CHANNEL = 0x02;
+static const uint8_t IRQ_CAD_DETECTED = 0x01;
+// symbols CAD listens for
+static const int CAD_SYMBOLS = 2;
+static const int NOISE_FIGURE_DB = 6;
+static const uint8_t FSK_IRQ_FIFO_FULL = 0x80;
+static const uint8_t FSK_IRQ_FIFO_EMPTY = 0x40;
+static const uint8_t FSK_IRQ_FIFO_LEVEL = 0x20;
+static const uint8_t FSK_IRQ_FIFO_OVERRUN = 0x10;
+static const uint8_t FSK_IRQ_PACKET_SENT = 0x08;
+static const uint8_t FSK_IRQ_PAYLOAD_READY = 0x04;
+static const uint8_t FSK_IRQ_CRC_OK = 0x02;
+
+static bool fsk_mode(const sim_rfm95 *radio) {
+  return !(radio->regs[REG_OP_MODE] & LONG_RANGE_MODE);
+}
+
+bool sim_rfm95_fsk(const sim_rfm95 *radio, fsk_modem *modem) {
+  fsk_modem_from_registers(
+      modem,
+      radio->regs[FSK_REG_BITRATE_MSB] << 8 | radio->regs[FSK_REG_BITRATE_LSB],
+      radio->regs[FSK_REG_FDEV_MSB] << 8 | radio->regs[FSK_REG_FDEV_LSB],
+      radio->fsk_regs[FSK_REG_RX_BW],
+      radio->fsk_regs[FSK_REG_PREAMBLE_MSB] << 8 |
+          radio->fsk_regs[FSK_REG_PREAMBLE_LSB]);
+  return fsk_mode(radio);
+}
+
+uint32_t sim_rfm95_frf(const sim_rfm95 *radio) {
+  return (uint32_t)radio->regs[REG_FRF_MSB] << 16 |
+         radio->regs[REG_FRF_MID] << 8 | radio->regs[REG_FRF_LSB];
+}
+
+// unless IRQ_FLAGS_MASK has them masked
+static void raise_irq(sim_rfm95 *radio, uint8_t flags) {
+  radio->regs[REG_IRQ_FLAGS] |= flags & ~radio->regs[REG_IRQ_FLAGS_MASK];
+}
+
+/*
+The packet going out, to each radio joined to the channel with it that the
+link carries it to
+*/
+static void send_over_air(sim_rfm95 *radio, const uint8_t *data) {
+  if (radio->channel == NULL || radio->joined < 0) {
+    return;
+  }
+  sim_channel *channel = radio->channel;
+  lora_modem modem;
+  sim_rfm95_modem(radio, &modem);
+  fsk_modem fsk;
+  bool is_fsk = sim_rfm95_fsk(radio, &fsk);
+  uint32_t bandwidth_hz = is_fsk ? 2 * fsk_rx_bandwidth_hz(fsk.rx_bandwidth)
+                                 : lora_bandwidth_hz(modem.bandwidth);
+  double noise_dbm = -174 + 10 * log10(bandwidth_hz) + NOISE_FIGURE_DB;
+  for (int i = 0; i < channel->radio_count; i++) {
+    sim_rfm95 *other = channel->radios[i];
+    if (other == radio || !sim_channel_carries(channel, radio->joined, i)) {
+      continue;
+    }
+    int rssi = sim_rfm95_tx_power_dbm(radio) -
+               channel->links[radio->joined][i].path_loss_db;
+    int snr = (int)lround(rssi - noise_dbm);
+    snr = snr < -128 ? -128 : snr > 127 ? 127 : snr;
+    bool queued =
+        is_fsk ? sim_rfm95_deliver_fsk(other, data, radio->tx_length, &fsk,
+                                       sim_rfm95_frf(radio), radio->tx_start_us,
+                                       rssi, snr)
+               : sim_rfm95_deliver(other, data, radio->tx_length, &modem,
+                                   sim_rfm95_frf(radio), radio->tx_start_us,
+                                   rssi, snr);
+    if (queued) {
+      sim_rfm95_incoming *packet = &other->incoming[other->incoming_count - 1];
+      packet->over_air = true;
+      packet->source = radio->source;
+    } else {
+      other->missed++;
+    }
+  }
+}
+
+// a LoRa packet cut short never finishes arriving anywhere either
+static void recall_over_air(sim_rfm95 *radio) {
+  if (radio->channel == NULL || radio->joined < 0) {
+    return;
+  }
+  for (int i = 0; i < radio->channel->radio_count; i++) {
+    sim_rfm95 *other = radio->channel->radios[i];
+    for (int j = 0; j < other->incoming_count; j++) {
+      if (other->incoming[j].over_air &&
+          other->incoming[j].source == radio->source &&
+          other->incoming[j].start_us == radio->tx_start_us) {
+        other->incoming[j] = other->incoming[--other->incoming_count];
+        break;
+      }
+    }
+  }
+}
+
+// a packet just started, for everyone else on the channel
+static void on_air(sim_rfm95 *radio) {
+  if (radio->channel == NULL) {
+    return;
+  }
+  lora_modem modem;
+  sim_rfm95_modem(radio, &modem);
+  sim_channel_transmit(radio->channel, radio->source, fsk_mode(radio), &modem,
+                       sim_rfm95_frf(radio), radio->tx_start_us,
+                       radio->tx_end_us);
+  if (!fsk_mode(radio)) {
+    send_over_air(radio, radio->tx_data);
+  }
+}
+
+/*
+When byte index of the packet going out (0 is the length byte) leaves the
+FIFO for the air, after the preamble and sync word
+*/
+static uint64_t fsk_slot_us(const sim_rfm95 *radio, uint16_t index) {
+  fsk_modem modem;
+  sim_rfm95_fsk(radio, &modem);
+  uint64_t bytes = modem.preamble_length + FSK_SYNC_LENGTH + index;
+  return radio->tx_start_us +
+         (bytes * fsk_bit_rate_register(&modem) + 3) / 4;
+}
+
+// bytes waiting in the FSK FIFO now
+static uint8_t fsk_fifo_level(const sim_rfm95 *radio) {
+  if (!radio->transmitting) {
+    return radio->fsk_fifo_count;
+  }
+  uint64_t now = sim_time_us();
+  uint16_t gone = 0;
+  while (gone < radio->tx_written && fsk_slot_us(radio, gone) <= now) {
+    gone++;
+  }
+  return (uint8_t)(radio->tx_written - gone);
+}
+
+static uint8_t fsk_irq_flags_2(const sim_rfm95 *radio) {
+  uint8_t level = fsk_fifo_level(radio);
+  uint8_t flags = radio->fsk_irq_flags;
+  if (level == 0) {
+    flags |= FSK_IRQ_FIFO_EMPTY;
+  }
+  if (level >= SIM_RFM95_FSK_FIFO) {
+    flags |= FSK_IRQ_FIFO_FULL;
+  }
+  if (level > (radio->fsk_regs[FSK_REG_FIFO_THRESH] & 0x3F)) {
+    flags |= FSK_IRQ_FIFO_LEVEL;
+  }
+  return flags;
+}
+
+/*
+TX with something in the FIFO: the length byte says how long the packet is,
+the rest is streamed in as it goes
+*/
+static void fsk_start_transmit(sim_rfm95 *radio) {
+  radio->tx_written = 0;
+  while (radio->fsk_fifo_count > 0) {
+    radio->tx_data[radio->tx_written++] = radio->fsk_fifo[radio->fsk_fifo_first];
+    radio->fsk_fifo_first = (radio->fsk_fifo_first + 1) % SIM_RFM95_FSK_FIFO;
+    radio->fsk_fifo_count--;
+  }
+  fsk_modem modem;
+  sim_rfm95_fsk(radio, &modem);
+  radio->tx_length = radio->tx_data[0];
+  radio->tx_underrun = false;
+  radio->transmitting = true;
+  radio->tx_start_us = sim_time_us();
+  radio->tx_end_us =
+      radio->tx_start_us + fsk_airtime_us(&modem, radio->tx_length);
+  radio->fsk_irq_flags &= ~FSK_IRQ_PACKET_SENT;
+  on_air(radio);
+}
+
+static void fsk_write_fifo(sim_rfm95 *radio, uint8_t value) {
+  if (radio->transmitting) {
+    uint16_t index = radio->tx_written;
+    if (fsk_fifo_level(radio) >= SIM_RFM95_FSK_FIFO ||
+        index >= sizeof(radio->tx_data)) {
+      radio->fsk_irq_flags |= FSK_IRQ_FIFO_OVERRUN;
+      return;
+    }
+    if (sim_time_us() > fsk_slot_us(radio, index)) {
+      radio->tx_underrun = true; // the air got there first
+    }
+    radio->tx_data[radio->tx_written++] = value;
+    return;
+  }
+  if (radio->fsk_fifo_count == SIM_RFM95_FSK_FIFO) {
+    radio->fsk_irq_flags |= FSK_IRQ_FIFO_OVERRUN;
+    return;
+  }
+  radio->fsk_fifo[(radio->fsk_fifo_first + radio->fsk_fifo_count++) %
+                  SIM_RFM95_FSK_FIFO] = value;
+  if ((radio->regs[REG_OP_MODE] & MODE_MASK) == MODE_TX) {
+    fsk_start_transmit(radio);
+  }
+}
+
+static uint8_t fsk_read_fifo(sim_rfm95 *radio) {
+  if (radio->fsk_fifo_count == 0) {
+    return 0;
+  }
+  uint8_t value = radio->fsk_fifo[radio->fsk_fifo_first];
+  radio->fsk_fifo_first = (radio->fsk_fifo_first + 1) % SIM_RFM95_FSK_FIFO;
+  if (--radio->fsk_fifo_count == 0) {
+    radio->fsk_irq_flags &= ~(FSK_IRQ_PAYLOAD_READY | FSK_IRQ_CRC_OK);
+  }
+  return value;
+}
+
+static double symbol_us(const sim_rfm95 *radio) {
+  lora_modem modem;
+  sim_rfm95_modem(radio, &modem);
+  return lora_symbol_us(&modem);
+}
+
+// the same calculation the firmware schedules with
+uint64_t sim_rfm95_airtime_us(const sim_rfm95 *radio, uint8_t length) {
+  lora_modem modem;
+  sim_rfm95_modem(radio, &modem);
+  return lora_airtime_us(&modem, length);
+}
+
+static void finish_transmit(sim_rfm95 *radio) {
+  radio->transmitting = false;
+  radio->packets++;
+  radio->bytes += radio->tx_length;
+  radio->airtime_us += radio->tx_end_us - radio->tx_start_us;
+  const uint8_t *data = radio->tx_data;
+  if (fsk_mode(radio)) {
+    // stays in TX until told otherwise
+    radio->fsk_irq_flags |= FSK_IRQ_PACKET_SENT;
+    if (radio->tx_underrun || radio->tx_written < 1 + radio->tx_length) {
+      radio->underruns++;
+      return;
+    }
+    data++; // past the length byte
+    send_over_air(radio, data);
+  } else {
+    raise_irq(radio, IRQ_TX_DONE);
+    radio->regs[REG_OP_MODE] =
+        (radio->regs[REG_OP_MODE] & ~MODE_MASK) | MODE_STANDBY;
+  }
+  if (radio->on_transmit != NULL) {
+    radio->on_transmit(radio->transmit_context, data, radio->tx_length,
+                       radio->tx_start_us,
+                       radio->tx_end_us - radio->tx_start_us);
+  }
+}
+
+void sim_rfm95_modem(const sim_rfm95 *radio, lora_modem *modem) {
+  const uint8_t config[3] = {radio->regs[REG_MODEM_CONFIG_1],
+                             radio->regs[REG_MODEM_CONFIG_2],
+                             radio->regs[REG_MODEM_CONFIG_3]};
+  lora_modem_from_registers(
+      modem, config,
+      radio->regs[REG_PREAMBLE_MSB] << 8 | radio->regs[REG_PREAMBLE_LSB]);
+}
+
+
+/*
+Pout = 17 - (15 - OutputPower) on PA_BOOST, 3 dB more with the +20 dBm
+setting in PA_DAC. The RFO pin isn't connected on the RFM95, call it the same.
+*/
+int sim_rfm95_tx_power_dbm(const sim_rfm95 *radio) {
+  int power = 2 + (radio->regs[REG_PA_CONFIG] & 0x0F);
+  if ((radio->regs[REG_PA_DAC] & 0x07) == 0x07) {
+    power += 3;
+  }
+  return power;
+}
+
+static bool in_rx_mode(const sim_rfm95 *radio) {
+  uint8_t mode = radio->regs[REG_OP_MODE] & MODE_MASK;
+  return mode == MODE_RX_CONTINUOUS || mode == MODE_RX_SINGLE;
+}
+
+static void enter_standby(sim_rfm95 *radio) {
+  radio->regs[REG_OP_MODE] =
+      (radio->regs[REG_OP_MODE] & ~MODE_MASK) | MODE_STANDBY;
+}
+
+// single mode dropping back to standby by itself at at_us
+static void end_single_receive(sim_rfm95 *radio, uint64_t at_us) {
+  radio->rx_us += at_us - radio->rx_since_us;
+  radio->receiving = false;
+  enter_standby(radio);
+}
+
+// a packet from a joined radio with anyone else on its frequency meanwhile
+static bool collided(sim_rfm95 *radio, const sim_rfm95_incoming *packet) {
+  if (!packet->over_air ||
+      !sim_channel_active(radio->channel, packet->source, NULL, packet->frf,
+                          packet->start_us, packet->end_us)) {
+    return false;
+  }
+  radio->collided++;
+  return true;
+}
+
+static void receive_fsk(sim_rfm95 *radio, const sim_rfm95_incoming *packet) {
+  fsk_modem modem;
+  sim_rfm95_fsk(radio, &modem);
+  if (!in_rx_mode(radio) || radio->rx_since_us > packet->start_us ||
+      packet->frf != sim_rfm95_frf(radio) || !packet->fsk ||
+      !fsk_modem_compatible(&modem, &packet->fsk_modem) ||
+      packet->snr_db * 4 < fsk_snr_limit() ||
+      packet->length >= SIM_RFM95_FSK_FIFO) {
+    radio->missed++;
+    return;
+  }
+  if (collided(radio, packet)) {
+    return;
+  }
+  radio->fsk_fifo_first = 0;
+  radio->fsk_fifo_count = 1 + packet->length;
+  radio->fsk_fifo[0] = packet->length;
+  memcpy(radio->fsk_fifo + 1, packet->data, packet->length);
+  int rssi = -2 * packet->rssi_dbm;
+  radio->fsk_regs[FSK_REG_RSSI_VALUE] = rssi < 0 ? 0 : rssi > 255 ? 255 : rssi;
+  radio->fsk_irq_flags |= FSK_IRQ_PAYLOAD_READY | FSK_IRQ_CRC_OK;
+  radio->received++;
+}
+
+static void receive(sim_rfm95 *radio, const sim_rfm95_incoming *packet) {
+  if (fsk_mode(radio)) {
+    receive_fsk(radio, packet);
+    return;
+  }
+  lora_modem modem;
+  sim_rfm95_modem(radio, &modem);
+  if (!in_rx_mode(radio) || radio->rx_since_us > packet->start_us ||
+      packet->frf != sim_rfm95_frf(radio) || packet->fsk ||
+      !lora_modem_compatible(&modem, &packet->modem) ||
+      packet->snr_db * 4 < lora_snr_limit(modem.spreading_factor)) {
+    radio->missed++;
+    return;
+  }
+  if (collided(radio, packet)) {
+    raise_irq(radio, IRQ_VALID_HEADER | IRQ_PAYLOAD_CRC_ERROR);
+    if ((radio->regs[REG_OP_MODE] & MODE_MASK) == MODE_RX_SINGLE) {
+      end_single_receive(radio, packet->end_us);
+    }
+    return;
+  }
+
+  // one after the other in RX continuous, like the FIFO's own write pointer
+  uint8_t base = radio->rx_byte_addr;
+  for (int i = 0; i < packet->length; i++) {
+    radio->fifo[(uint8_t)(base + i)] = packet->data[i];
+  }
+  radio->rx_byte_addr = base + packet->length;
+  radio->regs[REG_FIFO_RX_CURRENT_ADDR] = base;
+  radio->regs[REG_FIFO_RX_BYTE_ADDR] = radio->rx_byte_addr;
+  radio->regs[REG_RX_NB_BYTES] = packet->length;
+  int snr = packet->snr_db * 4;
+  radio->regs[REG_PKT_SNR] = (uint8_t)(int8_t)(snr > 127 ? 127 : snr);
+  int rssi = packet->rssi_dbm + 157;
+  radio->regs[REG_PKT_RSSI] = rssi < 0 ? 0 : rssi > 255 ? 255 : rssi;
+  raise_irq(radio, IRQ_RX_DONE | IRQ_VALID_HEADER);
+  radio->received++;
+  if ((radio->regs[REG_OP_MODE] & MODE_MASK) == MODE_RX_SINGLE) {
+    end_single_receive(radio, packet->end_us);
+  }
+}
+
+/*
+When single mode gives up, if no preamble turns up within SYMB_TIMEOUT
+symbols. UINT64_MAX if not in single mode or a packet is already coming in.
+*/
+static uint64_t rx_timeout_us(const sim_rfm95 *radio) {
+  if (fsk_mode(radio) ||
+      (radio->regs[REG_OP_MODE] & MODE_MASK) != MODE_RX_SINGLE) {
+    return UINT64_MAX;
+  }
+  uint16_t symbols = (radio->regs[REG_MODEM_CONFIG_2] & 0x03) << 8 |
+                     radio->regs[REG_SYMB_TIMEOUT_LSB];
+  uint64_t timeout =
+      radio->rx_since_us + (uint64_t)(symbols * symbol_us(radio));
+  for (int i = 0; i < radio->incoming_count; i++) {
+    if (radio->incoming[i].start_us >= radio->rx_since_us &&
+        radio->incoming[i].start_us <= timeout) {
+      return UINT64_MAX;
+    }
+  }
+  return timeout;
+}
+
+// anyone on the same spreading factor and bandwidth while CAD was listening
+static void finish_detect(sim_rfm95 *radio) {
+  lora_modem modem;
+  sim_rfm95_modem(radio, &modem);
+  bool detected = false;
+  for (int i = 0; i < radio->incoming_count; i++) {
+    const sim_rfm95_incoming *packet = &radio->incoming[i];
+    if (!packet->fsk && packet->frf == sim_rfm95_frf(radio) &&
+        packet->start_us < radio->cad_end_us &&
+        packet->end_us > radio->cad_start_us &&
+        packet->modem.spreading_factor == modem.spreading_factor &&
+        packet->modem.bandwidth == modem.bandwidth) {
+      detected = true;
+    }
+  }
+  if (radio->channel != NULL &&
+      sim_channel_active(radio->channel, radio->source, &modem,
+                         sim_rfm95_frf(radio), radio->cad_start_us,
+                         radio->cad_end_us)) {
+    detected = true;
+  }
+  radio->detecting = false;
+  radio->cad_runs++;
+  raise_irq(radio, IRQ_CAD_DONE);
+  if (detected) {
+    raise_irq(radio, IRQ_CAD_DETECTED);
+    radio->cad_detected++;
+  }
+  enter_standby(radio);
+}
+
+// play out everything that has happened by now, in order
+void sim_rfm95_update(sim_rfm95 *radio) {
+  uint64_t now = sim_time_us();
+  if (radio->transmitting && now >= radio->tx_end_us) {
+    finish_transmit(radio);
+  }
+  if (radio->detecting && now >= radio->cad_end_us) {
+    finish_detect(radio);
+  }
+
+  while (true) {
+    int next = -1;
+    for (int i = 0; i < radio->incoming_count; i++) {
+      if (radio->incoming[i].end_us <= now &&
+          (next < 0 || radio->incoming[i].end_us < radio->incoming[next].end_us)) {
+        next = i;
+      }
+    }
+    uint64_t timeout = rx_timeout_us(radio);
+    if (timeout <= now && (next < 0 || timeout < radio->incoming[next].end_us)) {
+      raise_irq(radio, IRQ_RX_TIMEOUT);
+      radio->rx_timeouts++;
+      end_single_receive(radio, timeout);
+      continue;
+    }
+    if (next < 0) {
+      break;
+    }
+    sim_rfm95_incoming packet = radio->incoming[next];
+    radio->incoming[next] = radio->incoming[--radio->incoming_count];
+    receive(radio, &packet);
+  }
+}
+
+bool sim_rfm95_deliver(sim_rfm95 *radio, const uint8_t *data, uint8_t length,
+                       const lora_modem *modem, uint32_t frf,
+                       uint64_t start_us, int16_t rssi_dbm, int8_t snr_db) {
+  if (radio->incoming_count == SIM_RFM95_INCOMING) {
+    return false;
+  }
+  sim_rfm95_incoming *packet = &radio->incoming[radio->incoming_count++];
+  memset(packet, 0, sizeof(*packet));
+  memcpy(packet->data, data, length);
+  packet->length = length;
+  packet->modem = *modem;
+  packet->frf = frf;
+  packet->start_us = start_us;
+  packet->end_us = start_us + lora_airtime_us(modem, length);
+  packet->rssi_dbm = rssi_dbm;
+  packet->snr_db = snr_db;
+  return true;
+}
+
+bool sim_rfm95_deliver_fsk(sim_rfm95 *radio, const uint8_t *data,
+                           uint8_t length, const fsk_modem *modem,
+                           uint32_t frf, uint64_t start_us, int16_t rssi_dbm,
+                           int8_t snr_db) {
+  if (radio->incoming_count == SIM_RFM95_INCOMING) {
+    return false;
+  }
+  sim_rfm95_incoming *packet = &radio->incoming[radio->incoming_count++];
+  memset(packet, 0, sizeof(*packet));
+  memcpy(packet->data, data, length);
+  packet->length = length;
+  packet->fsk = true;
+  packet->fsk_modem = *modem;
+  packet->frf = frf;
+  packet->start_us = start_us;
+  packet->end_us = start_us + fsk_airtime_us(modem, length);
+  packet->rssi_dbm = rssi_dbm;
+  packet->snr_db = snr_db;
+  return true;
+}
+
+static void set_mode(sim_rfm95 *radio, uint8_t value) {
+  sim_rfm95_update(radio);
+  uint8_t mode = value & MODE_MASK;
+  // LongRangeMode only changes on the way into or out of sleep
+  if ((radio->regs[REG_OP_MODE] & MODE_MASK) != MODE_SLEEP &&
+      mode != MODE_SLEEP) {
+    value = (value & ~LONG_RANGE_MODE) |
+            (radio->regs[REG_OP_MODE] & LONG_RANGE_MODE);
+  }
+  radio->detecting = false; // cut short, or about to start again
+  if (radio->transmitting && mode != MODE_TX) {
+    // leaving TX early, the packet never made it out
+    radio->transmitting = false;
+    radio->aborted++;
+    if (!fsk_mode(radio)) {
+      recall_over_air(radio);
+    }
+    radio->airtime_us += sim_time_us() - radio->tx_start_us;
+  }
+  bool was_receiving = radio->receiving;
+  if (mode != MODE_TX) {
+    radio->fsk_irq_flags &= ~FSK_IRQ_PACKET_SENT;
+  }
+  radio->regs[REG_OP_MODE] = value;
+
+  bool receiving = mode == MODE_RX_CONTINUOUS || mode == MODE_RX_SINGLE;
+  if (was_receiving && (!receiving || !in_rx_mode(radio))) {
+    radio->rx_us += sim_time_us() - radio->rx_since_us;
+  }
+  if (receiving && !(was_receiving && in_rx_mode(radio))) {
+    radio->rx_since_us = sim_time_us();
+    radio->rx_byte_addr = radio->regs[REG_FIFO_RX_BASE_ADDR];
+  }
+  radio->receiving = receiving;
+
+  if (mode == MODE_TX && !radio->transmitting && fsk_mode(radio)) {
+    if (radio->fsk_fifo_count > 0) {
+      fsk_start_transmit(radio);
+    }
+  } else if (mode == MODE_TX && !radio->transmitting) {
+    uint8_t base = radio->regs[REG_FIFO_TX_BASE_ADDR];
+    radio->tx_length = radio->regs[REG_PAYLOAD_LENGTH];
+    for (int i = 0; i < radio->tx_length; i++) {
+      radio->tx_data[i] = radio->fifo[(uint8_t)(base + i)];
+    }
+    radio->transmitting = true;
+    radio->tx_start_us = sim_time_us();
+    radio->tx_end_us =
+        radio->tx_start_us + sim_rfm95_airtime_us(radio, radio->tx_length);
+    on_air(radio);
+  }
+  if (mode == MODE_CAD && !fsk_mode(radio)) {
+    radio->detecting = true;
+    radio->cad_start_us = sim_time_us();
+    radio->cad_end_us =
+        radio->cad_start_us + (uint64_t)(CAD_SYMBOLS * symbol_us(radio));
+  }
+}
+
+static void write_register(sim_rfm95 *radio, uint8_t address, uint8_t value) {
+  if (fsk_mode(radio) && address == REG_FIFO) {
+    fsk_write_fifo(radio, value);
+    return;
+  }
+  if (fsk_mode(radio) && address == FSK_REG_IRQ_FLAGS_2) {
+    if (value & FSK_IRQ_FIFO_OVERRUN) {
+      // clearing it empties the FIFO
+      radio->fsk_irq_flags &= ~(FSK_IRQ_FIFO_OVERRUN | FSK_IRQ_PAYLOAD_READY |
+                                FSK_IRQ_CRC_OK);
+      radio->fsk_fifo_count = 0;
+    }
+    return;
+  }
+  if (fsk_mode(radio) && address >= FSK_PAGE_FIRST &&
+      address <= FSK_PAGE_LAST) {
+    radio->fsk_regs[address] = value;
+    return;
+  }
+  switch (address) {
+  case REG_FIFO:
+    if (radio->transmitting) {
+      radio->fifo_tx_writes++; // only taken in standby
+      break;
+    }
+    radio->fifo[radio->regs[REG_FIFO_ADDR_PTR]++] = value;
+    break;
+  case REG_OP_MODE:
+    set_mode(radio, value);
+    break;
+  case REG_IRQ_FLAGS:
+    radio->regs[REG_IRQ_FLAGS] &= ~value; // write one to clear
+    break;
+  case REG_VERSION:
+    break;
+  default:
+    radio->regs[address] = value;
+    break;
+  }
+}
+
+static uint8_t read_register(sim_rfm95 *radio, uint8_t address) {
+  if (fsk_mode(radio)) {
+    if (address == REG_FIFO) {
+      return fsk_read_fifo(radio);
+    }
+    if (address == FSK_REG_IRQ_FLAGS_2) {
+      return fsk_irq_flags_2(radio);
+    }
+    if (address >= FSK_PAGE_FIRST && address <= FSK_PAGE_LAST) {
+      return radio->fsk_regs[address];
+    }
+  }
+  if (address == REG_FIFO) {
+    return radio->fifo[radio->regs[REG_FIFO_ADDR_PTR]++];
+  }
+  if (address == REG_RSSI_WIDEBAND && in_rx_mode(radio)) {
+    // noise, xorshift, with the receiver running, otherwise it holds still
+    radio->random ^= radio->random << 13;
+    radio->random ^= radio->random >> 17;
+    radio->random ^= radio->random << 5;
+    return radio->random & 0xFF;
+  }
+  return radio->regs[address];
+}
+
+static void on_select(void *context) {
+  sim_rfm95 *radio = context;
+  sim_rfm95_update(radio);
+  radio->byte_index = 0;
+}
+
+static uint8_t on_exchange(void *context, uint8_t mosi) {
+  sim_rfm95 *radio = context;
+  if (radio->byte_index++ == 0) {
+    radio->write = mosi & 0x80;
+    radio->address = mosi & 0x7F;
+    return 0;
+  }
+  uint8_t address = radio->address;
+  // bursts auto increment, except on the FIFO which moves its own pointer
+  if (address != REG_FIFO) {
+    radio->address = (radio->address + 1) & 0x7F;
+  }
+  if (radio->write) {
+    write_register(radio, address, mosi);
+    return 0;
+  }
+  return read_register(radio, address);
+}
+
+void sim_rfm95_init(sim_rfm95 *radio) {
+  memset(radio, 0, sizeof(*radio));
+  // SX1276 reset values for the registers the driver cares about
+  radio->regs[REG_OP_MODE] = 0x09; // FSK standby
+  radio->regs[REG_FRF_MSB] = 0x6C; // 434 MHz
+  radio->regs[REG_FRF_MID] = 0x80;
+  radio->regs[REG_FIFO_TX_BASE_ADDR] = 0x80;
+  radio->regs[REG_MODEM_CONFIG_1] = 0x72;
+  radio->regs[REG_MODEM_CONFIG_2] = 0x70;
+  radio->regs[REG_PREAMBLE_LSB] = 0x08;
+  radio->regs[REG_PAYLOAD_LENGTH] = 0x01;
+  radio->regs[REG_SYMB_TIMEOUT_LSB] = 0x64;
+  radio->regs[REG_MODEM_CONFIG_3] = 0x00;
+  radio->regs[REG_VERSION] = 0x12;
+  radio->regs[REG_PA_CONFIG] = 0x4F;
+  radio->regs[REG_PA_DAC] = 0x84;
+  // and the FSK ones: 4.8 kbps, 5 kHz deviation, 3 bytes of preamble
+  radio->regs[FSK_REG_BITRATE_MSB] = 0x1A;
+  radio->regs[FSK_REG_BITRATE_LSB] = 0x0B;
+  radio->regs[FSK_REG_FDEV_LSB] = 0x52;
+  radio->fsk_regs[FSK_REG_RX_BW] = 0x05;
+  radio->fsk_regs[FSK_REG_PREAMBLE_LSB] = 0x03;
+  radio->fsk_regs[FSK_REG_FIFO_THRESH] = 0x0F;
+  radio->random = 0x2545f491;
+  radio->joined = -1;
+}
+
+// LoRa flags on DIO0 to DIO3 for each RegDioMapping1 setting, page 46
+static const uint8_t DIO_FLAGS[4][4] = {
+    {IRQ_RX_DONE, IRQ_TX_DONE, IRQ_CAD_DONE, 0},
+    {IRQ_RX_TIMEOUT, IRQ_FHSS_CHANGE_CHANNEL, IRQ_CAD_DETECTED, 0},
+    {IRQ_FHSS_CHANGE_CHANNEL, IRQ_FHSS_CHANGE_CHANNEL, IRQ_FHSS_CHANGE_CHANNEL,
+     0},
+    {IRQ_CAD_DONE, IRQ_VALID_HEADER, IRQ_PAYLOAD_CRC_ERROR, 0},
+};
+
+bool sim_rfm95_dio(sim_rfm95 *radio, uint8_t pin) {
+  sim_rfm95_update(radio);
+  if (fsk_mode(radio)) {
+    if (pin != 0) {
+      return false;
+    }
+    // mapping 00: PacketSent in TX, PayloadReady otherwise
+    uint8_t flag = (radio->regs[REG_OP_MODE] & MODE_MASK) == MODE_TX
+                       ? FSK_IRQ_PACKET_SENT
+                       : FSK_IRQ_PAYLOAD_READY;
+    return (radio->fsk_irq_flags & flag) != 0;
+  }
+  uint8_t mapping = radio->regs[REG_DIO_MAPPING_1] >> (6 - 2 * pin) & 0x03;
+  return (radio->regs[REG_IRQ_FLAGS] & DIO_FLAGS[pin][mapping]) != 0;
+}
+
+static bool dio0(void *context) { return sim_rfm95_dio(context, 0); }
+
+int sim_rfm95_join(sim_rfm95 *radio, sim_channel *channel) {
+  if (channel->radio_count == SIM_CHANNEL_RADIOS) {
+    return -1;
+  }
+  radio->channel = channel;
+  radio->joined = channel->radio_count;
+  channel->radios[channel->radio_count++] = radio;
+  return radio->joined;
+}
+
+void sim_rfm95_write(sim_rfm95 *radio, uint8_t address, uint8_t value) {
+  sim_rfm95_update(radio);
+  write_register(radio, address & 0x7F, value);
+}
+
+uint8_t sim_rfm95_read(sim_rfm95 *radio, uint8_t address) {
+  sim_rfm95_update(radio);
+  return read_register(radio, address & 0x7F);
+}
+
+void sim_rfm95_attach(sim_rfm95 *radio) {
+  sim_spi_device device = {radio, on_select, on_exchange, NULL};
+  sim_spi_attach(&SPI_1, LORA_CS, &device);
+  sim_gpio_input(LORA_INT, dio0, radio);
+}
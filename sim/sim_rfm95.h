@@ -0,0 +1,176 @@
+/*
+ * sim_rfm95.h
+ *
+ * Created: 10/19/2026
+ *
+ * RFM95 (SX1276 LoRa mode) on the simulated SPI_1. Keeps the register file
+ * and 256 byte FIFO, transmits PAYLOAD_LENGTH bytes from FIFO_TX_BASE_ADDR
+ * when put in TX, and finishes after the time on air given by the modem
+ * config registers.
+ *
+ * Like the SX1276, the LoRa FIFO doesn't take writes while a packet is going
+ * out, they are dropped and counted in fifo_tx_writes.
+ *
+ * Packets from the ground are handed over with sim_rfm95_deliver. One is
+ * received if the radio was in an RX mode with compatible modem settings
+ * (lora_modem_compatible) for its whole time on air and arrives above the
+ * demodulator's SNR limit. It lands in the FIFO at FIFO_RX_BASE_ADDR with
+ * RxDone raised on DIO0 (LORA_INT). Anything else is counted as missed.
+ *
+ * With LongRangeMode clear (it only changes going into or out of sleep) the
+ * FSK packet engine takes over registers 0x0d to 0x3f and a 64 byte FIFO.
+ * Variable length packets go out as the FIFO drains at the bit rate; a byte
+ * written after its turn on air is an underrun and the packet goes out
+ * garbled. PacketSent and PayloadReady are on DIO0, and FSK packets
+ * (sim_rfm95_deliver_fsk) are only heard in FSK mode and the other way round.
+ *
+ * On a channel (sim_channel.h) its packets go on air for everyone else, and
+ * CAD mode looks for LoRa on the same spreading factor and bandwidth there
+ * or coming in, for two symbols before raising CadDone (and CadDetected).
+ * Joined to it, it sends to and hears the other radios joined, LoRa packets
+ * from the moment they start and FSK ones once all of them went out.
+ *
+ * Received LoRa packets go in the FIFO from FIFO_RX_BASE_ADDR on going into
+ * RX, and one after the other in RX continuous, with FIFO_RX_CURRENT_ADDR at
+ * the last one's start and FIFO_RX_BYTE_ADDR past its end. IRQ flags set in
+ * IRQ_FLAGS_MASK are never raised. DIO0 to DIO3 follow DIO_MAPPING_1 for
+ * the LoRa flags, sim_rfm95_dio reads them for a radio off the bus.
+ *
+ * Only packets on the frequency in the FRF registers are heard or detected,
+ * and a packet goes out on the one set when it starts.
+ */
+
+#ifndef SIM_RFM95_H_
+#define SIM_RFM95_H_
+
+#include "fsk_modem.h"
+#include "lora_modem.h"
+#include "sim_channel.h"
+#include "sim_hal.h"
+
+typedef void (*sim_rfm95_transmit)(void *context, const uint8_t *data,
+                                   uint8_t length, uint64_t start_us,
+                                   uint64_t airtime_us);
+
+#define SIM_RFM95_INCOMING 4
+
+typedef struct sim_rfm95_incoming {
+  uint8_t data[256];
+  uint8_t length;
+  bool fsk;
+  lora_modem modem; // the sender's
+  uint32_t frf;
+  fsk_modem fsk_modem;
+  uint64_t start_us;
+  uint64_t end_us;
+  int16_t rssi_dbm;
+  int8_t snr_db;
+  bool over_air; // from a joined radio, can collide
+  uint8_t source;
+} sim_rfm95_incoming;
+
+#define SIM_RFM95_FSK_FIFO 64
+
+typedef struct sim_rfm95 {
+  uint8_t regs[128];
+  uint8_t fifo[256];
+
+  // FSK page of registers 0x0d to 0x3f, and its FIFO
+  uint8_t fsk_regs[0x40];
+  uint8_t fsk_fifo[SIM_RFM95_FSK_FIFO];
+  uint8_t fsk_fifo_first;
+  uint8_t fsk_fifo_count;
+  uint8_t fsk_irq_flags; // PacketSent, PayloadReady, CrcOk, FifoOverrun
+  // bytes of the packet going out so far, length byte included
+  uint16_t tx_written;
+  bool tx_underrun;
+
+  // SPI transaction state
+  int byte_index;
+  uint8_t address;
+  bool write;
+
+  bool transmitting;
+  uint64_t tx_start_us;
+  uint64_t tx_end_us;
+  uint8_t tx_length;
+  uint8_t tx_data[256];
+
+  sim_rfm95_transmit on_transmit;
+  void *transmit_context;
+  sim_channel *channel; // NULL for a private link to the ground
+  uint8_t source; // who it is on the channel
+  int joined; // its number among the channel's radios, -1 if not
+
+  bool detecting; // in CAD mode
+  uint64_t cad_start_us;
+  uint64_t cad_end_us;
+  uint32_t random; // for the wideband RSSI's noise
+
+  bool receiving;
+  uint64_t rx_since_us; // when the current RX mode was entered
+  uint8_t rx_byte_addr; // where the next packet received goes
+  sim_rfm95_incoming incoming[SIM_RFM95_INCOMING];
+  uint8_t incoming_count;
+
+  uint32_t packets;
+  uint32_t aborted; // TX cut short by a mode change
+  uint32_t underruns; // FSK packets the FIFO ran dry on
+  uint32_t fifo_tx_writes; // LoRa FIFO writes in TX, dropped
+  uint64_t bytes;
+  uint64_t airtime_us;
+
+  uint32_t received;
+  uint32_t missed; // not listening, or listening with other settings
+  uint32_t collided; // from joined radios, someone else on air too
+  uint32_t rx_timeouts;
+  uint32_t cad_runs;
+  uint32_t cad_detected;
+  uint64_t rx_us; // total time spent in RX modes
+} sim_rfm95;
+
+void sim_rfm95_init(sim_rfm95 *radio);
+// attach to SPI_1 / LORA_CS
+void sim_rfm95_attach(sim_rfm95 *radio);
+// finish anything that is due by now
+void sim_rfm95_update(sim_rfm95 *radio);
+/*
+Onto channel as its next radio, sending to and hearing the others already
+joined (sim_channel_link for how well). Returns its number there for the
+links, -1 if SIM_CHANNEL_RADIOS already have.
+*/
+int sim_rfm95_join(sim_rfm95 *radio, sim_channel *channel);
+
+// register access for a radio driven directly rather than over SPI_1
+void sim_rfm95_write(sim_rfm95 *radio, uint8_t address, uint8_t value);
+uint8_t sim_rfm95_read(sim_rfm95 *radio, uint8_t address);
+// DIO0 to DIO3
+bool sim_rfm95_dio(sim_rfm95 *radio, uint8_t pin);
+
+// time on air for a payload with the current modem config registers, from
+// lora_airtime_us like the firmware's own estimate
+uint64_t sim_rfm95_airtime_us(const sim_rfm95 *radio, uint8_t length);
+
+/*
+A packet (RadioHead header included) sent by someone else with the given
+modem settings on frf, starting on air at start_us. Returns false if too
+many are already on their way.
+*/
+bool sim_rfm95_deliver(sim_rfm95 *radio, const uint8_t *data, uint8_t length,
+                       const lora_modem *modem, uint32_t frf,
+                       uint64_t start_us, int16_t rssi_dbm, int8_t snr_db);
+// the same in FSK
+bool sim_rfm95_deliver_fsk(sim_rfm95 *radio, const uint8_t *data,
+                           uint8_t length, const fsk_modem *modem,
+                           uint32_t frf, uint64_t start_us, int16_t rssi_dbm,
+                           int8_t snr_db);
+// the FRF registers, where it's sending or listening
+uint32_t sim_rfm95_frf(const sim_rfm95 *radio);
+// the radio's current modem settings, for sending it something it can hear
+void sim_rfm95_modem(const sim_rfm95 *radio, lora_modem *modem);
+// true in FSK mode, with its settings
+bool sim_rfm95_fsk(const sim_rfm95 *radio, fsk_modem *modem);
+// output power on PA_BOOST from PA_CONFIG and PA_DAC
+int sim_rfm95_tx_power_dbm(const sim_rfm95 *radio);
+
+#endif /* SIM_RFM95_H_ */
@@ -0,0 +1,359 @@
+/*
+ * sim_w25.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "sim_w25.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum {
+  CMD_WRITE_ENABLE = 0x06,
+  CMD_WRITE_DISABLE = 0x04,
+  CMD_READ_STATUS_1 = 0x05,
+  CMD_READ_STATUS_2 = 0x35,
+  CMD_READ_DATA = 0x03,
+  CMD_PAGE_PROGRAM = 0x02,
+  CMD_SECTOR_ERASE = 0x20,
+  CMD_CHIP_ERASE = 0xC7,
+  CMD_CHIP_ERASE_ALT = 0x60,
+  CMD_SUSPEND = 0x75,
+  CMD_RESUME = 0x7A,
+  CMD_RELEASE_POWER_DOWN = 0xAB,
+  CMD_MANUFACTURER_ID = 0x90,
+  CMD_JEDEC_ID = 0x9F,
+};
+
+// W25Q64FV datasheet typical timings
+static const uint64_t PAGE_PROGRAM_US = 700;
+static const uint64_t SECTOR_ERASE_US = 45000;
+static const uint64_t CHIP_ERASE_US = 20000000;
+/*
+tSUS, from the suspend command to BUSY going low, and the least from a
+resume to the next suspend
+*/
+static const uint64_t SUSPEND_US = 20;
+
+static const uint8_t STATUS_2_SUSPENDED = 0x80;
+
+static const uint8_t MANUFACTURER = 0xEF;
+static const uint8_t DEVICE_ID = 0x16;
+static const uint8_t JEDEC_ID[] = {0xEF, 0x70, 0x17};
+
+static bool busy(const sim_w25 *flash) {
+  return sim_time_us() < flash->busy_until_us;
+}
+
+static void start_busy(sim_w25 *flash, uint64_t us) {
+  flash->busy_until_us = sim_time_us() + us;
+  flash->busy_us += us;
+  flash->write_enabled = false;
+  flash->erasing = false;
+  flash->resumed = false;
+}
+
+// a sector erase is going, one that can be suspended
+static bool erase_busy(const sim_w25 *flash) {
+  return busy(flash) && flash->erasing;
+}
+
+// the sector being erased, while it's suspended
+static bool in_suspended_sector(const sim_w25 *flash, uint32_t address) {
+  return flash->suspended &&
+         address / SIM_W25_SECTOR_SIZE ==
+             flash->suspended_address / SIM_W25_SECTOR_SIZE;
+}
+
+// what the chip takes while an erase is suspended
+static bool allowed_suspended(uint8_t command) {
+  return command != CMD_SECTOR_ERASE && command != CMD_CHIP_ERASE &&
+         command != CMD_CHIP_ERASE_ALT && command != CMD_SUSPEND;
+}
+
+/*
+Byte by byte programming (AND with value) or erasing (value 0xFF) of
+length bytes from address, as far as the power lasts. Returns false if it
+went part way.
+*/
+static bool touch(sim_w25 *flash, uint32_t address, uint8_t value,
+                  uint32_t length, bool erase) {
+  uint64_t left = flash->cut_at - flash->work;
+  if (left >= length) {
+    if (erase) {
+      memset(&flash->memory[address], 0xFF, length);
+    } else {
+      flash->memory[address] &= value;
+    }
+    flash->work += length;
+    return true;
+  }
+  if (erase) {
+    memset(&flash->memory[address], 0xFF, left);
+  }
+  // xorshift, the bits that flipped before the power went
+  flash->random ^= flash->random << 13;
+  flash->random ^= flash->random >> 17;
+  flash->random ^= flash->random << 5;
+  uint8_t *torn = &flash->memory[address + left];
+  if (erase) {
+    *torn |= flash->random;
+  } else {
+    *torn &= value | flash->random;
+  }
+  flash->work += left;
+  flash->powered = false;
+  flash->power_losses++;
+  return false;
+}
+
+static void on_select(void *context) {
+  sim_w25 *flash = context;
+  flash->byte_index = 0;
+  flash->programming = false;
+}
+
+static uint8_t on_exchange(void *context, uint8_t mosi) {
+  sim_w25 *flash = context;
+  int index = flash->byte_index++;
+  if (!flash->powered) {
+    flash->command = 0;
+    return 0x00;
+  }
+
+  if (index == 0) {
+    flash->command = mosi;
+    flash->address = 0;
+    if (busy(flash) && mosi != CMD_READ_STATUS_1 &&
+        mosi != CMD_READ_STATUS_2 &&
+        !(mosi == CMD_SUSPEND && erase_busy(flash))) {
+      flash->command = 0; // ignored while busy
+    }
+    if (flash->suspended && !allowed_suspended(flash->command)) {
+      flash->command = 0;
+    }
+    switch (flash->command) {
+    case CMD_WRITE_ENABLE:
+      flash->write_enabled = true;
+      break;
+    case CMD_WRITE_DISABLE:
+      flash->write_enabled = false;
+      break;
+    case CMD_PAGE_PROGRAM:
+      memset(flash->latched, 0, sizeof(flash->latched));
+      flash->programming = flash->write_enabled;
+      break;
+    }
+    return 0xFF;
+  }
+
+  switch (flash->command) {
+  case CMD_READ_STATUS_1:
+    return (busy(flash) ? 0x01 : 0) | (flash->write_enabled ? 0x02 : 0);
+
+  case CMD_READ_STATUS_2:
+    return flash->suspended ? STATUS_2_SUSPENDED : 0x00;
+
+  case CMD_JEDEC_ID:
+    return index <= 3 ? JEDEC_ID[index - 1] : 0xFF;
+
+  case CMD_RELEASE_POWER_DOWN:
+    // three dummy bytes, then the device ID repeats
+    return index >= 4 ? DEVICE_ID : 0xFF;
+
+  case CMD_MANUFACTURER_ID:
+    if (index <= 3) {
+      flash->address = (flash->address << 8) | mosi;
+      return 0x00;
+    }
+    // an odd address swaps the order to device ID first
+    return ((flash->address ^ (index - 4)) & 1) ? DEVICE_ID : MANUFACTURER;
+
+  case CMD_READ_DATA:
+  case CMD_PAGE_PROGRAM:
+  case CMD_SECTOR_ERASE:
+    if (index <= 3) {
+      flash->address = (flash->address << 8) | mosi;
+      return 0xFF;
+    }
+    if (flash->command == CMD_READ_DATA) {
+      if (in_suspended_sector(flash, flash->address % SIM_W25_SIZE)) {
+        flash->suspend_violations++; // half erased on the real chip
+      }
+      uint8_t value = flash->memory[flash->address % SIM_W25_SIZE];
+      flash->address = (flash->address + 1) % SIM_W25_SIZE;
+      flash->bytes_read++;
+      return value;
+    }
+    if (flash->command == CMD_PAGE_PROGRAM && flash->programming) {
+      uint8_t offset = (uint8_t)(flash->address + (index - 4));
+      flash->latch[offset] = mosi;
+      flash->latched[offset] = true;
+    }
+    return 0xFF;
+  }
+  return 0xFF;
+}
+
+static void on_deselect(void *context) {
+  sim_w25 *flash = context;
+  if (flash->byte_index == 0 || !flash->powered) {
+    return;
+  }
+
+  switch (flash->command) {
+  case CMD_PAGE_PROGRAM:
+    if (flash->programming && flash->byte_index > 4) {
+      uint32_t page = (flash->address % SIM_W25_SIZE) & ~(SIM_W25_PAGE_SIZE - 1);
+      if (in_suspended_sector(flash, page)) {
+        flash->suspend_violations++; // the datasheet doesn't allow it
+        break;
+      }
+      for (int i = 0; i < SIM_W25_PAGE_SIZE; i++) {
+        if (flash->latched[i]) {
+          if (!touch(flash, page + i, flash->latch[i], 1, false)) {
+            return;
+          }
+          flash->bytes_programmed++;
+        }
+      }
+      flash->page_programs++;
+      start_busy(flash, PAGE_PROGRAM_US);
+    }
+    break;
+
+  case CMD_SECTOR_ERASE:
+    if (flash->write_enabled && flash->byte_index >= 4) {
+      uint32_t sector =
+          (flash->address % SIM_W25_SIZE) & ~(SIM_W25_SECTOR_SIZE - 1);
+      if (!touch(flash, sector, 0xFF, SIM_W25_SECTOR_SIZE, true)) {
+        return;
+      }
+      flash->sector_erases++;
+      start_busy(flash, SECTOR_ERASE_US);
+      flash->erasing = true;
+      flash->erase_address = sector;
+    }
+    break;
+
+  case CMD_SUSPEND:
+    if (!erase_busy(flash)) {
+      break; // finished while the command went in
+    }
+    // the erase keeps what it's done, the time left waits for the resume
+    if (flash->resumed && sim_time_us() - flash->resumed_us < SUSPEND_US) {
+      flash->suspend_violations++; // too soon, it got nowhere
+    } else {
+      flash->erase_left_us = flash->busy_until_us - sim_time_us();
+    }
+    flash->suspended_address = flash->erase_address;
+    flash->suspended = true;
+    flash->erasing = false;
+    flash->busy_until_us = sim_time_us() + SUSPEND_US;
+    flash->busy_us += SUSPEND_US;
+    flash->suspends++;
+    break;
+
+  case CMD_RESUME:
+    if (flash->suspended) {
+      flash->suspended = false;
+      flash->erasing = true;
+      flash->busy_until_us = sim_time_us() + flash->erase_left_us;
+      flash->resumed = true;
+      flash->resumed_us = sim_time_us();
+      flash->resumes++;
+    }
+    break;
+
+  case CMD_CHIP_ERASE:
+  case CMD_CHIP_ERASE_ALT:
+    if (flash->write_enabled) {
+      if (!touch(flash, 0, 0xFF, SIM_W25_SIZE, true)) {
+        return;
+      }
+      flash->chip_erases++;
+      start_busy(flash, CHIP_ERASE_US);
+    }
+    break;
+  }
+  flash->programming = false;
+}
+
+void sim_w25_init(sim_w25 *flash) {
+  memset(flash, 0, sizeof(*flash));
+  flash->memory = malloc(SIM_W25_SIZE);
+  if (flash->memory == NULL) {
+    fprintf(stderr, "sim_w25: out of memory\n");
+    exit(1);
+  }
+  memset(flash->memory, 0xFF, SIM_W25_SIZE);
+  flash->cut_at = UINT64_MAX;
+  flash->powered = true;
+  flash->random = 0x6b43a9b5;
+}
+
+bool sim_w25_init_file(sim_w25 *flash, const char *path) {
+  memset(flash, 0, sizeof(*flash));
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  bool created = fstat(fd, &st) == 0 && st.st_size == 0;
+  if (created && ftruncate(fd, SIM_W25_SIZE) != 0) {
+    close(fd);
+    return false;
+  }
+  if (!created && st.st_size != SIM_W25_SIZE) {
+    close(fd);
+    return false;
+  }
+  void *memory =
+      mmap(NULL, SIM_W25_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd); // the mapping keeps it open
+  if (memory == MAP_FAILED) {
+    return false;
+  }
+  flash->memory = memory;
+  flash->mapped = true;
+  if (created) {
+    memset(flash->memory, 0xFF, SIM_W25_SIZE);
+  }
+  flash->cut_at = UINT64_MAX;
+  flash->powered = true;
+  flash->random = 0x6b43a9b5;
+  return true;
+}
+
+void sim_w25_free(sim_w25 *flash) {
+  if (flash->mapped) {
+    munmap(flash->memory, SIM_W25_SIZE);
+  } else {
+    free(flash->memory);
+  }
+  flash->memory = NULL;
+}
+
+void sim_w25_cut_power(sim_w25 *flash, uint64_t bytes) {
+  flash->cut_at = flash->work + bytes;
+}
+
+void sim_w25_power_on(sim_w25 *flash) {
+  flash->powered = true;
+  flash->cut_at = UINT64_MAX;
+  flash->write_enabled = false;
+  flash->programming = false;
+  flash->busy_until_us = 0;
+  flash->erasing = false;
+  flash->suspended = false;
+}
+
+void sim_w25_attach(sim_w25 *flash) {
+  sim_spi_device device = {flash, on_select, on_exchange, on_deselect};
+  sim_spi_attach(&SPI_0, FLASH_CS, &device);
+}
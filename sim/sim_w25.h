@@ -0,0 +1,93 @@
+/*
+ * sim_w25.h
+ *
+ * Created: 10/19/2026
+ *
+ * W25Q64 on the simulated SPI_0. NOR semantics: programming ANDs into the
+ * array and wraps within the page, erasing sets 0xFF, and the chip reports
+ * BUSY for the typical program/erase times. A sector erase can be suspended
+ * (0x75) and resumed (0x7A), SUS in status register 2 while it is; reading or
+ * programming the sector being erased meanwhile is counted as a violation,
+ * the real chip leaves it undefined. So is a suspend within tSUS of the last
+ * resume, which the datasheet forbids; the erase makes no progress then.
+ *
+ * The array is in memory, or memory mapped from a file with
+ * sim_w25_init_file so it outlives the process like the real chip outlives
+ * a reset.
+ *
+ * sim_w25_cut_power makes the power go at a chosen byte of programming or
+ * erasing, counting every byte each page program and erase touches in
+ * order from the first. Bytes before it are done, the one it lands on is
+ * left with only some of its bits flipped and the rest untouched, as a
+ * brown-out midway would leave them. Until sim_w25_power_on the chip takes
+ * no commands and reads back zeros (never BUSY, so the firmware doesn't
+ * hang waiting on it).
+ */
+
+#ifndef SIM_W25_H_
+#define SIM_W25_H_
+
+#include "sim_hal.h"
+
+#define SIM_W25_SIZE (8u * 1024 * 1024)
+#define SIM_W25_PAGE_SIZE 256
+#define SIM_W25_SECTOR_SIZE 4096
+
+typedef struct sim_w25 {
+  uint8_t *memory;
+
+  // SPI transaction state
+  int byte_index;
+  uint8_t command;
+  uint32_t address;
+  bool write_enabled;
+
+  // page program latch, committed when CS goes high
+  uint8_t latch[SIM_W25_PAGE_SIZE];
+  bool latched[SIM_W25_PAGE_SIZE];
+  bool programming;
+
+  uint64_t busy_until_us;
+  bool erasing; // the busy time is a sector erase, at erase_address
+  uint32_t erase_address;
+  bool suspended;
+  uint32_t suspended_address;
+  uint64_t erase_left_us;
+  bool resumed; // the erase going was resumed at resumed_us
+  uint64_t resumed_us;
+
+  bool mapped; // memory is a file mapping
+  uint64_t work; // bytes programmed or erased so far
+  uint64_t cut_at; // work the power goes at, UINT64_MAX for never
+  bool powered;
+  uint32_t random; // which bits of a torn byte made it
+
+  uint32_t page_programs;
+  uint64_t bytes_programmed;
+  uint32_t sector_erases;
+  uint32_t chip_erases;
+  uint64_t bytes_read;
+  uint64_t busy_us; // total time spent programming/erasing
+  uint32_t power_losses;
+  uint32_t suspends;
+  uint32_t resumes;
+  uint32_t suspend_violations;
+} sim_w25;
+
+// the array starts erased
+void sim_w25_init(sim_w25 *flash);
+/*
+The array memory mapped from path, created erased if it doesn't exist.
+Returns false if the file can't be opened or is the wrong size.
+*/
+bool sim_w25_init_file(sim_w25 *flash, const char *path);
+void sim_w25_free(sim_w25 *flash);
+
+// power goes after bytes more of programming or erasing
+void sim_w25_cut_power(sim_w25 *flash, uint64_t bytes);
+// back on after a cut, the array as the cut left it
+void sim_w25_power_on(sim_w25 *flash);
+// attach to SPI_0 / FLASH_CS
+void sim_w25_attach(sim_w25 *flash);
+
+#endif /* SIM_W25_H_ */
@@ -0,0 +1,178 @@
+/*
+ * trace.c
+ *
+ * Created: 10/19/2026
+ */
+
+#include "trace.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const double SEA_LEVEL_PA = 101325.0;
+static const double GROUND_ALTITUDE_M = 50.0;
+static const double SAMPLE_RATE_HZ = 10.0;
+
+static const char *const NAMES[TRACE_KIND_COUNT] = {
+    "pad_idle",
+    "fast_ascent",
+    "long_soaring",
+    "landing",
+};
+
+static const double DURATIONS_S[TRACE_KIND_COUNT] = {
+    30 * 60,
+    4 * 60,
+    2 * 60 * 60,
+    10 * 60,
+};
+
+double trace_altitude_to_pressure(double altitude_m) {
+  return SEA_LEVEL_PA * pow(1.0 - altitude_m / 44330.0, 5.255);
+}
+
+// xorshift, so every run of a canonical trace is identical
+static double noise(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return (double)x / UINT32_MAX * 2.0 - 1.0;
+}
+
+static double smoothstep(double t) {
+  if (t <= 0) {
+    return 0;
+  }
+  if (t >= 1) {
+    return 1;
+  }
+  return t * t * (3 - 2 * t);
+}
+
+// height above the field for each canonical flight
+static double height_m(trace_kind kind, double t, double *wander,
+                       uint32_t *state) {
+  switch (kind) {
+  case TRACE_PAD_IDLE:
+    return 0;
+  case TRACE_FAST_ASCENT:
+    // ~10 s on the pad, then 300 m in about a minute
+    return 300.0 * smoothstep((t - 10.0) / 60.0);
+  case TRACE_LONG_SOARING: {
+    // climb out, then gusts and thermals on top of a slow random walk
+    *wander += noise(state) * 0.4;
+    *wander *= 0.999;
+    double climb = smoothstep(t / 90.0);
+    double h = 225.0 + 60.0 * sin(t / 600.0) + 15.0 * sin(t / 37.0) + *wander;
+    return climb * h;
+  }
+  case TRACE_LANDING:
+    // 200 m down to the ground over three minutes
+    return 200.0 * (1.0 - smoothstep((t - 20.0) / 180.0));
+  default:
+    return 0;
+  }
+}
+
+void trace_synthetic(trace *trace, trace_kind kind) {
+  memset(trace, 0, sizeof(*trace));
+  snprintf(trace->name, sizeof(trace->name), "%s", NAMES[kind]);
+  trace->count = (size_t)(DURATIONS_S[kind] * SAMPLE_RATE_HZ) + 1;
+  trace->samples = calloc(trace->count, sizeof(trace_sample));
+
+  uint32_t state = 0x12345678u + (uint32_t)kind;
+  double wander = 0;
+  for (size_t i = 0; i < trace->count; i++) {
+    double t = i / SAMPLE_RATE_HZ;
+    double h = height_m(kind, t, &wander, &state);
+    // a little turbulence and sensor noise everywhere
+    double altitude = GROUND_ALTITUDE_M + h + noise(&state) * 0.15;
+    trace_sample *s = &trace->samples[i];
+    s->time_s = t;
+    s->pressure_pa = trace_altitude_to_pressure(altitude);
+    s->temperature_c = 21.0 - 0.0065 * h + noise(&state) * 0.05;
+    s->battery_v = 4.15 - 0.35 * (t / (3 * 60 * 60));
+  }
+}
+
+int trace_load_csv(trace *trace, const char *path) {
+  memset(trace, 0, sizeof(*trace));
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    return -1;
+  }
+  const char *base = strrchr(path, '/');
+  snprintf(trace->name, sizeof(trace->name), "%s", base ? base + 1 : path);
+
+  size_t capacity = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    trace_sample s = {0, 0, 0, 3.9};
+    int fields = sscanf(line, "%lf,%lf,%lf,%lf", &s.time_s, &s.pressure_pa,
+                        &s.temperature_c, &s.battery_v);
+    if (fields < 3) {
+      continue;
+    }
+    if (trace->count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      trace_sample *grown =
+          realloc(trace->samples, capacity * sizeof(trace_sample));
+      if (grown == NULL) {
+        fclose(file);
+        trace_free(trace);
+        return -1;
+      }
+      trace->samples = grown;
+    }
+    trace->samples[trace->count++] = s;
+  }
+  fclose(file);
+  return trace->count > 0 ? 0 : -1;
+}
+
+void trace_free(trace *trace) {
+  free(trace->samples);
+  trace->samples = NULL;
+  trace->count = 0;
+}
+
+double trace_duration_s(const trace *trace) {
+  if (trace->count == 0) {
+    return 0;
+  }
+  return trace->samples[trace->count - 1].time_s - trace->samples[0].time_s;
+}
+
+trace_sample trace_at(const trace *trace, double time_s) {
+  const trace_sample *s = trace->samples;
+  time_s += s[0].time_s;
+  if (time_s <= s[0].time_s) {
+    return s[0];
+  }
+  if (time_s >= s[trace->count - 1].time_s) {
+    return s[trace->count - 1];
+  }
+  size_t low = 0;
+  size_t high = trace->count - 1;
+  while (high - low > 1) {
+    size_t middle = (low + high) / 2;
+    if (s[middle].time_s <= time_s) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  double span = s[high].time_s - s[low].time_s;
+  double f = span > 0 ? (time_s - s[low].time_s) / span : 0;
+  trace_sample out;
+  out.time_s = time_s;
+  out.pressure_pa = s[low].pressure_pa + f * (s[high].pressure_pa - s[low].pressure_pa);
+  out.temperature_c =
+      s[low].temperature_c + f * (s[high].temperature_c - s[low].temperature_c);
+  out.battery_v = s[low].battery_v + f * (s[high].battery_v - s[low].battery_v);
+  return out;
+}
@@ -0,0 +1,54 @@
+/*
+ * trace.h
+ *
+ * Created: 10/19/2026
+ *
+ * Pressure/temperature/battery traces to replay through the simulated
+ * BMP388 and ADC, either loaded from CSV or one of the canonical synthetic
+ * flights.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stddef.h>
+
+typedef struct trace_sample {
+  double time_s;
+  double pressure_pa;
+  double temperature_c;
+  double battery_v;
+} trace_sample;
+
+typedef struct trace {
+  char name[64];
+  size_t count;
+  trace_sample *samples; // sorted by time
+} trace;
+
+typedef enum trace_kind {
+  TRACE_PAD_IDLE,     // sitting on the field
+  TRACE_FAST_ASCENT,  // launch and a hard climb to 300 m
+  TRACE_LONG_SOARING, // two hours wandering between 150 and 300 m
+  TRACE_LANDING,      // descent from 200 m and some time on the ground
+  TRACE_KIND_COUNT
+} trace_kind;
+
+void trace_synthetic(trace *trace, trace_kind kind);
+
+/*
+Load "time_s,pressure_pa,temperature_c[,battery_v]" rows, lines that don't
+parse are skipped. Returns 0 on success.
+*/
+int trace_load_csv(trace *trace, const char *path);
+
+void trace_free(trace *trace);
+
+double trace_duration_s(const trace *trace);
+// time_s is from the start of the trace, linear interpolation clamped to the ends
+trace_sample trace_at(const trace *trace, double time_s);
+
+// standard atmosphere, shared with anything that wants to go back to metres
+double trace_altitude_to_pressure(double altitude_m);
+
+#endif /* TRACE_H_ */